@@ -0,0 +1,140 @@
+/*
+ * Write a 'compile_commands.json' for the gen-make program (option '--emit compdb').
+ *
+ * A Clang compilation database for clangd, clang-tidy etc. without running
+ * a build. One entry for each source:
+ *   { "directory": "c:/src/foo",
+ *     "file": "src/foo.c",
+ *     "output": "objects/foo.obj",
+ *     "arguments": ["cl", "-nologo", ..., "-c", "src/foo.c", "-Foobjects/foo.obj"] }
+ *
+ * The JSON is streamed into an 'out_buf'. The escaped "directory" and the
+ * compiler and flags in "arguments" are the same in all entries; so these
+ * are made once for C and once for C++. An entry is then a few 'buf_add()'
+ * of prepared text; and the escaping of the file and object names.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "gen-make.h"
+#include "smartlist.h"
+#include "strmap.h"
+#include "outbuf.h"
+#include "tools.h"
+#include "compdb.h"
+
+/*
+ * Add 'len' bytes of 'str' as the inside of a JSON string.
+ */
+static void put_json (out_buf *out, const char *str, size_t len)
+{
+  const char *end = str + len;
+  const char *run = str;
+
+  for ( ; str < end; str++)
+  {
+    unsigned char c = *(const unsigned char*) str;
+
+    if (c >= 0x20 && c != '"' && c != '\\')
+       continue;
+    buf_add (out, run, str - run);
+    if (c == '"' || c == '\\')
+         buf_printf (out, "\\%c", c);
+    else buf_printf (out, "\\u%04x", c);
+    run = str + 1;
+  }
+  buf_add (out, run, end - run);
+}
+
+/*
+ * Make the '"arguments": ["cc", "flag", ...' start of an entry for 'cc'
+ * and the space separated 'flags'.
+ */
+static void make_args (out_buf *out, const char *cc, const char *flags)
+{
+  const char *p = flags, *start;
+
+  buf_puts (out, "    \"arguments\": [\"");
+  put_json (out, cc, strlen(cc));
+  buf_putc (out, '"');
+  while (*p)
+  {
+    while (isspace((int)*p))
+       p++;
+    if (!*p)
+       break;
+    for (start = p; *p && !isspace((int)*p); p++)
+        ;
+    buf_puts (out, ", \"");
+    put_json (out, start, p - start);
+    buf_putc (out, '"');
+  }
+}
+
+static bool is_cxx_source (const char *file)
+{
+  const char *dot = strrchr (file, '.');
+
+  return (dot && stricmp(dot, ".c"));
+}
+
+/*
+ * Write the entries for 'sources' into 'out'. 'directory' is where the
+ * sources and the 'tools->obj_dir' are relative to.
+ */
+void compdb_write (out_buf *out, const build_tools *tools, const smartlist_t *inc_dirs,
+                   const char *directory, const smartlist_t *sources)
+{
+  strmap_t *objs = strmap_new (true);
+  out_buf   flags, dir, c_args, cxx_args;
+  char      obj [_MAX_PATH];
+  int       i;
+
+  memset (&flags, '\0', sizeof(flags));
+  memset (&dir, '\0', sizeof(dir));
+  memset (&c_args, '\0', sizeof(c_args));
+  memset (&cxx_args, '\0', sizeof(cxx_args));
+
+  buf_puts (&dir, "  {\n    \"directory\": \"");
+  put_json (&dir, directory, strlen(directory));
+  buf_puts (&dir, "\",\n    \"file\": \"");
+
+  build_tools_cflags (tools, inc_dirs, &flags);
+  make_args (&c_args, tools->cc, flags.data);
+  buf_printf (&flags, " %s", tools->cxxflags);
+  make_args (&cxx_args, tools->cxx, flags.data);
+
+  buf_putc (out, '[');
+  for (i = 0; i < smartlist_len(sources); i++)
+  {
+    const char    *src  = smartlist_get (sources, i);
+    const out_buf *args = is_cxx_source (src) ? &cxx_args : &c_args;
+    size_t         src_len, obj_len;
+
+    build_tools_object (tools, objs, src, obj, sizeof(obj));
+    src_len = strlen (src);
+    obj_len = strlen (obj);
+
+    buf_puts (out, i == 0 ? "\n" : ",\n");
+    buf_add (out, dir.data, dir.size);
+    put_json (out, src, src_len);
+    buf_puts (out, "\",\n    \"output\": \"");
+    put_json (out, obj, obj_len);
+    buf_puts (out, "\",\n");
+    buf_add (out, args->data, args->size);
+    buf_puts (out, ", \"-c\", \"");
+    put_json (out, src, src_len);
+    buf_puts (out, tools->msvc ? "\", \"-Fo" : "\", \"-o\", \"");
+    put_json (out, obj, obj_len);
+    buf_puts (out, "\"]\n  }");
+  }
+  buf_puts (out, "\n]\n");
+
+  buf_free (&cxx_args);
+  buf_free (&c_args);
+  buf_free (&dir);
+  buf_free (&flags);
+  strmap_free (objs, NULL);
+}
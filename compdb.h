@@ -0,0 +1,11 @@
+#ifndef _COMPDB_H
+#define _COMPDB_H
+
+#include "smartlist.h"
+#include "outbuf.h"
+#include "tools.h"
+
+void compdb_write (out_buf *out, const build_tools *tools, const smartlist_t *inc_dirs,
+                   const char *directory, const smartlist_t *sources);
+
+#endif
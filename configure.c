@@ -0,0 +1,236 @@
+/*
+ * Configure a '.h.in' file for the gen-make program.
+ *
+ * Like CMake's 'configure_file()'; the 'vars' are "NAME=value" strings:
+ *   '@NAME@' and '${NAME}'     -> the value (empty if 'NAME' is not defined).
+ *   '#cmakedefine NAME [rest]' -> '#define NAME [rest]' if 'NAME' is true.
+ *                                 a '#undef NAME' comment otherwise.
+ *   '#cmakedefine01 NAME'      -> '#define NAME 1' or '#define NAME 0'.
+ *
+ * The output file is only written if the result differs from what it
+ * already contains. So its time-stamp does not change on a rerun and
+ * nothing that includes it gets rebuilt.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "strmap.h"
+#include "outbuf.h"
+#include "configure.h"
+
+typedef struct configure_ctx {
+        strmap_t   *vars;
+        const char *in_file;
+        unsigned    line;
+        out_buf     buf;
+      } configure_ctx;
+
+/*
+ * Return the value of 'name' or NULL if not defined.
+ */
+static const char *lookup (const configure_ctx *ctx, const char *name, size_t len)
+{
+  char key [256];
+
+  if (len >= sizeof(key))
+     return (NULL);
+  memcpy (key, name, len);
+  key [len] = '\0';
+  return strmap_get (ctx->vars, key);
+}
+
+/*
+ * The same values as CMake's 'if()' treats as false.
+ */
+static bool is_true (const char *value)
+{
+  static const char *false_values[] = { "", "0", "OFF", "NO", "FALSE", "N", "IGNORE", "NOTFOUND" };
+  size_t i, len;
+
+  if (!value)
+     return (false);
+
+  for (i = 0; i < DIM(false_values); i++)
+      if (!stricmp(value, false_values[i]))
+         return (false);
+
+  len = strlen (value);
+  return (len < 9 || stricmp(value + len - 9, "-NOTFOUND") != 0);
+}
+
+/*
+ * Copy 'p ... end-1' to the output with the '@NAME@' and '${NAME}' expanded.
+ */
+static void expand (configure_ctx *ctx, const char *p, const char *end)
+{
+  while (p < end)
+  {
+    const char *name, *q;
+    const char *value;
+    char        close;
+
+    if (*p == '@')
+    {
+      name  = p + 1;
+      close = '@';
+    }
+    else if (*p == '$' && p + 1 < end && p[1] == '{')
+    {
+      name  = p + 2;
+      close = '}';
+    }
+    else
+    {
+      buf_add (&ctx->buf, p++, 1);
+      continue;
+    }
+
+    for (q = name; q < end && is_ident_char(*q); q++)
+        ;
+    if (q == name || q >= end || *q != close)
+    {
+      buf_add (&ctx->buf, p++, 1);
+      continue;
+    }
+
+    value = lookup (ctx, name, q - name);
+    if (value)
+         buf_puts (&ctx->buf, value);
+    else fprintf (stderr, "%s(%u): '%.*s' is not defined.\n", ctx->in_file, ctx->line, (int)(q - name), name);
+    p = q + 1;
+  }
+}
+
+static const char *skip_blanks (const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t'))
+     p++;
+  return (p);
+}
+
+/*
+ * Handle a '#cmakedefine' or '#cmakedefine01' line. Return false if it's not one.
+ * 'eol' is the end of the line without the newline.
+ */
+static bool cmakedefine (configure_ctx *ctx, const char *line, const char *eol)
+{
+  const char *p = skip_blanks (line, eol);
+  const char *keyword, *name, *rest;
+  bool        is_01 = false;
+  size_t      len;
+
+  if (p == eol || *p != '#')
+     return (false);
+
+  keyword = skip_blanks (p + 1, eol);
+  len = eol - keyword;
+  if (len > 13 && !strncmp(keyword, "cmakedefine01", 13) && (keyword[13] == ' ' || keyword[13] == '\t'))
+  {
+    is_01 = true;
+    name = keyword + 13;
+  }
+  else if (len > 11 && !strncmp(keyword, "cmakedefine", 11) && (keyword[11] == ' ' || keyword[11] == '\t'))
+    name = keyword + 11;
+  else
+    return (false);
+
+  name = skip_blanks (name, eol);
+  for (p = name; p < eol && is_ident_char(*p); p++)
+      ;
+  if (p == name)
+     return (false);
+
+  len  = p - name;
+  rest = skip_blanks (p, eol);
+
+  if (is_01)
+  {
+    buf_add (&ctx->buf, line, keyword - line);
+    buf_puts (&ctx->buf, "define ");
+    buf_add (&ctx->buf, name, len);
+    buf_puts (&ctx->buf, is_true(lookup(ctx, name, len)) ? " 1" : " 0");
+  }
+  else if (is_true(lookup(ctx, name, len)))
+  {
+    buf_add (&ctx->buf, line, keyword - line);
+    buf_puts (&ctx->buf, "define ");
+    buf_add (&ctx->buf, name, len);
+    if (rest < eol)
+    {
+      buf_puts (&ctx->buf, " ");
+      expand (ctx, rest, eol);
+    }
+  }
+  else
+  {
+    buf_puts (&ctx->buf, "/* #undef ");
+    buf_add (&ctx->buf, name, len);
+    buf_puts (&ctx->buf, " */");
+  }
+  return (true);
+}
+
+/*
+ * Configure 'in_file' into 'out_file' using the "NAME=value" strings in 'vars'.
+ * A "NAME" without a '=' gets the value "1".
+ */
+bool configure_file (const char *in_file, const char *out_file, const smartlist_t *vars)
+{
+  configure_ctx ctx;
+  mapped_file   mf;
+  const char   *p, *end;
+  bool          rc, changed;
+  int           i;
+
+  if (!map_file(in_file, &mf))
+  {
+    fprintf (stderr, "Failed to read '%s'.\n", in_file);
+    return (false);
+  }
+
+  memset (&ctx, '\0', sizeof(ctx));
+  ctx.vars    = strmap_new (false);
+  ctx.in_file = in_file;
+
+  for (i = 0; i < smartlist_len(vars); i++)
+  {
+    char *var = strdup (smartlist_get(vars, i));
+    char *eq  = strchr (var, '=');
+
+    if (eq)
+       *eq++ = '\0';
+    free (strmap_set(ctx.vars, var, strdup(eq ? eq : "1")));
+    free (var);
+  }
+
+  p   = mf.data;
+  end = mf.data + mf.size;
+  while (p < end)
+  {
+    const char *nl  = memchr (p, '\n', end - p);
+    const char *eol = nl ? nl : end;
+
+    ctx.line++;
+    if (eol > p && eol[-1] == '\r')
+       eol--;
+
+    if (!cmakedefine(&ctx, p, eol))
+       expand (&ctx, p, eol);
+
+    p = nl ? nl + 1 : end;
+    buf_add (&ctx.buf, eol, p - eol);   /* the newline as it was */
+  }
+  unmap_file (&mf);
+  strmap_free (ctx.vars, free);
+
+  rc = buf_write_file (&ctx.buf, out_file, &changed);
+  if (rc && !changed)
+     fprintf (stderr, "'%s' is unchanged.\n", out_file);
+  DEBUG (1, "Configured '%s' from '%s' with %d vars.\n", out_file, in_file, smartlist_len(vars));
+  buf_free (&ctx.buf);
+  return (rc);
+}
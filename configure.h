@@ -0,0 +1,10 @@
+#ifndef _CONFIGURE_H
+#define _CONFIGURE_H
+
+#include <stdbool.h>
+
+#include "smartlist.h"
+
+bool configure_file (const char *in_file, const char *out_file, const smartlist_t *vars);
+
+#endif
@@ -0,0 +1,483 @@
+/*
+ * A persistent cache of the include-graph for the gen-make program.
+ *
+ * The file is memory-mapped and used as-is; no parsing is done. It has
+ * these sections (in this order):
+ *   dep_cache_header
+ *   dep_cache_node  nodes    [num_nodes]
+ *   uint32_t        raw_incs [num_raw_incs]  -> offsets into 'strings'
+ *   uint32_t        edges    [num_edges]     -> indices into 'nodes'
+ *   uint32_t        table    [table_size]    -> 1 + index into 'nodes'; 0 if free
+ *   char            strings  [strings_size]
+ *
+ * 'table' is an open-addressing hash-table on the node names. So a lookup
+ * is done directly in the mapped file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "hash.h"
+#include "depend.h"
+#include "outbuf.h"
+
+#define DEP_CACHE_MAGIC    "GMDEPS\r\n"
+#define DEP_CACHE_VERSION  1
+
+typedef struct dep_cache_header {
+        char     magic [8];
+        uint32_t version;
+        uint32_t num_nodes;
+        uint32_t num_raw_incs;
+        uint32_t num_edges;
+        uint32_t table_size;      /* a power of 2 */
+        uint32_t strings_size;
+        uint64_t inc_paths_hash;  /* 'dep_inc_paths_hash()' of the '-I' paths used */
+        uint64_t file_size;
+      } dep_cache_header;
+
+typedef struct dep_cache_node {
+        uint64_t mtime;
+        uint64_t size;
+        uint64_t hash;
+        uint32_t name;            /* offset into 'strings' */
+        uint32_t name_hash;
+        uint32_t first_raw_inc;   /* index into 'raw_incs' */
+        uint32_t num_raw_incs;
+        uint32_t first_edge;      /* index into 'edges' */
+        uint32_t num_edges;
+      } dep_cache_node;
+
+struct dep_cache {
+        mapped_file             mf;
+        const dep_cache_header *hdr;
+        const dep_cache_node   *nodes;
+        const uint32_t         *raw_incs;
+        const uint32_t         *edges;
+        const uint32_t         *table;
+        const char             *strings;
+      };
+
+/*
+ * Case-insensitive FNV-1a of a file-name.
+ */
+static uint32_t name_hash (const char *name)
+{
+  uint32_t h = 2166136261U;
+
+  for ( ; *name; name++)
+  {
+    int ch = *(const unsigned char*) name;
+
+    if (ch >= 'A' && ch <= 'Z')
+       ch += 'a' - 'A';
+    h = (h ^ ch) * 16777619U;
+  }
+  return (h);
+}
+
+uint64_t dep_inc_paths_hash (const smartlist_t *inc_paths)
+{
+  uint64_t h = 0;
+  int      i;
+
+  for (i = 0; i < smartlist_len(inc_paths); i++)
+  {
+    const char *dir = smartlist_get (inc_paths, i);
+
+    h = hash64 (dir, strlen(dir)) ^ (h * 31);
+  }
+  return (h);
+}
+
+/*
+ * Check that all offsets, indices and counts in 'c' are inside their
+ * sections. So a truncated or corrupt cache is never read out of bounds.
+ */
+static bool cache_is_sane (const dep_cache *c)
+{
+  const dep_cache_header *hdr = c->hdr;
+  uint32_t                i;
+
+  if (hdr->table_size <= hdr->num_nodes ||    /* a lookup needs a free slot */
+      (hdr->strings_size > 0 && c->strings[hdr->strings_size - 1] != '\0'))
+     return (false);
+
+  for (i = 0; i < hdr->num_nodes; i++)
+  {
+    const dep_cache_node *n = c->nodes + i;
+
+    if (n->name >= hdr->strings_size ||
+        (uint64_t)n->first_raw_inc + n->num_raw_incs > hdr->num_raw_incs ||
+        (uint64_t)n->first_edge + n->num_edges > hdr->num_edges)
+       return (false);
+  }
+  for (i = 0; i < hdr->num_raw_incs; i++)
+      if (c->raw_incs[i] >= hdr->strings_size)
+         return (false);
+  for (i = 0; i < hdr->num_edges; i++)
+      if (c->edges[i] >= hdr->num_nodes)
+         return (false);
+  for (i = 0; i < hdr->table_size; i++)
+      if (c->table[i] > hdr->num_nodes)
+         return (false);
+  return (true);
+}
+
+/*
+ * Map 'fname' and check it's a valid cache. Return NULL if not.
+ */
+dep_cache *dep_cache_open (const char *fname)
+{
+  dep_cache              *c = calloc (1, sizeof(*c));
+  const dep_cache_header *hdr;
+  uint64_t                need;
+
+  assert (c);
+  if (!map_file(fname, &c->mf) || c->mf.size < sizeof(*hdr))
+     goto fail;
+
+  hdr = (const dep_cache_header*) c->mf.data;
+  if (memcmp(hdr->magic, DEP_CACHE_MAGIC, sizeof(hdr->magic)) ||
+      hdr->version != DEP_CACHE_VERSION || hdr->file_size != c->mf.size)
+  {
+    DEBUG (1, "Cache '%s' is not valid or of another version.\n", fname);
+    goto fail;
+  }
+
+  need = sizeof(*hdr) +
+         (uint64_t)hdr->num_nodes * sizeof(dep_cache_node) +
+         (uint64_t)hdr->num_raw_incs * sizeof(uint32_t) +
+         (uint64_t)hdr->num_edges * sizeof(uint32_t) +
+         (uint64_t)hdr->table_size * sizeof(uint32_t) +
+         hdr->strings_size;
+  if (need != c->mf.size || hdr->table_size == 0 || (hdr->table_size & (hdr->table_size - 1)))
+  {
+    DEBUG (1, "Cache '%s' is corrupt.\n", fname);
+    goto fail;
+  }
+
+  c->hdr      = hdr;
+  c->nodes    = (const dep_cache_node*) (hdr + 1);
+  c->raw_incs = (const uint32_t*) (c->nodes + hdr->num_nodes);
+  c->edges    = c->raw_incs + hdr->num_raw_incs;
+  c->table    = c->edges + hdr->num_edges;
+  c->strings  = (const char*) (c->table + hdr->table_size);
+
+  if (!cache_is_sane(c))
+  {
+    DEBUG (1, "Cache '%s' is corrupt.\n", fname);
+    goto fail;
+  }
+
+  DEBUG (1, "Cache '%s' has %u nodes and %u edges.\n", fname, hdr->num_nodes, hdr->num_edges);
+  return (c);
+
+fail:
+  unmap_file (&c->mf);
+  free (c);
+  return (NULL);
+}
+
+void dep_cache_close (dep_cache *c)
+{
+  if (c)
+  {
+    unmap_file (&c->mf);
+    free (c);
+  }
+}
+
+uint64_t dep_cache_inc_paths_hash (const dep_cache *c)
+{
+  return (c->hdr->inc_paths_hash);
+}
+
+int dep_cache_num_nodes (const dep_cache *c)
+{
+  return (int) c->hdr->num_nodes;
+}
+
+/*
+ * Return the index of 'file' in the cache or -1 if not found.
+ */
+int dep_cache_lookup (const dep_cache *c, const char *file)
+{
+  uint32_t h    = name_hash (file);
+  uint32_t mask = c->hdr->table_size - 1;
+  uint32_t i    = h & mask;
+
+  while (c->table[i])
+  {
+    uint32_t idx = c->table[i] - 1;
+
+    if (idx < c->hdr->num_nodes && c->nodes[idx].name_hash == h &&
+        !stricmp(c->strings + c->nodes[idx].name, file))
+       return (int) idx;
+    i = (i + 1) & mask;
+  }
+  return (-1);
+}
+
+const char *dep_cache_name (const dep_cache *c, int idx)
+{
+  return (c->strings + c->nodes[idx].name);
+}
+
+void dep_cache_stat (const dep_cache *c, int idx, uint64_t *mtime, uint64_t *size, uint64_t *hash)
+{
+  *mtime = c->nodes[idx].mtime;
+  *size  = c->nodes[idx].size;
+  *hash  = c->nodes[idx].hash;
+}
+
+int dep_cache_num_raw_includes (const dep_cache *c, int idx)
+{
+  return (int) c->nodes[idx].num_raw_incs;
+}
+
+const char *dep_cache_raw_include (const dep_cache *c, int idx, int inc)
+{
+  return (c->strings + c->raw_incs[c->nodes[idx].first_raw_inc + inc]);
+}
+
+const uint32_t *dep_cache_edges (const dep_cache *c, int idx, int *num)
+{
+  *num = (int) c->nodes[idx].num_edges;
+  return (c->edges + c->nodes[idx].first_edge);
+}
+
+/*
+ * Return the names of all files in the cache that include any of the
+ * 'changed' indices (directly or not). The 'changed' files are included.
+ * A breadth-first search over the reverse edges.
+ */
+smartlist_t *dep_cache_affected (const dep_cache *c, const int *changed, int num_changed)
+{
+  uint32_t     num = c->hdr->num_nodes;
+  uint32_t    *rev_first = calloc (num + 2, sizeof(*rev_first));
+  uint32_t    *rev_fill  = calloc (num + 2, sizeof(*rev_fill));
+  uint32_t    *rev_edges = calloc (c->hdr->num_edges + 1, sizeof(*rev_edges));
+  uint32_t    *queue     = calloc (num + 1, sizeof(*queue));
+  char        *seen      = calloc (num + 1, 1);
+  smartlist_t *out = smartlist_new();
+  uint32_t     i, j, head = 0, tail = 0;
+  int          k;
+
+  assert (rev_first && rev_fill && rev_edges && queue && seen);
+
+  for (i = 0; i < num; i++)
+      for (j = 0; j < c->nodes[i].num_edges; j++)
+      {
+        uint32_t to = c->edges [c->nodes[i].first_edge + j];
+
+        if (to < num)
+           rev_first [to+1]++;
+      }
+
+  for (i = 0; i < num; i++)
+  {
+    rev_first [i+1] += rev_first[i];
+    rev_fill [i] = rev_first[i];
+  }
+
+  for (i = 0; i < num; i++)
+      for (j = 0; j < c->nodes[i].num_edges; j++)
+      {
+        uint32_t to = c->edges [c->nodes[i].first_edge + j];
+
+        if (to < num)
+           rev_edges [rev_fill[to]++] = i;
+      }
+
+  for (k = 0; k < num_changed; k++)
+      if (changed[k] >= 0 && (uint32_t)changed[k] < num && !seen[changed[k]])
+      {
+        seen [changed[k]] = 1;
+        queue [tail++] = changed[k];
+      }
+
+  while (head < tail)
+  {
+    uint32_t n = queue [head++];
+
+    smartlist_add (out, (void*) dep_cache_name(c, n));
+    for (j = rev_first[n]; j < rev_first[n+1]; j++)
+        if (!seen[rev_edges[j]])
+        {
+          seen [rev_edges[j]] = 1;
+          queue [tail++] = rev_edges[j];
+        }
+  }
+
+  free (seen);
+  free (queue);
+  free (rev_edges);
+  free (rev_fill);
+  free (rev_first);
+  return (out);
+}
+
+/*
+ * A growable blob of 0-terminated strings. Each unique string is stored once.
+ */
+typedef struct string_blob {
+        char     *data;
+        uint32_t  size;
+        uint32_t  capacity;
+        strmap_t *offsets;
+      } string_blob;
+
+static uint32_t blob_add (string_blob *b, const char *str)
+{
+  size_t    len = strlen (str) + 1;
+  uintptr_t off = (uintptr_t) strmap_get (b->offsets, str);
+
+  if (off)
+     return (uint32_t) (off - 1);
+
+  while (b->size + len > b->capacity)
+  {
+    b->capacity = b->capacity ? 2 * b->capacity : 64*1024;
+    b->data = realloc (b->data, b->capacity);
+    assert (b->data);
+  }
+  memcpy (b->data + b->size, str, len);
+  strmap_set (b->offsets, str, (void*) (uintptr_t) (b->size + 1));
+  b->size += (uint32_t) len;
+  return (b->size - (uint32_t)len);
+}
+
+/*
+ * The parts of a cache-file for 'write_image()'.
+ */
+typedef struct cache_image {
+        const dep_cache_header *hdr;
+        const dep_cache_node   *nodes;
+        const uint32_t         *raw_incs, *edges, *table;
+        const string_blob      *strings;
+      } cache_image;
+
+static bool write_image (void *arg, FILE *f)
+{
+  const cache_image      *img = arg;
+  const dep_cache_header *hdr = img->hdr;
+
+  return (fwrite(hdr, sizeof(*hdr), 1, f) == 1 &&
+          fwrite(img->nodes, sizeof(*img->nodes), hdr->num_nodes, f) == hdr->num_nodes &&
+          fwrite(img->raw_incs, sizeof(uint32_t), hdr->num_raw_incs, f) == hdr->num_raw_incs &&
+          fwrite(img->edges, sizeof(uint32_t), hdr->num_edges, f) == hdr->num_edges &&
+          fwrite(img->table, sizeof(uint32_t), hdr->table_size, f) == hdr->table_size &&
+          fwrite(img->strings->data, 1, img->strings->size, f) == img->strings->size);
+}
+
+/*
+ * Write all the scanned and existing files in 'g' to 'fname'.
+ * With 'write_replace_file()'; a temporary file renamed.
+ */
+bool dep_cache_write (const dep_graph *g, const char *fname)
+{
+  dep_cache_header hdr;
+  dep_cache_node  *nodes;
+  uint32_t        *remap, *raw_incs, *edges, *table;
+  string_blob      strings = { NULL, 0, 0, NULL };
+  cache_image      img;
+  int              i, j, num = 0, num_all = smartlist_len (g->nodes);
+  uint32_t         num_raw = 0, num_edges = 0, table_size = 16;
+  bool             rc = false;
+
+  remap = malloc (num_all * sizeof(*remap) + 1);
+  for (i = 0; i < num_all; i++)
+  {
+    const dep_node *n = smartlist_get (g->nodes, i);
+
+    remap[i] = (uint32_t) -1;
+    if (!n->scanned || n->missing)
+       continue;
+    remap[i] = num++;
+    num_raw   += smartlist_len (n->raw_incs);
+    num_edges += smartlist_len (n->includes);
+  }
+
+  while (table_size < 2 * (uint32_t)num)
+     table_size *= 2;
+
+  nodes    = calloc (num + 1, sizeof(*nodes));
+  raw_incs = calloc (num_raw + 1, sizeof(*raw_incs));
+  edges    = calloc (num_edges + 1, sizeof(*edges));
+  table    = calloc (table_size, sizeof(*table));
+  strings.offsets = strmap_new (false);
+  assert (nodes && raw_incs && edges && table && strings.offsets);
+
+  num_raw = num_edges = 0;
+  for (i = 0; i < num_all; i++)
+  {
+    const dep_node *n = smartlist_get (g->nodes, i);
+    dep_cache_node *cn;
+    uint32_t        slot;
+
+    if (remap[i] == (uint32_t)-1)
+       continue;
+
+    cn = nodes + remap[i];
+    cn->mtime     = n->mtime;
+    cn->size      = n->size;
+    cn->hash      = n->hash;
+    cn->name      = blob_add (&strings, n->file);
+    cn->name_hash = name_hash (n->file);
+
+    cn->first_raw_inc = num_raw;
+    for (j = 0; j < smartlist_len(n->raw_incs); j++)
+        raw_incs [num_raw++] = blob_add (&strings, smartlist_get(n->raw_incs, j));
+    cn->num_raw_incs = num_raw - cn->first_raw_inc;
+
+    cn->first_edge = num_edges;
+    for (j = 0; j < smartlist_len(n->includes); j++)
+    {
+      const dep_node *inc = smartlist_get (n->includes, j);
+
+      if (remap[inc->idx] != (uint32_t)-1)
+         edges [num_edges++] = remap [inc->idx];
+    }
+    cn->num_edges = num_edges - cn->first_edge;
+
+    slot = cn->name_hash & (table_size - 1);
+    while (table[slot])
+       slot = (slot + 1) & (table_size - 1);
+    table [slot] = remap[i] + 1;
+  }
+
+  memset (&hdr, '\0', sizeof(hdr));
+  memcpy (hdr.magic, DEP_CACHE_MAGIC, sizeof(hdr.magic));
+  hdr.version        = DEP_CACHE_VERSION;
+  hdr.num_nodes      = num;
+  hdr.num_raw_incs   = num_raw;
+  hdr.num_edges      = num_edges;
+  hdr.table_size     = table_size;
+  hdr.strings_size   = strings.size;
+  hdr.inc_paths_hash = dep_inc_paths_hash (g->inc_paths);
+  hdr.file_size      = sizeof(hdr) + num * sizeof(*nodes) +
+                       (uint64_t)(num_raw + num_edges + table_size) * sizeof(uint32_t) + strings.size;
+
+  img.hdr      = &hdr;
+  img.nodes    = nodes;
+  img.raw_incs = raw_incs;
+  img.edges    = edges;
+  img.table    = table;
+  img.strings  = &strings;
+  rc = write_replace_file (fname, write_image, &img);
+  DEBUG (1, "%s cache '%s' with %d nodes and %u edges.\n",
+         rc ? "Wrote" : "Failed to write", fname, num, num_edges);
+
+  strmap_free (strings.offsets, NULL);
+  free (strings.data);
+  free (table);
+  free (edges);
+  free (raw_incs);
+  free (nodes);
+  free (remap);
+  return (rc);
+}
@@ -0,0 +1,843 @@
+/*
+ * An in-process '#include' dependency scanner for the gen-make program.
+ * Replaces running 'gcc -MM' on all the SOURCES.
+ *
+ * All files known at one level are scanned in parallel. The includes
+ * found are then resolved (in the main thread) against the including
+ * file's directory and the '-I' paths. Any new file found is scanned
+ * at the next level. Hence a header is only scanned once, no matter how
+ * many files include it.
+ *
+ * With a cache from a previous run, a file with the same time-stamp and
+ * size (or the same contents) is not scanned again; it's includes are taken
+ * from the cache. As are the resolved includes if the '-I' paths are the same.
+ * An include not found on the previous run is looked for again; so a header
+ * added since is found. (A new header shadowing an old one in the '-I' paths
+ * is not detected).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "hash.h"
+#include "depend.h"
+
+/*
+ * Max length of a line in 'dep_graph_write()' before it's continued.
+ */
+#define DEP_LINE_WIDTH  80
+
+/*
+ * Normalise 'path' in-place: '\\' becomes '/', "./" and "dir/.."
+ * parts are removed. A leading "../" is kept.
+ */
+char *dep_normalise (char *path)
+{
+  char *src, *dst, *start;
+
+  for (src = path; *src; src++)
+      if (*src == '\\')
+         *src = '/';
+
+  start = path;
+  if (*start == '/')
+     start++;
+  else if (start[0] && start[1] == ':')
+     start += (start[2] == '/') ? 3 : 2;
+
+  src = dst = start;
+  while (*src)
+  {
+    char  *slash = strchr (src, '/');
+    size_t len   = slash ? (size_t)(slash - src) : strlen(src);
+
+    if (len == 0 || (len == 1 && *src == '.'))
+       ;                                  /* drop '//' and '/./' */
+    else if (len == 2 && src[0] == '.' && src[1] == '.' && dst > start &&
+             !(dst - start >= 3 && !strncmp(dst-3, "../", 3) && (dst - 3 == start || dst[-4] == '/')))
+    {
+      /* drop the previous component
+       */
+      dst--;
+      while (dst > start && dst[-1] != '/')
+         dst--;
+    }
+    else
+    {
+      memmove (dst, src, len);
+      dst += len;
+      if (slash)
+         *dst++ = '/';
+    }
+    src += len;
+    if (*src == '/')
+       src++;
+  }
+  if (dst > start && dst[-1] == '/')
+     dst--;
+  *dst = '\0';
+
+  if (!*path)
+     strcpy (path, ".");
+  return (path);
+}
+
+static dep_node *new_node (dep_graph *g, const char *file)
+{
+  dep_node *n = calloc (1, sizeof(*n));
+
+  assert (n);
+  n->idx       = smartlist_len (g->nodes);
+  n->cache_idx = -1;
+  n->file      = strdup (file);
+  n->raw_incs = smartlist_new();
+  n->includes = smartlist_new();
+  smartlist_add (g->nodes, n);
+  strmap_set (g->by_name, file, n);
+  return (n);
+}
+
+static void free_node (void *val)
+{
+  dep_node *n = val;
+
+  smartlist_free_all (n->raw_incs);
+  smartlist_free (n->includes);
+  free (n->file);
+  free (n);
+}
+
+dep_graph *dep_graph_new (void)
+{
+  dep_graph *g = calloc (1, sizeof(*g));
+
+  assert (g);
+  g->inc_paths = smartlist_new();
+  g->nodes     = smartlist_new();
+  g->sources   = smartlist_new();
+  g->by_name   = strmap_new (true);
+  g->no_such   = strmap_new (true);
+  return (g);
+}
+
+void dep_graph_free (dep_graph *g)
+{
+  if (!g)
+     return;
+  smartlist_free_all (g->inc_paths);
+  smartlist_free (g->sources);
+  smartlist_free (g->nodes);
+  strmap_free (g->by_name, free_node);
+  strmap_free (g->no_such, NULL);
+  smartlist_free_all (g->unresolved);
+  dep_cache_close (g->cache);
+  free (g->cache_file);
+  free (g->base);
+  free (g);
+}
+
+/*
+ * The sources and '-I' paths are relative to 'dir' (not to the current directory).
+ * The names in the graph (and it's cache) stay relative to 'dir'.
+ */
+void dep_graph_set_base (dep_graph *g, const char *dir)
+{
+  free (g->base);
+  g->base = dir ? strdup (dir) : NULL;
+}
+
+void dep_graph_add_inc_path (dep_graph *g, const char *dir)
+{
+  smartlist_add (g->inc_paths, dep_normalise(strdup(dir)));
+}
+
+dep_node *dep_graph_add_source (dep_graph *g, const char *file)
+{
+  char     *name = dep_normalise (strdup(file));
+  dep_node *n = strmap_get (g->by_name, name);
+
+  if (!n)
+     n = new_node (g, name);
+  if (!n->is_source)
+     smartlist_add (g->sources, n);
+  n->is_source = true;
+  free (name);
+  return (n);
+}
+
+/*
+ * Return the node for 'path' if it's a file. Otherwise NULL.
+ */
+static dep_node *lookup_path (dep_graph *g, char *path)
+{
+  dep_node *n;
+  DWORD     attr;
+  char      buf [_MAX_PATH];
+
+  dep_normalise (path);
+  n = strmap_get (g->by_name, path);
+  if (n)
+     return (n);
+
+  if (strmap_get(g->no_such, path))
+     return (NULL);
+
+  attr = GetFileAttributes (base_path(g->base, path, buf, sizeof(buf)));
+  if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY))
+  {
+    strmap_set (g->no_such, path, g);
+    return (NULL);
+  }
+  return new_node (g, path);
+}
+
+/*
+ * Resolve an include as written in 'from->file'.
+ *
+ * A '"name"' is searched for in the directory of 'from->file'
+ * and then in the '-I' paths. A '<name>' only in the '-I' paths.
+ * Like 'gcc -MM', an include not found here (e.g. a system header) is
+ * not a dependency.
+ */
+static dep_node *resolve_include (dep_graph *g, const dep_node *from, const char *raw)
+{
+  const char *name  = raw + 1;
+  bool        angle = (*raw == '<');
+  char        path [_MAX_PATH];
+  dep_node   *n;
+  int         i;
+
+  if (name[0] == '/' || name[0] == '\\' || (name[0] && name[1] == ':'))
+  {
+    snprintf (path, sizeof(path), "%s", name);
+    return lookup_path (g, path);
+  }
+
+  if (!angle)
+  {
+    const char *slash = strrchr (from->file, '/');
+
+    if (slash)
+         snprintf (path, sizeof(path), "%.*s/%s", (int)(slash - from->file), from->file, name);
+    else snprintf (path, sizeof(path), "%s", name);
+
+    n = lookup_path (g, path);
+    if (n)
+       return (n);
+  }
+
+  for (i = 0; i < smartlist_len(g->inc_paths); i++)
+  {
+    snprintf (path, sizeof(path), "%s/%s", (const char*)smartlist_get(g->inc_paths, i), name);
+    n = lookup_path (g, path);
+    if (n)
+       return (n);
+  }
+  DEBUG (2, "%s: include '%s' not found.\n", from->file, raw);
+  return (NULL);
+}
+
+static void add_raw_include (void *arg, const char *name, size_t len, bool angle)
+{
+  dep_node *n = arg;
+  char     *raw = malloc (len + 2);
+
+  raw[0] = angle ? '<' : '"';
+  memcpy (raw + 1, name, len);
+  raw [len+1] = '\0';
+  smartlist_add (n->raw_incs, raw);
+}
+
+typedef struct scan_job {
+        dep_graph   *g;
+        smartlist_t *todo;
+      } scan_job;
+
+static void scan_node (void *arg, size_t idx)
+{
+  scan_job                 *job = arg;
+  dep_node                 *n = smartlist_get (job->todo, (int)idx);
+  const dep_cache          *cache = job->g->cache;
+  WIN32_FILE_ATTRIBUTE_DATA fa;
+  uint64_t                  c_mtime = 0, c_size = 0, c_hash = 0;
+  mapped_file               mf;
+  char                      buf [_MAX_PATH];
+  const char               *fname = base_path (job->g->base, n->file, buf, sizeof(buf));
+
+  if (!GetFileAttributesEx(fname, GetFileExInfoStandard, &fa) ||
+      (fa.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+  {
+    n->missing = true;
+    return;
+  }
+
+  n->mtime = ((uint64_t)fa.ftLastWriteTime.dwHighDateTime << 32) + fa.ftLastWriteTime.dwLowDateTime;
+  n->size  = ((uint64_t)fa.nFileSizeHigh << 32) + fa.nFileSizeLow;
+
+  if (cache)
+  {
+    n->cache_idx = dep_cache_lookup (cache, n->file);
+    if (n->cache_idx >= 0)
+    {
+      dep_cache_stat (cache, n->cache_idx, &c_mtime, &c_size, &c_hash);
+      if (c_mtime == n->mtime && c_size == n->size)
+      {
+        n->hash = c_hash;
+        n->from_cache = true;
+        return;
+      }
+    }
+  }
+
+  if (!map_file(fname, &mf))
+  {
+    n->missing = true;
+    return;
+  }
+
+  n->hash = hash64 (mf.data, mf.size);
+  if (n->cache_idx >= 0 && c_size == mf.size && c_hash == n->hash)
+     n->from_cache = true;      /* only touched */
+  else
+     scan_includes (mf.data, mf.size, add_raw_include, n);
+  unmap_file (&mf);
+}
+
+static void add_include (dep_node *n, dep_node *inc)
+{
+  int i;
+
+  if (inc == n)
+     return;
+  for (i = 0; i < smartlist_len(n->includes); i++)
+      if (smartlist_get(n->includes, i) == inc)
+         return;
+  smartlist_add (n->includes, inc);
+}
+
+/*
+ * Resolve the 'raw' include of 'n' and add it. Remember it if not found.
+ */
+static void resolve_and_add (dep_graph *g, dep_node *n, const char *raw)
+{
+  dep_node *inc = resolve_include (g, n, raw);
+
+  if (inc)
+  {
+    add_include (n, inc);
+    return;
+  }
+  if (g->unresolved)
+  {
+    dep_unresolved *u = malloc (sizeof(*u));
+
+    assert (u);
+    u->from = n;
+    u->raw  = raw;
+    smartlist_add (g->unresolved, u);
+  }
+}
+
+/*
+ * Return true if one of the cached 'edges' can be the include 'raw'.
+ * I.e. the name ends in the '"name"' or '<name>' of 'raw'.
+ */
+static bool has_cached_edge (const dep_cache *cache, const uint32_t *edges, int num, const char *raw)
+{
+  char   name [_MAX_PATH], *p;
+  size_t len, e_len;
+  int    i;
+
+  snprintf (name, sizeof(name), "%s", raw + 1);
+  for (p = name; *p; p++)
+      if (*p == '\\')
+         *p = '/';
+  len = strlen (name);
+
+  for (i = 0; i < num; i++)
+  {
+    const char *e = dep_cache_name (cache, edges[i]);
+
+    e_len = strlen (e);
+    if (e_len >= len && !stricmp(e + e_len - len, name) &&
+        (e_len == len || e[e_len - len - 1] == '/'))
+       return (true);
+  }
+  return (false);
+}
+
+/*
+ * Take the includes of 'n' from the cache.
+ */
+static void includes_from_cache (dep_graph *g, dep_node *n)
+{
+  const uint32_t *edges;
+  uint64_t        c_mtime, c_size, c_hash;
+  int             i, num;
+
+  dep_cache_stat (g->cache, n->cache_idx, &c_mtime, &c_size, &c_hash);
+  if (c_mtime != n->mtime)
+     g->cache_dirty = true;
+
+  num = dep_cache_num_raw_includes (g->cache, n->cache_idx);
+  for (i = 0; i < num; i++)
+      smartlist_add (n->raw_incs, strdup(dep_cache_raw_include(g->cache, n->cache_idx, i)));
+
+  if (!g->cache_edges_ok)
+  {
+    for (i = 0; i < num; i++)
+        resolve_and_add (g, n, smartlist_get(n->raw_incs, i));
+    return;
+  }
+
+  edges = dep_cache_edges (g->cache, n->cache_idx, &num);
+  for (i = 0; i < num; i++)
+  {
+    const char *name = dep_cache_name (g->cache, edges[i]);
+    dep_node   *inc  = strmap_get (g->by_name, name);
+
+    if (!inc)
+       inc = new_node (g, name);
+    add_include (n, inc);
+  }
+
+  /* The cache has no edge for an include not found on the previous run.
+   * Look for it again; it may have been added since.
+   */
+  for (i = 0; i < smartlist_len(n->raw_incs); i++)
+  {
+    const char *raw = smartlist_get (n->raw_incs, i);
+    int         before = smartlist_len (n->includes);
+
+    if (has_cached_edge(g->cache, edges, num, raw))
+       continue;
+    resolve_and_add (g, n, raw);
+    if (smartlist_len(n->includes) > before)
+    {
+      DEBUG (1, "%s: include '%s' is now found.\n", n->file, raw);
+      g->cache_dirty = true;
+    }
+  }
+}
+
+/*
+ * Scan all files not yet scanned. Level by level until no new files are found.
+ */
+void dep_graph_scan (dep_graph *g)
+{
+  smartlist_t *todo = smartlist_new();
+  scan_job     job;
+  int          i, j, level = 0, num_cached = 0;
+
+  job.g    = g;
+  job.todo = todo;
+
+  while (g->num_scanned < smartlist_len(g->nodes))
+  {
+    smartlist_clear (todo);
+    for (i = g->num_scanned; i < smartlist_len(g->nodes); i++)
+    {
+      dep_node *n = smartlist_get (g->nodes, i);
+
+      if (!n->scanned)
+         smartlist_add (todo, n);
+    }
+    g->num_scanned = smartlist_len (g->nodes);
+
+    DEBUG (1, "Scanning %d files at level %d.\n", smartlist_len(todo), level++);
+    run_parallel (smartlist_len(todo), scan_node, &job);
+
+    for (i = 0; i < smartlist_len(todo); i++)
+    {
+      dep_node *n = smartlist_get (todo, i);
+
+      n->scanned = true;
+      if (n->missing)
+         continue;
+
+      if (n->from_cache)
+      {
+        includes_from_cache (g, n);
+        num_cached++;
+        continue;
+      }
+
+      g->cache_dirty = true;
+      for (j = 0; j < smartlist_len(n->raw_incs); j++)
+          resolve_and_add (g, n, smartlist_get(n->raw_incs, j));
+    }
+  }
+  DEBUG (1, "%d of %d files taken from the cache.\n", num_cached, smartlist_len(g->nodes));
+  smartlist_free (todo);
+}
+
+/*
+ * Use 'fname' as the cache. Must be called after all the '-I' paths are added.
+ */
+void dep_graph_use_cache (dep_graph *g, const char *fname)
+{
+  g->cache_file = strdup (fname);
+  g->cache = dep_cache_open (fname);
+  g->cache_edges_ok = (g->cache && dep_cache_inc_paths_hash(g->cache) == dep_inc_paths_hash(g->inc_paths));
+  if (g->cache && !g->cache_edges_ok)
+     DEBUG (1, "The '-I' paths changed; resolving all includes again.\n");
+}
+
+/*
+ * Write the cache if something changed since it was loaded.
+ */
+bool dep_graph_save_cache (dep_graph *g)
+{
+  int i, num = 0;
+
+  if (!g->cache_file)
+     return (false);
+
+  for (i = 0; i < smartlist_len(g->nodes); i++)
+  {
+    const dep_node *n = smartlist_get (g->nodes, i);
+
+    if (n->scanned && !n->missing)
+       num++;
+  }
+
+  if (g->cache && g->cache_edges_ok && !g->cache_dirty && num == dep_cache_num_nodes(g->cache))
+  {
+    DEBUG (1, "Cache '%s' is up-to-date.\n", g->cache_file);
+    return (true);
+  }
+
+  /* Windows cannot replace a mapped file
+   */
+  dep_cache_close (g->cache);
+  g->cache = NULL;
+  return dep_cache_write (g, g->cache_file);
+}
+
+/*
+ * Add 'dir' as a candidate for each include-name that a file 'header'
+ * in it would satisfy. E.g. for "a/b/c.h": "c.h" -> "a/b", "b/c.h" -> "a"
+ * and "a/b/c.h" -> ".".
+ */
+static void add_candidates (strmap_t *by_suffix, const char *header)
+{
+  char       *path = dep_normalise (strdup(header));
+  const char *suffix = path;
+
+  while (1)
+  {
+    smartlist_t *dirs = strmap_get (by_suffix, suffix);
+    char        *dir;
+
+    if (!dirs)
+    {
+      dirs = smartlist_new();
+      strmap_set (by_suffix, suffix, dirs);
+    }
+    if (suffix == path)
+         dir = strdup (".");
+    else
+    {
+      dir = strdup (path);
+      dir [suffix - path - 1] = '\0';
+    }
+    smartlist_add (dirs, dir);
+
+    suffix = strchr (suffix, '/');
+    if (!suffix)
+       break;
+    suffix++;
+  }
+  free (path);
+}
+
+static void free_dirs (void *val)
+{
+  smartlist_free_all (val);
+}
+
+static int compare_hits (const void **_a, const void **_b)
+{
+  const dep_inc_dir *a = *_a;
+  const dep_inc_dir *b = *_b;
+
+  if (a->hits != b->hits)
+     return (b->hits - a->hits);
+  return (a->order - b->order);
+}
+
+/*
+ * Find the '-I' directories needed for the includes not found by
+ * 'dep_graph_scan()'. 'headers' are all the header files known.
+ *
+ * A greedy set-cover: the directory that resolves most of the unresolved
+ * includes is added to 'g->inc_paths'. Then the graph is scanned again
+ * (the new headers may include others) until nothing more is resolved.
+ * Returns a list of 'dep_inc_dir*' sorted on the number of hits.
+ */
+smartlist_t *dep_graph_infer_inc_paths (dep_graph *g, const smartlist_t *headers)
+{
+  smartlist_t *result = smartlist_new();
+  strmap_t    *by_suffix = strmap_new (true);
+  strmap_t    *hits;
+  int          i, j;
+
+  for (i = 0; i < smartlist_len(headers); i++)
+      add_candidates (by_suffix, smartlist_get(headers, i));
+
+  if (!g->unresolved)
+     g->unresolved = smartlist_new();
+
+  /* The cached edges do not tell what was not found
+   */
+  g->cache_edges_ok = false;
+
+  while (1)
+  {
+    smartlist_t *still = smartlist_new();
+    dep_inc_dir *best = NULL;
+    char         name [_MAX_PATH];
+
+    dep_graph_scan (g);
+
+    hits = strmap_new (true);
+    for (i = 0; i < smartlist_len(g->unresolved); i++)
+    {
+      const dep_unresolved *u = smartlist_get (g->unresolved, i);
+      const smartlist_t    *dirs;
+
+      snprintf (name, sizeof(name), "%s", u->raw + 1);
+      dirs = strmap_get (by_suffix, dep_normalise(name));
+      for (j = 0; dirs && j < smartlist_len(dirs); j++)
+      {
+        const char  *dir = smartlist_get (dirs, j);
+        dep_inc_dir *d = strmap_get (hits, dir);
+
+        if (!d)
+        {
+          d = calloc (1, sizeof(*d));
+          assert (d);
+          d->dir = strdup (dir);
+          d->order = strmap_size (hits);
+          strmap_set (hits, dir, d);
+        }
+        if (d->last != u)     /* count an include once per directory */
+           d->hits++;
+        d->last = u;
+        if (!best || d->hits > best->hits || (d->hits == best->hits && d->order < best->order))
+           best = d;
+      }
+    }
+
+    if (best)
+    {
+      smartlist_add (result, best);
+      strmap_set (hits, best->dir, NULL);   /* keep it */
+      best->order = smartlist_len (result);
+      best->last  = NULL;
+      dep_graph_add_inc_path (g, best->dir);
+      DEBUG (1, "Include dir '%s' resolves %d includes.\n", best->dir, best->hits);
+
+      for (i = 0; i < smartlist_len(g->unresolved); i++)
+      {
+        dep_unresolved *u   = smartlist_get (g->unresolved, i);
+        dep_node       *inc = resolve_include (g, u->from, u->raw);
+
+        if (inc)
+        {
+          add_include (u->from, inc);
+          free (u);
+        }
+        else
+          smartlist_add (still, u);
+      }
+      smartlist_free (g->unresolved);
+      g->unresolved = still;
+    }
+    else
+      smartlist_free (still);
+
+    strmap_free (hits, dep_inc_dir_free);
+    if (!best)
+       break;
+  }
+
+  DEBUG (1, "%d includes not found in any directory.\n", smartlist_len(g->unresolved));
+  strmap_free (by_suffix, free_dirs);
+  smartlist_sort (result, compare_hits);
+  return (result);
+}
+
+void dep_inc_dir_free (void *val)
+{
+  dep_inc_dir *d = val;
+
+  if (d)
+  {
+    free (d->dir);
+    free (d);
+  }
+}
+
+static int compare_score (const void **_a, const void **_b)
+{
+  const dep_header_rank *a = *_a;
+  const dep_header_rank *b = *_b;
+
+  if (a->score != b->score)
+     return (a->score < b->score ? 1 : -1);
+  return (a->node->idx - b->node->idx);
+}
+
+/*
+ * Rank the headers included (directly or not) by at least 'min_tus' of
+ * the 'tus' (a list of 'dep_node*'). The score is the number of 'tus'
+ * including it times it's total size (with all it includes).
+ * Returns a list of 'dep_header_rank*' with the highest score first.
+ */
+smartlist_t *dep_graph_rank_headers (dep_graph *g, const smartlist_t *tus, int min_tus)
+{
+  smartlist_t *result = smartlist_new();
+  smartlist_t *deps   = smartlist_new();
+  int         *count  = calloc (smartlist_len(g->nodes) + 1, sizeof(*count));
+  int          i, j;
+
+  assert (count);
+  for (i = 0; i < smartlist_len(tus); i++)
+  {
+    smartlist_clear (deps);
+    dep_graph_closure (g, smartlist_get(tus, i), deps);
+    for (j = 0; j < smartlist_len(deps); j++)
+        count [((const dep_node*)smartlist_get(deps, j))->idx]++;
+  }
+
+  for (i = 0; i < smartlist_len(g->nodes); i++)
+  {
+    dep_node        *n = smartlist_get (g->nodes, i);
+    dep_header_rank *r;
+    uint64_t         size;
+
+    if (n->is_source || n->missing || count[i] < min_tus)
+       continue;
+
+    size = n->size;
+    smartlist_clear (deps);
+    dep_graph_closure (g, n, deps);
+    for (j = 0; j < smartlist_len(deps); j++)
+    {
+      const dep_node *inc = smartlist_get (deps, j);
+
+      if (!inc->missing)
+         size += inc->size;
+    }
+
+    r = calloc (1, sizeof(*r));
+    assert (r);
+    r->node    = n;
+    r->num_tus = count[i];
+    r->size    = size;
+    r->score   = size * count[i];
+    smartlist_add (result, r);
+  }
+
+  smartlist_sort (result, compare_score);
+  smartlist_free (deps);
+  free (count);
+  return (result);
+}
+
+/*
+ * Return true if 'node' is 'inc' or includes it (directly or not).
+ */
+bool dep_graph_includes (dep_graph *g, dep_node *node, const dep_node *inc)
+{
+  smartlist_t *deps = smartlist_new();
+  bool         found = (node == inc);
+  int          i;
+
+  dep_graph_closure (g, node, deps);
+  for (i = 0; !found && i < smartlist_len(deps); i++)
+      found = (smartlist_get(deps, i) == inc);
+  smartlist_free (deps);
+  return (found);
+}
+
+static void closure (dep_graph *g, dep_node *n, smartlist_t *out)
+{
+  int i;
+
+  for (i = 0; i < smartlist_len(n->includes); i++)
+  {
+    dep_node *inc = smartlist_get (n->includes, i);
+
+    if (inc->visited == g->visit_stamp)
+       continue;
+    inc->visited = g->visit_stamp;
+    smartlist_add (out, inc);
+    closure (g, inc, out);
+  }
+}
+
+/*
+ * Add all files 'node' depends on to 'out'. In the order 'gcc -MM' would list them.
+ */
+void dep_graph_closure (dep_graph *g, dep_node *node, smartlist_t *out)
+{
+  g->visit_stamp++;
+  node->visited = g->visit_stamp;
+  closure (g, node, out);
+}
+
+static void write_dep (FILE *out, const char *file, size_t *col)
+{
+  size_t len = strlen (file);
+
+  if (*col + len + 1 > DEP_LINE_WIDTH - 2)
+  {
+    fputs (" \\\n ", out);
+    *col = 1;
+  }
+  fprintf (out, " %s", file);
+  *col += len + 1;
+}
+
+/*
+ * Write the dependencies of all sources in the format of:
+ *   gcc -MM $(SOURCES) | sed -e 's/\(.*\)\.o: /\n$(OBJ_DIR)\/\1.obj: /'
+ */
+void dep_graph_write (dep_graph *g, FILE *out, const char *obj_prefix, const char *obj_ext)
+{
+  smartlist_t *deps = smartlist_new();
+  int          i, j;
+
+  for (i = 0; i < smartlist_len(g->sources); i++)
+  {
+    dep_node   *src = smartlist_get (g->sources, i);
+    const char *base = strrchr (src->file, '/');
+    const char *dot;
+    size_t      col;
+
+    base = base ? base + 1 : src->file;
+    dot  = strrchr (base, '.');
+    if (!dot)
+       dot = strchr (base, '\0');
+
+    col = fprintf (out, "\n%s%.*s%s:", obj_prefix, (int)(dot - base), base, obj_ext) - 1;
+    write_dep (out, src->file, &col);
+
+    smartlist_clear (deps);
+    dep_graph_closure (g, src, deps);
+    for (j = 0; j < smartlist_len(deps); j++)
+    {
+      const dep_node *n = smartlist_get (deps, j);
+
+      if (!n->missing)
+         write_dep (out, n->file, &col);
+    }
+    fputc ('\n', out);
+  }
+  smartlist_free (deps);
+}
@@ -0,0 +1,110 @@
+#ifndef _DEPEND_H
+#define _DEPEND_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smartlist.h"
+#include "strmap.h"
+
+/*
+ * A file in the include-graph.
+ */
+typedef struct dep_node {
+        char        *file;       /* normalised; '/' separators and no leading './' */
+        smartlist_t *raw_incs;   /* the includes as written; '"name' or '<name' */
+        smartlist_t *includes;   /* the 'dep_node*' that 'raw_incs' resolved to */
+        bool         is_source;  /* added by 'dep_graph_add_source()' */
+        bool         scanned;
+        bool         missing;    /* could not be read */
+        bool         from_cache; /* 'raw_incs' came from the cache; the file was not scanned */
+        unsigned     visited;    /* stamp used by 'dep_graph_closure()' */
+        int          idx;        /* index in 'dep_graph::nodes' */
+        int          cache_idx;  /* index in the cache or -1 */
+        uint64_t     mtime;      /* a FILETIME */
+        uint64_t     size;
+        uint64_t     hash;       /* 'hash64()' of the contents */
+      } dep_node;
+
+/*
+ * An include that was not found in the '-I' paths.
+ */
+typedef struct dep_unresolved {
+        dep_node   *from;
+        const char *raw;        /* in 'from->raw_incs' */
+      } dep_unresolved;
+
+/*
+ * A directory found by 'dep_graph_infer_inc_paths()'.
+ */
+typedef struct dep_inc_dir {
+        char                 *dir;
+        int                   hits;   /* number of includes it resolves */
+        int                   order;  /* the order it was found in */
+        const dep_unresolved *last;
+      } dep_inc_dir;
+
+/*
+ * A header ranked by 'dep_graph_rank_headers()'.
+ */
+typedef struct dep_header_rank {
+        dep_node *node;
+        int       num_tus;  /* number of translation units including it */
+        uint64_t  size;     /* the size of it and all it includes */
+        uint64_t  score;
+      } dep_header_rank;
+
+typedef struct dep_cache dep_cache;  /* Opaque struct; defined in depcache.c */
+
+typedef struct dep_graph {
+        smartlist_t *inc_paths;  /* the '-I' directories; in order of search */
+        smartlist_t *nodes;      /* all 'dep_node*'; in order of discovery */
+        smartlist_t *sources;    /* the 'dep_node*' of the sources */
+        strmap_t    *by_name;    /* normalised file-name -> 'dep_node*' */
+        strmap_t    *no_such;    /* normalised file-names known not to exist */
+        int          num_scanned;
+        unsigned     visit_stamp;
+        dep_cache   *cache;      /* the mapped cache from the previous run */
+        char        *cache_file;
+        bool         cache_edges_ok;  /* the '-I' paths are unchanged; reuse resolved includes */
+        bool         cache_dirty;
+        smartlist_t *unresolved; /* 'dep_unresolved*'; only if this list was created */
+        char        *base;       /* the file-names are relative to this directory; NULL for "." */
+      } dep_graph;
+
+dep_graph *dep_graph_new (void);
+void       dep_graph_free (dep_graph *g);
+void       dep_graph_set_base (dep_graph *g, const char *dir);
+void       dep_graph_add_inc_path (dep_graph *g, const char *dir);
+dep_node  *dep_graph_add_source (dep_graph *g, const char *file);
+void       dep_graph_scan (dep_graph *g);
+void       dep_graph_closure (dep_graph *g, dep_node *node, smartlist_t *out);
+void       dep_graph_write (dep_graph *g, FILE *out, const char *obj_prefix, const char *obj_ext);
+
+char      *dep_normalise (char *path);
+
+smartlist_t *dep_graph_infer_inc_paths (dep_graph *g, const smartlist_t *headers);
+void         dep_inc_dir_free (void *val);
+
+smartlist_t *dep_graph_rank_headers (dep_graph *g, const smartlist_t *tus, int min_tus);
+bool         dep_graph_includes (dep_graph *g, dep_node *node, const dep_node *inc);
+
+void       dep_graph_use_cache (dep_graph *g, const char *fname);
+bool       dep_graph_save_cache (dep_graph *g);
+
+dep_cache  *dep_cache_open (const char *fname);
+void        dep_cache_close (dep_cache *c);
+uint64_t    dep_cache_inc_paths_hash (const dep_cache *c);
+int         dep_cache_num_nodes (const dep_cache *c);
+int         dep_cache_lookup (const dep_cache *c, const char *file);
+const char *dep_cache_name (const dep_cache *c, int idx);
+void        dep_cache_stat (const dep_cache *c, int idx, uint64_t *mtime, uint64_t *size, uint64_t *hash);
+const char *dep_cache_raw_include (const dep_cache *c, int idx, int inc);
+int         dep_cache_num_raw_includes (const dep_cache *c, int idx);
+const uint32_t *dep_cache_edges (const dep_cache *c, int idx, int *num);
+smartlist_t    *dep_cache_affected (const dep_cache *c, const int *changed, int num_changed);
+bool        dep_cache_write (const dep_graph *g, const char *fname);
+uint64_t    dep_inc_paths_hash (const smartlist_t *inc_paths);
+
+#endif
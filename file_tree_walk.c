@@ -28,11 +28,12 @@
 #include <io.h>
 #include <windows.h>
 
-int file_tree_walk_recursive = 1;
+typedef int (*walker_func)(void *arg, const char *path, const WIN32_FIND_DATA *ff_data);
 
-typedef int (*walker_func)(const char *path, const WIN32_FIND_DATA *ff_data);
-
-DWORD file_tree_walk (const char *dir, walker_func func)
+/*
+ * 'arg' is passed on to 'func'. Into the sub-directories too if 'recursive'.
+ */
+DWORD file_tree_walk (const char *dir, int recursive, walker_func func, void *arg)
 {
   char            searchspec [MAX_PATH];
   char            path [MAX_PATH], *dir_end;
@@ -99,15 +100,15 @@ DWORD file_tree_walk (const char *dir, walker_func func)
 
     /* Invoke '(*func)()' on this file/directory.
      */
-    func_result = (*func) (path, &ff_data);
+    func_result = (*func) (arg, path, &ff_data);
     if (func_result != 0)
        return (func_result);
 
     /* If this is a directory, walk its siblings. Recursion!
      */
-    if (file_tree_walk_recursive && (ff_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    if (recursive && (ff_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
     {
-      DWORD rc = file_tree_walk (path, func);
+      DWORD rc = file_tree_walk (path, recursive, func, arg);
 
       if (rc != 0)
          return (rc);
@@ -132,7 +133,7 @@ DWORD file_tree_walk (const char *dir, walker_func func)
 static unsigned total;
 static DWORD64  total_size;
 
-int ff_walker (const char *path, const WIN32_FIND_DATA *ff)
+int ff_walker (void *arg, const char *path, const WIN32_FIND_DATA *ff)
 {
   DWORD64 size = ((DWORD64)ff->nFileSizeHigh << 32) + (DWORD64)ff->nFileSizeLow;
   char    attr[] = "------" ;
@@ -169,7 +170,7 @@ int main (int argc, char **argv)
 
     puts ("Attr      Size Path\n"
           "-----------------------------------------------------------------------------");
-    rc = file_tree_walk (argv[1], ff_walker);
+    rc = file_tree_walk (argv[1], 1, ff_walker, NULL);
 
     printf ("file_tree_walk: %lu, total: %u, total-size: %I64u bytes.",
             rc, total, total_size);
@@ -2,16 +2,16 @@
  * Quick and dirty makefile generator for MSVC or clang-cl.
  *
  * By Gisle Vanem <gvanem@yahoo.no>.
+ *
+ * The command-line of gen-make. The work is done by the gen-make library;
+ * see 'libgenmake.h'.
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
-#include <ctype.h>
 #include <time.h>
-#include <conio.h>
-#include <limits.h>
-#include <sys/stat.h>
 
 /* Assume if the generated Makefile was able to compile this, it also
  * generated a '$(OBJ_DIR)/config.h' file here. And the "TARGETS = bin/foo.exe".
@@ -22,12 +22,6 @@
   /* These are needed if the generated Makefile should be able to link "bin/foo.exe"
    */
   const char *program_name = "bin/foo";
-  int write_template_line (FILE *out, const char *templ)
-  {
-    (void) out;
-    (void) templ;
-    return (0);
-  }
 
 #else
   #include <getopt_long.h>
@@ -36,42 +30,58 @@
 
 #include "gen-make.h"
 #include "smartlist.h"
+#include "scanner.h"
+#include "configure.h"
+#include "probe.h"
+#include "libgenmake.h"
 
 #if defined(IN_THE_REAL_MAKEFILE)
 
 static char prog [_MAX_PATH] = { "bin/gen-make.exe" };
 
-static const char *line_end = "\\";
-
-static smartlist_t *c_files;
-static smartlist_t *cc_files;
-static smartlist_t *cpp_files;
-static smartlist_t *cxx_files;
-static smartlist_t *rc_files;
-static smartlist_t *h_in_files;
-static smartlist_t *vpaths;
-
-static size_t num_c_files    = 0;
-static size_t num_cc_files   = 0;
-static size_t num_cpp_files  = 0;
-static size_t num_cxx_files  = 0;
-static size_t num_rc_files   = 0;
-static size_t num_h_in_files = 0;
-static int    debug_level    = 0;
-
-static bool use_py_mako   = false; /* todo */
-static bool main_found    = false;
-static bool WinMain_found = false;
-static bool DllMain_found = false;
-
-static char *str_replace (int ch1, int ch2, char *str);
-static int   find_sources (void);
-
-#define DEBUG(level, fmt, ...)  do {                                       \
-                                  if (debug_level >= level)                \
-                                     fprintf (stderr, "%s(%u): " fmt,      \
-                                       __FILE__, __LINE__, ##__VA_ARGS__); \
-                                } while (0)
+static genmake_options opt;
+
+static bool do_depend       = false;
+static bool do_affected     = false;
+static bool do_configure    = false;
+static bool do_report       = false;
+static bool do_scan_modules = false;
+static bool do_analyze_objs = false;
+static bool do_fingerprint  = false;
+static bool do_probe        = false;
+
+static const char  *fingerprint_dir = NULL;
+static const char  *batch_file = NULL;
+static smartlist_t *inc_paths;
+static smartlist_t *unity_excludes;
+static smartlist_t *templates;       /* the names from option '--template' */
+
+/*
+ * Long options without a short option.
+ */
+enum long_only_opts {
+     OPT_DEPEND = 256,
+     OPT_CACHE,
+     OPT_NO_CACHE,
+     OPT_AFFECTED,
+     OPT_JSON,
+     OPT_UNITY_SIZE,
+     OPT_UNITY_EXCLUDE,
+     OPT_MULTI_TARGET,
+     OPT_MANIFEST,
+     OPT_CONFIGURE,
+     OPT_REPORT,
+     OPT_SORT,
+     OPT_SCAN_MODULES,
+     OPT_ANALYZE_OBJECTS,
+     OPT_FINGERPRINT,
+     OPT_TEMPLATE_FILE,
+     OPT_UPDATE,
+     OPT_TEMPLATE,
+     OPT_EMIT,
+     OPT_PROBE,
+     OPT_BATCH
+   };
 
 void Abort (const char *fmt, ...)
 {
@@ -87,23 +97,87 @@ static void usage (FILE *out)
   printf ("gen-make ver %d.%d.%d; A simple makefile generator.\n"
           "%s <options>:\n",  VER_MAJOR, VER_MINOR, VER_MICRO, prog);
   printf ("  -d, --debug:      sets debug-level.\n"
-          "  -r, --no-recurse: do not search recursively for source-files.\n");
+          "  -j, --jobs N:     use N threads for scanning (default: one per CPU).\n"
+          "  -r, --no-recurse: do not search recursively for source-files.\n"
+          "  -I dir:           add 'dir' to the include-paths for '--depend'.\n"
+          "  -o, --output file: write the makefile to 'file' (only if changed) instead of stdout.\n"
+          "  --depend [files]: write the dependencies of 'files' (or the sources found) to stdout.\n"
+          "  --cache file:     the include-graph cache for '--depend' (default: '%s').\n"
+          "  --no-cache:       do not use an include-graph cache (nor '%s' or '%s').\n"
+          "  --affected files: write the sources, objects and targets affected by a change to 'files'.\n"
+          "  --json:           write the '--affected', '--report' or '--fingerprint' result as JSON.\n"
+          "  --unity-size N:   the size of the unity batches in kB (default: %d).\n"
+          "  --unity-exclude file: do not put 'file' in a unity batch.\n"
+          "  --multi-target:   one program for each 'main()'; the other sources in a shared library.\n"
+          "  --manifest file:  write the size and content-hash of all files found to 'file'.\n"
+          "  --configure in out [VAR=value...]: expand '@VAR@' and '#cmakedefine VAR' in 'in' to 'out'.\n"
+          "  --report [files]: write the cost of each header included by 'files' (or the sources found).\n"
+          "  --sort key:       sort the '--report' on 'parsed' (default), 'tus', 'size', 'lines' or 'name'.\n"
+          "  --scan-modules [files]: write the C++20 module dependencies of 'files' (or the C++ sources) as P1689 JSON.\n"
+          "  --analyze-objects [files]: write the objects each program needs from the symbols in 'files' (or the .o/.obj files found).\n"
+          "  --fingerprint dir: write the Merkle hash of 'dir' and if it changed since the last run.\n"
+          "  --template name:  use the built-in template 'name'; 'windows' (default), 'linux', 'mingw' or 'cygwin'.\n"
+          "                    Several are written from one walk; each to it's own 'Makefile.X'.\n"
+          "  --template-file file: use the makefile template in 'file' instead of the built-in one.\n"
+          "  --update file:    replace the '#! gen-make begin/end' regions in a hand-edited 'file'.\n"
+          "  --emit kind:      write a 'make' makefile (default), a 'ninja' 'build.ninja' and/or a\n"
+          "                    'compdb' 'compile_commands.json'.\n"
+          "  --probe:          write the compilers and tools found on PATH (cached in '%s').\n"
+          "  --batch file:     generate for each 'root template output' line in 'file' from one walk.\n",
+          opt.cache_file, opt.merkle_file, opt.probe_file, (int)(opt.unity_size / 1024), opt.probe_file);
   exit (0);
 }
 
+/*
+ * For option '--emit kind'.
+ */
+static void add_emit (const char *kind)
+{
+  if (!stricmp(kind, "make"))
+     opt.emit |= GENMAKE_EMIT_MAKE;
+  else if (!stricmp(kind, "ninja"))
+     opt.emit |= GENMAKE_EMIT_NINJA;
+  else if (!stricmp(kind, "compdb"))
+     opt.emit |= GENMAKE_EMIT_COMPDB;
+  else Abort ("Unknown '--emit %s'; use 'make', 'ninja' or 'compdb'.\n", kind);
+}
+
 static void parse_args (int argc, char *const *argv)
 {
   static const struct option long_opt[] = {
         { "help",       0, NULL, 'h' },   /* 0 */
         { "debug",      0, NULL, 'd' },
         { "no-recurse", 0, NULL, 'r' },   /* 2 */
+        { "jobs",       1, NULL, 'j' },
+        { "output",     1, NULL, 'o' },
+        { "depend",     0, NULL, OPT_DEPEND },
+        { "cache",      1, NULL, OPT_CACHE },
+        { "no-cache",   0, NULL, OPT_NO_CACHE },
+        { "affected",   0, NULL, OPT_AFFECTED },
+        { "json",       0, NULL, OPT_JSON },
+        { "unity-size", 1, NULL, OPT_UNITY_SIZE },
+        { "unity-exclude", 1, NULL, OPT_UNITY_EXCLUDE },
+        { "multi-target",  0, NULL, OPT_MULTI_TARGET },
+        { "manifest",      1, NULL, OPT_MANIFEST },
+        { "configure",     0, NULL, OPT_CONFIGURE },
+        { "report",        0, NULL, OPT_REPORT },
+        { "sort",          1, NULL, OPT_SORT },
+        { "scan-modules",  0, NULL, OPT_SCAN_MODULES },
+        { "analyze-objects", 0, NULL, OPT_ANALYZE_OBJECTS },
+        { "fingerprint",   1, NULL, OPT_FINGERPRINT },
+        { "template-file", 1, NULL, OPT_TEMPLATE_FILE },
+        { "update",        1, NULL, OPT_UPDATE },
+        { "template",      1, NULL, OPT_TEMPLATE },
+        { "emit",          1, NULL, OPT_EMIT },
+        { "probe",         0, NULL, OPT_PROBE },
+        { "batch",         1, NULL, OPT_BATCH },
         { NULL,         0, NULL, 0 }
       };
 
   while (1)
   {
     int idx = 0;
-    int c = getopt_long (argc, argv, "hdrp", long_opt, &idx);
+    int c = getopt_long (argc, argv, "hdj:o:rI:", long_opt, &idx);
 
     if (c == -1)
        break;
@@ -116,7 +190,7 @@ static void parse_args (int argc, char *const *argv)
            if (idx == 1)
               debug_level++;
            if (idx == 2)
-              file_tree_walk_recursive = 0;
+              opt.no_recurse = true;
            break;
       case 'h':
            usage (stdout);
@@ -124,11 +198,83 @@ static void parse_args (int argc, char *const *argv)
       case 'd':
            debug_level++;
            break;
+      case 'j':
+           scan_threads = atoi (optarg);
+           break;
+      case 'o':
+           opt.output_file = optarg;
+           break;
       case 'r':
-           file_tree_walk_recursive = 0;
+           opt.no_recurse = true;
+           break;
+      case 'I':
+           smartlist_add (inc_paths, optarg);
+           break;
+      case OPT_DEPEND:
+           do_depend = true;
+           break;
+      case OPT_CACHE:
+           opt.cache_file = optarg;
+           break;
+      case OPT_NO_CACHE:
+           opt.cache_file = NULL;
+           opt.merkle_file = NULL;
+           opt.probe_file = NULL;
            break;
-      case 'p':
-           use_py_mako = true;
+      case OPT_AFFECTED:
+           do_affected = true;
+           break;
+      case OPT_JSON:
+           opt.json = true;
+           break;
+      case OPT_UNITY_SIZE:
+           opt.unity_size = 1024 * (uint64_t) atoi (optarg);
+           break;
+      case OPT_UNITY_EXCLUDE:
+           smartlist_add (unity_excludes, optarg);
+           break;
+      case OPT_MULTI_TARGET:
+           opt.multi_target = true;
+           break;
+      case OPT_MANIFEST:
+           opt.manifest_file = optarg;
+           break;
+      case OPT_CONFIGURE:
+           do_configure = true;
+           break;
+      case OPT_REPORT:
+           do_report = true;
+           break;
+      case OPT_SORT:
+           opt.report_sort = optarg;
+           break;
+      case OPT_SCAN_MODULES:
+           do_scan_modules = true;
+           break;
+      case OPT_ANALYZE_OBJECTS:
+           do_analyze_objs = true;
+           break;
+      case OPT_FINGERPRINT:
+           do_fingerprint = true;
+           fingerprint_dir = optarg;
+           break;
+      case OPT_TEMPLATE_FILE:
+           opt.template_file = optarg;
+           break;
+      case OPT_UPDATE:
+           opt.update_file = optarg;
+           break;
+      case OPT_TEMPLATE:
+           smartlist_add (templates, optarg);
+           break;
+      case OPT_EMIT:
+           add_emit (optarg);
+           break;
+      case OPT_PROBE:
+           do_probe = true;
+           break;
+      case OPT_BATCH:
+           batch_file = optarg;
            break;
       default:
            fprintf (stderr, "Illegal option: '%c'\n", c);
@@ -138,373 +284,277 @@ static void parse_args (int argc, char *const *argv)
   }
 }
 
-static void cleanup (void)
-{
-  smartlist_free (c_files);
-  smartlist_free (cc_files);
-  smartlist_free (cpp_files);
-  smartlist_free (cxx_files);
-  smartlist_free (rc_files);
-  smartlist_free (h_in_files);
-  smartlist_free (vpaths);
-}
-#endif /* IN_THE_REAL_MAKEFILE */
-
-int main (int argc, char **argv)
-{
-#if !defined(IN_THE_REAL_MAKEFILE)
-  fprintf (stderr,
-           "It seems a \"bin/gen-make.exe\" generated Makefile was able to compile and build this '%s' program.\n"
-           "Congratulations! But I will not let you do any damage here.\n", argv[0]);
-  exit (0);
-
-#else
-  size_t i;
-
-  GetModuleFileName (NULL, prog, sizeof(prog));
-  parse_args (argc, argv);
-  tzset();
-  if (!find_sources())
-  {
-    fputs ("I found no .c/.cc/.cpp/.cxx sources", stderr);
-    return (1);
-  }
-
-  for (i = 0; make_template[i]; i++)
-      write_template_line (stdout, make_template[i]);
-  fputs ("\n", stdout);
-
-  cleanup();
-  fprintf (stderr, "Generated makefile to stdout.\n");
-#endif       /* IN_THE_REAL_MAKEFILE */
-
-  return (0);
-}
-
-#if defined(IN_THE_REAL_MAKEFILE)
-static void add_file (int is_c, int is_cc, int is_cpp, int is_cxx, int is_rc, int is_h_in, const char *file)
-{
-  smartlist_t *array = is_c    ? c_files    :
-                       is_cc   ? cc_files   :
-                       is_cpp  ? cpp_files  :
-                       is_cxx  ? cxx_files  :
-                       is_rc   ? rc_files   :
-                       is_h_in ? h_in_files : NULL;
-
-  size_t *num = is_c    ? &num_c_files    :
-                is_cc   ? &num_cc_files   :
-                is_cpp  ? &num_cpp_files  :
-                is_cxx  ? &num_cxx_files  :
-                is_rc   ? &num_rc_files   :
-                is_h_in ? &num_h_in_files : NULL;
-
-  char *f = strdup (file);
-
-  assert (array);
-  assert (num);
-  str_replace ('\\', '/', f);
-
-  smartlist_add (array, f);
-  *num = smartlist_len (array);
-}
-
-static int file_walker (const char *path, const WIN32_FIND_DATA *ff)
-{
-  const char *p, *end;
-  char       *dot, *slash, dir [MAX_PATH];
-  int         is_c = 0, is_cc = 0, is_cpp = 0, is_cxx = 0, is_rc = 0, is_h_in = 0;
-  int         considered;
-  size_t      i, len;
-  bool        add_it;
-
-  /* Alway ignore '.git' entries
-   */
-  if (!strncmp(path, ".\\.git\\", 7))
-     return (0);
-
-  len = strlen (path);
-  end = strrchr (path, '\0');
-  dot = strrchr (path, '.');
-
-  if (len <= 2 || (size_t)(end - dot) > sizeof(".cpp"))
-     considered = 0;
-
-  else if (!strcmp(dot, ".c"))
-     is_c = 1;
-
-  else if (!strcmp(dot, ".cc"))
-     is_cc = 1;
-
-  else if (!strcmp(dot, ".cpp"))
-     is_cpp = 1;
-
-  else if (!strcmp(dot, ".cxx"))
-     is_cxx = 1;
-
-  else if (!strcmp(dot-2, ".h.in"))
-     is_h_in = 1;
-
-  else if (stricmp(path, "gen-make.rc") && !strcmp(dot, ".rc"))
-     is_rc = 1;
-
-#if 0     /* to-do: make dependency list */
-  else if (!strcmp(dot, ".h"))
-     is_h = 1;
-#endif
-
-  considered = is_c + is_cc + is_cpp + is_cxx + is_rc;
-
-  DEBUG (2, "%-40s %sconsidered. is_c: %d, is_cc: %d, is_cpp: %d, is_cxx: %d, is_rc: %d\n",
-         path, considered ? "" : "not ", is_c, is_cc, is_cpp, is_cxx, is_rc);
-
-#if 0
-  /*
-   * to-do: check the source-file for a 'main(', 'WinMain(' or a 'DllMain('.
-   */
-  if (!main_found && !WinMain_found && !DllMain_found && (is_c || is_cc || is_cpp || is_cxx))
-     grep_file (path, &main_found, &WinMain_found, &DllMain_found);
-#endif
-
-  if (!considered)
-     return (0);
-
-  p = path;
-  if (!strncmp(p, ".\\", 2))
-     p = path + 2;
-
-  add_file (is_c, is_cc, is_cpp, is_cxx, is_rc, is_h_in, p);
-
-  /* Check if this file has a unique directory part that needs to be added to 'vpaths[]'.
-   */
-  slash = strchr (p, '\\');
-  if (!slash)
-     return (0);
-
-  memcpy (dir, p, slash - p);
-  dir [slash - p] = '\0';
-  add_it = true;           /* assume not found */
-
-  for (i = 0; i < smartlist_len(vpaths); i++)
-      if (!strcmp(dir, smartlist_get(vpaths, (int)i)))
-      {
-        add_it = false;    /* already has this in 'vpaths[]' */
-        break;
-      }
-  if (add_it)
-     smartlist_add (vpaths, strdup(dir));
-
-  DEBUG (2, "Did %sadd '%s' to 'vpaths[].'\n", add_it ? "" : "not ", dir);
-  return (0);
-}
-
-static int print_sources (const char *which, const smartlist_t *sl)
-{
-  int i, max = smartlist_len (sl);
-
-  for (i = 0; i < max; i++)
-      DEBUG (2, "%s[%2d]: '%s'\n", which, i, (const char*)smartlist_get(sl,i));
-  return (max);
-}
-
-static int find_sources (void)
+/*
+ * Handle option '--configure in out [VAR=value...]'.
+ */
+static int configure (int num_args, char *const *args)
 {
-  int num;
-
-  c_files    = smartlist_new();
-  cc_files   = smartlist_new();
-  cpp_files  = smartlist_new();
-  cxx_files  = smartlist_new();
-  rc_files   = smartlist_new();
-  h_in_files = smartlist_new();
-  vpaths     = smartlist_new();
+  smartlist_t *vars = smartlist_new();
+  bool         rc;
+  int          i;
 
-  main_found = WinMain_found = DllMain_found = false;
+  if (num_args < 2)
+     Abort ("Option '--configure' needs an input and an output file.\n");
 
-  file_tree_walk (".", file_walker);
+  for (i = 2; i < num_args; i++)
+      smartlist_add (vars, args[i]);
 
-  num  = print_sources ("c_files", c_files);
-  num += print_sources ("cc_files", cc_files);
-  num += print_sources ("cpp_files", cpp_files);
-  num += print_sources ("cxx_files", cxx_files);
-
-  print_sources ("rc_files",   rc_files);
-  print_sources ("h_in_files", h_in_files);
-  return (num);
+  rc = configure_file (args[0], args[1], vars);
+  smartlist_free (vars);
+  return (rc ? 0 : 1);
 }
 
 /*
- * Replace 'ch1' to 'ch2' in string 'str'.
+ * Run the command given by the options in 'ctx'. Or generate the makefile etc.
  */
-static char *str_replace (int ch1, int ch2, char *str)
+static int run (genmake_ctx *ctx, int num_args, char *const *args)
 {
-  char *s;
+  if (do_depend)
+     return genmake_depend (ctx, num_args, args);
 
-  assert (str != NULL);
-  s = str;
-  while (*s)
-  {
-    if (*s == ch1)
-        *s = ch2;
-    s++;
-  }
-  return (str);
-}
+  if (do_affected)
+     return genmake_affected (ctx, num_args, args);
 
-static void write_files (FILE *out, smartlist_t *sl, size_t indent)
-{
-  const char *file;
-  int    i, max = smartlist_len (sl);
-  size_t len;
-  static size_t longest = 0;
+  if (do_report)
+     return genmake_report (ctx, num_args, args);
 
-  if (max == 0)
-     return;
+  if (do_scan_modules)
+     return genmake_scan_modules (ctx, num_args, args);
 
-  for (i = 0; i < max; i++)
-  {
-    file = smartlist_get (sl, i);
-    len = strlen (file);
-    if (len > longest)
-       longest = len;
-  }
+  if (do_analyze_objs)
+     return genmake_analyze_objects (ctx, num_args, args);
+
+  if (do_fingerprint)
+     return genmake_fingerprint (ctx, fingerprint_dir);
 
-  for (i = 0; i < max; i++)
+  genmake_walk (ctx);
+  if (!genmake_classify(ctx))
   {
-    file = smartlist_get (sl, i);
-    len = strlen (file);
-    if (i == 0)
-         fputs (file, out);
-    else fprintf (out, "%-*s%s", (int)indent, "", file);
-
-    if (i < max-1)
-         fprintf (out, " %*s%s\n", (int)(longest - len), "", line_end);
-    else fputc ('\n', out);
+    fputs ("I found no .c/.cc/.cpp/.cxx sources", stderr);
+    return (1);
   }
+  genmake_scan (ctx);
+  return (genmake_write(ctx) ? 0 : 1);
 }
 
 /*
- * Handler for format '%v'.
+ * A component of option '--batch'.
  */
-static void write_vpaths (FILE *out)
-{
-  int i, max = smartlist_len (vpaths);
-
-  if (max == 0)
-     return;
-
-  fprintf (out, "VPATH = ");
-  for (i = 0; i < max; i++)
-      fprintf (out, "%s ", (const char*)smartlist_get(vpaths, i));
-
-  fprintf (out, "  #! Found %d VPATHs\n", max);
-}
+typedef struct batch_job {
+        genmake_ctx *ctx;
+        char        *root;
+        bool         ok;
+      } batch_job;
 
 /*
- * Write out a line from the template. Handle these formats:
- *  '%a' -> '1' if 'astyle.exe' is found on PATH. '0' otherwise.
- *  '%c' -> write the .c/.cc/.cxx/.cpp -> object rule(s).
- *  '%T' -> write the time stamp.
- *  '%s' -> write list of .c-files for the SOURCES line.
- *  '%v' -> write a VPATH statement if needed.
+ * Called from 'run_parallel()' for each component after the walk.
  */
-int write_template_line (FILE *out, const char *templ)
+static void batch_one (void *arg, size_t idx)
 {
-  const char *p;
+  batch_job *job = smartlist_get (arg, (int)idx);
 
-  p = strchr (templ, '%');
-  if (p && p[1] == 'a')
+  if (!genmake_classify(job->ctx))
   {
-    char  exe [256] = "?";
-    DWORD len = SearchPath (getenv("PATH"), "astyle.exe", NULL, sizeof(exe), exe, NULL);
-    bool  found = (len > 0);
-
-    p += 2;
-    return fprintf (out, "%.*s%d%s\n", (int)(p - templ - 2), templ, found, p);
+    fprintf (stderr, "I found no .c/.cc/.cpp/.cxx sources in '%s'.\n", job->root);
+    return;
   }
+  genmake_scan (job->ctx);
+  job->ok = genmake_write (job->ctx);
+}
 
-  p = strchr (templ, '%');
-  if (p && p[1] == 's')
+/*
+ * Handle option '--batch file'.
+ * Each line in 'file' is a 'root template output' of a component. The
+ * 'template' is a built-in name, a template file (with a '.' or a slash)
+ * or '-' for the '--template' or '--template-file' given. A '#' starts a
+ * comment. Each component has it's own include-graph cache and Merkle tree
+ * in it's 'root'. The file-names and '-I' paths written for a component are
+ * relative to it's 'root'; so the 'output' belongs in the 'root'.
+ *
+ * The roots are walked once for all components. Then the components are
+ * generated in parallel.
+ */
+static int batch (const char *file)
+{
+  FILE         *f = fopen (file, "rt");
+  smartlist_t  *jobs = smartlist_new();
+  genmake_ctx **ctx;
+  char          line [3*_MAX_PATH], root [_MAX_PATH], tmpl [_MAX_PATH], output [_MAX_PATH];
+  char          cache [_MAX_PATH], merkle [_MAX_PATH], extra;
+  unsigned      line_num = 0;
+  int           i, num, rc = 0;
+
+  if (!f)
+     Abort ("Failed to open '%s'.\n", file);
+
+  while (rc == 0 && fgets(line, sizeof(line), f))
   {
-    size_t indent = p - templ;
-
-    fprintf (out, "%.*s", (int)indent, templ);
-
-    /* Write the list of .c/.cc/.cpp-files at this point.
-     */
-    write_files (out, c_files, indent);
-    fprintf (out, "%*s#! %zd .c SOURCES files found (recursively: %d)\n", (int)indent, "", num_c_files, file_tree_walk_recursive);
-
-    if (num_cc_files > 0)
+    genmake_options o = opt;
+    smartlist_t    *names = smartlist_new();
+    batch_job      *job;
+
+    line_num++;
+    line [strcspn(line, "#\r\n")] = '\0';
+    num = sscanf (line, "%259s %259s %259s %c", root, tmpl, output, &extra);
+    if (num <= 0)
     {
-      fprintf (out, "\n#\n#! Add these $(CC_SOURCES) to $(OBJECTS) as needed.\n#\nCC_SOURCES = ");
-      write_files (out, cc_files, indent+3);
+      smartlist_free (names);
+      continue;
     }
-
-    if (num_cpp_files > 0)
+    if (num != 3)
     {
-      fprintf (out, "\n#\n#! Add these $(CPP_SOURCES) to $(OBJECTS) as needed.\n#\nCPP_SOURCES = ");
-      write_files (out, cpp_files, indent+4);
+      fprintf (stderr, "%s(%u): expected 'root template output'.\n", file, line_num);
+      smartlist_free (names);
+      rc = 1;
+      break;
     }
 
-    if (num_cxx_files > 0)
+    o.root        = root;
+    o.output_file = output;
+    if (strcmp(tmpl, "-") && strpbrk(tmpl, "./\\"))
     {
-      fprintf (out, "\n#\n#! Add these $(CXX_SOURCES) to $(OBJECTS) as needed.\n#\nCXX_SOURCES = ");
-      write_files (out, cxx_files, indent+4);
+      o.template_file = tmpl;
+      o.templates     = NULL;
+    }
+    else if (strcmp(tmpl, "-"))
+    {
+      smartlist_add (names, tmpl);
+      o.template_file = NULL;
+      o.templates     = names;
+    }
+    if (opt.cache_file)
+    {
+      snprintf (cache, sizeof(cache), "%s/%s", root, opt.cache_file);
+      o.cache_file = cache;
+    }
+    if (opt.merkle_file)
+    {
+      snprintf (merkle, sizeof(merkle), "%s/%s", root, opt.merkle_file);
+      o.merkle_file = merkle;
     }
 
-    if (num_h_in_files > 0)
-       fprintf (out, "%*s#! Found %zd .h.in-file(s); add rules for these as needed.\n", (int)indent, "", num_h_in_files);
-
-    if (num_rc_files)
-       fprintf (out, "%*s#! Found %zd .rc-file(s).\n", (int)indent, "", num_rc_files);
-    return (1);
+    job = calloc (1, sizeof(*job));
+    assert (job);
+    job->root = strdup (root);
+    job->ctx  = genmake_new (&o);
+    smartlist_add (jobs, job);
+    smartlist_free (names);
+    if (!job->ctx)
+    {
+      fprintf (stderr, "%s(%u): illegal component '%s'.\n", file, line_num, root);
+      rc = 1;
+    }
   }
+  fclose (f);
 
-  p = strchr (templ, '%');
-  if (p && p[1] == 'T')
+  num = smartlist_len (jobs);
+  if (rc == 0 && num == 0)
   {
-    time_t now = time (NULL);
+    fprintf (stderr, "No components in '%s'.\n", file);
+    rc = 1;
+  }
 
-    p += 2;
-    return fprintf (out, "%.*s%.24s%s\n", (int)(p - templ - 2), templ, ctime(&now), p);
+  if (rc == 0)
+  {
+    ctx = calloc (num, sizeof(*ctx));
+    assert (ctx);
+    for (i = 0; i < num; i++)
+        ctx[i] = ((batch_job*)smartlist_get(jobs, i))->ctx;
+
+    genmake_walk_many (ctx, num);
+    run_parallel (num, batch_one, jobs);
+    free (ctx);
   }
 
-  p = strchr (templ, '%');
-  if (p && p[1] == 'c')
+  for (i = 0; i < num; i++)
   {
-    assert (c_rule);
-    assert (cc_rule);
-    assert (cpp_rule);
-    assert (cxx_rule);
-
-    if (num_c_files > 0)
-       fprintf (out, "%s\n", c_rule);
-    if (num_cc_files > 0)
-       fprintf (out, "%s\n", cc_rule);
-    if (num_cpp_files > 0)
-       fprintf (out, "%s\n", cpp_rule);
-    if (num_cxx_files > 0)
-       fprintf (out, "%s\n", cxx_rule);
-
-    templ = p + 2;  /* skip past '%c' and fall-through */
+    batch_job *job = smartlist_get (jobs, i);
+
+    if (rc == 0 && !job->ok)
+       rc = 1;
+    if (job->ctx)
+       genmake_free (job->ctx);
+    free (job->root);
+    free (job);
   }
+  smartlist_free (jobs);
+  return (rc);
+}
+#endif /* IN_THE_REAL_MAKEFILE */
 
-  p = strchr (templ, '%');
-  if (p && p[1] == 'v')
+int main (int argc, char **argv)
+{
+#if !defined(IN_THE_REAL_MAKEFILE)
+  fprintf (stderr,
+           "It seems a \"bin/gen-make.exe\" generated Makefile was able to compile and build this '%s' program.\n"
+           "Congratulations! But I will not let you do any damage here.\n", argv[0]);
+  exit (0);
+
+#else
+  genmake_ctx *ctx;
+  int          rc;
+
+  GetModuleFileName (NULL, prog, sizeof(prog));
+  inc_paths       = smartlist_new();
+  unity_excludes  = smartlist_new();
+  templates       = smartlist_new();
+  opt.prog        = prog;
+  opt.unity_size  = 256 * 1024;
+  opt.cache_file  = ".gen-make.cache";
+  opt.merkle_file = ".gen-make.merkle";
+  opt.probe_file  = ".gen-make.probe";
+  opt.report_sort = "parsed";
+  parse_args (argc, argv);
+  tzset();
+
+  if (do_configure)
+     return configure (argc - optind, argv + optind);
+
+  if (do_probe)
   {
-    write_vpaths (out);
-    return (1);
+    probe_tools (opt.probe_file);
+    probe_print();
+    return (0);
   }
 
-  if (!p && !strncmp(templ, "all: ", 5))
+  if (smartlist_len(templates) > 0 && opt.template_file)
+     Abort ("Use either '--template' or '--template-file'.\n");
+  if (smartlist_len(templates) > 1 && (opt.output_file || opt.update_file))
+     Abort ("Options '-o' and '--update' need a single '--template'.\n");
+  if (opt.emit == 0)
+     opt.emit = GENMAKE_EMIT_MAKE;
+  if (opt.emit != GENMAKE_EMIT_MAKE && opt.emit != GENMAKE_EMIT_NINJA && opt.emit != GENMAKE_EMIT_COMPDB && opt.output_file)
+     Abort ("Option '-o' needs a single '--emit'.\n");
+  if ((opt.emit & (GENMAKE_EMIT_NINJA | GENMAKE_EMIT_COMPDB)) && smartlist_len(templates) > 1)
+     Abort ("Options '--emit ninja' and '--emit compdb' need a single '--template'.\n");
+  if (!(opt.emit & GENMAKE_EMIT_MAKE) && opt.update_file)
+     Abort ("Option '--update' needs '--emit make'.\n");
+  if (batch_file && (do_depend || do_affected || do_report || do_scan_modules || do_analyze_objs || do_fingerprint))
+     Abort ("Option '--batch' only generates; drop the '--depend', '--report' etc.\n");
+  if (batch_file && (opt.output_file || opt.update_file || opt.manifest_file))
+     Abort ("Option '--batch' has the outputs in it's file; drop the '-o', '--update' and '--manifest'.\n");
+  if (batch_file && (smartlist_len(templates) > 1 ||
+      (opt.emit != GENMAKE_EMIT_MAKE && opt.emit != GENMAKE_EMIT_NINJA && opt.emit != GENMAKE_EMIT_COMPDB)))
+     Abort ("Option '--batch' needs a single '--template' and '--emit'.\n");
+
+  opt.inc_paths      = inc_paths;
+  opt.unity_excludes = unity_excludes;
+  opt.templates      = templates;
+
+  if (batch_file)
+     rc = batch (batch_file);
+  else
   {
-    if (!main_found && !WinMain_found)
-       fprintf (out, "#\n#! Failed to find a 'main()' or a 'WinMain()' in the SOURCES. Is it a .DLL?\n#\n");
-    else if (DllMain_found)
-       fprintf (out, "#\n#! Found a 'DllMain()' in the SOURCES. Rewrite the '$(PROGRAM)' rule into a 'link_DLL' rule.\n#\n");
+    ctx = genmake_new (&opt);
+    if (!ctx)
+       return (1);
+    rc = run (ctx, argc - optind, argv + optind);
+    genmake_free (ctx);
   }
-  fprintf (out, "%s\n", templ);
-  return (1);
+  genmake_free_caches();
+  smartlist_free (templates);
+  smartlist_free (unity_excludes);
+  smartlist_free (inc_paths);
+  return (rc);
+#endif       /* IN_THE_REAL_MAKEFILE */
 }
-#endif /* IN_THE_REAL_MAKEFILE */
-
@@ -15,15 +15,18 @@
 #define DIM(array)        (sizeof(array) / sizeof(array[0]))
 #define FILE_EXISTS(file) (access(file,0) == 0)
 
-extern const char *c_rule, *cc_rule, *cpp_rule, *cxx_rule;
-extern const char *make_template[];
+#define DEBUG(level, fmt, ...)  do {                                       \
+                                  if (debug_level >= level)                \
+                                     fprintf (stderr, "%s(%u): " fmt,      \
+                                       __FILE__, __LINE__, ##__VA_ARGS__); \
+                                } while (0)
+
+extern int debug_level;
 
 extern void Abort (const char *fmt, ...);
-extern int  write_template_line (FILE *out, const char *str);
 
-typedef int (*walker_func) (const char *found, const WIN32_FIND_DATA *ff_data);
+typedef int (*walker_func) (void *arg, const char *found, const WIN32_FIND_DATA *ff_data);
 
-extern DWORD file_tree_walk (const char *dir, walker_func func);
-extern int   file_tree_walk_recursive;
+extern DWORD file_tree_walk (const char *dir, int recursive, walker_func func, void *arg);
 
 #endif  /* RC_INVOKED */
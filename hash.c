@@ -0,0 +1,256 @@
+/*
+ * A 64-bit non-cryptographic hash for the gen-make program.
+ *
+ * It is modelled on XXH3 (but does not give the same values):
+ * 8 lanes of 64-bit accumulators eat 64-byte stripes. Each stripe
+ * uses the secret at a different offset. After a block of 16 stripes,
+ * the accumulators are scrambled.
+ *
+ * The stripes are done 2 lanes at a time with SSE2 or 4 lanes at a time
+ * with AVX2 (if compiled with '-arch:AVX2'). All give the same values.
+ * Compile with '-DHASH_SCALAR' to force the plain C version; 'make check'
+ * uses that to compare the 3 versions.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "scanner.h"
+
+#if defined(HASH_SCALAR)
+  #define HAVE_AVX2 0
+  #define HAVE_SSE2 0
+#elif defined(__AVX2__)
+  #define HAVE_AVX2 1
+  #define HAVE_SSE2 0
+  #include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define HAVE_AVX2 0
+  #define HAVE_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define HAVE_AVX2 0
+  #define HAVE_SSE2 0
+#endif
+
+#define HASH_LANES          8
+#define HASH_STRIPE_LEN     64
+#define HASH_STRIPES_BLOCK  16
+#define HASH_BLOCK_LEN      (HASH_STRIPE_LEN * HASH_STRIPES_BLOCK)
+
+#define PRIME32_1  0x9E3779B1U
+#define PRIME64_1  0x9E3779B185EBCA87ULL
+#define PRIME64_2  0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3  0x165667B19E3779F9ULL
+
+/*
+ * 24 values of 'splitmix64()' seeded with the first digits of pi.
+ */
+static const uint64_t hash_secret [HASH_LANES + HASH_STRIPES_BLOCK] = {
+  0x2CB0F69F4ABEA221ULL, 0x9417034723148989ULL, 0xDD555950609DFE03ULL,
+  0xDBAFB150DEB12800ULL, 0x7E789B2E6C442CB6ULL, 0xF41E5636C7E4F8C4ULL,
+  0x0959D150F8FBA7E4ULL, 0xA97316F13CDB9EEAULL, 0x74CD8258F9520068ULL,
+  0x55C74A62E116868BULL, 0xD2F4C799A2023CBDULL, 0xDF98CB79A37B51B9ULL,
+  0x396F5885524F3905ULL, 0xAF1D56386CA3B276ULL, 0xA9FFBE6B5104E85AULL,
+  0x6BD0C51B9FD533B3ULL, 0x980CE91C50AB4B56ULL, 0x28AC395780FE62C5ULL,
+  0x768912E3A6BCEDC7ULL, 0x50B3E8C9332C7C88ULL, 0xCE3BBFE520BD47DAULL,
+  0xCBA6C8E8E0BB7C4FULL, 0xBF194DB8434A346DULL, 0x7D8F2A7B60416D7FULL
+};
+
+#if HAVE_AVX2
+/*
+ * Lane 'i' gets the data of lane 'i ^ 1'; the 64-bit halves of each 128-bit
+ * part are swapped. '_mm256_mul_epu32()' gives the 'lo32 * hi32' product.
+ */
+static void accumulate_stripe (uint64_t *acc, const unsigned char *p, const uint64_t *key)
+{
+  __m256i *xacc = (__m256i*) acc;
+  int      i;
+
+  for (i = 0; i < HASH_LANES / 4; i++)
+  {
+    __m256i data = _mm256_loadu_si256 ((const __m256i*)p + i);
+    __m256i k    = _mm256_xor_si256 (data, _mm256_loadu_si256((const __m256i*)key + i));
+    __m256i prod = _mm256_mul_epu32 (k, _mm256_srli_epi64(k, 32));
+    __m256i swap = _mm256_shuffle_epi32 (data, _MM_SHUFFLE(1, 0, 3, 2));
+    __m256i a    = _mm256_loadu_si256 (xacc + i);
+
+    _mm256_storeu_si256 (xacc + i, _mm256_add_epi64(a, _mm256_add_epi64(swap, prod)));
+  }
+}
+
+static void scramble (uint64_t *acc)
+{
+  const uint64_t *key = hash_secret + HASH_STRIPES_BLOCK;
+  const __m256i   prime = _mm256_set1_epi32 ((int)PRIME32_1);
+  __m256i        *xacc = (__m256i*) acc;
+  int             i;
+
+  for (i = 0; i < HASH_LANES / 4; i++)
+  {
+    __m256i a = _mm256_loadu_si256 (xacc + i);
+    __m256i lo, hi;
+
+    a  = _mm256_xor_si256 (a, _mm256_srli_epi64(a, 47));
+    a  = _mm256_xor_si256 (a, _mm256_loadu_si256((const __m256i*)key + i));
+    lo = _mm256_mul_epu32 (a, prime);
+    hi = _mm256_mul_epu32 (_mm256_srli_epi64(a, 32), prime);
+    _mm256_storeu_si256 (xacc + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+  }
+}
+
+#elif HAVE_SSE2
+static void accumulate_stripe (uint64_t *acc, const unsigned char *p, const uint64_t *key)
+{
+  __m128i *xacc = (__m128i*) acc;
+  int      i;
+
+  for (i = 0; i < HASH_LANES / 2; i++)
+  {
+    __m128i data = _mm_loadu_si128 ((const __m128i*)p + i);
+    __m128i k    = _mm_xor_si128 (data, _mm_loadu_si128((const __m128i*)key + i));
+    __m128i prod = _mm_mul_epu32 (k, _mm_srli_epi64(k, 32));
+    __m128i swap = _mm_shuffle_epi32 (data, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i a    = _mm_loadu_si128 (xacc + i);
+
+    _mm_storeu_si128 (xacc + i, _mm_add_epi64(a, _mm_add_epi64(swap, prod)));
+  }
+}
+
+static void scramble (uint64_t *acc)
+{
+  const uint64_t *key = hash_secret + HASH_STRIPES_BLOCK;
+  const __m128i   prime = _mm_set1_epi32 ((int)PRIME32_1);
+  __m128i        *xacc = (__m128i*) acc;
+  int             i;
+
+  for (i = 0; i < HASH_LANES / 2; i++)
+  {
+    __m128i a = _mm_loadu_si128 (xacc + i);
+    __m128i lo, hi;
+
+    a  = _mm_xor_si128 (a, _mm_srli_epi64(a, 47));
+    a  = _mm_xor_si128 (a, _mm_loadu_si128((const __m128i*)key + i));
+    lo = _mm_mul_epu32 (a, prime);
+    hi = _mm_mul_epu32 (_mm_srli_epi64(a, 32), prime);
+    _mm_storeu_si128 (xacc + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+  }
+}
+
+#else
+static uint64_t read64 (const unsigned char *p)
+{
+  uint64_t val;
+
+  memcpy (&val, p, sizeof(val));   /* assumes little-endian */
+  return (val);
+}
+
+static void accumulate_stripe (uint64_t *acc, const unsigned char *p, const uint64_t *key)
+{
+  int i;
+
+  for (i = 0; i < HASH_LANES; i++)
+  {
+    uint64_t data = read64 (p + 8*i);
+    uint64_t k    = data ^ key[i];
+
+    acc [i ^ 1] += data;
+    acc [i]     += (uint64_t)(uint32_t)k * (k >> 32);
+  }
+}
+
+static void scramble (uint64_t *acc)
+{
+  const uint64_t *key = hash_secret + HASH_STRIPES_BLOCK;
+  int             i;
+
+  for (i = 0; i < HASH_LANES; i++)
+  {
+    uint64_t a = acc[i];
+
+    a ^= a >> 47;
+    a ^= key[i];
+    acc[i] = a * PRIME32_1;
+  }
+}
+#endif  /* HAVE_AVX2 || HAVE_SSE2 */
+
+/*
+ * The 128-bit product of 'a * b' with the halves xor'ed.
+ */
+static uint64_t mul128_fold64 (uint64_t a, uint64_t b)
+{
+  uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+  uint64_t hi_lo = (a >> 32)        * (b & 0xFFFFFFFF);
+  uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+  uint64_t hi_hi = (a >> 32)        * (b >> 32);
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+
+  return (upper ^ lower);
+}
+
+static uint64_t avalanche (uint64_t h)
+{
+  h ^= h >> 37;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return (h);
+}
+
+uint64_t hash64 (const void *data, size_t len)
+{
+  const unsigned char *p = data;
+  uint64_t             acc [HASH_LANES] = { PRIME32_1, PRIME64_1, PRIME64_2, PRIME64_3,
+                                            PRIME64_1, PRIME32_1, PRIME64_3, PRIME64_2 };
+  unsigned char        last [HASH_STRIPE_LEN];
+  size_t               left = len;
+  size_t               stripe = 0;
+  uint64_t             h;
+  int                  i;
+
+  while (left >= HASH_STRIPE_LEN)
+  {
+    accumulate_stripe (acc, p, hash_secret + stripe);
+    p    += HASH_STRIPE_LEN;
+    left -= HASH_STRIPE_LEN;
+    if (++stripe == HASH_STRIPES_BLOCK)
+    {
+      scramble (acc);
+      stripe = 0;
+    }
+  }
+
+  /* The last partial stripe is 0-padded. The length is mixed in below.
+   */
+  if (left > 0)
+  {
+    memset (last, '\0', sizeof(last));
+    memcpy (last, p, left);
+    accumulate_stripe (acc, last, hash_secret + stripe);
+  }
+
+  h = len * PRIME64_1;
+  for (i = 0; i < HASH_LANES; i += 2)
+      h += mul128_fold64 (acc[i] ^ hash_secret[8+i], acc[i+1] ^ hash_secret[9+i]);
+  return avalanche (h);
+}
+
+/*
+ * Hash the contents of 'fname'.
+ */
+bool hash_file (const char *fname, uint64_t *hash, uint64_t *size)
+{
+  mapped_file mf;
+
+  if (!map_file(fname, &mf))
+     return (false);
+
+  *hash = hash64 (mf.data, mf.size);
+  *size = mf.size;
+  unmap_file (&mf);
+  return (true);
+}
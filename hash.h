@@ -0,0 +1,11 @@
+#ifndef _HASH_H
+#define _HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+uint64_t hash64 (const void *data, size_t len);
+bool     hash_file (const char *fname, uint64_t *hash, uint64_t *size);
+
+#endif
@@ -0,0 +1,2904 @@
+/*
+ * The gen-make library; see 'libgenmake.h'.
+ *
+ * What was the state of the one generation in the 'gen-make' program is
+ * now in a 'genmake_ctx'. The handlers of the template directives and
+ * variables get it as the 'arg' of the 'template_env'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <ctype.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include "gen-make.h"
+#include "smartlist.h"
+#include "scanner.h"
+#include "depend.h"
+#include "unity.h"
+#include "targets.h"
+#include "manifest.h"
+#include "merkle.h"
+#include "report.h"
+#include "modules.h"
+#include "symbols.h"
+#include "outbuf.h"
+#include "template.h"
+#include "update.h"
+#include "tools.h"
+#include "ninja.h"
+#include "compdb.h"
+#include "probe.h"
+#include "libgenmake.h"
+
+int debug_level = 0;
+
+static const char *line_end = "\\";
+
+/*
+ * Max number of headers in the precompiled header.
+ */
+#define MAX_PCH_HEADERS  8
+
+/*
+ * The 'SCAN_x' flags of each .c/.cc/.cpp/.cxx file.
+ */
+typedef struct entry_scan {
+        const char *file;
+        const char *base;    /* 'file' is relative to this; NULL for "." */
+        unsigned    flags;
+      } entry_scan;
+
+/*
+ * The built-in templates for 'genmake_options::templates'.
+ */
+typedef struct builtin_template {
+        const char          *name;
+        const template_code *code;
+        const char          *makefile;   /* written to if several are used */
+      } builtin_template;
+
+static const builtin_template builtin_templates[] = {
+                            { "windows", &make_template_windows, "Makefile.Windows" },
+                            { "linux",   &make_template_linux,   "Makefile.Linux"   },
+                            { "mingw",   &make_template_mingw,   "Makefile.MinGW"   },
+                            { "cygwin",  &make_template_cygwin,  "Makefile.Cygwin"  }
+                          };
+
+struct genmake_ctx {
+       char         *root;
+       char         *base;             /* 'root' with '/'; NULL for "." */
+       char         *git_dir;          /* 'root\.git\' */
+       char         *prog;
+
+       smartlist_t  *c_files;
+       smartlist_t  *cc_files;
+       smartlist_t  *cpp_files;
+       smartlist_t  *cxx_files;
+       smartlist_t  *rc_files;
+       smartlist_t  *h_in_files;
+       smartlist_t  *h_files;
+       smartlist_t  *ixx_files;        /* C++20 module interfaces; .ixx and .cppm */
+       smartlist_t  *obj_files;        /* for 'genmake_analyze_objects()' */
+       smartlist_t  *vpaths;
+       smartlist_t  *inc_paths;
+       smartlist_t  *found_inc_dirs;   /* 'dep_inc_dir*' from 'infer_inc_paths()' */
+       smartlist_t  *sys_inc_dirs;     /* from '%INCLUDE%' */
+       smartlist_t  *pch_headers;      /* 'dep_header_rank*' from 'find_pch_headers()' */
+       smartlist_t  *pch_ranks;        /* all 'dep_header_rank*' */
+       dep_graph    *src_graph;        /* include-graph of the sources */
+       bool          pch_config_h;     /* include the generated 'config.h' in the PCH */
+       smartlist_t  *unity_excludes;
+       unity_plan   *unity;
+       uint64_t      unity_size;
+       smartlist_t  *programs;         /* 'program*' from 'find_programs()' */
+       smartlist_t  *shared_srcs;      /* the sources not in one program */
+       module_plan  *modules;          /* the C++ sources in module build order */
+       smartlist_t  *dup_sources;      /* groups of identical sources from 'find_duplicates()' */
+       smartlist_t  *dup_unmerged;     /* groups of identical sources including other headers */
+       merkle_tree  *merkle;           /* of the directories walked */
+       merkle_tree  *merkle_prev;      /* as in 'merkle_file' from the previous run */
+       entry_scan   *entry_scans;
+       size_t        num_entry_scans;
+
+       size_t        num_c_files;
+       size_t        num_cc_files;
+       size_t        num_cpp_files;
+       size_t        num_cxx_files;
+       size_t        num_rc_files;
+       size_t        num_h_in_files;
+       int           num_sources;      /* from 'genmake_classify()' */
+
+       bool          recursive;
+       bool          classified;       /* 'genmake_classify()' was done */
+       bool          merkle_query;     /* for '--fingerprint'; do not write 'merkle_file' */
+       bool          json_output;
+       bool          multi_target;
+       bool          main_found;
+       bool          WinMain_found;
+       bool          DllMain_found;
+       bool          dllexport_found;
+
+       unsigned      emit;
+       smartlist_t  *templates;        /* the 'builtin_template*' to use */
+       const template_code *cur_template;  /* the one being written */
+       char         *template_file;
+       char         *output_file;
+       char         *update_file;
+       char         *manifest_file;
+       char         *report_sort;
+       char         *cache_file;
+       char         *merkle_file;
+       char         *probe_file;
+
+       size_t        longest_file;     /* for 'write_files()' */
+       char          var_buf [100];    /* for 'template_var()' */
+       char          targets_buf [100];  /* for 'get_targets()' */
+     };
+
+static char *str_replace (int ch1, int ch2, char *str);
+static int   find_sources (genmake_ctx *ctx);
+static void  infer_inc_paths (genmake_ctx *ctx);
+static void  find_programs (genmake_ctx *ctx);
+static const char *get_targets (genmake_ctx *ctx);
+static bool  get_tools (genmake_ctx *ctx, build_tools *tools);
+static void  affected_programs (genmake_ctx *ctx, const smartlist_t *sources, smartlist_t *targets);
+
+static void add_file (genmake_ctx *ctx, int is_c, int is_cc, int is_cpp, int is_cxx, int is_rc, int is_h_in, const char *file)
+{
+  smartlist_t *array = is_c    ? ctx->c_files    :
+                       is_cc   ? ctx->cc_files   :
+                       is_cpp  ? ctx->cpp_files  :
+                       is_cxx  ? ctx->cxx_files  :
+                       is_rc   ? ctx->rc_files   :
+                       is_h_in ? ctx->h_in_files : NULL;
+
+  size_t *num = is_c    ? &ctx->num_c_files    :
+                is_cc   ? &ctx->num_cc_files   :
+                is_cpp  ? &ctx->num_cpp_files  :
+                is_cxx  ? &ctx->num_cxx_files  :
+                is_rc   ? &ctx->num_rc_files   :
+                is_h_in ? &ctx->num_h_in_files : NULL;
+
+  char *f = strdup (file);
+
+  assert (array);
+  assert (num);
+  str_replace ('\\', '/', f);
+
+  smartlist_add (array, f);
+  *num = smartlist_len (array);
+}
+
+/*
+ * Add the file or directory 'path' found by 'genmake_walk()'. Or by a
+ * walk of a directory above 'root' shared by several contexts.
+ * The names kept are relative to 'root'.
+ */
+void genmake_add_file (genmake_ctx *ctx, const char *path, const WIN32_FIND_DATA *ff)
+{
+  const char *p, *end;
+  char       *dot, *slash, dir [MAX_PATH];
+  int         is_c = 0, is_cc = 0, is_cpp = 0, is_cxx = 0, is_rc = 0, is_h_in = 0, is_h = 0, is_ixx = 0;
+  int         considered;
+  size_t      i, len;
+  bool        add_it;
+
+  p = path;
+  if (!strncmp(p, ".\\", 2))
+     p = path + 2;
+
+  len = strlen (ctx->root);
+  if (strcmp(ctx->root, ".") && !strnicmp(p, ctx->root, len) && p[len] == '\\')
+     p += len + 1;
+
+  /* Alway ignore '.git' entries
+   */
+  if (!strncmp(p, ".git\\", 5))
+     return;
+
+  len = strlen (path);
+  end = strrchr (path, '\0');
+  dot = strrchr (path, '.');
+
+  if (len <= 2 || (size_t)(end - dot) > sizeof(".cpp"))
+     considered = 0;
+
+  else if (!strcmp(dot, ".c"))
+     is_c = 1;
+
+  else if (!strcmp(dot, ".cc"))
+     is_cc = 1;
+
+  else if (!strcmp(dot, ".cpp"))
+     is_cpp = 1;
+
+  else if (!strcmp(dot, ".cxx"))
+     is_cxx = 1;
+
+  else if (!strcmp(dot, ".ixx") || !strcmp(dot, ".cppm"))
+     is_ixx = 1;
+
+  else if (!strcmp(dot-2, ".h.in"))
+     is_h_in = 1;
+
+  else if (stricmp(p, "gen-make.rc") && !strcmp(dot, ".rc"))
+     is_rc = 1;
+
+  else if (!strcmp(dot, ".h") || !strcmp(dot, ".hh") || !strcmp(dot, ".hpp") ||
+           !strcmp(dot, ".hxx") || !strcmp(dot, ".inl"))
+     is_h = 1;
+
+  considered = is_c + is_cc + is_cpp + is_cxx + is_rc;
+
+  DEBUG (2, "%-40s %sconsidered. is_c: %d, is_cc: %d, is_cpp: %d, is_cxx: %d, is_rc: %d\n",
+         path, considered ? "" : "not ", is_c, is_cc, is_cpp, is_cxx, is_rc);
+
+  if (considered || is_h || is_ixx || is_h_in)
+     merkle_add_file (ctx->merkle, p, ((uint64_t)ff->nFileSizeHigh << 32) + ff->nFileSizeLow,
+                      ((uint64_t)ff->ftLastWriteTime.dwHighDateTime << 32) + ff->ftLastWriteTime.dwLowDateTime);
+
+  /* Headers are only needed for 'infer_inc_paths()'
+   */
+  if (is_h)
+  {
+    smartlist_add (ctx->h_files, str_replace('\\', '/', strdup(p)));
+    return;
+  }
+
+  /* The module interfaces get explicit rules from 'write_modules()'; no VPATH needed.
+   */
+  if (is_ixx)
+  {
+    smartlist_add (ctx->ixx_files, str_replace('\\', '/', strdup(p)));
+    return;
+  }
+
+  /* The '.h.in' files are configured into '$(OBJ_DIR)'; no VPATH needed.
+   */
+  if (is_h_in)
+  {
+    add_file (ctx, 0, 0, 0, 0, 0, is_h_in, p);
+    return;
+  }
+
+  if (!considered)
+     return;
+
+  add_file (ctx, is_c, is_cc, is_cpp, is_cxx, is_rc, 0, p);
+
+  /* Check if this file has a unique directory part that needs to be added to 'vpaths[]'.
+   */
+  slash = strrchr (p, '\\');
+  if (!slash)
+     return;
+
+  memcpy (dir, p, slash - p);
+  dir [slash - p] = '\0';
+  str_replace ('\\', '/', dir);
+  add_it = true;           /* assume not found */
+
+  for (i = 0; i < smartlist_len(ctx->vpaths); i++)
+      if (!strcmp(dir, smartlist_get(ctx->vpaths, (int)i)))
+      {
+        add_it = false;    /* already has this in 'vpaths[]' */
+        break;
+      }
+  if (add_it)
+     smartlist_add (ctx->vpaths, strdup(dir));
+
+  DEBUG (2, "Did %sadd '%s' to 'vpaths[].'\n", add_it ? "" : "not ", dir);
+  return;
+}
+
+static int file_walker (void *arg, const char *path, const WIN32_FIND_DATA *ff)
+{
+  genmake_add_file (arg, path, ff);
+  return (0);
+}
+
+/*
+ * Scan the include-graph of 'files' (or all sources if none given).
+ * Use and update the cache.
+ */
+static dep_graph *scan_depend (genmake_ctx *ctx, int num_files, char *const *files)
+{
+  dep_graph *g = dep_graph_new();
+  int        i;
+
+  dep_graph_set_base (g, ctx->base);
+  for (i = 0; i < smartlist_len(ctx->inc_paths); i++)
+      dep_graph_add_inc_path (g, smartlist_get(ctx->inc_paths, i));
+
+  if (ctx->cache_file)
+     dep_graph_use_cache (g, ctx->cache_file);
+
+  if (num_files == 0)
+  {
+    const smartlist_t *lists[5];
+    int                j;
+
+    find_sources (ctx);
+    lists[0] = ctx->c_files;
+    lists[1] = ctx->cc_files;
+    lists[2] = ctx->cpp_files;
+    lists[3] = ctx->cxx_files;
+    lists[4] = ctx->ixx_files;
+    for (i = 0; i < (int)DIM(lists); i++)
+        for (j = 0; j < smartlist_len(lists[i]); j++)
+            dep_graph_add_source (g, smartlist_get(lists[i], j));
+  }
+  else
+  {
+    for (i = 0; i < num_files; i++)
+        dep_graph_add_source (g, files[i]);
+  }
+
+  dep_graph_scan (g);
+  dep_graph_save_cache (g);
+  return (g);
+}
+
+/*
+ * For option '--depend'.
+ * Write the dependencies of 'files' (or all sources if none given) to stdout.
+ */
+int genmake_depend (genmake_ctx *ctx, int num_files, char *const *files)
+{
+  dep_graph *g = scan_depend (ctx, num_files, files);
+
+  dep_graph_write (g, stdout, "$(OBJ_DIR)/", ".obj");
+  DEBUG (1, "Wrote dependencies of %d files (%d files scanned).\n",
+         smartlist_len(g->sources), smartlist_len(g->nodes));
+  dep_graph_free (g);
+  return (0);
+}
+
+static bool is_source_file (const char *file)
+{
+  const char *dot = strrchr (file, '.');
+
+  return (dot && (!strcmp(dot, ".c") || !strcmp(dot, ".cc") ||
+                  !strcmp(dot, ".cpp") || !strcmp(dot, ".cxx") ||
+                  !strcmp(dot, ".ixx") || !strcmp(dot, ".cppm")));
+}
+
+/*
+ * Write 'str' as a JSON string.
+ */
+static void write_json_str (FILE *out, const char *str)
+{
+  fputc ('"', out);
+  for ( ; *str; str++)
+  {
+    if (*str == '"' || *str == '\\')
+         fprintf (out, "\\%c", *str);
+    else if ((unsigned char)*str < ' ')
+         fprintf (out, "\\u%04x", *str);
+    else fputc (*str, out);
+  }
+  fputc ('"', out);
+}
+
+static void write_affected_list (genmake_ctx *ctx, FILE *out, const char *name, const smartlist_t *sl, const char *prefix, bool is_last)
+{
+  int i, max = smartlist_len (sl);
+
+  if (ctx->json_output)
+  {
+    fputs ("  \"", out);
+    for (i = 0; name[i]; i++)
+        fputc (tolower(name[i]), out);
+    fputs ("\": [", out);
+    for (i = 0; i < max; i++)
+    {
+      char buf [_MAX_PATH];
+
+      snprintf (buf, sizeof(buf), "%s%s", prefix ? prefix : "", (const char*)smartlist_get(sl, i));
+      fputs (i > 0 ? ",\n    " : "\n    ", out);
+      write_json_str (out, buf);
+    }
+    fprintf (out, "%s]%s\n", max > 0 ? "\n  " : "", is_last ? "" : ",");
+    return;
+  }
+
+  fprintf (out, "AFFECTED_%s =", name);
+  for (i = 0; i < max; i++)
+      fprintf (out, " %s%s", prefix ? prefix : "", (const char*)smartlist_get(sl, i));
+  fputc ('\n', out);
+}
+
+/*
+ * For option '--report'.
+ * Write the cost of each header included by 'files' (or all sources if none given).
+ */
+int genmake_report (genmake_ctx *ctx, int num_files, char *const *files)
+{
+  dep_graph    *g = scan_depend (ctx, num_files, files);
+  build_report *r = build_report_new (g);
+  int           i, num = smartlist_len (r->headers);
+
+  if (!build_report_sort(r, ctx->report_sort))
+  {
+    fprintf (stderr, "Illegal '--sort' key: '%s'.\n", ctx->report_sort);
+    build_report_free (r);
+    dep_graph_free (g);
+    return (1);
+  }
+
+  if (ctx->json_output)
+  {
+    printf ("{\n  \"translation_units\": %d,\n  \"total_bytes\": %llu,\n  \"total_lines\": %llu,\n"
+            "  \"unguarded\": %d,\n  \"headers\": [",
+            r->num_tus, (unsigned long long)r->total_parsed, (unsigned long long)r->total_lines, r->num_unguarded);
+    for (i = 0; i < num; i++)
+    {
+      const header_report *h = smartlist_get (r->headers, i);
+
+      fputs (i > 0 ? ",\n    { \"header\": " : "\n    { \"header\": ", stdout);
+      write_json_str (stdout, h->node->file);
+      printf (", \"tus\": %d, \"lines\": %llu, \"trans_bytes\": %llu, \"trans_lines\": %llu, \"parsed\": %llu, \"guarded\": %s }",
+              h->num_tus, (unsigned long long)h->lines, (unsigned long long)h->trans_size,
+              (unsigned long long)h->trans_lines, (unsigned long long)h->parsed, h->guarded ? "true" : "false");
+    }
+    printf ("%s]\n}\n", num > 0 ? "\n  " : "");
+  }
+  else
+  {
+    printf ("#   TUs     lines  trans-lines   trans-bytes        parsed  guard  header\n");
+    for (i = 0; i < num; i++)
+    {
+      const header_report *h = smartlist_get (r->headers, i);
+
+      printf ("%7d %9llu %12llu %13llu %13llu  %-5s  %s\n",
+              h->num_tus, (unsigned long long)h->lines, (unsigned long long)h->trans_lines,
+              (unsigned long long)h->trans_size, (unsigned long long)h->parsed,
+              h->guarded ? "yes" : "NO", h->node->file);
+    }
+    printf ("#\n# %d headers in %d translation units; %d without a '#pragma once' or an include-guard.\n"
+            "# %llu bytes (%llu lines) parsed in total.\n",
+            num, r->num_tus, r->num_unguarded, (unsigned long long)r->total_parsed, (unsigned long long)r->total_lines);
+  }
+
+  build_report_free (r);
+  dep_graph_free (g);
+  return (0);
+}
+
+/*
+ * Put the object-name of 'file' in 'buf'; 'dir/foo.cpp' gives 'foo.obj'.
+ */
+static const char *obj_name (const char *file, char *buf, size_t size)
+{
+  const char *base = strrchr (file, '/');
+  const char *dot;
+
+  base = base ? base + 1 : file;
+  dot  = strrchr (base, '.');
+  snprintf (buf, size, "%.*s.obj", dot ? (int)(dot - base) : (int)strlen(base), base);
+  return (buf);
+}
+
+/*
+ * Return a list of the C++ sources; including the module interfaces.
+ */
+static smartlist_t *cxx_sources (genmake_ctx *ctx)
+{
+  smartlist_t *files = smartlist_new();
+
+  smartlist_append (files, ctx->cc_files);
+  smartlist_append (files, ctx->cpp_files);
+  smartlist_append (files, ctx->cxx_files);
+  smartlist_append (files, ctx->ixx_files);
+  return (files);
+}
+
+/*
+ * Scan the C++ sources for module declarations and imports. For the '%M' format.
+ */
+static void find_modules (genmake_ctx *ctx)
+{
+  smartlist_t *files = cxx_sources (ctx);
+
+  ctx->modules = module_plan_new (ctx->base, files);
+  smartlist_free (files);
+}
+
+/*
+ * A P1689 'provides' entry (with the 'is-interface') or a 'requires' entry.
+ */
+static void write_module_name (FILE *out, const char *name, const char *source, bool provides, bool is_interface)
+{
+  char bmi [_MAX_PATH];
+
+  fputs ("{ \"logical-name\": ", out);
+  write_json_str (out, name);
+  if (source)
+  {
+    fputs (", \"source-path\": ", out);
+    write_json_str (out, source);
+    fprintf (out, ", \"compiled-module-path\": \"objects/%s.ifc\"", module_bmi_name(name, bmi, sizeof(bmi)));
+  }
+  if (provides)
+     fprintf (out, ", \"is-interface\": %s", is_interface ? "true" : "false");
+  fputs (" }", out);
+}
+
+/*
+ * For option '--scan-modules'.
+ * Write the modules each of 'files' (or all C++ sources if none given) provides
+ * and requires. In the P1689 format; the units are in build order.
+ */
+int genmake_scan_modules (genmake_ctx *ctx, int num_files, char *const *files)
+{
+  smartlist_t *sl;
+  int          i, j;
+
+  if (num_files == 0)
+  {
+    find_sources (ctx);
+    sl = cxx_sources (ctx);
+  }
+  else
+  {
+    sl = smartlist_new();
+    for (i = 0; i < num_files; i++)
+        smartlist_add (sl, files[i]);
+  }
+
+  ctx->modules = module_plan_new (ctx->base, sl);
+  smartlist_free (sl);
+
+  printf ("{\n  \"version\": 1,\n  \"revision\": 0,\n  \"rules\": [");
+  for (i = 0; i < smartlist_len(ctx->modules->units); i++)
+  {
+    const module_unit *u = smartlist_get (ctx->modules->units, i);
+    char               obj [_MAX_PATH];
+    int                num_reqs = 0;
+
+    printf ("%s\n    {\n      \"primary-output\": \"objects/%s\"", i > 0 ? "," : "", obj_name(u->file, obj, sizeof(obj)));
+    if (u->provides)
+    {
+      fputs (",\n      \"provides\": [ ", stdout);
+      write_module_name (stdout, u->provides, u->file, true, u->is_interface);
+      fputs (" ]", stdout);
+    }
+
+    for (j = 0; j < smartlist_len(u->requires); j++)
+    {
+      const char        *req = smartlist_get (u->requires, j);
+      const module_unit *provider = strmap_get (ctx->modules->providers, req);
+
+      fputs (num_reqs++ > 0 ? ",\n        " : ",\n      \"requires\": [\n        ", stdout);
+      write_module_name (stdout, req, provider ? provider->file : NULL, false, false);
+    }
+    for (j = 0; j < smartlist_len(u->header_units); j++)
+    {
+      const char *h = smartlist_get (u->header_units, j);
+      char       *name = strdup (h + 1);
+
+      name [strlen(name) - 1] = '\0';
+      fputs (num_reqs++ > 0 ? ",\n        " : ",\n      \"requires\": [\n        ", stdout);
+      fputs ("{ \"logical-name\": ", stdout);
+      write_json_str (stdout, name);
+      printf (", \"lookup-method\": \"%s\" }", *h == '<' ? "include-angle" : "include-quote");
+      free (name);
+    }
+    printf ("%s\n    }", num_reqs > 0 ? "\n      ]" : "");
+  }
+  printf ("%s]\n}\n", smartlist_len(ctx->modules->units) > 0 ? "\n  " : "");
+
+  for (i = 0; i < smartlist_len(ctx->modules->missing); i++)
+      fprintf (stderr, "Module '%s' is not provided by any source.\n", (const char*)smartlist_get(ctx->modules->missing, i));
+  return (0);
+}
+
+static int obj_walker (void *arg, const char *path, const WIN32_FIND_DATA *ff)
+{
+  genmake_ctx *ctx = arg;
+  const char  *dot = strrchr (path, '.');
+
+  if (!strncmp(path, ".\\", 2))
+     path += 2;
+
+  if (!strncmp(path, ctx->git_dir, strlen(ctx->git_dir)) || (ff->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+     return (0);
+
+  if (dot && (!stricmp(dot, ".o") || !stricmp(dot, ".obj")))
+  {
+    smartlist_add (ctx->obj_files, str_replace('\\', '/', strdup(path)));
+  }
+  return (0);
+}
+
+/*
+ * The name of the program for the object 'o'; 'dir/foo.o' gives 'foo'.
+ */
+static const char *target_name (const obj_symbols *o, char *buf, size_t size)
+{
+  obj_name (o->file, buf, size);
+  *strrchr (buf, '.') = '\0';
+  return (buf);
+}
+
+static void write_obj_list (FILE *out, const char *name, const smartlist_t *objects)
+{
+  int i;
+
+  fprintf (out, "%s =", name);
+  for (i = 0; i < smartlist_len(objects); i++)
+      fprintf (out, " %s", ((const obj_symbols*)smartlist_get(objects, i))->file);
+  fputc ('\n', out);
+}
+
+/*
+ * For option '--analyze-objects'.
+ * Read the symbols of the object 'files' (or all .o/.obj files found) and
+ * write the objects each program needs. And the other needed objects in
+ * the order a single-pass linker wants them in a static library.
+ */
+int genmake_analyze_objects (genmake_ctx *ctx, int num_files, char *const *files)
+{
+  link_plan *lp;
+  int        i, num_objs = 0;
+
+  ctx->obj_files = smartlist_new();
+  if (num_files == 0)
+       file_tree_walk (ctx->root, ctx->recursive, obj_walker, ctx);
+  else for (i = 0; i < num_files; i++)
+           smartlist_add (ctx->obj_files, str_replace('\\', '/', strdup(files[i])));
+
+  lp = link_plan_new (ctx->obj_files);
+  for (i = 0; i < smartlist_len(lp->objects); i++)
+      if (((const obj_symbols*)smartlist_get(lp->objects, i))->format)
+         num_objs++;
+
+  printf ("#\n# Generated by 'gen-make --analyze-objects' from %d objects.\n"
+          "# %d names defined; %d not defined in any object (in a system library?). %d defined more than once.\n#\n",
+          num_objs, lp->num_defined, lp->num_unresolved, lp->num_duplicates);
+
+  for (i = 0; i < smartlist_len(lp->objects); i++)
+  {
+    const obj_symbols *o = smartlist_get (lp->objects, i);
+
+    if (!o->format)
+       printf ("#! '%s' is not an ELF or COFF object.\n", o->file);
+  }
+  for (i = 0; i < smartlist_len(lp->unreachable); i++)
+      printf ("#! '%s' is not needed by any program or DLL.\n", ((const obj_symbols*)smartlist_get(lp->unreachable, i))->file);
+
+  fputs ("ANALYZED_TARGETS =", stdout);
+  for (i = 0; i < smartlist_len(lp->targets); i++)
+  {
+    const link_target *t = smartlist_get (lp->targets, i);
+    char               name [_MAX_PATH];
+
+    printf (" %s", target_name(t->root, name, sizeof(name)));
+  }
+  fputs ("\n\n", stdout);
+
+  for (i = 0; i < smartlist_len(lp->targets); i++)
+  {
+    const link_target *t = smartlist_get (lp->targets, i);
+    char               name [_MAX_PATH];
+
+    if (t->root->entry)
+         printf ("#\n# The objects needed by '%s()' in '%s'.\n#\n", t->root->entry, t->root->file);
+    else printf ("#\n# The objects needed by the names exported from '%s' etc.\n#\n", t->root->file);
+    target_name (t->root, name, sizeof(name) - sizeof("_OBJECTS"));
+    strcat (name, "_OBJECTS");
+    write_obj_list (stdout, name, t->objects);
+    fputc ('\n', stdout);
+  }
+
+  fputs ("#\n# The objects needed by the programs; each before those it needs.\n#\n", stdout);
+  write_obj_list (stdout, "LIB_OBJ", lp->lib_order);
+
+  link_plan_free (lp);
+  return (0);
+}
+
+static bool in_list (const smartlist_t *sl, const char *str)
+{
+  int i;
+
+  for (i = 0; i < smartlist_len(sl); i++)
+      if (!stricmp(smartlist_get(sl, i), str))
+         return (true);
+  return (false);
+}
+
+/*
+ * For '--affected --multi-target': add the programs that link any of
+ * the 'sources'. A shared source affects all of them.
+ */
+static void affected_programs (genmake_ctx *ctx, const smartlist_t *sources, smartlist_t *targets)
+{
+  bool all = false;
+  int  i, j;
+
+  for (i = 0; i < smartlist_len(sources); i++)
+      if (in_list(ctx->shared_srcs, smartlist_get(sources, i)))
+         all = true;
+
+  if (all)
+     smartlist_add (targets, strdup("lib/shared.lib"));
+
+  for (i = 0; i < smartlist_len(ctx->programs); i++)
+  {
+    const program *p = smartlist_get (ctx->programs, i);
+    bool           add = all;
+
+    for (j = 0; !add && j < smartlist_len(p->sources); j++)
+        add = in_list (sources, smartlist_get(p->sources, j));
+    if (add)
+       smartlist_add (targets, strdup(p->target));
+  }
+}
+
+/*
+ * For option '--affected'.
+ * Write the sources, objects and targets that depend on any of 'files'.
+ * The reverse closure is done directly on the mapped cache. If there is no
+ * cache yet, all sources are scanned first to make one.
+ */
+int genmake_affected (genmake_ctx *ctx, int num_files, char *const *files)
+{
+  dep_cache   *cache;
+  smartlist_t *affected, *sources, *objects, *targets;
+  int         *changed;
+  int          i, num_changed = 0;
+
+  if (!ctx->cache_file)
+  {
+    fprintf (stderr, "Option '--affected' needs a cache; drop the '--no-cache'.\n");
+    return (1);
+  }
+
+  cache = dep_cache_open (ctx->cache_file);
+  if (!cache)
+  {
+    dep_graph_free (scan_depend(ctx, 0, NULL));
+    cache = dep_cache_open (ctx->cache_file);
+    if (!cache)
+    {
+      fprintf (stderr, "Failed to create the cache '%s'.\n", ctx->cache_file);
+      return (1);
+    }
+  }
+
+  changed = calloc (num_files + 1, sizeof(*changed));
+  assert (changed);
+
+  sources = smartlist_new();
+  for (i = 0; i < num_files; i++)
+  {
+    char *file = dep_normalise (strdup(files[i]));
+    int   idx  = dep_cache_lookup (cache, file);
+
+    if (idx >= 0)
+         changed [num_changed++] = idx;
+    else if (is_source_file(file))
+         smartlist_add (sources, strdup(file));   /* a new source */
+    DEBUG (1, "Changed file '%s' is %sin the cache.\n", file, idx >= 0 ? "" : "not ");
+    free (file);
+  }
+
+  affected = dep_cache_affected (cache, changed, num_changed);
+  for (i = 0; i < smartlist_len(affected); i++)
+  {
+    const char *file = smartlist_get (affected, i);
+
+    if (is_source_file(file))
+       smartlist_add (sources, strdup(file));
+  }
+  smartlist_sort (sources, smartlist_compare_strings);
+  smartlist_make_uniq (sources, smartlist_compare_strings, free);
+
+  objects = smartlist_new();
+  for (i = 0; i < smartlist_len(sources); i++)
+  {
+    const char *file = smartlist_get (sources, i);
+    const char *base = strrchr (file, '/');
+    char       *obj  = malloc (strlen(file) + sizeof(".obj"));
+
+    base = base ? base + 1 : file;
+    strcpy (obj, base);
+    strcpy (strrchr(obj, '.'), ".obj");
+    smartlist_add (objects, obj);
+  }
+  smartlist_sort (objects, smartlist_compare_strings);
+  smartlist_make_uniq (objects, smartlist_compare_strings, free);
+
+  /* Only look for the entry points when something needs to be relinked.
+   */
+  targets = smartlist_new();
+  if (smartlist_len(sources) > 0 && ctx->multi_target)
+  {
+    find_sources (ctx);
+    infer_inc_paths (ctx);
+    find_programs (ctx);
+    affected_programs (ctx, sources, targets);
+  }
+  else if (smartlist_len(sources) > 0)
+  {
+    char *tok, *copy;
+
+    find_sources (ctx);
+    copy = strdup (get_targets(ctx));
+    for (tok = strtok(copy, " "); tok; tok = strtok(NULL, " "))
+        smartlist_add (targets, strdup(tok));
+    free (copy);
+  }
+
+  if (ctx->json_output)
+     fputs ("{\n", stdout);
+  write_affected_list (ctx, stdout, "SOURCES", sources, NULL, false);
+  write_affected_list (ctx, stdout, "OBJECTS", objects, "$(OBJ_DIR)/", false);
+  write_affected_list (ctx, stdout, "TARGETS", targets, NULL, true);
+  if (ctx->json_output)
+     fputs ("}\n", stdout);
+
+  DEBUG (1, "%d files changed; %d files, %d sources affected.\n",
+         num_files, smartlist_len(affected), smartlist_len(sources));
+
+  smartlist_free (affected);
+  smartlist_free_all (sources);
+  smartlist_free_all (objects);
+  smartlist_free_all (targets);
+  dep_cache_close (cache);
+  free (changed);
+  return (0);
+}
+
+/*
+ * Find the directories needed (in addition to '.' and the '-I' paths given)
+ * to resolve the includes in the sources. For the '%I' format.
+ * The include-graph is kept in 'src_graph' for 'find_pch_headers()'.
+ */
+static void infer_inc_paths (genmake_ctx *ctx)
+{
+  const smartlist_t *lists[] = { ctx->c_files, ctx->cc_files, ctx->cpp_files, ctx->cxx_files, ctx->ixx_files };
+  dep_graph         *g = dep_graph_new();
+  const char        *env = getenv ("INCLUDE");
+  size_t             i;
+  int                j;
+
+  dep_graph_set_base (g, ctx->base);
+  dep_graph_add_inc_path (g, ".");
+  for (j = 0; j < smartlist_len(ctx->inc_paths); j++)
+      dep_graph_add_inc_path (g, smartlist_get(ctx->inc_paths, j));
+
+  /* Add the compiler's include dirs. So the size of e.g. '<windows.h>' is known.
+   */
+  ctx->sys_inc_dirs = smartlist_new();
+  if (env)
+  {
+    char *copy = strdup (env);
+    char *tok;
+
+    for (tok = strtok(copy, ";"); tok; tok = strtok(NULL, ";"))
+    {
+      smartlist_add (ctx->sys_inc_dirs, dep_normalise(strdup(tok)));
+      dep_graph_add_inc_path (g, tok);
+    }
+    free (copy);
+  }
+
+  /* Use the cache, but do not update it. The '-I' paths differs from '--depend'.
+   */
+  if (ctx->cache_file)
+     dep_graph_use_cache (g, ctx->cache_file);
+
+  for (i = 0; i < DIM(lists); i++)
+      for (j = 0; j < smartlist_len(lists[i]); j++)
+          dep_graph_add_source (g, smartlist_get(lists[i], j));
+
+  ctx->found_inc_dirs = dep_graph_infer_inc_paths (g, ctx->h_files);
+  ctx->src_graph = g;
+}
+
+/*
+ * Return the name of 'file' relative to the '%INCLUDE%' dir it's in.
+ * Or NULL if not a system header.
+ */
+static const char *sys_header_name (genmake_ctx *ctx, const char *file)
+{
+  int i;
+
+  for (i = 0; i < smartlist_len(ctx->sys_inc_dirs); i++)
+  {
+    const char *dir = smartlist_get (ctx->sys_inc_dirs, i);
+    size_t      len = strlen (dir);
+
+    if (!strnicmp(file, dir, len) && file[len] == '/')
+       return (file + len + 1);
+  }
+  return (NULL);
+}
+
+/*
+ * Select the headers for a precompiled header. For the '%P' format.
+ *
+ * The headers are ranked by the number of .c files including them times
+ * their total size. Only the stable ones are used; the system headers.
+ * And the generated 'config.h' if a source includes it. A header should
+ * be included by at least half of the .c files. A header included by
+ * another selected header is not needed.
+ */
+static void find_pch_headers (genmake_ctx *ctx)
+{
+  smartlist_t *tus = smartlist_new();
+  int          i, j, min_tus;
+
+  ctx->pch_headers = smartlist_new();
+  for (i = 0; i < smartlist_len(ctx->c_files); i++)
+      smartlist_add (tus, dep_graph_add_source(ctx->src_graph, smartlist_get(ctx->c_files, i)));
+
+  min_tus = smartlist_len (tus) / 2;
+  if (min_tus < 2)
+     min_tus = 2;
+  ctx->pch_ranks = dep_graph_rank_headers (ctx->src_graph, tus, min_tus);
+
+  for (i = 0; i < smartlist_len(ctx->pch_ranks) && smartlist_len(ctx->pch_headers) < MAX_PCH_HEADERS; i++)
+  {
+    dep_header_rank *r = smartlist_get (ctx->pch_ranks, i);
+    bool             needed = true;
+
+    if (!sys_header_name(ctx, r->node->file))
+       continue;
+
+    for (j = 0; needed && j < smartlist_len(ctx->pch_headers); j++)
+    {
+      const dep_header_rank *sel = smartlist_get (ctx->pch_headers, j);
+
+      needed = !dep_graph_includes (ctx->src_graph, sel->node, r->node);
+    }
+    if (needed)
+       smartlist_add (ctx->pch_headers, r);
+    DEBUG (1, "PCH candidate %-30s %d TUs, %llu bytes, %sneeded.\n",
+           r->node->file, r->num_tus, (unsigned long long)r->size, needed ? "" : "not ");
+  }
+
+  /* The includes of "config.h" are not found since it's generated
+   * by the makefile.
+   */
+  for (i = 0; ctx->src_graph->unresolved && i < smartlist_len(ctx->src_graph->unresolved); i++)
+  {
+    const dep_unresolved *u = smartlist_get (ctx->src_graph->unresolved, i);
+
+    if (!stricmp(u->raw, "\"config.h"))
+       ctx->pch_config_h = true;
+  }
+  smartlist_free (tus);
+}
+
+/*
+ * For option '--multi-target': make a program of each source with a
+ * 'main()' or 'WinMain()'. Needs the 'src_graph' from 'infer_inc_paths()'.
+ */
+static void find_programs (genmake_ctx *ctx)
+{
+  smartlist_t *mains  = smartlist_new();
+  smartlist_t *others = smartlist_new();
+  build_tools  tools;
+  size_t       i;
+
+  for (i = 0; i < ctx->num_entry_scans; i++)
+  {
+    if (ctx->entry_scans[i].flags & (SCAN_MAIN | SCAN_WINMAIN))
+         smartlist_add (mains, (void*)ctx->entry_scans[i].file);
+    else smartlist_add (others, (void*)ctx->entry_scans[i].file);
+  }
+
+  ctx->shared_srcs = smartlist_new();
+  if (smartlist_len(mains) > 0)
+     ctx->programs = partition_programs (ctx->src_graph, mains, others, ctx->shared_srcs);
+  smartlist_free (mains);
+  smartlist_free (others);
+
+  /* The targets are 'bin/name.exe'; use the '.exe' of the template.
+   */
+  if (ctx->programs && get_tools(ctx, &tools))
+  {
+    for (i = 0; i < (size_t)smartlist_len(ctx->programs); i++)
+    {
+      program *p   = smartlist_get (ctx->programs, (int)i);
+      char    *dot = strrchr (p->target, '.');
+      char     target [_MAX_PATH];
+
+      snprintf (target, sizeof(target), "%.*s%s", (int)(dot - p->target), p->target, tools.exe_ext);
+      free (p->target);
+      p->target = strdup (target);
+    }
+    build_tools_free (&tools);
+  }
+}
+
+/*
+ * Handler for option '--manifest'.
+ * Hash all files found and write the sorted manifest.
+ */
+static void write_manifest (genmake_ctx *ctx)
+{
+  const smartlist_t *lists[] = { ctx->c_files, ctx->cc_files, ctx->cpp_files, ctx->cxx_files, ctx->ixx_files, ctx->rc_files, ctx->h_in_files, ctx->h_files };
+  smartlist_t       *files = smartlist_new();
+  manifest          *m;
+  size_t             i;
+
+  for (i = 0; i < DIM(lists); i++)
+      smartlist_append (files, lists[i]);
+
+  m = manifest_new (ctx->base, files);
+  manifest_write (m, ctx->manifest_file);
+  manifest_free (m);
+  smartlist_free (files);
+}
+
+static int print_sources (const char *which, const smartlist_t *sl)
+{
+  int i, max = smartlist_len (sl);
+
+  for (i = 0; i < max; i++)
+      DEBUG (2, "%s[%2d]: '%s'\n", which, i, (const char*)smartlist_get(sl,i));
+  return (max);
+}
+
+/*
+ * Save the Merkle tree of this walk if it's top changed since the previous
+ * run; not for '--fingerprint'. The hashes are for '--fingerprint' and for
+ * tools keying a cache on a subtree. gen-make itself still walks all of it.
+ * With '-d', the changed directories are listed (only a changed directory
+ * is descended into).
+ */
+static void update_merkle (genmake_ctx *ctx)
+{
+  merkle_finish (ctx->merkle);
+  if (ctx->merkle_file)
+     ctx->merkle_prev = merkle_read (ctx->merkle_file);
+
+  if (debug_level >= 1)
+  {
+    smartlist_t *changed = smartlist_new();
+    int          i, num = merkle_changed (ctx->merkle, ctx->merkle_prev, changed);
+
+    DEBUG (1, "%d directories changed since the last run.\n", num);
+    for (i = 0; i < num; i++)
+        DEBUG (2, "  %s\n", (const char*)smartlist_get(changed, i));
+    smartlist_free (changed);
+  }
+
+  if (ctx->merkle_file && !ctx->merkle_query &&
+      (!ctx->merkle_prev || ctx->merkle_prev->root->hash != ctx->merkle->root->hash))
+     merkle_write (ctx->merkle, ctx->merkle_file);
+}
+
+/*
+ * For option '--fingerprint'.
+ * Write the Merkle hash of 'dir' and if it changed since the last run.
+ * A query; the 'merkle_file' is not updated.
+ */
+int genmake_fingerprint (genmake_ctx *ctx, const char *dir)
+{
+  const merkle_dir *d, *prev;
+  int               rc = 0;
+
+  ctx->merkle_query = true;
+  find_sources (ctx);
+  d = merkle_lookup (ctx->merkle, dir);
+  prev = ctx->merkle_prev ? merkle_lookup (ctx->merkle_prev, dir) : NULL;
+
+  if (!d)
+  {
+    fprintf (stderr, "No files used by gen-make in '%s'%s.\n", dir, prev ? " now" : "");
+    rc = 1;
+  }
+  else if (ctx->json_output)
+  {
+    fputs ("{\"dir\": ", stdout);
+    write_json_str (stdout, d->dir);
+    printf (", \"hash\": \"%016llx\", \"files\": %u, \"changed\": %s}\n",
+            (unsigned long long)d->hash, d->num_files,
+            !ctx->merkle_prev ? "null" : (prev && prev->hash == d->hash) ? "false" : "true");
+  }
+  else
+    printf ("%016llx %s%s\n", (unsigned long long)d->hash, d->dir,
+            !ctx->merkle_prev ? "" : (prev && prev->hash == d->hash) ? " (unchanged)" : " (changed)");
+  return (rc);
+}
+
+/*
+ * The sorted names of the files 'node' includes; directly or not.
+ */
+static smartlist_t *include_closure (dep_graph *g, dep_node *node)
+{
+  smartlist_t *deps  = smartlist_new();
+  smartlist_t *names = smartlist_new();
+  int          i;
+
+  dep_graph_closure (g, node, deps);
+  for (i = 0; i < smartlist_len(deps); i++)
+      smartlist_add (names, ((dep_node*)smartlist_get(deps, i))->file);
+  smartlist_free (deps);
+  smartlist_sort (names, smartlist_compare_strings);
+  return (names);
+}
+
+static bool same_closure (const smartlist_t *a, const smartlist_t *b)
+{
+  int i;
+
+  if (smartlist_len(a) != smartlist_len(b))
+     return (false);
+  for (i = 0; i < smartlist_len(a); i++)
+      if (stricmp(smartlist_get(a, i), smartlist_get(b, i)))
+         return (false);
+  return (true);
+}
+
+/*
+ * Split the identical sources in 'group' on the headers they include.
+ * E.g. 2 copies of 'util.c' each including the 'util.h' next to it do not
+ * give the same object. Those including the same headers as the first stay
+ * in 'group'; the others are moved to a new group in 'ctx->dup_unmerged'
+ * (with the first) and are compiled as usual.
+ */
+static void split_on_includes (genmake_ctx *ctx, dep_graph *g, smartlist_t *group)
+{
+  smartlist_t *first = include_closure (g, dep_graph_add_source(g, smartlist_get(group, 0)));
+  smartlist_t *other = NULL;
+  int          i;
+
+  for (i = 1; i < smartlist_len(group); i++)
+  {
+    const char  *file = smartlist_get (group, i);
+    smartlist_t *incs = include_closure (g, dep_graph_add_source(g, file));
+
+    if (!same_closure(first, incs))
+    {
+      DEBUG (1, "%s is identical to %s but includes other headers.\n", file, (const char*)smartlist_get(group, 0));
+      if (!other)
+      {
+        other = smartlist_new();
+        smartlist_add (other, smartlist_get(group, 0));
+      }
+      smartlist_add (other, (void*)file);
+      smartlist_del_keeporder (group, i--);
+    }
+    smartlist_free (incs);
+  }
+  if (other)
+     smartlist_add (ctx->dup_unmerged, other);
+  smartlist_free (first);
+}
+
+/*
+ * Find the byte-identical .c/.cc/.cpp/.cxx files; like vendored copies of
+ * the same source. Only if they also include the same headers (from '.' and
+ * the '-I' paths) is the first of each group kept in the lists; it's object
+ * is compiled once and is the object for all of them. The groups are
+ * reported by the '%s' format.
+ */
+static void find_duplicates (genmake_ctx *ctx)
+{
+  smartlist_t *lists[] = { ctx->c_files, ctx->cc_files, ctx->cpp_files, ctx->cxx_files };
+  size_t      *nums[]  = { &ctx->num_c_files, &ctx->num_cc_files, &ctx->num_cpp_files, &ctx->num_cxx_files };
+  strmap_t    *copies  = strmap_new (false);
+  smartlist_t *kept    = smartlist_new();
+  dep_graph   *g = NULL;
+  size_t       i;
+  int          j, k;
+
+  ctx->dup_sources  = smartlist_new();
+  ctx->dup_unmerged = smartlist_new();
+  for (i = 0; i < DIM(lists); i++)
+  {
+    smartlist_t *groups;
+
+    if (smartlist_len(lists[i]) < 2)
+       continue;
+
+    groups = manifest_duplicates (ctx->base, lists[i]);
+    if (smartlist_len(groups) == 0)
+    {
+      manifest_duplicates_free (groups);
+      continue;
+    }
+
+    /* Only the sources in a group need to be scanned for includes.
+     */
+    if (!g)
+    {
+      g = dep_graph_new();
+      dep_graph_set_base (g, ctx->base);
+      dep_graph_add_inc_path (g, ".");
+      for (j = 0; j < smartlist_len(ctx->inc_paths); j++)
+          dep_graph_add_inc_path (g, smartlist_get(ctx->inc_paths, j));
+      if (ctx->cache_file)
+         dep_graph_use_cache (g, ctx->cache_file);
+    }
+    for (j = 0; j < smartlist_len(groups); j++)
+    {
+      smartlist_t *group = smartlist_get (groups, j);
+
+      for (k = 0; k < smartlist_len(group); k++)
+          dep_graph_add_source (g, smartlist_get(group, k));
+    }
+    dep_graph_scan (g);
+
+    for (j = 0; j < smartlist_len(groups); j++)
+    {
+      smartlist_t *group = smartlist_get (groups, j);
+
+      split_on_includes (ctx, g, group);
+      if (smartlist_len(group) < 2)
+      {
+        smartlist_free (group);
+        smartlist_del_keeporder (groups, j--);
+        continue;
+      }
+      for (k = 1; k < smartlist_len(group); k++)
+          strmap_set (copies, smartlist_get(group, k), group);
+      DEBUG (1, "%s has %d identical copies.\n", (const char*)smartlist_get(group, 0), smartlist_len(group) - 1);
+    }
+    smartlist_append (ctx->dup_sources, groups);
+    smartlist_free (groups);
+
+    smartlist_clear (kept);
+    for (j = 0; j < smartlist_len(lists[i]); j++)
+        if (!strmap_get(copies, smartlist_get(lists[i], j)))
+           smartlist_add (kept, smartlist_get(lists[i], j));
+    smartlist_clear (lists[i]);
+    smartlist_append (lists[i], kept);
+    *nums[i] = smartlist_len (lists[i]);
+  }
+  if (g)
+     dep_graph_free (g);
+  strmap_free (copies, NULL);
+  smartlist_free (kept);
+}
+
+/*
+ * For the '%s' format: tell which sources are not compiled since
+ * they are identical to another.
+ */
+static void write_duplicates (genmake_ctx *ctx, out_buf *out, size_t indent)
+{
+  int i, j, num = 0;
+
+  for (i = 0; i < smartlist_len(ctx->dup_sources); i++)
+  {
+    const smartlist_t *group = smartlist_get (ctx->dup_sources, i);
+    const char        *first = smartlist_get (group, 0);
+    char               obj [_MAX_PATH];
+
+    obj_name (first, obj, sizeof(obj));
+    for (j = 1; j < smartlist_len(group); j++, num++)
+    {
+      buf_pad (out, indent);
+      buf_printf (out, "#! '%s' is identical to '%s'; compiled once as '$(OBJ_DIR)/%s'.\n",
+                  (const char*)smartlist_get(group, j), first, obj);
+    }
+  }
+  if (num > 0)
+  {
+    buf_pad (out, indent);
+    buf_printf (out, "#! %d duplicated source(s) not in the SOURCES.\n", num);
+  }
+
+  for (i = 0; i < smartlist_len(ctx->dup_unmerged); i++)
+  {
+    const smartlist_t *group = smartlist_get (ctx->dup_unmerged, i);
+
+    for (j = 1; j < smartlist_len(group); j++)
+    {
+      buf_pad (out, indent);
+      buf_printf (out, "#! '%s' is identical to '%s' but includes other headers; compiled separately.\n",
+                  (const char*)smartlist_get(group, j), (const char*)smartlist_get(group, 0));
+    }
+  }
+}
+
+static void scan_one_entry (void *arg, size_t idx)
+{
+  entry_scan *es = (entry_scan*) arg + idx;
+  char        buf [_MAX_PATH];
+
+  es->flags = scan_file_entry_points (base_path(es->base, es->file, buf, sizeof(buf)));
+}
+
+/*
+ * Check all the .c/.cc/.cpp/.cxx files for a 'main(', 'WinMain(', 'DllMain('
+ * or a '__declspec(dllexport)'. Done in parallel.
+ */
+static void find_entry_points (genmake_ctx *ctx)
+{
+  const smartlist_t *lists[] = { ctx->c_files, ctx->cc_files, ctx->cpp_files, ctx->cxx_files };
+  size_t i, n = 0;
+  int    j;
+
+  ctx->num_entry_scans = ctx->num_c_files + ctx->num_cc_files + ctx->num_cpp_files + ctx->num_cxx_files;
+  ctx->entry_scans = calloc (ctx->num_entry_scans + 1, sizeof(*ctx->entry_scans));
+
+  for (i = 0; i < DIM(lists); i++)
+      for (j = 0; j < smartlist_len(lists[i]); j++)
+      {
+        ctx->entry_scans [n].file   = smartlist_get (lists[i], j);
+        ctx->entry_scans [n++].base = ctx->base;
+      }
+
+  run_parallel (ctx->num_entry_scans, scan_one_entry, ctx->entry_scans);
+
+  for (i = 0; i < ctx->num_entry_scans; i++)
+  {
+    unsigned flags = ctx->entry_scans[i].flags;
+
+    if (flags & SCAN_MAIN)
+       ctx->main_found = true;
+    if (flags & SCAN_WINMAIN)
+       ctx->WinMain_found = true;
+    if (flags & SCAN_DLLMAIN)
+       ctx->DllMain_found = true;
+    if (flags & SCAN_DLLEXPORT)
+       ctx->dllexport_found = true;
+    if (flags)
+       DEBUG (1, "%-30s main: %d, WinMain: %d, DllMain: %d, dllexport: %d\n",
+              ctx->entry_scans[i].file, !!(flags & SCAN_MAIN), !!(flags & SCAN_WINMAIN),
+              !!(flags & SCAN_DLLMAIN), !!(flags & SCAN_DLLEXPORT));
+  }
+}
+
+/*
+ * Walk 'root' for the files used; see 'genmake_add_file()'.
+ */
+void genmake_walk (genmake_ctx *ctx)
+{
+  file_tree_walk (ctx->root, ctx->recursive, file_walker, ctx);
+}
+
+/*
+ * For 'genmake_walk_many()'.
+ */
+typedef struct walk_many {
+        strmap_t    *by_root;    /* root -> 'smartlist_t*' of the 'genmake_ctx*' with it */
+        smartlist_t *tops;       /* the roots not below another root */
+        int          recursive;
+      } walk_many;
+
+static void free_ctx_list (void *val)
+{
+  smartlist_free (val);
+}
+
+/*
+ * Return true if the normalised 'path' is below ".". I.e. not absolute
+ * and not starting with "..".
+ */
+static bool below_dot (const char *path)
+{
+  if (path[0] == '\\' || (path[0] && path[1] == ':'))
+     return (false);
+  return (strcmp(path, "..") && strncmp(path, "..\\", 3));
+}
+
+/*
+ * Give 'path' to the contexts with root 'root'. 'rest' is the part of
+ * 'path' below 'root'.
+ */
+static void add_to_root (const walk_many *wm, const char *root, const char *path,
+                         const char *rest, const WIN32_FIND_DATA *ff)
+{
+  const smartlist_t *ctxs = strmap_get (wm->by_root, root);
+  int                i;
+
+  for (i = 0; ctxs && i < smartlist_len(ctxs); i++)
+  {
+    genmake_ctx *ctx = smartlist_get (ctxs, i);
+
+    if (ctx->recursive || !strchr(rest, '\\'))
+       genmake_add_file (ctx, path, ff);
+  }
+}
+
+/*
+ * Look up each directory above 'path' in the roots. That's a few
+ * hash lookups for each file; not one compare for each root.
+ */
+static int many_walker (void *arg, const char *path, const WIN32_FIND_DATA *ff)
+{
+  const walk_many *wm = arg;
+  const char      *p = path;
+  char             dir [MAX_PATH], *s;
+
+  if (!strncmp(p, ".\\", 2))
+     p += 2;
+
+  if (below_dot(p))
+     add_to_root (wm, ".", path, p, ff);
+
+  snprintf (dir, sizeof(dir), "%s", p);
+  for (s = strchr(dir, '\\'); s; s = strchr(s + 1, '\\'))
+  {
+    *s = '\0';
+    add_to_root (wm, dir, path, p + (s - dir) + 1, ff);
+    *s = '\\';
+  }
+  return (0);
+}
+
+/*
+ * Called from 'run_parallel()' for each top root. The contexts below two
+ * top roots are not the same; so no locking is needed.
+ */
+static void walk_top (void *arg, size_t idx)
+{
+  const walk_many *wm = arg;
+
+  file_tree_walk (smartlist_get(wm->tops, (int)idx), wm->recursive, many_walker, (void*)wm);
+}
+
+/*
+ * Return true if a directory above 'root' is also a root.
+ * The roots are normalised; so a root above is a prefix of whole components.
+ */
+static bool below_root (const walk_many *wm, const char *root)
+{
+  char  dir [MAX_PATH];
+  char *s;
+
+  if (!strcmp(root, "."))
+     return (false);
+  if (below_dot(root) && strmap_get(wm->by_root, "."))
+     return (true);
+
+  snprintf (dir, sizeof(dir), "%s", root);
+  while ((s = strrchr(dir, '\\')) != NULL)
+  {
+    *s = '\0';
+    if (strmap_get(wm->by_root, dir))
+       return (true);
+  }
+  return (false);
+}
+
+/*
+ * Walk the roots of 'num' contexts once; instead of a 'genmake_walk()'
+ * of each. Only the top roots are walked (in parallel). Each file found
+ * is given to the contexts with a root above it; the same files in the
+ * same order as their own walk would find.
+ */
+void genmake_walk_many (genmake_ctx **ctx, size_t num)
+{
+  walk_many    wm;
+  smartlist_t *ctxs;
+  size_t       i;
+
+  wm.by_root   = strmap_new (true);
+  wm.tops      = smartlist_new();
+  wm.recursive = 0;
+
+  for (i = 0; i < num; i++)
+  {
+    ctxs = strmap_get (wm.by_root, ctx[i]->root);
+    if (!ctxs)
+    {
+      ctxs = smartlist_new();
+      strmap_set (wm.by_root, ctx[i]->root, ctxs);
+    }
+    smartlist_add (ctxs, ctx[i]);
+    if (ctx[i]->recursive)
+       wm.recursive = 1;
+  }
+
+  for (i = 0; i < num; i++)
+  {
+    ctxs = strmap_get (wm.by_root, ctx[i]->root);
+    if (smartlist_get(ctxs, 0) != ctx[i])
+       continue;
+    if (below_root(&wm, ctx[i]->root))
+         wm.recursive = 1;   /* to get to it from the top root */
+    else smartlist_add (wm.tops, ctx[i]->root);
+  }
+
+  DEBUG (1, "Walking %d top roots for %u contexts.\n", smartlist_len(wm.tops), (unsigned)num);
+  run_parallel (smartlist_len(wm.tops), walk_top, &wm);
+
+  smartlist_free (wm.tops);
+  strmap_free (wm.by_root, free_ctx_list);
+}
+
+/*
+ * After the walk: update the Merkle tree, drop the duplicated sources and
+ * look for the entry-points. Return the number of sources found.
+ */
+int genmake_classify (genmake_ctx *ctx)
+{
+  int num;
+
+  update_merkle (ctx);
+  find_duplicates (ctx);
+  find_entry_points (ctx);
+
+  num  = print_sources ("c_files", ctx->c_files);
+  num += print_sources ("cc_files", ctx->cc_files);
+  num += print_sources ("cpp_files", ctx->cpp_files);
+  num += print_sources ("cxx_files", ctx->cxx_files);
+
+  print_sources ("rc_files",   ctx->rc_files);
+  print_sources ("h_in_files", ctx->h_in_files);
+  print_sources ("ixx_files",  ctx->ixx_files);
+
+  ctx->classified  = true;
+  ctx->num_sources = num + smartlist_len (ctx->ixx_files);
+  return (ctx->num_sources);
+}
+
+/*
+ * Walk and classify once; '--affected' can need the sources both for a
+ * new cache and for the programs.
+ */
+static int find_sources (genmake_ctx *ctx)
+{
+  if (ctx->classified)
+     return (ctx->num_sources);
+  genmake_walk (ctx);
+  return genmake_classify (ctx);
+}
+
+/*
+ * Replace 'ch1' to 'ch2' in string 'str'.
+ */
+static char *str_replace (int ch1, int ch2, char *str)
+{
+  char *s;
+
+  assert (str != NULL);
+  s = str;
+  while (*s)
+  {
+    if (*s == ch1)
+        *s = ch2;
+    s++;
+  }
+  return (str);
+}
+
+static void write_files (genmake_ctx *ctx, out_buf *out, smartlist_t *sl, size_t indent)
+{
+  const char *file;
+  int    i, max = smartlist_len (sl);
+  size_t len;
+
+  if (max == 0)
+     return;
+
+  for (i = 0; i < max; i++)
+  {
+    file = smartlist_get (sl, i);
+    len = strlen (file);
+    if (len > ctx->longest_file)
+       ctx->longest_file = len;
+  }
+
+  for (i = 0; i < max; i++)
+  {
+    file = smartlist_get (sl, i);
+    len = strlen (file);
+    if (i > 0)
+       buf_pad (out, indent);
+    buf_puts (out, file);
+
+    if (i < max-1)
+    {
+      buf_pad (out, 1 + ctx->longest_file - len);
+      buf_puts (out, line_end);
+      buf_putc (out, '\n');
+    }
+    else
+      buf_putc (out, '\n');
+  }
+}
+
+/*
+ * Handler for format '%v'.
+ */
+static void write_vpaths (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  int          i, max = smartlist_len (ctx->vpaths);
+
+  if (max == 0)
+     return;
+
+  buf_printf (out, "VPATH = ");
+  for (i = 0; i < max; i++)
+      buf_printf (out, "%s ", (const char*)smartlist_get(ctx->vpaths, i));
+
+  buf_printf (out, "  #! Found %d VPATHs\n", max);
+}
+
+/*
+ * Handler for format '%I'.
+ * The '-I' paths given and the directories found by 'infer_inc_paths()'.
+ */
+static void write_inc_paths (void *arg, out_buf *out, const char *templ, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  int          i, num = smartlist_len (ctx->found_inc_dirs);
+
+  buf_printf (out, "%.*s", (int)(rest - templ - 2), templ);
+  for (i = 0; i < smartlist_len(ctx->inc_paths); i++)
+      buf_printf (out, "-I%s ", (const char*)smartlist_get(ctx->inc_paths, i));
+
+  for (i = 0; i < num; i++)
+  {
+    const dep_inc_dir *d = smartlist_get (ctx->found_inc_dirs, i);
+
+    buf_printf (out, "-I%s ", d->dir);
+  }
+  buf_printf (out, "%s", rest);
+
+  if (num == 0)
+     buf_printf (out, "#! No extra include dirs needed\n");
+  else
+  {
+    buf_printf (out, "#! Found %d include dir(s); ordered by use:", num);
+    for (i = 0; i < num; i++)
+    {
+      const dep_inc_dir *d = smartlist_get (ctx->found_inc_dirs, i);
+
+      buf_printf (out, " %s (%d)", d->dir, d->hits);
+    }
+    buf_putc (out, '\n');
+  }
+}
+
+/*
+ * Handler for format '%P'.
+ * The 'PCH_HEADERS' for the precompiled header.
+ */
+static void write_pch_headers (void *arg, out_buf *out, const char *templ, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  int          i, num = smartlist_len (ctx->pch_headers);
+
+  buf_printf (out, "#\n# The headers for the precompiled header '$(OBJ_DIR)/pch.h' used by the .c SOURCES.\n");
+  if (num == 0)
+     buf_printf (out, "#! Found no system header included by most .c files.\n");
+
+  for (i = 0; i < num; i++)
+  {
+    const dep_header_rank *r = smartlist_get (ctx->pch_headers, i);
+
+    buf_printf (out, "#! <%s> is included by %d of %d .c files; %llu kB.\n",
+                sys_header_name(ctx, r->node->file), r->num_tus, smartlist_len(ctx->c_files),
+                (unsigned long long)(r->size / 1024));
+  }
+  buf_printf (out, "#\n%.*s", (int)(rest - templ - 2), templ);
+
+  if (ctx->pch_config_h && num > 0)
+     buf_printf (out, "\"config.h\" ");
+  for (i = 0; i < num; i++)
+  {
+    const dep_header_rank *r = smartlist_get (ctx->pch_headers, i);
+
+    buf_printf (out, "<%s> ", sys_header_name(ctx, r->node->file));
+  }
+  buf_printf (out, "%s\n", rest);
+}
+
+/*
+ * Handler for format '%u'.
+ * The unity batches; 'UNITY_BATCHES', 'UNITY_N' and 'UNITY_EXCLUDE'.
+ */
+static void write_unity (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  int          i, j, num = smartlist_len (ctx->unity->batches);
+
+  buf_printf (out, "#\n# Unity batches of the .c SOURCES (if USE_UNITY = 1); about %d kB each.\n",
+              (int)(ctx->unity_size / 1024));
+  for (i = 0; i < smartlist_len(ctx->unity->excluded); i++)
+  {
+    const unity_excluded *ex = smartlist_get (ctx->unity->excluded, i);
+
+    buf_printf (out, "#! Excluded %s; %s.\n", ex->file, ex->reason);
+  }
+  buf_puts (out, "#\nUNITY_BATCHES =");
+  for (i = 0; i < num; i++)
+      buf_printf (out, " %d", i + 1);
+
+  buf_puts (out, "\nUNITY_EXCLUDE =");
+  for (i = 0; i < smartlist_len(ctx->unity->excluded); i++)
+      buf_printf (out, " %s", ((const unity_excluded*)smartlist_get(ctx->unity->excluded, i))->file);
+  buf_puts (out, "\n\n");
+
+  for (i = 0; i < num; i++)
+  {
+    const unity_batch *b = smartlist_get (ctx->unity->batches, i);
+
+    buf_printf (out, "UNITY_%d = ", i + 1);
+    for (j = 0; j < smartlist_len(b->files); j++)
+        buf_printf (out, "%s%s", j > 0 ? " " : "", (const char*)smartlist_get(b->files, j));
+    buf_printf (out, "  #! %llu kB\n", (unsigned long long)(b->size / 1024));
+  }
+}
+
+/*
+ * Handler for format '%t'.
+ * A program needs a 'main()' or 'WinMain()'. Otherwise a 'DllMain()' or
+ * an exported symbol says it's a DLL (and it's import-lib). Named from
+ * the '%%define tools' of the template; e.g. 'bin/foo' and 'lib/libfoo.so'
+ * for the 'linux' template.
+ */
+static const char *get_targets (genmake_ctx *ctx)
+{
+  build_tools tools;
+  char       *buf = ctx->targets_buf;
+  size_t      size = sizeof(ctx->targets_buf);
+  bool        dll = !ctx->main_found && !ctx->WinMain_found && (ctx->DllMain_found || ctx->dllexport_found);
+
+  if (!get_tools(ctx, &tools))
+     return (dll ? "bin/foo.dll lib/foo_imp.lib" : "bin/foo.exe");
+
+  if (!dll)
+       snprintf (buf, size, "bin/foo%s", tools.exe_ext);
+  else if (tools.msvc)
+       snprintf (buf, size, "bin/foo%s lib/foo_imp%s", tools.dll_ext, tools.lib_ext);
+  else if (!stricmp(tools.dll_ext, ".dll"))   /* MinGW and Cygwin; with an import-lib */
+       snprintf (buf, size, "bin/foo%s lib/libfoo%s%s", tools.dll_ext, tools.dll_ext, tools.lib_ext);
+  else snprintf (buf, size, "lib/libfoo%s", tools.dll_ext);
+  build_tools_free (&tools);
+  return (buf);
+}
+
+static void write_targets (void *arg, out_buf *out, const char *templ, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  int          i;
+
+  if (!ctx->programs)
+  {
+    buf_printf (out, "%.*s%s%s\n", (int)(rest - templ - 2), templ, get_targets(ctx), rest);
+    return;
+  }
+
+  buf_printf (out, "%.*s", (int)(rest - templ - 2), templ);
+  for (i = 0; i < smartlist_len(ctx->programs); i++)
+      buf_printf (out, "%s ", ((const program*)smartlist_get(ctx->programs, i))->target);
+  buf_printf (out, "%s\n", rest);
+}
+
+/*
+ * The objects are named after the base-name of the sources.
+ * Warn about sources giving the same object.
+ */
+static void write_object_clashes (genmake_ctx *ctx, out_buf *out)
+{
+  strmap_t *objs = strmap_new (true);
+  size_t    i;
+
+  for (i = 0; i < ctx->num_entry_scans; i++)
+  {
+    const char *src   = ctx->entry_scans[i].file;
+    const char *slash = strrchr (src, '/');
+    const char *base  = slash ? slash + 1 : src;
+    const char *dot   = strrchr (base, '.');
+    const char *other;
+    char        obj [_MAX_PATH];
+
+    snprintf (obj, sizeof(obj), "%.*s.obj", dot ? (int)(dot - base) : (int)strlen(base), base);
+    other = strmap_get (objs, obj);
+    if (other)
+         buf_printf (out, "#! %s and %s both give '$(OBJ_DIR)/%s'. Rename one of them.\n", other, src, obj);
+    else strmap_set (objs, obj, (void*)src);
+  }
+  strmap_free (objs, NULL);
+}
+
+/*
+ * Put the '$(OBJ_DIR)' file configured from the .h.in-file 'in_file' in 'buf'.
+ * Return false if an earlier .h.in-file gives the same name.
+ */
+static bool configured_name (genmake_ctx *ctx, int idx, char *buf, size_t size)
+{
+  const char *in_file = smartlist_get (ctx->h_in_files, idx);
+  const char *base = strrchr (in_file, '/');
+  int         i;
+
+  base = base ? base + 1 : in_file;
+  snprintf (buf, size, "%.*s", (int)(strlen(base) - sizeof(".in") + 1), base);
+
+  for (i = 0; i < idx; i++)
+  {
+    const char *other = smartlist_get (ctx->h_in_files, i);
+    const char *other_base = strrchr (other, '/');
+
+    other_base = other_base ? other_base + 1 : other;
+    if (!stricmp(base, other_base))
+       return (false);
+  }
+  return (true);
+}
+
+/*
+ * Handler for format '%H'.
+ * The .h.in files to configure; 'CONFIGURE_VARS' and 'CONFIGURED_H'.
+ */
+static void write_configured (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  char         name [_MAX_PATH];
+  int          i;
+
+  if (ctx->num_h_in_files == 0)
+  {
+    buf_puts (out, "CONFIGURED_H =\n");
+    return;
+  }
+
+  buf_puts (out, "#\n# Configured from the .h.in files by 'gen-make --configure'.\n#\n"
+                 "CONFIGURE_VARS = VER_MAJOR=$(strip $(VER_MAJOR)) VER_MINOR=$(strip $(VER_MINOR)) VER_PATCH=$(strip $(VER_PATCH)) "
+                 "VERSION=$(VERSION)  #! Add more 'VAR=value' as needed\n\nCONFIGURED_H =");
+
+  for (i = 0; i < smartlist_len(ctx->h_in_files); i++)
+      if (configured_name(ctx, i, name, sizeof(name)))
+         buf_printf (out, " $(OBJ_DIR)/%s", name);
+
+  buf_puts (out, "\n\nGENERATED +=");
+  for (i = 0; i < smartlist_len(ctx->h_in_files); i++)
+      if (configured_name(ctx, i, name, sizeof(name)) && stricmp(name, "config.h"))
+         buf_printf (out, " $(OBJ_DIR)/%s", name);
+  buf_putc (out, '\n');
+}
+
+/*
+ * Handler for format '%h'.
+ * A rule for each of the 'CONFIGURED_H' files.
+ * The output of 'gen-make --configure' is only written if changed.
+ */
+static void write_configure_rules (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  char         name [_MAX_PATH];
+  int          i;
+
+  for (i = 0; i < smartlist_len(ctx->h_in_files); i++)
+  {
+    const char *in_file = smartlist_get (ctx->h_in_files, i);
+
+    if (!configured_name(ctx, i, name, sizeof(name)))
+    {
+      buf_printf (out, "#! Ignoring '%s'; another .h.in-file also gives '$(OBJ_DIR)/%s'.\n\n", in_file, name);
+      continue;
+    }
+    buf_printf (out, "$(OBJ_DIR)/%s: %s $(THIS_FILE) | $(OBJ_DIR)\n"
+                     "\t$(GEN_MAKE) --configure $< $@ $(CONFIGURE_VARS)\n\n", name, in_file);
+  }
+}
+
+/*
+ * Return true if 'u' needs a rule from 'write_modules()'.
+ */
+static bool needs_module_rule (const module_unit *u)
+{
+  const char *dot = strrchr (u->file, '.');
+
+  return (module_unit_uses_modules(u) || (dot && (!strcmp(dot, ".ixx") || !strcmp(dot, ".cppm"))));
+}
+
+/*
+ * The BMI of 'module'; a '$(OBJ_DIR)/M.ifc' for 'cl' and 'clang-cl'. For
+ * g++ it's 'gcm.cache/M.gcm'; where it's default module-mapper puts it.
+ */
+static const char *bmi_file (bool gcc, const char *module, char *buf, size_t size)
+{
+  char name [_MAX_PATH];
+
+  module_bmi_name (module, name, sizeof(name));
+  snprintf (buf, size, gcc ? "gcm.cache/%s.gcm" : "$(OBJ_DIR)/%s.ifc", name);
+  return (buf);
+}
+
+/*
+ * Handler for format '%M'.
+ * The C++20 module units; a rule for each with the BMIs of the modules it
+ * imports as prerequisites. So they are compiled in the order needed.
+ * For 'kind = gcc' in the '%%define tools' of the template, the rules are
+ * for 'g++ -fmodules-ts'.
+ */
+static void write_modules (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  smartlist_t *units, *header_units;
+  build_tools  tools;
+  char         obj [_MAX_PATH], bmi [_MAX_PATH], file [_MAX_PATH];
+  bool         imports, gcc;
+  int          i, j;
+
+  if (!ctx->modules)
+     return;
+
+  units = smartlist_new();
+  header_units = smartlist_new();
+  for (i = 0; i < smartlist_len(ctx->modules->units); i++)
+  {
+    module_unit *u = smartlist_get (ctx->modules->units, i);
+
+    if (!needs_module_rule(u))
+       continue;
+    smartlist_add (units, u->file);
+    for (j = 0; j < smartlist_len(u->header_units); j++)
+        if (!in_list(header_units, smartlist_get(u->header_units, j)))
+           smartlist_add (header_units, smartlist_get(u->header_units, j));
+  }
+
+  if (smartlist_len(units) == 0 || !get_tools(ctx, &tools))
+  {
+    smartlist_free (units);
+    smartlist_free (header_units);
+    return;
+  }
+  gcc = !tools.msvc;
+
+  if (gcc)
+       buf_puts (out, "#\n# C++20 modules (for g++ -fmodules-ts). Each unit is compiled after the modules it imports.\n"
+                      "# A module 'M' (or a partition 'M:part') gives a 'gcm.cache/M.gcm' (or 'M-part.gcm').\n#\n");
+  else buf_puts (out, "#\n# C++20 modules (for CC=cl or clang-cl). Each unit is compiled after the modules it imports.\n"
+                      "# A module 'M' (or a partition 'M:part') gives a '$(OBJ_DIR)/M.ifc' (or 'M-part.ifc').\n"
+                      "# For clang-cl this is a clang BMI ('.pcm') with another name.\n#\n");
+
+  for (i = 0; i < smartlist_len(ctx->modules->missing); i++)
+      buf_printf (out, "#! Module '%s' is not provided by any source.\n", (const char*)smartlist_get(ctx->modules->missing, i));
+  for (i = 0; i < smartlist_len(ctx->modules->cycles); i++)
+      buf_printf (out, "#! '%s' is in an import-cycle.\n", ((const module_unit*)smartlist_get(ctx->modules->cycles, i))->file);
+  for (i = 0; i < smartlist_len(header_units); i++)
+      buf_printf (out, "#! Header unit %s is imported; %s.\n", (const char*)smartlist_get(header_units, i),
+                  gcc ? "compile it first with '-x c++-header'" : "add a '-headerUnit' or '-translateInclude' to 'MODULE_CXXFLAGS'");
+
+  for (i = 0; !gcc && i < smartlist_len(ctx->modules->units); i++)
+  {
+    const module_unit *u = smartlist_get (ctx->modules->units, i);
+    const char        *dot = strrchr (u->file, '.');
+
+    if (u->provides && needs_module_rule(u) && (!dot || strcmp(dot, ".cppm")))
+       buf_printf (out, "#! clang-cl only takes a '.cppm' as a module unit with a BMI; rename '%s' for CC=clang-cl.\n", u->file);
+  }
+
+  /* 'cl' finds the imported BMIs in '-ifcSearchDir'. 'clang-cl' gets each one
+   * as a 'M=$(OBJ_DIR)/M.ifc' and writes the BMI with '-fmodule-output'.
+   * g++ reads and writes them in 'gcm.cache'.
+   */
+  if (gcc)
+     buf_puts (out, "MODULE_CXXFLAGS = $(filter-out -std=c++%, $(CXXFLAGS)) -std=c++20 -fmodules-ts\n\n"
+                    "MODULE_SOURCES = ");
+  else buf_puts (out, "ifeq ($(CC),clang-cl)\n"
+                 "  MODULE_CXXFLAGS = $(filter-out -std:c++%, $(CXXFLAGS)) -std:c++20\n"
+                 "  module_output   = /clang:-fmodule-output=$(OBJ_DIR)/$(strip $(1)).ifc\n"
+                 "  module_imports  = $(foreach m, $(1), /clang:-fmodule-file=$(subst =,=$(OBJ_DIR)/,$(m)).ifc)\n"
+                 "else\n"
+                 "  MODULE_CXXFLAGS = $(filter-out -std:c++%, $(CXXFLAGS)) -std:c++20 -ifcSearchDir $(OBJ_DIR)\n"
+                 "  module_output   = $(2) -ifcOutput $(OBJ_DIR)/$(strip $(1)).ifc\n"
+                 "  module_imports  =\n"
+                 "endif\n\n"
+                 "MODULE_SOURCES = ");
+  write_files (ctx, out, units, sizeof("MODULE_SOURCES = ") - 1);
+  buf_puts (out, "\n#! Add $(call src_to_obj, $(MODULE_SOURCES)) to $(OBJECTS) as needed.\n\n");
+
+  for (i = 0; i < smartlist_len(ctx->modules->units); i++)
+  {
+    const module_unit *u = smartlist_get (ctx->modules->units, i);
+    const char        *dot;
+
+    if (!needs_module_rule(u))
+       continue;
+
+    obj_name (u->file, obj, sizeof(obj));
+    dot = strrchr (obj, '.');
+    snprintf (obj + (dot - obj), sizeof(obj) - (dot - obj), "%s", tools.obj_ext);
+
+    buf_printf (out, "$(OBJ_DIR)/%s: %s", obj, u->file);
+    for (j = 0; j < smartlist_len(u->requires); j++)
+    {
+      const char        *req = smartlist_get (u->requires, j);
+      const module_unit *provider = strmap_get (ctx->modules->providers, req);
+
+      if (provider && provider != u)
+         buf_printf (out, " %s", bmi_file(gcc, req, file, sizeof(file)));
+    }
+
+    if (gcc)   /* g++ does not know '.ixx' or '.cppm' */
+    {
+      dot = strrchr (u->file, '.');
+      buf_printf (out, " | $(OBJ_DIR)\n\t$(CXX) -c $(MODULE_CXXFLAGS) -o $@ %s%s\n\n",
+                  dot && (!strcmp(dot, ".ixx") || !strcmp(dot, ".cppm")) ? "-x c++ " : "", u->file);
+      if (u->provides)
+         buf_printf (out, "%s: $(OBJ_DIR)/%s ;\n\n", bmi_file(gcc, u->provides, file, sizeof(file)), obj);
+      continue;
+    }
+
+    buf_puts (out, " | $(OBJ_DIR)\n\t$(call C_compile, $@, $(MODULE_CXXFLAGS)");
+
+    imports = false;
+    for (j = 0; j < smartlist_len(u->requires); j++)
+    {
+      const char        *req = smartlist_get (u->requires, j);
+      const module_unit *provider = strmap_get (ctx->modules->providers, req);
+
+      if (!provider || provider == u)
+         continue;
+      buf_printf (out, "%s%s=%s", imports ? " " : " $(call module_imports, ", req, module_bmi_name(req, bmi, sizeof(bmi)));
+      imports = true;
+    }
+    if (imports)
+       buf_puts (out, ")");
+
+    if (u->provides)
+       buf_printf (out, " $(call module_output, %s, %s)",
+                   module_bmi_name(u->provides, bmi, sizeof(bmi)), u->is_interface ? "-interface" : "-internalPartition");
+    buf_printf (out, " %s)\n\n", u->file);
+
+    if (u->provides)
+       buf_printf (out, "%s: $(OBJ_DIR)/%s ;\n\n", bmi_file(gcc, u->provides, file, sizeof(file)), obj);
+  }
+  build_tools_free (&tools);
+  smartlist_free (units);
+  smartlist_free (header_units);
+}
+
+/*
+ * Handler for format '%m'.
+ * With option '--multi-target'; a link rule for each program and the shared library.
+ */
+static void write_programs (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  int          i, j;
+
+  if (!ctx->programs)
+     return;
+
+  buf_puts (out, "#\n# The sources shared by the programs; linked from 'lib/shared.lib'.\n");
+  write_object_clashes (ctx, out);
+  buf_puts (out, "#\nSHARED_SOURCES =");
+  for (i = 0; i < smartlist_len(ctx->shared_srcs); i++)
+      buf_printf (out, " %s", (const char*)smartlist_get(ctx->shared_srcs, i));
+  buf_puts (out, "\n\n");
+
+  if (smartlist_len(ctx->shared_srcs) > 0)
+     buf_puts (out, "lib/shared.lib: $(call src_to_obj, $(SHARED_SOURCES)) | lib\n"
+                    "\t$(call create_static_lib, $@, $^)\n\n");
+
+  for (i = 0; i < smartlist_len(ctx->programs); i++)
+  {
+    const program *p = smartlist_get (ctx->programs, i);
+
+    buf_printf (out, "%s: $(call src_to_obj,", p->target);
+    for (j = 0; j < smartlist_len(p->sources); j++)
+        buf_printf (out, " %s", (const char*)smartlist_get(p->sources, j));
+    buf_printf (out, ")%s | bin\n\t$(call link_EXE, $@, $^ $(EX_LIBS))\n\n",
+                smartlist_len(ctx->shared_srcs) > 0 ? " lib/shared.lib" : "");
+  }
+}
+
+/*
+ * Return the 'probe_tool' 'name'; probing the tools on first use.
+ */
+static const probe_tool *get_tool (genmake_ctx *ctx, const char *name)
+{
+  probe_tools (ctx->probe_file);
+  return probe_get (name);
+}
+
+/*
+ * For the '%a' format: '1' if 'astyle.exe' is found on PATH. '0' otherwise.
+ */
+static void write_astyle (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  bool found = (get_tool(arg, "astyle")->path[0] != '\0');
+
+  buf_printf (out, "%.*s%d%s\n", (int)(rest - line - 2), line, found, rest);
+}
+
+/*
+ * For the '%{tool.name}' and '%{tool.name.version}' variables.
+ */
+static const char *tool_var (genmake_ctx *ctx, const char *name)
+{
+  const probe_tool *t;
+  const char       *dot = strchr (name, '.');
+  char              tool [30];
+
+  if (dot && strcmp(dot, ".version"))
+     return (NULL);
+  snprintf (tool, sizeof(tool), "%.*s", dot ? (int)(dot - name) : (int)strlen(name), name);
+  t = get_tool (ctx, tool);
+  if (!t)
+     return (NULL);
+  return (dot ? t->version : t->path);
+}
+
+/*
+ * For the '%s' format: the list of .c/.cc/.cpp-files at this point.
+ */
+static void write_sources (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  size_t       indent = rest - line - 2;
+
+  buf_printf (out, "%.*s", (int)indent, line);
+
+  write_files (ctx, out, ctx->c_files, indent);
+  buf_pad (out, indent);
+  buf_printf (out, "#! %zd .c SOURCES files found (recursively: %d)\n", ctx->num_c_files, ctx->recursive);
+  write_duplicates (ctx, out, indent);
+
+  if (ctx->num_cc_files > 0)
+  {
+    buf_printf (out, "\n#\n#! Add these $(CC_SOURCES) to $(OBJECTS) as needed.\n#\nCC_SOURCES = ");
+    write_files (ctx, out, ctx->cc_files, indent+3);
+  }
+
+  if (ctx->num_cpp_files > 0)
+  {
+    buf_printf (out, "\n#\n#! Add these $(CPP_SOURCES) to $(OBJECTS) as needed.\n#\nCPP_SOURCES = ");
+    write_files (ctx, out, ctx->cpp_files, indent+4);
+  }
+
+  if (ctx->num_cxx_files > 0)
+  {
+    buf_printf (out, "\n#\n#! Add these $(CXX_SOURCES) to $(OBJECTS) as needed.\n#\nCXX_SOURCES = ");
+    write_files (ctx, out, ctx->cxx_files, indent+4);
+  }
+
+  if (ctx->num_h_in_files > 0)
+  {
+    buf_pad (out, indent);
+    buf_printf (out, "#! Found %zd .h.in-file(s); see 'CONFIGURED_H' below.\n", ctx->num_h_in_files);
+  }
+
+  if (ctx->num_rc_files)
+  {
+    buf_pad (out, indent);
+    buf_printf (out, "#! Found %zd .rc-file(s).\n", ctx->num_rc_files);
+  }
+}
+
+/*
+ * The time-stamp for '%T' and '%{time}'; like a 'ctime()' without the newline.
+ * If 'SOURCE_DATE_EPOCH' is set, it's that time in UTC; for a reproducible
+ * makefile. The same for the whole run; in all contexts.
+ */
+static const char *time_stamp (void)
+{
+  static char    stamp [30];
+  static SRWLOCK lock = SRWLOCK_INIT;
+  const char    *epoch;
+  struct tm     *tm;
+  time_t         t;
+
+  AcquireSRWLockExclusive (&lock);
+  if (stamp[0])
+  {
+    ReleaseSRWLockExclusive (&lock);
+    return (stamp);
+  }
+
+  epoch = getenv ("SOURCE_DATE_EPOCH");
+  if (epoch && *epoch)
+  {
+    char *end;
+
+    t  = (time_t) strtoull (epoch, &end, 10);
+    tm = (*end == '\0') ? gmtime (&t) : NULL;
+    if (!tm)
+       fprintf (stderr, "Ignoring an illegal SOURCE_DATE_EPOCH='%s'.\n", epoch);
+  }
+  else
+    tm = NULL;
+
+  if (!tm)
+  {
+    t  = time (NULL);
+    tm = localtime (&t);
+  }
+  snprintf (stamp, sizeof(stamp), "%.24s", asctime(tm));
+  ReleaseSRWLockExclusive (&lock);
+  return (stamp);
+}
+
+static void write_time (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  buf_printf (out, "%.*s%s%s\n", (int)(rest - line - 2), line, time_stamp(), rest);
+}
+
+static void write_prog (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+  const char  *quote = strchr (ctx->prog, ' ') ? "\"" : "";
+
+  buf_printf (out, "%.*s%s%s%s%s\n", (int)(rest - line - 2), line, quote, ctx->prog, quote, rest);
+}
+
+/*
+ * For the '%c' format: the .c/.cc/.cxx/.cpp -> object rule(s) needed.
+ */
+static void write_rule (genmake_ctx *ctx, out_buf *out, const char *name, size_t num_files)
+{
+  const char *rule = template_get_define (ctx->cur_template, name);
+
+  if (!rule)   /* a '--template-file' uses the Windows rules */
+     rule = template_get_define (&make_template_windows, name);
+  assert (rule);
+  if (num_files > 0)
+     buf_printf (out, "%s\n", rule);
+}
+
+static void write_rules (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+
+  write_rule (ctx, out, "c_rule", ctx->num_c_files);
+  write_rule (ctx, out, "cc_rule", ctx->num_cc_files);
+  write_rule (ctx, out, "cpp_rule", ctx->num_cpp_files);
+  write_rule (ctx, out, "cxx_rule", ctx->num_cxx_files);
+}
+
+/*
+ * For the '%A' format: a hint on the 'all' rule from the entry-points found.
+ */
+static void write_entry_hint (void *arg, out_buf *out, const char *line, const char *rest)
+{
+  genmake_ctx *ctx = arg;
+
+  if (!ctx->main_found && !ctx->WinMain_found && !ctx->DllMain_found && !ctx->dllexport_found)
+     buf_printf (out, "#\n#! Failed to find a 'main()' or a 'WinMain()' in the SOURCES. Is it a .DLL?\n#\n");
+  else if (!ctx->main_found && !ctx->WinMain_found)
+     buf_printf (out, "#\n#! Found a %s in the SOURCES. Using the rule for a DLL; '%s'.\n#\n",
+                 ctx->DllMain_found ? "'DllMain()'" : "'__declspec(dllexport)'", get_targets(ctx));
+  else if (ctx->DllMain_found)
+     buf_printf (out, "#\n#! Found a 'DllMain()' and a 'main()' in the SOURCES. Rewrite the '%s' rule into a rule for a DLL?\n#\n",
+                 get_targets(ctx));
+}
+
+/*
+ * The handlers of the '%x' formats in the template. See 'template-windows.mk'.
+ */
+static const template_directive directives[] = {
+       { 'A', write_entry_hint      },
+       { 'a', write_astyle          },
+       { 'c', write_rules           },
+       { 'g', write_prog            },
+       { 'H', write_configured      },
+       { 'h', write_configure_rules },
+       { 'I', write_inc_paths       },
+       { 'M', write_modules         },
+       { 'm', write_programs        },
+       { 'P', write_pch_headers     },
+       { 's', write_sources         },
+       { 'T', write_time            },
+       { 't', write_targets         },
+       { 'u', write_unity           },
+       { 'v', write_vpaths          }
+     };
+
+/*
+ * The '%{name}' variables of a template.
+ */
+static const char *template_var (void *arg, const char *name)
+{
+  genmake_ctx *ctx = arg;
+  char        *buf = ctx->var_buf;
+  const struct {
+        const char   *name;
+        const size_t *num;
+      } counts[] = {
+        { "num_c",    &ctx->num_c_files    },
+        { "num_cc",   &ctx->num_cc_files   },
+        { "num_cpp",  &ctx->num_cpp_files  },
+        { "num_cxx",  &ctx->num_cxx_files  },
+        { "num_rc",   &ctx->num_rc_files   },
+        { "num_h_in", &ctx->num_h_in_files }
+      };
+  size_t i;
+
+  for (i = 0; i < DIM(counts); i++)
+      if (!strcmp(name, counts[i].name))
+      {
+        snprintf (buf, sizeof(ctx->var_buf), "%zu", *counts[i].num);
+        return (buf);
+      }
+
+  if (!strcmp(name, "num_ixx"))
+  {
+    snprintf (buf, sizeof(ctx->var_buf), "%d", smartlist_len(ctx->ixx_files));
+    return (buf);
+  }
+  if (!strcmp(name, "gen_make"))
+     return (ctx->prog);
+  if (!strcmp(name, "version"))
+  {
+    snprintf (buf, sizeof(ctx->var_buf), "%d.%d.%d", VER_MAJOR, VER_MINOR, VER_MICRO);
+    return (buf);
+  }
+  if (!strcmp(name, "time"))
+     return time_stamp();
+  if (!strcmp(name, "targets"))
+     return get_targets(ctx);
+  if (!strcmp(name, "main"))
+     return (ctx->main_found ? "1" : "0");
+  if (!strcmp(name, "WinMain"))
+     return (ctx->WinMain_found ? "1" : "0");
+  if (!strcmp(name, "DllMain"))
+     return (ctx->DllMain_found ? "1" : "0");
+  if (!strcmp(name, "dllexport"))
+     return (ctx->dllexport_found ? "1" : "0");
+  if (!strcmp(name, "multi_target"))
+     return (ctx->multi_target ? "1" : "0");
+  if (!strcmp(name, "recursive"))
+     return (ctx->recursive ? "1" : "0");
+  if (!strncmp(name, "env.", 4))
+     return getenv (name + 4);
+  if (!strncmp(name, "tool.", 5))
+     return tool_var (ctx, name + 5);
+  return (NULL);
+}
+
+/*
+ * The lists for a '%%for' loop in a template.
+ */
+static const smartlist_t *template_list (void *arg, const char *name)
+{
+  genmake_ctx *ctx = arg;
+  const struct {
+        const char        *name;
+        const smartlist_t *list;
+      } lists[] = {
+        { "c",      ctx->c_files    },
+        { "cc",     ctx->cc_files   },
+        { "cpp",    ctx->cpp_files  },
+        { "cxx",    ctx->cxx_files  },
+        { "rc",     ctx->rc_files   },
+        { "h_in",   ctx->h_in_files },
+        { "ixx",    ctx->ixx_files  },
+        { "h",      ctx->h_files    },
+        { "vpaths", ctx->vpaths     }
+      };
+  size_t i;
+
+  for (i = 0; i < DIM(lists); i++)
+      if (!strcmp(name, lists[i].name))
+         return (lists[i].list);
+  fprintf (stderr, "No list '%s' for a '%%%%for' loop.\n", name);
+  return (NULL);
+}
+
+/*
+ * Write the template 'tc' into 'out'.
+ */
+static bool write_template (genmake_ctx *ctx, out_buf *out, const template_code *tc)
+{
+  template_env env;
+
+  memset (&env, '\0', sizeof(env));
+  env.directives     = directives;
+  env.num_directives = DIM(directives);
+  env.get_var        = template_var;
+  env.get_list       = template_list;
+  env.load           = template_load;
+  env.arg            = ctx;
+  ctx->cur_template  = tc;
+  template_run (tc, out, &env);
+  ctx->cur_template  = NULL;
+  buf_putc (out, '\n');
+  return (true);
+}
+
+/*
+ * Write the generated 'out' to stdout or to 'output'; 'what' is for the
+ * messages. That file is only replaced if it changed (the time-stamps are
+ * not compared).
+ */
+static bool write_output (out_buf *out, const char *output, const char *what)
+{
+  const char *stamp = time_stamp();
+  const char *p;
+  bool        rc, changed;
+
+  if (!output)
+  {
+    rc = buf_write (out, stdout) && fflush (stdout) == 0;
+    if (rc)
+         fprintf (stderr, "Generated %s to stdout.\n", what);
+    else fprintf (stderr, "Failed to write the %s to stdout.\n", what);
+    return (rc);
+  }
+
+  for (p = out->data; (p = strstr(p, stamp)) != NULL; p += strlen(stamp))
+      buf_mask (out, p - out->data, strlen(stamp));
+
+  rc = buf_write_file (out, output, &changed);
+  if (rc)
+     fprintf (stderr, changed ? "Generated %s '%s'.\n" : "'%s' is unchanged.\n",
+              changed ? what : output, output);
+  return (rc);
+}
+
+/*
+ * Generate a makefile from 'tc' into a buffer and write it in one go; to
+ * stdout or to 'output'. That file is only replaced if it changed (the
+ * time-stamps are not compared). So a rerun does not trigger a rebuild of
+ * what depends on '$(THIS_FILE)'. With option '--update', only the regions
+ * of that file are replaced.
+ */
+static bool write_one_makefile (genmake_ctx *ctx, const template_code *tc, const char *output)
+{
+  out_buf out;
+  bool    rc;
+
+  memset (&out, '\0', sizeof(out));
+  if (!write_template(ctx, &out, tc))
+  {
+    buf_free (&out);
+    return (false);
+  }
+
+  if (ctx->update_file)
+  {
+    rc = update_regions (ctx->update_file, &out);
+    buf_free (&out);
+    return (rc);
+  }
+
+  rc = write_output (&out, output, "makefile");
+  buf_free (&out);
+  return (rc);
+}
+
+/*
+ * The template in option '--template-file' or the first '--template'; the
+ * Windows one by default.
+ */
+static const builtin_template *first_template (genmake_ctx *ctx)
+{
+  return (ctx->templates ? smartlist_get (ctx->templates, 0) : builtin_templates + 0);
+}
+
+/*
+ * Write the makefile from the template in option '--template-file' or
+ * '--template'; the Windows one by default. With several '--template', each
+ * is written to it's own 'Makefile.X' from the same sources found.
+ */
+static bool write_makefile (genmake_ctx *ctx)
+{
+  const builtin_template *bt;
+  const template_code    *tc;
+  int                     i, num = ctx->templates ? smartlist_len (ctx->templates) : 0;
+  bool                    rc = true;
+
+  if (ctx->template_file)
+  {
+    tc = template_load (ctx->template_file);
+    return (tc && write_one_makefile(ctx, tc, ctx->output_file));
+  }
+
+  if (num <= 1)
+     return write_one_makefile (ctx, first_template(ctx)->code, ctx->output_file);
+
+  for (i = 0; i < num; i++)
+  {
+    bt = smartlist_get (ctx->templates, i);
+    if (!write_one_makefile(ctx, bt->code, bt->makefile))
+       rc = false;
+  }
+  return (rc);
+}
+
+/*
+ * Get the '%%define tools' of the template used. A '--template-file'
+ * without one gets those of the Windows template.
+ */
+static bool get_tools (genmake_ctx *ctx, build_tools *tools)
+{
+  const builtin_template *bt = first_template (ctx);
+  const template_code    *tc = ctx->template_file ? template_load (ctx->template_file) : bt->code;
+  const char             *text = tc ? template_get_define (tc, "tools") : NULL;
+
+  if (!text)
+  {
+    tc = &make_template_windows;
+    text = template_get_define (tc, "tools");
+  }
+  assert (text);
+  return build_tools_parse (text, tc->fname ? tc->fname : bt->name, tools);
+}
+
+/*
+ * The .c/.cc/.cpp/.cxx sources for '--emit ninja' and '--emit compdb'.
+ */
+static smartlist_t *all_sources (genmake_ctx *ctx)
+{
+  smartlist_t *sources = smartlist_new();
+
+  smartlist_append (sources, ctx->c_files);
+  smartlist_append (sources, ctx->cc_files);
+  smartlist_append (sources, ctx->cpp_files);
+  smartlist_append (sources, ctx->cxx_files);
+  return (sources);
+}
+
+/*
+ * The '-I' dirs given and found by 'infer_inc_paths()'.
+ */
+static smartlist_t *all_inc_dirs (genmake_ctx *ctx)
+{
+  smartlist_t *dirs = smartlist_new();
+  int          i;
+
+  smartlist_append (dirs, ctx->inc_paths);
+  for (i = 0; i < smartlist_len(ctx->found_inc_dirs); i++)
+      smartlist_add (dirs, ((dep_inc_dir*)smartlist_get(ctx->found_inc_dirs, i))->dir);
+  return (dirs);
+}
+
+/*
+ * Like the makefiles, '--emit ninja/compdb' use a '$(OBJ_DIR)/config.h'.
+ * Unless configured from a 'config.h.in', write a default one here (below
+ * the root); only if changed so nothing gets rebuilt on a rerun.
+ */
+static bool write_config_h (genmake_ctx *ctx, const build_tools *tools)
+{
+  out_buf     out;
+  const char *dir;
+  char        fname [_MAX_PATH], buf [_MAX_PATH];
+  int         i;
+  bool        rc, changed;
+
+  for (i = 0; i < smartlist_len(ctx->h_in_files); i++)
+      if (configured_name(ctx, i, fname, sizeof(fname)) && !stricmp(fname, "config.h"))
+         return (true);
+
+  dir = base_path (ctx->base, tools->obj_dir, buf, sizeof(buf));
+  snprintf (fname, sizeof(fname), "%s/config.h", dir);
+  CreateDirectory (dir, NULL);
+
+  memset (&out, '\0', sizeof(out));
+  buf_puts (&out, "/*\n * Generated by 'gen-make --emit ninja'. Add more stuff here.\n */\n#pragma once\n");
+  if (tools->msvc)
+     buf_puts (&out, "#define WIN32_LEAN_AND_MEAN\n");
+  rc = buf_write_file (&out, fname, &changed);
+  if (rc && changed)
+     fprintf (stderr, "Generated '%s'.\n", fname);
+  buf_free (&out);
+  return (rc);
+}
+
+/*
+ * For option '--emit ninja': a 'build.ninja' from the same sources.
+ * The C++20 modules, unity batches, PCH and .rc files are only in the
+ * makefile.
+ */
+static bool emit_ninja (genmake_ctx *ctx, const build_tools *tools, out_buf *out)
+{
+  ninja_input  in;
+  smartlist_t *sources, *inc_dirs, *h_in, *h_out;
+  char         name [_MAX_PATH], path [_MAX_PATH];
+  const char  *dot;
+  size_t       n, num_entries = 0;
+  int          i;
+
+  /* Without '--multi-target', only the .c sources are linked into one program.
+   * That can not have 2 entry-points.
+   */
+  for (n = 0; !ctx->programs && n < ctx->num_entry_scans; n++)
+  {
+    dot = strrchr (ctx->entry_scans[n].file, '.');
+    if (dot && !stricmp(dot, ".c") && (ctx->entry_scans[n].flags & (SCAN_MAIN | SCAN_WINMAIN)))
+       num_entries++;
+  }
+  if (num_entries > 1)
+  {
+    fprintf (stderr, "Found %u .c files with a 'main()' or 'WinMain()'; 'build.ninja' can only link one of these.\n"
+                     "Use option '--multi-target' for a program for each.\n", (unsigned)num_entries);
+    return (false);
+  }
+
+  sources  = all_sources (ctx);
+  inc_dirs = all_inc_dirs (ctx);
+  h_in     = smartlist_new();
+  h_out    = smartlist_new();
+
+  for (i = 0; i < smartlist_len(ctx->h_in_files); i++)
+  {
+    if (!configured_name(ctx, i, name, sizeof(name)))
+       continue;
+    snprintf (path, sizeof(path), "%s/%s", tools->obj_dir, name);
+    smartlist_add (h_in, smartlist_get(ctx->h_in_files, i));
+    smartlist_add (h_out, strdup(path));
+  }
+
+  memset (&in, '\0', sizeof(in));
+  in.tools    = tools;
+  in.inc_dirs = inc_dirs;
+  in.gen_make = ctx->prog;
+  in.stamp    = time_stamp();
+  in.sources  = sources;
+  in.h_in     = h_in;
+  in.h_out    = h_out;
+  in.is_dll   = !ctx->main_found && !ctx->WinMain_found && (ctx->DllMain_found || ctx->dllexport_found);
+  in.programs = ctx->programs;
+  in.shared   = ctx->shared_srcs;
+  ninja_write (out, &in);
+
+  smartlist_free_all (h_out);
+  smartlist_free (h_in);
+  smartlist_free (inc_dirs);
+  smartlist_free (sources);
+  return (true);
+}
+
+/*
+ * For option '--emit compdb': a 'compile_commands.json' for clangd etc.
+ * With the effective flags of the template; as for '--emit ninja'.
+ * The "directory" is the root; the sources are relative to it.
+ */
+static void emit_compdb (genmake_ctx *ctx, const build_tools *tools, out_buf *out)
+{
+  smartlist_t *sources, *inc_dirs;
+  const char  *dir;
+  char         cwd [_MAX_PATH], buf [_MAX_PATH];
+
+  if (!GetCurrentDirectory(sizeof(cwd), cwd))
+     strcpy (cwd, ".");
+  str_replace ('\\', '/', cwd);
+  dir = ctx->base ? base_path (cwd, ctx->base, buf, sizeof(buf)) : cwd;
+
+  sources  = all_sources (ctx);
+  inc_dirs = all_inc_dirs (ctx);
+  compdb_write (out, tools, inc_dirs, dir, sources);
+  smartlist_free (inc_dirs);
+  smartlist_free (sources);
+}
+
+/*
+ * Write the 'build.ninja' or 'compile_commands.json' (or '-o file') and
+ * the default '$(OBJ_DIR)/config.h' it needs.
+ */
+static bool write_tools_file (genmake_ctx *ctx, unsigned kind)
+{
+  build_tools tools;
+  out_buf     out;
+  const char *output, *what;
+  bool        rc;
+
+  if (!get_tools(ctx, &tools))
+     return (false);
+
+  if (kind == GENMAKE_EMIT_NINJA)
+  {
+    output = "build.ninja";
+    what   = "ninja file";
+  }
+  else
+  {
+    output = "compile_commands.json";
+    what   = "compilation database";
+  }
+
+  memset (&out, '\0', sizeof(out));
+  rc = true;
+  if (kind == GENMAKE_EMIT_NINJA)
+       rc = emit_ninja (ctx, &tools, &out);
+  else emit_compdb (ctx, &tools, &out);
+  rc = rc && write_config_h (ctx, &tools) && write_output (&out, ctx->output_file ? ctx->output_file : output, what);
+
+  buf_free (&out);
+  build_tools_free (&tools);
+  return (rc);
+}
+
+/*
+ * Generate one 'kind' ('GENMAKE_EMIT_x') into 'out'. A makefile is from
+ * the '--template-file' or the first template. Nothing is written to disk;
+ * not even the '$(OBJ_DIR)/config.h' from 'genmake_write()'.
+ */
+bool genmake_emit (genmake_ctx *ctx, unsigned kind, out_buf *out)
+{
+  const template_code *tc;
+  build_tools          tools;
+  bool                 rc = true;
+
+  if (kind == GENMAKE_EMIT_MAKE)
+  {
+    tc = ctx->template_file ? template_load (ctx->template_file) : first_template(ctx)->code;
+    return (tc && write_template(ctx, out, tc));
+  }
+
+  if (kind != GENMAKE_EMIT_NINJA && kind != GENMAKE_EMIT_COMPDB)
+  {
+    fprintf (stderr, "Cannot emit kind 0x%02X.\n", kind);
+    return (false);
+  }
+  if (!get_tools(ctx, &tools))
+     return (false);
+
+  if (kind == GENMAKE_EMIT_NINJA)
+       rc = emit_ninja (ctx, &tools, out);
+  else emit_compdb (ctx, &tools, out);
+  build_tools_free (&tools);
+  return (rc);
+}
+
+/*
+ * Write the manifest and all of 'genmake_options::emit'; to the files given
+ * or to the default ones.
+ */
+bool genmake_write (genmake_ctx *ctx)
+{
+  if (ctx->manifest_file)
+     write_manifest (ctx);
+
+  return ((!(ctx->emit & GENMAKE_EMIT_MAKE)   || write_makefile(ctx)) &&
+          (!(ctx->emit & GENMAKE_EMIT_NINJA)  || write_tools_file(ctx, GENMAKE_EMIT_NINJA)) &&
+          (!(ctx->emit & GENMAKE_EMIT_COMPDB) || write_tools_file(ctx, GENMAKE_EMIT_COMPDB)));
+}
+
+/*
+ * Scan the sources found for the include-paths, the PCH headers, the
+ * unity batches, the programs (with 'multi_target') and the C++20 modules.
+ */
+void genmake_scan (genmake_ctx *ctx)
+{
+  infer_inc_paths (ctx);
+  find_pch_headers (ctx);
+  ctx->unity = unity_plan_new (ctx->base, ctx->c_files, ctx->unity_excludes, ctx->unity_size);
+  if (ctx->multi_target)
+     find_programs (ctx);
+  find_modules (ctx);
+}
+
+static char *dup_opt (const char *str)
+{
+  return (str ? strdup(str) : NULL);
+}
+
+/*
+ * Return a new context for the options in 'opt'. Or NULL if an option is
+ * illegal.
+ */
+genmake_ctx *genmake_new (const genmake_options *opt)
+{
+  genmake_ctx *ctx = calloc (1, sizeof(*ctx));
+  const char  *root = opt->root ? opt->root : ".";
+  size_t       len;
+  int          i, j;
+
+  assert (ctx);
+  ctx->root = str_replace ('/', '\\', dep_normalise(strdup(*root ? root : ".")));
+  len = strlen (ctx->root);
+
+  ctx->git_dir = malloc (len + sizeof("\\.git\\"));
+  assert (ctx->git_dir);
+  if (!strcmp(ctx->root, "."))
+       strcpy (ctx->git_dir, ".git\\");
+  else sprintf (ctx->git_dir, "%s\\.git\\", ctx->root);
+
+  if (strcmp(ctx->root, "."))
+     ctx->base = str_replace ('\\', '/', strdup(ctx->root));
+
+  ctx->prog = str_replace ('\\', '/', strdup(opt->prog ? opt->prog : "gen-make"));
+
+  ctx->c_files        = smartlist_new();
+  ctx->cc_files       = smartlist_new();
+  ctx->cpp_files      = smartlist_new();
+  ctx->cxx_files      = smartlist_new();
+  ctx->rc_files       = smartlist_new();
+  ctx->h_in_files     = smartlist_new();
+  ctx->h_files        = smartlist_new();
+  ctx->ixx_files      = smartlist_new();
+  ctx->vpaths         = smartlist_new();
+  ctx->inc_paths      = smartlist_new();
+  ctx->unity_excludes = smartlist_new();
+  ctx->merkle         = merkle_new();
+
+  for (i = 0; opt->inc_paths && i < smartlist_len(opt->inc_paths); i++)
+      smartlist_add (ctx->inc_paths, strdup(smartlist_get(opt->inc_paths, i)));
+  for (i = 0; opt->unity_excludes && i < smartlist_len(opt->unity_excludes); i++)
+      smartlist_add (ctx->unity_excludes, str_replace('\\', '/', strdup(smartlist_get(opt->unity_excludes, i))));
+
+  ctx->recursive     = !opt->no_recurse;
+  ctx->multi_target  = opt->multi_target;
+  ctx->json_output   = opt->json;
+  ctx->emit          = opt->emit ? opt->emit : GENMAKE_EMIT_MAKE;
+  ctx->unity_size    = opt->unity_size ? opt->unity_size : 256 * 1024;
+  ctx->template_file = dup_opt (opt->template_file);
+  ctx->output_file   = dup_opt (opt->output_file);
+  ctx->update_file   = dup_opt (opt->update_file);
+  ctx->manifest_file = dup_opt (opt->manifest_file);
+  ctx->report_sort   = dup_opt (opt->report_sort ? opt->report_sort : "parsed");
+  ctx->cache_file    = dup_opt (opt->cache_file);
+  ctx->merkle_file   = dup_opt (opt->merkle_file);
+  ctx->probe_file    = dup_opt (opt->probe_file);
+
+  for (i = 0; opt->templates && i < smartlist_len(opt->templates); i++)
+  {
+    const char *name = smartlist_get (opt->templates, i);
+
+    for (j = 0; j < (int)DIM(builtin_templates); j++)
+        if (!stricmp(name, builtin_templates[j].name))
+           break;
+    if (j == (int)DIM(builtin_templates))
+    {
+      fprintf (stderr, "Unknown template '%s'; use 'windows', 'linux', 'mingw' or 'cygwin'.\n", name);
+      genmake_free (ctx);
+      return (NULL);
+    }
+    if (!ctx->templates)
+       ctx->templates = smartlist_new();
+    smartlist_add (ctx->templates, (void*)(builtin_templates + j));
+  }
+  return (ctx);
+}
+
+void genmake_free (genmake_ctx *ctx)
+{
+  if (!ctx)
+     return;
+
+  smartlist_free (ctx->c_files);
+  smartlist_free (ctx->cc_files);
+  smartlist_free (ctx->cpp_files);
+  smartlist_free (ctx->cxx_files);
+  smartlist_free (ctx->rc_files);
+  smartlist_free (ctx->h_in_files);
+  smartlist_free_all (ctx->h_files);
+  smartlist_free_all (ctx->ixx_files);
+  smartlist_free_all (ctx->obj_files);
+  smartlist_free (ctx->vpaths);
+  smartlist_free_all (ctx->inc_paths);
+  if (ctx->found_inc_dirs)
+     smartlist_wipe (ctx->found_inc_dirs, dep_inc_dir_free);
+  smartlist_free (ctx->found_inc_dirs);
+  smartlist_free_all (ctx->sys_inc_dirs);
+  smartlist_free (ctx->pch_headers);
+  smartlist_free_all (ctx->pch_ranks);
+  dep_graph_free (ctx->src_graph);
+  smartlist_free_all (ctx->unity_excludes);
+  unity_plan_free (ctx->unity);
+  if (ctx->programs)
+     smartlist_wipe (ctx->programs, program_free);
+  smartlist_free (ctx->programs);
+  smartlist_free (ctx->shared_srcs);
+  smartlist_free (ctx->templates);
+  module_plan_free (ctx->modules);
+  manifest_duplicates_free (ctx->dup_sources);
+  manifest_duplicates_free (ctx->dup_unmerged);
+  merkle_free (ctx->merkle);
+  merkle_free (ctx->merkle_prev);
+  free (ctx->entry_scans);
+  free (ctx->template_file);
+  free (ctx->output_file);
+  free (ctx->update_file);
+  free (ctx->manifest_file);
+  free (ctx->report_sort);
+  free (ctx->cache_file);
+  free (ctx->merkle_file);
+  free (ctx->probe_file);
+  free (ctx->prog);
+  free (ctx->git_dir);
+  free (ctx->base);
+  free (ctx->root);
+  free (ctx);
+}
+
+/*
+ * Free the compiled templates shared by all contexts. After the last
+ * 'genmake_free()'.
+ */
+void genmake_free_caches (void)
+{
+  template_unload_all();
+}
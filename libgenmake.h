@@ -0,0 +1,83 @@
+#ifndef _LIBGENMAKE_H
+#define _LIBGENMAKE_H
+
+/*
+ * The gen-make library; all of gen-make except the command-line.
+ *
+ * All the state of one generation is in a 'genmake_ctx'. So several contexts
+ * can generate on threads in one process; e.g. one for each component of a
+ * bigger build. They share the compiled templates and the tools probed.
+ * A context is only used by one thread at a time.
+ *
+ * The steps are:
+ *   ctx = genmake_new (&opt);
+ *   genmake_walk (ctx);          find the files under 'opt.root'
+ *   genmake_classify (ctx);      drop the duplicated sources, find the entry-points
+ *   genmake_scan (ctx);          the includes, PCH, unity batches, programs and modules
+ *   genmake_write (ctx);         or 'genmake_emit()' into a buffer
+ *   genmake_free (ctx);
+ *
+ * Several contexts can share one walk with 'genmake_walk_many()'; each
+ * gets the files below it's root. The file-names (and the '-I' paths) of a
+ * context are relative to it's root; so the output belongs in the root.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gen-make.h"
+#include "smartlist.h"
+#include "outbuf.h"
+
+/*
+ * What to write; the 'genmake_options::emit' flags.
+ */
+#define GENMAKE_EMIT_MAKE    0x01
+#define GENMAKE_EMIT_NINJA   0x02
+#define GENMAKE_EMIT_COMPDB  0x04
+
+/*
+ * The options of a context. The strings and lists are copied by 'genmake_new()'.
+ */
+typedef struct genmake_options {
+        const char        *root;            /* the directory to walk; "." if NULL */
+        const char        *prog;            /* the 'gen-make' in the makefile rules; "gen-make" if NULL */
+        bool               no_recurse;      /* only the files in 'root' */
+        bool               multi_target;    /* one program for each 'main()' */
+        bool               json;            /* JSON from 'genmake_affected()' etc. */
+        unsigned           emit;            /* 'GENMAKE_EMIT_x'; a makefile if 0 */
+        uint64_t           unity_size;      /* of a unity batch; 256 kB if 0 */
+        const smartlist_t *inc_paths;       /* the '-I' dirs */
+        const smartlist_t *unity_excludes;
+        const smartlist_t *templates;       /* the names of the built-in templates; 'windows' if none */
+        const char        *template_file;   /* instead of the built-in templates */
+        const char        *output_file;     /* stdout if NULL and 'emit' is a makefile */
+        const char        *update_file;     /* replace the regions of this makefile */
+        const char        *manifest_file;
+        const char        *report_sort;     /* for 'genmake_report()'; 'parsed' if NULL */
+        const char        *cache_file;      /* the include-graph cache; none if NULL */
+        const char        *merkle_file;     /* the Merkle tree of the previous run; none if NULL */
+        const char        *probe_file;      /* the probed tools; none if NULL */
+      } genmake_options;
+
+typedef struct genmake_ctx genmake_ctx;
+
+genmake_ctx *genmake_new (const genmake_options *opt);
+void         genmake_free (genmake_ctx *ctx);
+void         genmake_free_caches (void);
+
+void genmake_walk (genmake_ctx *ctx);
+void genmake_walk_many (genmake_ctx **ctx, size_t num);
+void genmake_add_file (genmake_ctx *ctx, const char *path, const WIN32_FIND_DATA *ff);
+int  genmake_classify (genmake_ctx *ctx);
+void genmake_scan (genmake_ctx *ctx);
+bool genmake_emit (genmake_ctx *ctx, unsigned kind, out_buf *out);
+bool genmake_write (genmake_ctx *ctx);
+
+int  genmake_depend (genmake_ctx *ctx, int num_files, char *const *files);
+int  genmake_affected (genmake_ctx *ctx, int num_files, char *const *files);
+int  genmake_report (genmake_ctx *ctx, int num_files, char *const *files);
+int  genmake_scan_modules (genmake_ctx *ctx, int num_files, char *const *files);
+int  genmake_analyze_objects (genmake_ctx *ctx, int num_files, char *const *files);
+int  genmake_fingerprint (genmake_ctx *ctx, const char *dir);
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ * A manifest of content-hashes for the gen-make program.
+ *
+ * All files are hashed in parallel; each is memory-mapped and hashed
+ * with 'hash64()'. The manifest is sorted on the file-names. So it's
+ * stable and a 'diff' of two manifests shows what changed; regardless
+ * of the time-stamps.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/stat.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "hash.h"
+#include "manifest.h"
+
+typedef struct hash_job {
+        manifest   *m;
+        const char *base;
+      } hash_job;
+
+static void hash_entry (void *arg, size_t idx)
+{
+  hash_job       *job = arg;
+  manifest_entry *e = job->m->entries + idx;
+  char            buf [_MAX_PATH];
+
+  e->ok = hash_file (base_path(job->base, e->file, buf, sizeof(buf)), &e->hash, &e->size);
+}
+
+static int compare_entry (const void *_a, const void *_b)
+{
+  const manifest_entry *a = _a;
+  const manifest_entry *b = _b;
+
+  return strcmp (a->file, b->file);
+}
+
+/*
+ * Hash all the 'files' (relative to 'base'; NULL for the current directory).
+ * The entries are sorted on the file-name.
+ */
+manifest *manifest_new (const char *base, const smartlist_t *files)
+{
+  manifest *m = calloc (1, sizeof(*m));
+  hash_job  job;
+  size_t    i;
+
+  assert (m);
+  m->num = smartlist_len (files);
+  m->entries = calloc (m->num + 1, sizeof(*m->entries));
+  assert (m->entries);
+
+  for (i = 0; i < m->num; i++)
+      m->entries[i].file = strdup (smartlist_get(files, (int)i));
+
+  qsort (m->entries, m->num, sizeof(*m->entries), compare_entry);
+  job.m    = m;
+  job.base = base;
+  run_parallel (m->num, hash_entry, &job);
+  return (m);
+}
+
+/*
+ * Write the manifest as lines of "hash size file".
+ */
+bool manifest_write (const manifest *m, const char *fname)
+{
+  FILE  *out = fopen (fname, "wb");
+  size_t i;
+
+  if (!out)
+  {
+    fprintf (stderr, "Failed to create '%s'.\n", fname);
+    return (false);
+  }
+
+  fprintf (out, "# gen-make manifest: hash64, size, file\n");
+  for (i = 0; i < m->num; i++)
+  {
+    const manifest_entry *e = m->entries + i;
+
+    if (e->ok)
+       fprintf (out, "%016llx %10llu %s\n", (unsigned long long)e->hash, (unsigned long long)e->size, e->file);
+  }
+  fclose (out);
+  DEBUG (1, "Wrote manifest '%s' with %zu files.\n", fname, m->num);
+  return (true);
+}
+
+void manifest_free (manifest *m)
+{
+  size_t i;
+
+  if (!m)
+     return;
+  for (i = 0; i < m->num; i++)
+      free (m->entries[i].file);
+  free (m->entries);
+  free (m);
+}
+
+/*
+ * A file in 'manifest_duplicates()'.
+ */
+typedef struct dup_entry {
+        const char *file;
+        const char *base;    /* 'file' is relative to this; NULL for "." */
+        size_t      idx;     /* index in the 'files' */
+        uint64_t    size;
+        uint64_t    hash;    /* 0 until hashed */
+        bool        ok;
+      } dup_entry;
+
+static int compare_dup (const void *_a, const void *_b)
+{
+  const dup_entry *a = _a;
+  const dup_entry *b = _b;
+
+  if (a->ok != b->ok)
+     return (a->ok ? -1 : 1);
+  if (a->size != b->size)
+     return (a->size < b->size ? -1 : 1);
+  if (a->hash != b->hash)
+     return (a->hash < b->hash ? -1 : 1);
+  return (a->idx < b->idx ? -1 : a->idx > b->idx);
+}
+
+static void size_dup (void *arg, size_t idx)
+{
+  dup_entry  *e = (dup_entry*) arg + idx;
+  struct stat st;
+  char        buf [_MAX_PATH];
+
+  e->ok = (stat(base_path(e->base, e->file, buf, sizeof(buf)), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG);
+  e->size = e->ok ? (uint64_t) st.st_size : 0;
+}
+
+static void hash_dup (void *arg, size_t idx)
+{
+  dup_entry *e = (dup_entry*) arg + idx;
+  uint64_t   size;
+  char       buf [_MAX_PATH];
+
+  e->ok = hash_file (base_path(e->base, e->file, buf, sizeof(buf)), &e->hash, &size) && size == e->size;
+}
+
+static bool same_contents (const char *base, const char *file1, const char *file2)
+{
+  mapped_file mf1, mf2;
+  bool        same = false;
+  char        buf [_MAX_PATH];
+
+  if (!map_file(base_path(base, file1, buf, sizeof(buf)), &mf1))
+     return (false);
+  if (map_file(base_path(base, file2, buf, sizeof(buf)), &mf2))
+  {
+    same = (mf1.size == mf2.size && !memcmp(mf1.data, mf2.data, mf1.size));
+    unmap_file (&mf2);
+  }
+  unmap_file (&mf1);
+  return (same);
+}
+
+/*
+ * Find the 'files' with the same contents. The sizes are compared first;
+ * only the files sharing a size with another are hashed (in parallel) and
+ * the files with equal hashes are compared byte by byte.
+ *
+ * Returns a list of groups; each a 'smartlist_t*' of 2 or more of the
+ * 'const char*' in 'files' (not copies) in the order of 'files'.
+ * Free it with 'manifest_duplicates_free()'. The 'files' are relative
+ * to 'base' (NULL for the current directory).
+ */
+smartlist_t *manifest_duplicates (const char *base, const smartlist_t *files)
+{
+  smartlist_t *groups = smartlist_new();
+  dup_entry   *e;
+  size_t       i, j, k, num = smartlist_len (files), num_hashed = 0;
+
+  e = calloc (num + 1, sizeof(*e));
+  assert (e);
+  for (i = 0; i < num; i++)
+  {
+    e[i].file = smartlist_get (files, (int)i);
+    e[i].base = base;
+    e[i].idx  = i;
+  }
+  run_parallel (num, size_dup, e);
+  qsort (e, num, sizeof(*e), compare_dup);
+
+  /* Move the runs of 2 or more non-empty files with the same size to the front.
+   */
+  for (i = 0; i < num && e[i].ok; i = j)
+  {
+    for (j = i + 1; j < num && e[j].ok && e[j].size == e[i].size; j++)
+        ;
+    if (j - i < 2 || e[i].size == 0)
+       continue;
+    while (i < j)
+      e [num_hashed++] = e [i++];
+  }
+
+  run_parallel (num_hashed, hash_dup, e);
+  qsort (e, num_hashed, sizeof(*e), compare_dup);
+  DEBUG (1, "%zu of %zu files share a size with another file.\n", num_hashed, num);
+
+  for (i = 0; i < num_hashed && e[i].ok; i = j)
+  {
+    for (j = i + 1; j < num_hashed && e[j].ok && e[j].size == e[i].size && e[j].hash == e[i].hash; j++)
+        ;
+
+    /* Group the files in this run equal to the first one left.
+     * A hash-collision is left for the next round.
+     */
+    while (j - i >= 2)
+    {
+      smartlist_t *group = NULL;
+
+      for (k = i + 1; k < j; k++)
+      {
+        if (!e[k].file || !same_contents(base, e[i].file, e[k].file))
+           continue;
+        if (!group)
+        {
+          group = smartlist_new();
+          smartlist_add (group, (void*)e[i].file);
+        }
+        smartlist_add (group, (void*)e[k].file);
+        e[k].file = NULL;
+      }
+      if (group)
+         smartlist_add (groups, group);
+      for (i++; i < j && !e[i].file; i++)
+          ;
+    }
+  }
+  free (e);
+  DEBUG (1, "Found %d groups of identical files.\n", smartlist_len(groups));
+  return (groups);
+}
+
+void manifest_duplicates_free (smartlist_t *groups)
+{
+  int i;
+
+  if (!groups)
+     return;
+  for (i = 0; i < smartlist_len(groups); i++)
+      smartlist_free (smartlist_get(groups, i));
+  smartlist_free (groups);
+}
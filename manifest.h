@@ -0,0 +1,31 @@
+#ifndef _MANIFEST_H
+#define _MANIFEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smartlist.h"
+
+/*
+ * The content-hash of a file.
+ */
+typedef struct manifest_entry {
+        char     *file;
+        uint64_t  size;
+        uint64_t  hash;     /* 'hash64()' of the contents */
+        bool      ok;       /* false if it could not be read */
+      } manifest_entry;
+
+typedef struct manifest {
+        manifest_entry *entries;   /* sorted on 'file' */
+        size_t          num;
+      } manifest;
+
+manifest *manifest_new (const char *base, const smartlist_t *files);
+bool      manifest_write (const manifest *m, const char *fname);
+void      manifest_free (manifest *m);
+
+smartlist_t *manifest_duplicates (const char *base, const smartlist_t *files);
+void         manifest_duplicates_free (smartlist_t *groups);
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * A Merkle tree of the directories walked by the gen-make program.
+ *
+ * The hash of a directory combines the names, sizes and time-stamps of
+ * the files found in it (only those gen-make uses) and the hashes of
+ * it's sub-directories. So if the hash of a directory is the same as
+ * in the previous run, nothing below it has changed. But the walk still
+ * visits (and stats) every directory to compute it. The tree is kept in
+ * the text-file '.gen-make.merkle' as lines of "hash files-hash num-files
+ * directory".
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "hash.h"
+#include "merkle.h"
+#include "outbuf.h"
+
+#define MERKLE_HEADER  "# gen-make merkle: hash64, files-hash64, files, directory"
+
+/*
+ * Make 'path' into the form used as a key; '/' separators, no
+ * leading "./" and no trailing '/'. The top directory is ".".
+ */
+static char *merkle_norm (const char *path, char *buf, size_t size)
+{
+  char *p, *end;
+
+  while (path[0] == '.' && (path[1] == '/' || path[1] == '\\'))
+        path += 2;
+  snprintf (buf, size, "%s", path);
+  for (p = buf; *p; p++)
+      if (*p == '\\')
+         *p = '/';
+
+  end = buf + strlen (buf);
+  while (end > buf && end[-1] == '/')
+        *(--end) = '\0';
+  if (!*buf || !strcmp(buf, "."))
+     snprintf (buf, size, ".");
+  return (buf);
+}
+
+/*
+ * Return the node for the normalised 'dir'; create it and it's parents as needed.
+ */
+static merkle_dir *merkle_get_dir (merkle_tree *mt, const char *dir)
+{
+  merkle_dir *d = strmap_get (mt->dirs, dir);
+  const char *slash;
+  char        parent [_MAX_PATH];
+
+  if (d)
+     return (d);
+
+  d = calloc (1, sizeof(*d));
+  assert (d);
+  d->dir      = strdup (dir);
+  d->children = smartlist_new();
+  strmap_set (mt->dirs, dir, d);
+  smartlist_add (mt->all, d);
+
+  if (!strcmp(dir, "."))
+     return (d);
+
+  slash = strrchr (dir, '/');
+  if (slash)
+       snprintf (parent, sizeof(parent), "%.*s", (int)(slash - dir), dir);
+  else strcpy (parent, ".");
+  d->parent = merkle_get_dir (mt, parent);
+  smartlist_add (d->parent->children, d);
+  return (d);
+}
+
+merkle_tree *merkle_new (void)
+{
+  merkle_tree *mt = calloc (1, sizeof(*mt));
+
+  assert (mt);
+  mt->dirs = strmap_new (true);
+  mt->all  = smartlist_new();
+  mt->root = merkle_get_dir (mt, ".");
+  return (mt);
+}
+
+/*
+ * Add a 'file' found by the walk to the files-hash of it's directory.
+ * The files are added as a sum of their hashes; so the order of the
+ * walk does not matter.
+ */
+void merkle_add_file (merkle_tree *mt, const char *file, uint64_t size, uint64_t mtime)
+{
+  merkle_dir *d;
+  char        path [_MAX_PATH], entry [_MAX_PATH + 2*sizeof(uint64_t)];
+  char       *slash;
+  const char *base;
+  size_t      len;
+
+  merkle_norm (file, path, sizeof(path));
+  slash = strrchr (path, '/');
+  if (slash)
+  {
+    *slash = '\0';
+    base = slash + 1;
+    d = merkle_get_dir (mt, path);
+  }
+  else
+  {
+    base = path;
+    d = mt->root;
+  }
+
+  len = strlen (base) + 1;
+  memcpy (entry, base, len);
+  memcpy (entry + len, &size, sizeof(size));
+  memcpy (entry + len + sizeof(size), &mtime, sizeof(mtime));
+  d->files_hash += hash64 (entry, len + 2*sizeof(uint64_t));
+  d->num_files++;
+}
+
+static int compare_dir (const void **_a, const void **_b)
+{
+  const merkle_dir *a = *_a;
+  const merkle_dir *b = *_b;
+
+  return strcmp (a->dir, b->dir);
+}
+
+static void merkle_hash_dir (merkle_dir *d)
+{
+  char  *buf, *p;
+  size_t size = sizeof(d->files_hash) + sizeof(d->num_files);
+  int    i;
+
+  smartlist_sort (d->children, compare_dir);
+  for (i = 0; i < smartlist_len(d->children); i++)
+  {
+    merkle_dir *child = smartlist_get (d->children, i);
+
+    merkle_hash_dir (child);
+    size += strlen (child->dir) + 1 + sizeof(child->hash);
+  }
+
+  p = buf = malloc (size);
+  assert (buf);
+  memcpy (p, &d->files_hash, sizeof(d->files_hash));
+  p += sizeof(d->files_hash);
+  memcpy (p, &d->num_files, sizeof(d->num_files));
+  p += sizeof(d->num_files);
+
+  for (i = 0; i < smartlist_len(d->children); i++)
+  {
+    const merkle_dir *child = smartlist_get (d->children, i);
+    size_t            len = strlen (child->dir) + 1;
+
+    memcpy (p, child->dir, len);
+    p += len;
+    memcpy (p, &child->hash, sizeof(child->hash));
+    p += sizeof(child->hash);
+  }
+  d->hash = hash64 (buf, size);
+  free (buf);
+}
+
+/*
+ * Compute the hashes of all directories; the children before the parent.
+ * Call when all files are added.
+ */
+void merkle_finish (merkle_tree *mt)
+{
+  merkle_hash_dir (mt->root);
+  smartlist_sort (mt->all, compare_dir);
+  DEBUG (1, "Merkle tree of %d directories: %016llx.\n", smartlist_len(mt->all), (unsigned long long)mt->root->hash);
+}
+
+merkle_dir *merkle_lookup (const merkle_tree *mt, const char *dir)
+{
+  char key [_MAX_PATH];
+
+  return strmap_get (mt->dirs, merkle_norm(dir, key, sizeof(key)));
+}
+
+static void merkle_diff (const merkle_tree *mt, const merkle_tree *prev, const merkle_dir *d, smartlist_t *changed)
+{
+  const merkle_dir *p = prev ? strmap_get (prev->dirs, d->dir) : NULL;
+  int               i;
+
+  if (p && p->hash == d->hash)
+     return;
+
+  if (!p || p->files_hash != d->files_hash || p->num_files != d->num_files)
+     smartlist_add (changed, d->dir);
+
+  for (i = 0; i < smartlist_len(d->children); i++)
+      merkle_diff (mt, prev, smartlist_get(d->children, i), changed);
+
+  for (i = 0; p && i < smartlist_len(p->children); i++)
+  {
+    const merkle_dir *gone = smartlist_get (p->children, i);
+
+    if (!strmap_get(mt->dirs, gone->dir))
+       smartlist_add (changed, gone->dir);
+  }
+}
+
+/*
+ * Add to 'changed' the directories in 'mt' with other files than in 'prev',
+ * the new ones and those in 'prev' now gone. The unchanged subtrees are not
+ * descended into. Returns the number of these.
+ * The names added are owned by 'mt' and 'prev'.
+ */
+int merkle_changed (const merkle_tree *mt, const merkle_tree *prev, smartlist_t *changed)
+{
+  int num = smartlist_len (changed);
+
+  merkle_diff (mt, prev, mt->root, changed);
+  return (smartlist_len(changed) - num);
+}
+
+/*
+ * Read a tree written by 'merkle_write()'. Returns NULL if not found.
+ * The hashes are as read; 'merkle_finish()' must not be called on it.
+ */
+merkle_tree *merkle_read (const char *fname)
+{
+  merkle_tree *mt;
+  FILE        *in = fopen (fname, "rb");
+  char         line [_MAX_PATH + 100];
+
+  if (!in)
+     return (NULL);
+
+  mt = merkle_new();
+  while (fgets(line, sizeof(line), in))
+  {
+    unsigned long long hash, files_hash;
+    unsigned           num_files;
+    int                pos = 0;
+    char              *end;
+    merkle_dir        *d;
+
+    if (line[0] == '#')
+       continue;
+    if (sscanf(line, "%llx %llx %u %n", &hash, &files_hash, &num_files, &pos) != 3 || pos == 0)
+       continue;
+
+    end = strpbrk (line + pos, "\r\n");
+    if (end)
+       *end = '\0';
+    d = merkle_get_dir (mt, line + pos);
+    d->hash       = hash;
+    d->files_hash = files_hash;
+    d->num_files  = num_files;
+  }
+  fclose (in);
+  smartlist_sort (mt->all, compare_dir);
+  DEBUG (1, "Read Merkle tree '%s' with %d directories.\n", fname, smartlist_len(mt->all));
+  return (mt);
+}
+
+static bool write_dirs (void *arg, FILE *f)
+{
+  const merkle_tree *mt = arg;
+  int                i;
+
+  fprintf (f, "%s\n", MERKLE_HEADER);
+  for (i = 0; i < smartlist_len(mt->all); i++)
+  {
+    const merkle_dir *d = smartlist_get (mt->all, i);
+
+    fprintf (f, "%016llx %016llx %u %s\n", (unsigned long long)d->hash,
+             (unsigned long long)d->files_hash, d->num_files, d->dir);
+  }
+  return (true);
+}
+
+bool merkle_write (const merkle_tree *mt, const char *fname)
+{
+  bool rc = write_replace_file (fname, write_dirs, (void*)mt);
+
+  DEBUG (1, "%s Merkle tree '%s' with %d directories.\n",
+         rc ? "Wrote" : "Failed to write", fname, smartlist_len(mt->all));
+  return (rc);
+}
+
+static void merkle_dir_free (void *val)
+{
+  merkle_dir *d = val;
+
+  free (d->dir);
+  smartlist_free (d->children);
+  free (d);
+}
+
+void merkle_free (merkle_tree *mt)
+{
+  if (!mt)
+     return;
+  strmap_free (mt->dirs, NULL);
+  smartlist_wipe (mt->all, merkle_dir_free);
+  smartlist_free (mt->all);
+  free (mt);
+}
@@ -0,0 +1,37 @@
+#ifndef _MERKLE_H
+#define _MERKLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smartlist.h"
+#include "strmap.h"
+
+/*
+ * A directory in the Merkle tree; "." is the root.
+ */
+typedef struct merkle_dir {
+        char              *dir;         /* "." or "sub/dir" */
+        uint64_t           hash;        /* of 'files_hash' and the hashes of the 'children' */
+        uint64_t           files_hash;  /* of the names, sizes and time-stamps of the files here */
+        unsigned           num_files;
+        struct merkle_dir *parent;
+        smartlist_t       *children;    /* 'merkle_dir*'; sorted on 'dir' by 'merkle_finish()' */
+      } merkle_dir;
+
+typedef struct merkle_tree {
+        merkle_dir  *root;
+        strmap_t    *dirs;      /* dir -> 'merkle_dir*' */
+        smartlist_t *all;       /* all 'merkle_dir*' */
+      } merkle_tree;
+
+merkle_tree *merkle_new (void);
+void         merkle_add_file (merkle_tree *mt, const char *file, uint64_t size, uint64_t mtime);
+void         merkle_finish (merkle_tree *mt);
+merkle_dir  *merkle_lookup (const merkle_tree *mt, const char *dir);
+int          merkle_changed (const merkle_tree *mt, const merkle_tree *prev, smartlist_t *changed);
+merkle_tree *merkle_read (const char *fname);
+bool         merkle_write (const merkle_tree *mt, const char *fname);
+void         merkle_free (merkle_tree *mt);
+
+#endif
@@ -0,0 +1,269 @@
+/*
+ * C++20 modules for the gen-make program.
+ *
+ * All C++ sources are scanned (in parallel) for their module declarations
+ * and imports. A unit must be compiled after the units providing the
+ * modules it imports; their compiled interface (the BMI; a '.ifc' file
+ * for MSVC) is read when compiling it. So the units are put in an order
+ * where each comes after all it imports. Like the 'P1689' dependency
+ * format, an import no unit provides is reported (e.g. 'import std;').
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "modules.h"
+
+#define STATE_NEW      0
+#define STATE_VISITING 1
+#define STATE_DONE     2
+
+static char *str_dup_len (const char *str, size_t len)
+{
+  char *s = malloc (len + 1);
+
+  assert (s);
+  memcpy (s, str, len);
+  s [len] = '\0';
+  return (s);
+}
+
+static void add_decl (void *arg, int kind, const char *name, size_t len)
+{
+  module_unit *u = arg;
+  char        *colon;
+
+  switch (kind)
+  {
+    case MODULE_EXPORT:
+    case MODULE_IMPL:
+         free (u->provides);
+         free (u->module);
+         u->module = str_dup_len (name, len);
+         colon = strchr (u->module, ':');
+         if (colon)
+            *colon = '\0';
+
+         /* 'module M;' imports the primary interface of 'M'.
+          * 'module M:part;' is an internal partition.
+          */
+         if (kind == MODULE_IMPL && !colon)
+         {
+           u->provides = NULL;
+           smartlist_add (u->requires, strdup(u->module));
+         }
+         else
+           u->provides = str_dup_len (name, len);
+         u->is_interface = (kind == MODULE_EXPORT);
+         break;
+
+    case MODULE_IMPORT:
+         smartlist_add (u->requires, str_dup_len(name, len));
+         break;
+
+    case MODULE_HEADER_ANGLE:
+    case MODULE_HEADER_QUOTE:
+         {
+           char *h = malloc (len + 3);
+
+           assert (h);
+           h[0] = (kind == MODULE_HEADER_ANGLE) ? '<' : '"';
+           memcpy (h + 1, name, len);
+           h [len+1] = (kind == MODULE_HEADER_ANGLE) ? '>' : '"';
+           h [len+2] = '\0';
+           smartlist_add (u->header_units, h);
+         }
+         break;
+  }
+}
+
+typedef struct scan_job {
+        module_unit **units;
+        const char   *base;
+      } scan_job;
+
+static void scan_unit (void *arg, size_t idx)
+{
+  scan_job    *job = arg;
+  module_unit *u = job->units [idx];
+  mapped_file  mf;
+  char         buf [_MAX_PATH];
+
+  if (!map_file(base_path(job->base, u->file, buf, sizeof(buf)), &mf))
+     return;
+  scan_module_decls (mf.data, mf.size, add_decl, u);
+  unmap_file (&mf);
+}
+
+/*
+ * Make an import of a partition ':part' into 'M:part'.
+ */
+static void resolve_partitions (module_unit *u)
+{
+  int i;
+
+  for (i = 0; i < smartlist_len(u->requires); i++)
+  {
+    char *req = smartlist_get (u->requires, i);
+    char *full;
+
+    if (*req != ':')
+       continue;
+    if (!u->module)
+    {
+      fprintf (stderr, "%s: import of partition '%s' outside a module.\n", u->file, req);
+      continue;
+    }
+    full = malloc (strlen(u->module) + strlen(req) + 1);
+    assert (full);
+    strcpy (full, u->module);
+    strcat (full, req);
+    smartlist_set (u->requires, i, full);
+    free (req);
+  }
+}
+
+/*
+ * Add 'u' to 'mp->units' after all the units it imports (depth first).
+ */
+static void order_unit (module_plan *mp, module_unit *u)
+{
+  int i;
+
+  if (u->state == STATE_DONE)
+     return;
+
+  if (u->state == STATE_VISITING)
+  {
+    smartlist_add (mp->cycles, u);
+    return;
+  }
+
+  u->state = STATE_VISITING;
+  for (i = 0; i < smartlist_len(u->requires); i++)
+  {
+    module_unit *provider = strmap_get (mp->providers, smartlist_get(u->requires, i));
+
+    if (provider && provider != u)
+       order_unit (mp, provider);
+  }
+  u->state = STATE_DONE;
+  smartlist_add (mp->units, u);
+}
+
+/*
+ * Scan the C++ 'files' (relative to 'base'; NULL for the current directory)
+ * and put them in build order.
+ */
+module_plan *module_plan_new (const char *base, const smartlist_t *files)
+{
+  module_plan  *mp = calloc (1, sizeof(*mp));
+  module_unit **units;
+  scan_job      job;
+  int           i, j, num = smartlist_len (files);
+
+  assert (mp);
+  units = calloc (num + 1, sizeof(*units));
+  assert (units);
+
+  for (i = 0; i < num; i++)
+  {
+    units[i] = calloc (1, sizeof(**units));
+    assert (units[i]);
+    units[i]->file         = strdup (smartlist_get(files, i));
+    units[i]->requires     = smartlist_new();
+    units[i]->header_units = smartlist_new();
+  }
+  job.units = units;
+  job.base  = base;
+  run_parallel (num, scan_unit, &job);
+
+  mp->units     = smartlist_new();
+  mp->providers = strmap_new (false);
+  mp->missing   = smartlist_new();
+  mp->cycles    = smartlist_new();
+
+  for (i = 0; i < num; i++)
+  {
+    module_unit *u = units[i];
+
+    resolve_partitions (u);
+    if (module_unit_uses_modules(u))
+       mp->num_users++;
+    if (!u->provides)
+       continue;
+
+    if (strmap_get(mp->providers, u->provides))
+         fprintf (stderr, "Module '%s' is provided by both '%s' and '%s'.\n", u->provides,
+                  ((const module_unit*)strmap_get(mp->providers, u->provides))->file, u->file);
+    else strmap_set (mp->providers, u->provides, u);
+  }
+
+  for (i = 0; i < num; i++)
+  {
+    order_unit (mp, units[i]);
+    for (j = 0; j < smartlist_len(units[i]->requires); j++)
+    {
+      const char *req = smartlist_get (units[i]->requires, j);
+
+      if (!strmap_get(mp->providers, req))
+         smartlist_add (mp->missing, strdup(req));
+    }
+  }
+  smartlist_sort (mp->missing, smartlist_compare_strings);
+  smartlist_make_uniq (mp->missing, smartlist_compare_strings, free);
+
+  DEBUG (1, "%d of %d C++ files use modules; %d modules provided, %d missing, %d in cycles.\n",
+         mp->num_users, num, strmap_size(mp->providers), smartlist_len(mp->missing), smartlist_len(mp->cycles));
+  free (units);
+  return (mp);
+}
+
+/*
+ * Return true if 'u' declares or imports a module (or a header unit).
+ */
+bool module_unit_uses_modules (const module_unit *u)
+{
+  return (u->module || smartlist_len(u->requires) > 0 || smartlist_len(u->header_units) > 0);
+}
+
+/*
+ * Return the base-name of the BMI for 'module'. A 'M:part' gives 'M-part' (as MSVC does).
+ */
+char *module_bmi_name (const char *module, char *buf, size_t size)
+{
+  char *colon;
+
+  snprintf (buf, size, "%s", module);
+  colon = strchr (buf, ':');
+  if (colon)
+     *colon = '-';
+  return (buf);
+}
+
+static void module_unit_free (void *val)
+{
+  module_unit *u = val;
+
+  free (u->file);
+  free (u->provides);
+  free (u->module);
+  smartlist_free_all (u->requires);
+  smartlist_free_all (u->header_units);
+  free (u);
+}
+
+void module_plan_free (module_plan *mp)
+{
+  if (!mp)
+     return;
+  smartlist_wipe (mp->units, module_unit_free);
+  smartlist_free (mp->units);
+  strmap_free (mp->providers, NULL);
+  smartlist_free_all (mp->missing);
+  smartlist_free (mp->cycles);
+  free (mp);
+}
@@ -0,0 +1,35 @@
+#ifndef _MODULES_H
+#define _MODULES_H
+
+#include <stdbool.h>
+
+#include "smartlist.h"
+#include "strmap.h"
+
+/*
+ * A C++ translation unit and the modules it declares and imports.
+ */
+typedef struct module_unit {
+        char        *file;
+        char        *provides;      /* the module or 'M:part' it declares; NULL if none */
+        char        *module;        /* the module it belongs to; NULL if none */
+        bool         is_interface;  /* 'export module M;' */
+        smartlist_t *requires;      /* the modules it imports; a partition as 'M:part' */
+        smartlist_t *header_units;  /* '<h>' or '"h"' */
+        int          state;         /* used by 'module_plan_new()' */
+      } module_unit;
+
+typedef struct module_plan {
+        smartlist_t *units;      /* all 'module_unit*'; each after the units it imports */
+        strmap_t    *providers;  /* module-name -> 'module_unit*' */
+        smartlist_t *missing;    /* "module" of the imports no unit provides */
+        smartlist_t *cycles;     /* 'module_unit*' found in an import-cycle */
+        int          num_users;  /* number of units declaring or importing a module */
+      } module_plan;
+
+module_plan *module_plan_new (const char *base, const smartlist_t *files);
+void         module_plan_free (module_plan *mp);
+bool         module_unit_uses_modules (const module_unit *u);
+char        *module_bmi_name (const char *module, char *buf, size_t size);
+
+#endif
@@ -0,0 +1,336 @@
+/*
+ * Write a 'build.ninja' for the gen-make program (option '--emit ninja').
+ *
+ * The same sources as for the makefile; but with an explicit edge for
+ * each object instead of pattern rules:
+ *   build objects/foo.o: cc src/foo.c || objects/config.h
+ *
+ * The headers of each object are tracked by Ninja itself; from the
+ * '-MMD -MF $out.d' depfile of gcc ('deps = gcc') or the '-showIncludes'
+ * output of cl ('deps = msvc'). The configured .h.in files are order-only
+ * inputs and their 'configure' rule has 'restat = 1'; 'gen-make --configure'
+ * does not touch an unchanged header, so nothing including it is rebuilt.
+ * The links share a 'link_pool' since they are I/O and memory bound.
+ * The '$obj_dir/config.h' is written by gen-make itself; unless it comes
+ * from a 'config.h.in'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "smartlist.h"
+#include "strmap.h"
+#include "outbuf.h"
+#include "targets.h"
+#include "ninja.h"
+
+/*
+ * Add a path to a 'build' line. A '$', ' ' and ':' must be escaped there.
+ */
+static void put_path (out_buf *out, const char *path)
+{
+  for ( ; *path; path++)
+  {
+    if (*path == '$' || *path == ' ' || *path == ':')
+       buf_putc (out, '$');
+    buf_putc (out, *path);
+  }
+}
+
+/*
+ * Add a 'name = value' variable. Only a '$' must be escaped in a value.
+ */
+static void put_var (out_buf *out, const char *indent, const char *name, const char *value)
+{
+  buf_printf (out, "%s%s =%s", indent, name, *value ? " " : "");
+  for ( ; *value; value++)
+  {
+    if (*value == '$')
+       buf_putc (out, '$');
+    buf_putc (out, *value);
+  }
+  buf_putc (out, '\n');
+}
+
+static bool is_c_source (const char *file)
+{
+  const char *dot = strrchr (file, '.');
+
+  return (dot && !stricmp(dot, ".c"));
+}
+
+static void write_rules (out_buf *out, const ninja_input *in, bool has_cxx)
+{
+  const build_tools *t = in->tools;
+  const char        *ld = t->ld[0] ? t->ld : has_cxx ? "$cxx" : "$cc";
+
+  if (t->msvc)
+  {
+    buf_puts (out, "rule cc\n"
+                   "  command = $cc -showIncludes $cflags -c $in -Fo$out\n"
+                   "  deps = msvc\n"
+                   "  msvc_deps_prefix = Note: including file:\n"
+                   "  description = CC $out\n\n"
+                   "rule cxx\n"
+                   "  command = $cxx -showIncludes $cxxflags -c $in -Fo$out\n"
+                   "  deps = msvc\n"
+                   "  msvc_deps_prefix = Note: including file:\n"
+                   "  description = CXX $out\n\n");
+    buf_printf (out, "rule link\n"
+                     "  command = %s $ldflags -out:$out @$out.rsp $libs\n"
+                     "  rspfile = $out.rsp\n"
+                     "  rspfile_content = $in\n"
+                     "  pool = link_pool\n"
+                     "  description = LINK $out\n\n"
+                     "rule link_dll\n"
+                     "  command = %s $ldflags -dll -out:$out -implib:$implib @$out.rsp $libs\n"
+                     "  rspfile = $out.rsp\n"
+                     "  rspfile_content = $in\n"
+                     "  pool = link_pool\n"
+                     "  description = LINK $out\n\n"
+                     "rule lib\n"
+                     "  command = %s -nologo -out:$out @$out.rsp\n"
+                     "  rspfile = $out.rsp\n"
+                     "  rspfile_content = $in\n"
+                     "  description = LIB $out\n\n", ld, ld, t->ar);
+  }
+  else
+  {
+    buf_puts (out, "rule cc\n"
+                   "  command = $cc -MMD -MF $out.d $cflags -c $in -o $out\n"
+                   "  depfile = $out.d\n"
+                   "  deps = gcc\n"
+                   "  description = CC $out\n\n"
+                   "rule cxx\n"
+                   "  command = $cxx -MMD -MF $out.d $cxxflags -c $in -o $out\n"
+                   "  depfile = $out.d\n"
+                   "  deps = gcc\n"
+                   "  description = CXX $out\n\n");
+    buf_printf (out, "rule link\n"
+                     "  command = %s $ldflags -o $out @$out.rsp $libs\n"
+                     "  rspfile = $out.rsp\n"
+                     "  rspfile_content = $in\n"
+                     "  pool = link_pool\n"
+                     "  description = LINK $out\n\n"
+                     "rule link_dll\n"
+                     "  command = %s -shared $ldflags -o $out @$out.rsp $libs\n"
+                     "  rspfile = $out.rsp\n"
+                     "  rspfile_content = $in\n"
+                     "  pool = link_pool\n"
+                     "  description = LINK $out\n\n"
+                     "rule lib\n"
+                     "  command = %s rcs $out @$out.rsp\n"
+                     "  rspfile = $out.rsp\n"
+                     "  rspfile_content = $in\n"
+                     "  description = AR $out\n\n", ld, ld, t->ar);
+  }
+
+  if (smartlist_len(in->h_in) > 0)
+     buf_puts (out, "rule configure\n"
+                    "  command = $gen_make --configure $in $out $configure_vars\n"
+                    "  restat = 1\n"
+                    "  description = CONFIGURE $out\n\n");
+}
+
+/*
+ * A 'build' edge for the object of each source in 'sources'. Add the
+ * object names to 'objects'.
+ */
+static void write_objects (out_buf *out, const ninja_input *in, strmap_t *objs,
+                           const smartlist_t *sources, smartlist_t *objects)
+{
+  char obj [_MAX_PATH];
+  int  i, j;
+
+  for (i = 0; i < smartlist_len(sources); i++)
+  {
+    const char *src = smartlist_get (sources, i);
+
+    build_tools_object (in->tools, objs, src, obj, sizeof(obj));
+    smartlist_add (objects, strdup(obj));
+
+    buf_puts (out, "build ");
+    put_path (out, obj);
+    buf_printf (out, ": %s ", is_c_source(src) ? "cc" : "cxx");
+    put_path (out, src);
+    for (j = 0; j < smartlist_len(in->h_out); j++)
+    {
+      buf_puts (out, j == 0 ? " || " : " ");
+      put_path (out, smartlist_get(in->h_out, j));
+    }
+    buf_putc (out, '\n');
+    if (in->is_dll && !in->programs && in->tools->dll_cflags[0])
+       buf_printf (out, "  %s = $%s %s\n", is_c_source(src) ? "cflags" : "cxxflags",
+                   is_c_source(src) ? "cflags" : "cxxflags", in->tools->dll_cflags);
+  }
+  buf_putc (out, '\n');
+}
+
+/*
+ * A 'build target: rule objects [extra]' edge.
+ */
+static void write_link (out_buf *out, const char *target, const char *rule,
+                        const smartlist_t *objects, const char *extra)
+{
+  int i;
+
+  buf_puts (out, "build ");
+  put_path (out, target);
+  buf_printf (out, ": %s", rule);
+  for (i = 0; i < smartlist_len(objects); i++)
+  {
+    buf_puts (out, " $\n    ");
+    put_path (out, smartlist_get(objects, i));
+  }
+  if (extra)
+  {
+    buf_puts (out, " $\n    ");
+    put_path (out, extra);
+  }
+  buf_putc (out, '\n');
+}
+
+/*
+ * The program 'bin/name.exe' from '--multi-target' with the 'exe_ext' of the tools.
+ */
+static const char *program_name (const build_tools *t, const program *p, char *buf, size_t size)
+{
+  const char *dot = strrchr (p->target, '.');
+
+  if (dot && !stricmp(dot, ".exe"))
+       snprintf (buf, size, "%.*s%s", (int)(dot - p->target), p->target, t->exe_ext);
+  else snprintf (buf, size, "%s", p->target);
+  return (buf);
+}
+
+static void write_targets (out_buf *out, const ninja_input *in, strmap_t *objs, smartlist_t *defaults)
+{
+  const build_tools *t = in->tools;
+  smartlist_t       *objects = smartlist_new();
+  char               target [_MAX_PATH], lib [_MAX_PATH];
+  int                i;
+
+  /* Like the 'bin/foo' rule of the makefiles; only the .c SOURCES are linked.
+   * The C++ sources are compiled but not linked.
+   */
+  if (!in->programs)
+  {
+    smartlist_t *c_sources   = smartlist_new();
+    smartlist_t *cxx_sources = smartlist_new();
+    smartlist_t *cxx_objects = smartlist_new();
+
+    for (i = 0; i < smartlist_len(in->sources); i++)
+        smartlist_add (is_c_source(smartlist_get(in->sources, i)) ? c_sources : cxx_sources,
+                       smartlist_get(in->sources, i));
+
+    write_objects (out, in, objs, c_sources, objects);
+    write_objects (out, in, objs, cxx_sources, cxx_objects);
+    snprintf (target, sizeof(target), "bin/foo%s", in->is_dll ? t->dll_ext : t->exe_ext);
+    write_link (out, target, in->is_dll ? "link_dll" : "link", objects, NULL);
+    if (in->is_dll && t->msvc)
+       buf_puts (out, "  implib = lib/foo_imp.lib\n");
+    buf_putc (out, '\n');
+    smartlist_add (defaults, strdup(target));
+    smartlist_free_all (cxx_objects);
+    smartlist_free_all (objects);
+    smartlist_free (cxx_sources);
+    smartlist_free (c_sources);
+    return;
+  }
+
+  lib[0] = '\0';
+  if (smartlist_len(in->shared) > 0)
+  {
+    write_objects (out, in, objs, in->shared, objects);
+    snprintf (lib, sizeof(lib), "lib/%sshared%s", t->msvc ? "" : "lib", t->lib_ext);
+    write_link (out, lib, "lib", objects, NULL);
+    buf_putc (out, '\n');
+    smartlist_free_all (objects);
+    objects = smartlist_new();
+  }
+
+  for (i = 0; i < smartlist_len(in->programs); i++)
+  {
+    const program *p = smartlist_get (in->programs, i);
+
+    write_objects (out, in, objs, p->sources, objects);
+    program_name (t, p, target, sizeof(target));
+    write_link (out, target, "link", objects, lib[0] ? lib : NULL);
+    buf_putc (out, '\n');
+    smartlist_add (defaults, strdup(target));
+    smartlist_free_all (objects);
+    objects = smartlist_new();
+  }
+  smartlist_free (objects);
+}
+
+/*
+ * Write the 'build.ninja' for 'in' into 'out'.
+ */
+void ninja_write (out_buf *out, const ninja_input *in)
+{
+  const build_tools *t = in->tools;
+  strmap_t          *objs = strmap_new (true);
+  smartlist_t       *defaults = smartlist_new();
+  out_buf            flags;
+  bool               has_cxx = false;
+  const char        *quote = strchr (in->gen_make, ' ') ? "\"" : "";
+  char               gen_make [_MAX_PATH + 2];
+  int                i;
+
+  for (i = 0; i < smartlist_len(in->sources); i++)
+      if (!is_c_source(smartlist_get(in->sources, i)))
+         has_cxx = true;
+
+  buf_printf (out, "#\n# Ninja build-file for project X (%s).\n"
+                   "# Generated by 'gen-make --emit ninja' at %s.\n#\n"
+                   "ninja_required_version = 1.5\n\n", t->msvc ? "cl" : "gcc", in->stamp);
+
+  memset (&flags, '\0', sizeof(flags));
+  build_tools_cflags (t, in->inc_dirs, &flags);
+
+  snprintf (gen_make, sizeof(gen_make), "%s%s%s", quote, in->gen_make, quote);
+
+  put_var (out, "", "obj_dir", t->obj_dir);
+  put_var (out, "", "cc", t->cc);
+  put_var (out, "", "cxx", t->cxx);
+  put_var (out, "", "cflags", flags.data);
+  buf_printf (out, "cxxflags = $cflags %s\n", t->cxxflags);
+  put_var (out, "", "ldflags", t->ldflags);
+  put_var (out, "", "libs", t->libs);
+  if (smartlist_len(in->h_in) > 0)
+  {
+    put_var (out, "", "gen_make", gen_make);
+    buf_puts (out, "# Change this:\nconfigure_vars = VER_MAJOR=1 VER_MINOR=2 VER_PATCH=3 VERSION=1.2.3\n");
+  }
+  buf_printf (out, "\npool link_pool\n  depth = %d\n\n", NINJA_LINK_DEPTH);
+  buf_free (&flags);
+
+  write_rules (out, in, has_cxx);
+
+  for (i = 0; i < smartlist_len(in->h_in); i++)
+  {
+    buf_puts (out, "build ");
+    put_path (out, smartlist_get(in->h_out, i));
+    buf_puts (out, ": configure ");
+    put_path (out, smartlist_get(in->h_in, i));
+    buf_putc (out, '\n');
+  }
+  if (smartlist_len(in->h_in) > 0)
+     buf_putc (out, '\n');
+
+  write_targets (out, in, objs, defaults);
+
+  buf_puts (out, "build all: phony");
+  for (i = 0; i < smartlist_len(defaults); i++)
+  {
+    buf_putc (out, ' ');
+    put_path (out, smartlist_get(defaults, i));
+  }
+  buf_puts (out, "\n\ndefault all\n");
+
+  smartlist_free_all (defaults);
+  strmap_free (objs, NULL);
+}
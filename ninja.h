@@ -0,0 +1,31 @@
+#ifndef _NINJA_H
+#define _NINJA_H
+
+#include "smartlist.h"
+#include "outbuf.h"
+#include "tools.h"
+
+/*
+ * Max number of links running at the same time; the 'link_pool' depth.
+ */
+#define NINJA_LINK_DEPTH  2
+
+/*
+ * What 'ninja_write()' needs from the program.
+ */
+typedef struct ninja_input {
+        const build_tools *tools;
+        const smartlist_t *inc_dirs;    /* the '-I' dirs given and found */
+        const char        *gen_make;    /* for the '--configure' rule */
+        const char        *stamp;       /* the time-stamp in the header */
+        const smartlist_t *sources;     /* the .c/.cc/.cpp/.cxx files */
+        const smartlist_t *h_in;        /* the .h.in files to configure */
+        const smartlist_t *h_out;       /* and the header of each in 'tools->obj_dir' */
+        bool               is_dll;      /* link a DLL instead of a program */
+        const smartlist_t *programs;    /* 'program*' from option '--multi-target' */
+        const smartlist_t *shared;      /* and the sources they share */
+      } ninja_input;
+
+void ninja_write (out_buf *out, const ninja_input *in);
+
+#endif
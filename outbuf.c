@@ -0,0 +1,180 @@
+/*
+ * A growable output buffer for the gen-make program.
+ *
+ * The generated makefile (and a configured header) is built up in an
+ * 'out_buf' and written with one 'fwrite()'. 'buf_write_file()' only
+ * replaces a file if the contents differ; the spans marked with
+ * 'buf_mask()' (like a time-stamp) are not compared. So a rerun with no
+ * changes leaves the file and it's time-stamp alone.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "outbuf.h"
+
+static void buf_reserve (out_buf *b, size_t len)
+{
+  if (b->size + len + 1 > b->capacity)
+  {
+    b->capacity = 2 * (b->size + len) + 1024;
+    b->data = realloc (b->data, b->capacity);
+    assert (b->data);
+  }
+}
+
+void buf_add (out_buf *b, const void *data, size_t len)
+{
+  buf_reserve (b, len);
+  memcpy (b->data + b->size, data, len);
+  b->size += len;
+  b->data [b->size] = '\0';
+}
+
+void buf_puts (out_buf *b, const char *str)
+{
+  buf_add (b, str, strlen(str));
+}
+
+void buf_putc (out_buf *b, int ch)
+{
+  char c = (char) ch;
+
+  buf_add (b, &c, 1);
+}
+
+/*
+ * Add 'num' spaces.
+ */
+void buf_pad (out_buf *b, size_t num)
+{
+  buf_reserve (b, num);
+  memset (b->data + b->size, ' ', num);
+  b->size += num;
+  b->data [b->size] = '\0';
+}
+
+void buf_printf (out_buf *b, const char *fmt, ...)
+{
+  va_list args;
+  int     len;
+
+  va_start (args, fmt);
+  len = vsnprintf (NULL, 0, fmt, args);
+  va_end (args);
+  if (len <= 0)
+     return;
+
+  buf_reserve (b, len);
+  va_start (args, fmt);
+  vsnprintf (b->data + b->size, len + 1, fmt, args);
+  va_end (args);
+  b->size += len;
+}
+
+/*
+ * Do not compare 'len' bytes at 'start' in 'buf_write_file()'.
+ */
+void buf_mask (out_buf *b, size_t start, size_t len)
+{
+  if (b->num_masks < OUT_BUF_MAX_MASKS)
+  {
+    b->mask_start [b->num_masks] = start;
+    b->mask_len   [b->num_masks] = len;
+    b->num_masks++;
+  }
+  else
+    DEBUG (1, "Too many masks in an 'out_buf'.\n");
+}
+
+bool buf_write (const out_buf *b, FILE *f)
+{
+  return (b->size == 0 || fwrite(b->data, b->size, 1, f) == 1);
+}
+
+/*
+ * Compare 'b' with the contents of 'fname'; except the masked spans.
+ */
+static bool same_contents (const out_buf *b, const char *fname)
+{
+  mapped_file mf;
+  size_t      pos = 0;
+  int         i;
+  bool        same;
+
+  if (!map_file(fname, &mf))
+     return (false);
+
+  same = (mf.size == b->size);
+  for (i = 0; same && i <= b->num_masks; i++)
+  {
+    size_t end = (i < b->num_masks) ? b->mask_start[i] : b->size;
+
+    if (end > pos)
+       same = !memcmp (mf.data + pos, b->data + pos, end - pos);
+    if (i < b->num_masks && b->mask_start[i] + b->mask_len[i] > pos)
+       pos = b->mask_start[i] + b->mask_len[i];
+  }
+  unmap_file (&mf);
+  return (same);
+}
+
+/*
+ * Replace 'fname' with what 'func (arg, f)' writes. Via a temporary file
+ * unique to the process and thread; so 2 threads (or programs) writing the
+ * same file do not mix. 'fname' is only replaced if all was written.
+ */
+bool write_replace_file (const char *fname, write_func func, void *arg)
+{
+  FILE *f;
+  char  tmp [_MAX_PATH];
+  bool  rc;
+
+  snprintf (tmp, sizeof(tmp), "%s.%lu.%lu.tmp", fname,
+            (unsigned long)GetCurrentProcessId(), (unsigned long)GetCurrentThreadId());
+  f = fopen (tmp, "wb");
+  if (!f)
+     return (false);
+
+  rc = (*func) (arg, f) && ferror(f) == 0;
+  rc = (fclose(f) == 0) && rc;
+  if (rc)
+     rc = MoveFileEx (tmp, fname, MOVEFILE_REPLACE_EXISTING) != 0;
+  if (!rc)
+     DeleteFile (tmp);
+  return (rc);
+}
+
+static bool write_buf (void *arg, FILE *f)
+{
+  return buf_write (arg, f);
+}
+
+/*
+ * Write 'b' to 'fname' with 'write_replace_file()'. Unless 'fname' already
+ * has the same contents (except the masked spans); then '*changed' is false.
+ */
+bool buf_write_file (const out_buf *b, const char *fname, bool *changed)
+{
+  bool rc;
+
+  *changed = false;
+  if (same_contents(b, fname))
+     return (true);
+
+  rc = write_replace_file (fname, write_buf, (void*)b);
+  if (!rc)
+       fprintf (stderr, "Failed to write '%s'.\n", fname);
+  else *changed = true;
+  return (rc);
+}
+
+void buf_free (out_buf *b)
+{
+  free (b->data);
+  memset (b, '\0', sizeof(*b));
+}
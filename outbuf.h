@@ -0,0 +1,40 @@
+#ifndef _OUTBUF_H
+#define _OUTBUF_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/*
+ * Max number of spans in an 'out_buf' not compared by 'buf_write_file()'.
+ */
+#define OUT_BUF_MAX_MASKS  8
+
+/*
+ * A growable output buffer; written in one go.
+ */
+typedef struct out_buf {
+        char   *data;
+        size_t  size;
+        size_t  capacity;
+        size_t  mask_start [OUT_BUF_MAX_MASKS];
+        size_t  mask_len   [OUT_BUF_MAX_MASKS];
+        int     num_masks;
+      } out_buf;
+
+/*
+ * Called from 'write_replace_file()' to write the contents to 'f'.
+ */
+typedef bool (*write_func) (void *arg, FILE *f);
+
+void buf_add (out_buf *b, const void *data, size_t len);
+void buf_puts (out_buf *b, const char *str);
+void buf_putc (out_buf *b, int ch);
+void buf_pad (out_buf *b, size_t num);
+void buf_printf (out_buf *b, const char *fmt, ...);
+void buf_mask (out_buf *b, size_t start, size_t len);
+bool buf_write (const out_buf *b, FILE *f);
+bool buf_write_file (const out_buf *b, const char *fname, bool *changed);
+bool write_replace_file (const char *fname, write_func func, void *arg);
+void buf_free (out_buf *b);
+
+#endif
@@ -0,0 +1,292 @@
+/*
+ * Probe the toolchain for the gen-make program.
+ *
+ * Search PATH for the compilers, compiler caches, fast linkers, 'ninja' and
+ * 'astyle'. For each one found, run it to get it's version. This is done
+ * in parallel since each program started can take 100 ms or more.
+ *
+ * The result is cached in a file (default '.gen-make.probe') with a hash
+ * of PATH and the time-stamps of it's directories, and the time-stamp of
+ * each program found. On the next run it's used as-is if PATH is the same,
+ * no program was added to (or removed from) a PATH directory and no program
+ * found has changed. So a warm run only needs a 'GetFileAttributesEx()' for
+ * each PATH directory and each program found.
+ *
+ * A template gets the results as '%{tool.gcc}' (the path or empty) and
+ * '%{tool.gcc.version}'. E.g. '%%if tool.ccache'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "hash.h"
+#include "probe.h"
+#include "outbuf.h"
+
+#define PROBE_HEADER  "# gen-make probe cache: PATH-and-dirs-hash, then 'name <TAB> mtime <TAB> path <TAB> version'"
+
+static probe_tool tools[] = {
+                  { "cl",       "cl",       ""          },  /* prints it's version with no args */
+                  { "clang_cl", "clang-cl", "--version" },
+                  { "gcc",      "gcc",      "--version" },
+                  { "clang",    "clang",    "--version" },
+                  { "ccache",   "ccache",   "--version" },
+                  { "sccache",  "sccache",  "--version" },
+                  { "lld_link", "lld-link", "--version" },
+                  { "ld_lld",   "ld.lld",   "--version" },
+                  { "mold",     "mold",     "--version" },
+                  { "ninja",    "ninja",    "--version" },
+                  { "astyle",   "astyle",   "--version" }
+                };
+
+static bool    probed = false;
+static SRWLOCK probe_lock = SRWLOCK_INIT;   /* the 'tools[]' are shared by all threads */
+
+static uint64_t file_mtime (const char *file)
+{
+  WIN32_FILE_ATTRIBUTE_DATA fa;
+
+  if (!GetFileAttributesEx(file, GetFileExInfoStandard, &fa))
+     return (0);
+  return ((uint64_t)fa.ftLastWriteTime.dwHighDateTime << 32) + fa.ftLastWriteTime.dwLowDateTime;
+}
+
+/*
+ * The hash of 'path' and the time-stamps of the directories in it. Adding
+ * or removing a file in a directory changes it's time-stamp. So a tool
+ * installed since the cache was written (not found before or now found
+ * earlier in PATH) gives another hash.
+ */
+static uint64_t path_dirs_hash (const char *path)
+{
+  uint64_t h[2];
+  char     dir [_MAX_PATH];
+  size_t   len;
+
+  h[0] = hash64 (path, strlen(path));
+  while (*path)
+  {
+    len = strcspn (path, ";");
+    if (len > 0 && len < sizeof(dir))
+    {
+      memcpy (dir, path, len);
+      dir [len] = '\0';
+      h[1] = file_mtime (dir);
+      h[0] = hash64 (h, sizeof(h));
+    }
+    path += len;
+    if (*path == ';')
+       path++;
+  }
+  return (h[0]);
+}
+
+/*
+ * Put the first non-empty line of the output from 't' in 't->version'.
+ */
+static void get_version (probe_tool *t)
+{
+  const char *quote = strchr (t->path, ' ') ? "\"" : "";
+  char        cmd [_MAX_PATH + 100];
+  char        line [500];
+  FILE       *p;
+  size_t      len;
+
+  /* 'cmd.exe /c' strips the outer quotes; hence the extra 'quote' around it all.
+   */
+  snprintf (cmd, sizeof(cmd), "%s%s%s%s %s 2>&1%s", quote, quote, t->path, quote, t->args, quote);
+  p = _popen (cmd, "r");
+  if (!p)
+     return;
+
+  while (fgets(line, sizeof(line), p))
+  {
+    len = strcspn (line, "\r\n");
+    line [len] = '\0';
+    if (len > 0 && !t->version[0])
+       snprintf (t->version, sizeof(t->version), "%s", line);
+  }
+  _pclose (p);
+}
+
+/*
+ * Called from 'run_parallel()' for each tool.
+ */
+static void probe_one (void *arg, size_t idx)
+{
+  probe_tool *t = tools + idx;
+  const char *path = arg;
+  DWORD       len = SearchPath (path, t->exe, ".exe", sizeof(t->path), t->path, NULL);
+  char       *p;
+
+  if (len == 0 || len >= sizeof(t->path))
+  {
+    t->path[0] = '\0';
+    return;
+  }
+  for (p = t->path; *p; p++)
+      if (*p == '\\')
+         *p = '/';
+  t->mtime = file_mtime (t->path);
+  get_version (t);
+  DEBUG (2, "Found '%s' (%s).\n", t->path, t->version);
+}
+
+static void clear_tools (void)
+{
+  size_t i;
+
+  for (i = 0; i < DIM(tools); i++)
+  {
+    tools[i].path[0]    = '\0';
+    tools[i].version[0] = '\0';
+    tools[i].mtime      = 0;
+  }
+}
+
+/*
+ * Read the tools from 'fname'. Return false if it was written with another
+ * PATH (or PATH directories changed) or a program found has changed since.
+ */
+static bool read_cache (const char *fname, uint64_t path_hash)
+{
+  FILE              *f = fopen (fname, "rb");
+  char               line [_MAX_PATH + 200];
+  unsigned long long hash = 0;
+  size_t             i, num = 0;
+  bool               rc = false;
+
+  if (!f)
+     return (false);
+
+  if (!fgets(line, sizeof(line), f) || strncmp(line, PROBE_HEADER, strlen(PROBE_HEADER)) ||
+      !fgets(line, sizeof(line), f) || sscanf(line, "%llx", &hash) != 1 || hash != path_hash)
+     goto quit;
+
+  while (fgets(line, sizeof(line), f))
+  {
+    char *name = line;
+    char *mtime, *path, *version;
+
+    line [strcspn(line, "\r\n")] = '\0';
+    mtime   = strchr (name, '\t');
+    path    = mtime ? strchr (mtime + 1, '\t') : NULL;
+    version = path  ? strchr (path + 1, '\t')  : NULL;
+    if (!version)
+       goto quit;
+    *mtime++ = *path++ = *version++ = '\0';
+
+    for (i = 0; i < DIM(tools); i++)
+        if (!strcmp(name, tools[i].name))
+           break;
+    if (i == DIM(tools))
+       goto quit;
+
+    tools[i].mtime = strtoull (mtime, NULL, 16);
+    snprintf (tools[i].path, sizeof(tools[i].path), "%s", path);
+    snprintf (tools[i].version, sizeof(tools[i].version), "%s", version);
+    if (tools[i].path[0] && file_mtime(tools[i].path) != tools[i].mtime)
+    {
+      DEBUG (1, "'%s' has changed.\n", tools[i].path);
+      goto quit;
+    }
+    num++;
+  }
+  rc = (num == DIM(tools));
+
+quit:
+  fclose (f);
+  if (!rc)
+     clear_tools();
+  return (rc);
+}
+
+static bool write_tools (void *arg, FILE *f)
+{
+  size_t i;
+
+  fprintf (f, "%s\n%016llx\n", PROBE_HEADER, *(const unsigned long long*)arg);
+  for (i = 0; i < DIM(tools); i++)
+      fprintf (f, "%s\t%llx\t%s\t%s\n", tools[i].name, (unsigned long long)tools[i].mtime,
+               tools[i].path, tools[i].version);
+  return (true);
+}
+
+static bool write_cache (const char *fname, uint64_t path_hash)
+{
+  unsigned long long hash = path_hash;
+  bool               rc = write_replace_file (fname, write_tools, &hash);
+
+  DEBUG (1, "%s probe cache '%s'.\n", rc ? "Wrote" : "Failed to write", fname);
+  return (rc);
+}
+
+static void probe_all (const char *cache_file)
+{
+  const char *path = getenv ("PATH");
+  uint64_t    hash;
+
+  if (!path)
+     path = "";
+  hash = path_dirs_hash (path);
+
+  if (cache_file && read_cache(cache_file, hash))
+  {
+    DEBUG (1, "Using probe cache '%s'.\n", cache_file);
+    return;
+  }
+  run_parallel (DIM(tools), probe_one, (void*)path);
+  if (cache_file)
+     write_cache (cache_file, hash);
+}
+
+/*
+ * Probe the tools once; from 'cache_file' if still valid. No cache if
+ * 'cache_file == NULL'. The first thread to call this does it; the others
+ * wait for it.
+ */
+void probe_tools (const char *cache_file)
+{
+  AcquireSRWLockExclusive (&probe_lock);
+  if (!probed)
+  {
+    probed = true;
+    probe_all (cache_file);
+  }
+  ReleaseSRWLockExclusive (&probe_lock);
+}
+
+/*
+ * Return the tool 'name'. Or NULL if it's not one of 'tools[]'.
+ */
+const probe_tool *probe_get (const char *name)
+{
+  size_t i;
+
+  assert (probed);
+  for (i = 0; i < DIM(tools); i++)
+      if (!strcmp(name, tools[i].name))
+         return (tools + i);
+  return (NULL);
+}
+
+/*
+ * For option '--probe'.
+ */
+void probe_print (void)
+{
+  size_t i;
+
+  assert (probed);
+  for (i = 0; i < DIM(tools); i++)
+  {
+    const probe_tool *t = tools + i;
+
+    if (t->path[0])
+         printf ("%-9s %s\n          %s\n", t->name, t->path, t->version[0] ? t->version : "?");
+    else printf ("%-9s not found\n", t->name);
+  }
+}
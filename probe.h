@@ -0,0 +1,23 @@
+#ifndef _PROBE_H
+#define _PROBE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A program searched for on PATH by 'probe_tools()'.
+ */
+typedef struct probe_tool {
+        const char *name;                /* for '%{tool.name}'; like 'clang_cl' */
+        const char *exe;                 /* like 'clang-cl' ('.exe' is added on Windows) */
+        const char *args;                /* to print the version */
+        char        path [_MAX_PATH];    /* empty if not found */
+        uint64_t    mtime;               /* of 'path' */
+        char        version [100];       /* first line of the output from 'exe args' */
+      } probe_tool;
+
+void              probe_tools (const char *cache_file);
+const probe_tool *probe_get (const char *name);
+void              probe_print (void);
+
+#endif
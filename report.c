@@ -0,0 +1,209 @@
+/*
+ * A report of the header costs for the gen-make program.
+ *
+ * For each header included by the translation units (the sources in a
+ * 'dep_graph'); the number of them including it, the bytes and lines of
+ * it and all it includes and hence the bytes parsed for it in the build.
+ * A header without a '#pragma once' or an include-guard is flagged;
+ * the compiler must read it again on each '#include'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "report.h"
+
+/*
+ * What a read of each node in the graph gives.
+ */
+typedef struct file_info {
+        dep_node *node;
+        uint64_t  size;
+        uint64_t  lines;
+        bool      guarded;
+      } file_info;
+
+static void read_file_info (void *arg, size_t idx)
+{
+  file_info  *fi = (file_info*) arg + idx;
+  mapped_file mf;
+
+  if (fi->node->missing || !map_file(fi->node->file, &mf))
+     return;
+
+  fi->size  = mf.size;
+  fi->lines = count_lines (mf.data, mf.size);
+  if (!fi->node->is_source)
+     fi->guarded = scan_include_guard (mf.data, mf.size);
+  unmap_file (&mf);
+}
+
+/*
+ * Make a report of the headers included by the sources in 'g'.
+ * 'g' must be scanned. The headers are sorted on the bytes parsed.
+ */
+build_report *build_report_new (dep_graph *g)
+{
+  build_report *r     = calloc (1, sizeof(*r));
+  smartlist_t  *deps  = smartlist_new();
+  int           num   = smartlist_len (g->nodes);
+  file_info    *info  = calloc (num + 1, sizeof(*info));
+  int          *count = calloc (num + 1, sizeof(*count));
+  int           i, j;
+
+  assert (r);
+  assert (info);
+  assert (count);
+
+  for (i = 0; i < num; i++)
+      info[i].node = smartlist_get (g->nodes, i);
+  run_parallel (num, read_file_info, info);
+
+  r->headers = smartlist_new();
+  r->num_tus = smartlist_len (g->sources);
+
+  for (i = 0; i < r->num_tus; i++)
+  {
+    const dep_node *tu = smartlist_get (g->sources, i);
+
+    r->total_parsed += info[tu->idx].size;
+    r->total_lines  += info[tu->idx].lines;
+
+    smartlist_clear (deps);
+    dep_graph_closure (g, (dep_node*)tu, deps);
+    for (j = 0; j < smartlist_len(deps); j++)
+    {
+      const dep_node *inc = smartlist_get (deps, j);
+
+      count [inc->idx]++;
+      r->total_parsed += info[inc->idx].size;
+      r->total_lines  += info[inc->idx].lines;
+    }
+  }
+
+  for (i = 0; i < num; i++)
+  {
+    dep_node      *n = info[i].node;
+    header_report *h;
+
+    if (n->is_source || n->missing || count[i] == 0)
+       continue;
+
+    h = calloc (1, sizeof(*h));
+    assert (h);
+    h->node        = n;
+    h->num_tus     = count[i];
+    h->lines       = info[i].lines;
+    h->trans_size  = info[i].size;
+    h->trans_lines = info[i].lines;
+    h->guarded     = info[i].guarded;
+
+    smartlist_clear (deps);
+    dep_graph_closure (g, n, deps);
+    for (j = 0; j < smartlist_len(deps); j++)
+    {
+      const dep_node *inc = smartlist_get (deps, j);
+
+      h->trans_size  += info[inc->idx].size;
+      h->trans_lines += info[inc->idx].lines;
+    }
+    h->parsed = h->trans_size * h->num_tus;
+    if (!h->guarded)
+       r->num_unguarded++;
+    smartlist_add (r->headers, h);
+  }
+
+  build_report_sort (r, "parsed");
+  DEBUG (1, "Made a report of %d headers in %d translation units.\n", smartlist_len(r->headers), r->num_tus);
+  smartlist_free (deps);
+  free (count);
+  free (info);
+  return (r);
+}
+
+static int compare_name (const void **_a, const void **_b)
+{
+  const header_report *a = *_a;
+  const header_report *b = *_b;
+
+  return strcmp (a->node->file, b->node->file);
+}
+
+static int compare_parsed (const void **_a, const void **_b)
+{
+  const header_report *a = *_a;
+  const header_report *b = *_b;
+
+  if (a->parsed != b->parsed)
+     return (a->parsed < b->parsed ? 1 : -1);
+  return compare_name (_a, _b);
+}
+
+static int compare_tus (const void **_a, const void **_b)
+{
+  const header_report *a = *_a;
+  const header_report *b = *_b;
+
+  if (a->num_tus != b->num_tus)
+     return (a->num_tus < b->num_tus ? 1 : -1);
+  return compare_name (_a, _b);
+}
+
+static int compare_size (const void **_a, const void **_b)
+{
+  const header_report *a = *_a;
+  const header_report *b = *_b;
+
+  if (a->trans_size != b->trans_size)
+     return (a->trans_size < b->trans_size ? 1 : -1);
+  return compare_name (_a, _b);
+}
+
+static int compare_lines (const void **_a, const void **_b)
+{
+  const header_report *a = *_a;
+  const header_report *b = *_b;
+
+  if (a->trans_lines != b->trans_lines)
+     return (a->trans_lines < b->trans_lines ? 1 : -1);
+  return compare_name (_a, _b);
+}
+
+/*
+ * Sort the headers on 'key'; "parsed", "tus", "size", "lines" or "name".
+ * The numbers are sorted with the largest first. Return false for an unknown 'key'.
+ */
+bool build_report_sort (build_report *r, const char *key)
+{
+  static const struct {
+         const char          *key;
+         smartlist_sort_func  compare;
+       } keys[] = {
+         { "parsed", compare_parsed },
+         { "tus",    compare_tus    },
+         { "size",   compare_size   },
+         { "lines",  compare_lines  },
+         { "name",   compare_name   }
+       };
+  size_t i;
+
+  for (i = 0; i < DIM(keys); i++)
+      if (!strcmp(key, keys[i].key))
+      {
+        smartlist_sort (r->headers, keys[i].compare);
+        return (true);
+      }
+  return (false);
+}
+
+void build_report_free (build_report *r)
+{
+  if (r)
+  {
+    smartlist_free_all (r->headers);
+    free (r);
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef _REPORT_H
+#define _REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smartlist.h"
+#include "depend.h"
+
+/*
+ * The cost of a header in a build.
+ */
+typedef struct header_report {
+        dep_node *node;
+        int       num_tus;      /* number of translation units including it (directly or not) */
+        uint64_t  lines;
+        uint64_t  trans_size;   /* the size of it and all it includes */
+        uint64_t  trans_lines;  /* the lines of it and all it includes */
+        uint64_t  parsed;       /* 'num_tus * trans_size'; the bytes parsed for it in the build */
+        bool      guarded;      /* has a '#pragma once' or an include-guard */
+      } header_report;
+
+typedef struct build_report {
+        smartlist_t *headers;       /* 'header_report*' */
+        int          num_tus;
+        uint64_t     total_parsed;  /* the bytes of all translation units and all they include */
+        uint64_t     total_lines;
+        int          num_unguarded;
+      } build_report;
+
+build_report *build_report_new (dep_graph *g);
+bool          build_report_sort (build_report *r, const char *key);
+void          build_report_free (build_report *r);
+
+#endif
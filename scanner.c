@@ -0,0 +1,964 @@
+/*
+ * Memory-mapped source scanning for the gen-make program.
+ *
+ * The scanners here never look inside comments, string- or
+ * character-literals. Only the code in between is searched.
+ * Finding the next interesting byte is done 16 bytes at a time
+ * using SSE2 (where available).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define HAVE_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define HAVE_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+
+  static __inline unsigned lowest_bit (unsigned mask)
+  {
+    unsigned long idx;
+
+    _BitScanForward (&idx, mask);
+    return (unsigned) idx;
+  }
+#else
+  #define lowest_bit(mask)  (unsigned) __builtin_ctz (mask)
+#endif
+
+/*
+ * Max number of threads 'run_parallel()' will start.
+ */
+#define MAX_THREADS  64
+
+int scan_threads = 0;
+
+/*
+ * Number of 'run_parallel()' calls running on several threads.
+ */
+static volatile LONG num_parallel = 0;
+
+/*
+ * Return 'fname' as a path from the current directory; a relative
+ * 'fname' is relative to 'base'. A NULL 'base' is the current directory.
+ */
+const char *base_path (const char *base, const char *fname, char *buf, size_t size)
+{
+  if (!base || fname[0] == '/' || fname[0] == '\\' || (fname[0] && fname[1] == ':'))
+     return (fname);
+  snprintf (buf, size, "%s/%s", base, fname);
+  return (buf);
+}
+
+/*
+ * Map the whole of 'fname' read-only into memory.
+ * The handles are closed at once; the view keeps the mapping alive.
+ */
+bool map_file (const char *fname, mapped_file *mf)
+{
+  LARGE_INTEGER size;
+  HANDLE        fh, mh;
+  const void   *data;
+
+  mf->data = NULL;
+  mf->size = 0;
+
+  fh = CreateFile (fname, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                   OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (fh == INVALID_HANDLE_VALUE)
+     return (false);
+
+  if (!GetFileSizeEx(fh, &size) || (ULONGLONG)size.QuadPart > (size_t)-1)
+  {
+    CloseHandle (fh);
+    return (false);
+  }
+
+  if (size.QuadPart == 0)   /* 'CreateFileMapping()' refuses empty files */
+  {
+    CloseHandle (fh);
+    return (true);
+  }
+
+  mh = CreateFileMapping (fh, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle (fh);
+  if (!mh)
+     return (false);
+
+  data = MapViewOfFile (mh, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle (mh);
+  if (!data)
+     return (false);
+
+  mf->data = data;
+  mf->size = (size_t) size.QuadPart;
+  return (true);
+}
+
+void unmap_file (mapped_file *mf)
+{
+  if (mf->data)
+     UnmapViewOfFile (mf->data);
+  mf->data = NULL;
+  mf->size = 0;
+}
+
+bool is_ident_char (int ch)
+{
+  return ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+          (ch >= '0' && ch <= '9') || ch == '_');
+}
+
+/*
+ * Return a pointer to the first byte in range 'p ... end-1' that is
+ * in 'set'. Return 'end' if none found.
+ */
+const char *find_any_byte (const char *p, const char *end, const byte_set *set)
+{
+#if HAVE_SSE2
+  const __m128i c0 = _mm_set1_epi8 (set->ch[0]);
+  const __m128i c1 = _mm_set1_epi8 (set->ch[1]);
+  const __m128i c2 = _mm_set1_epi8 (set->ch[2]);
+  const __m128i c3 = _mm_set1_epi8 (set->ch[3]);
+
+  while (end - p >= 16)
+  {
+    __m128i v = _mm_loadu_si128 ((const __m128i*)p);
+    __m128i m = _mm_or_si128 (_mm_or_si128(_mm_cmpeq_epi8(v, c0), _mm_cmpeq_epi8(v, c1)),
+                              _mm_or_si128(_mm_cmpeq_epi8(v, c2), _mm_cmpeq_epi8(v, c3)));
+    unsigned mask = (unsigned) _mm_movemask_epi8 (m);
+
+    if (mask)
+       return (p + lowest_bit(mask));
+    p += 16;
+  }
+#endif
+
+  for ( ; p < end; p++)
+      if (*p == set->ch[0] || *p == set->ch[1] || *p == set->ch[2] || *p == set->ch[3])
+         break;
+  return (p);
+}
+
+/*
+ * Return the start of the token (identifier or pp-number) ending at 'p'.
+ */
+static const char *token_start (const char *start, const char *p)
+{
+  while (p > start && (is_ident_char(p[-1]) || p[-1] == '.' || p[-1] == '\''))
+     p--;
+  return (p);
+}
+
+/*
+ * 'p' points to the '"' of a C++11 raw string-literal: 'R"delim( ... )delim"'.
+ */
+static const char *skip_raw_string (const char *p, const char *end)
+{
+  const char *delim = p + 1;
+  const char *lparen = delim;
+  size_t      len;
+
+  while (lparen < end && *lparen != '(' && lparen - delim <= 16)
+     lparen++;
+
+  if (lparen >= end || *lparen != '(')
+     return (p + 1);
+
+  len = lparen - delim;
+  for (p = lparen + 1; p < end; p++)
+  {
+    p = memchr (p, ')', end - p);
+    if (!p)
+       break;
+    if ((size_t)(end - p) > len + 1 && !memcmp(p + 1, delim, len) && p[1+len] == '"')
+       return (p + len + 2);
+  }
+  return (end);
+}
+
+/*
+ * 'p' points to a '/', '"' or '\''. If it starts a comment or a literal,
+ * return a pointer past it. Otherwise return 'p + 1'.
+ *
+ * An unterminated string- or character-literal ends at the newline;
+ * these are common in '#error' lines and '#if 0' blocks.
+ */
+const char *skip_comment_or_literal (const char *start, const char *p, const char *end)
+{
+  const char *tok;
+  int         quote;
+
+  if (*p == '/')
+  {
+    if (end - p < 2)
+       return (end);
+
+    if (p[1] == '*')
+    {
+      for (p += 2; p < end; p++)
+      {
+        p = memchr (p, '*', end - p);
+        if (!p || p + 1 >= end)
+           break;
+        if (p[1] == '/')
+           return (p + 2);
+      }
+      return (end);
+    }
+
+    if (p[1] == '/')
+    {
+      for (p += 2; p < end; p++)
+      {
+        const char *nl = memchr (p, '\n', end - p);
+        const char *q  = nl;
+
+        if (!nl)
+           break;
+        if (q > p && q[-1] == '\r')
+           q--;
+        if (q > p && q[-1] == '\\')   /* line-splice; the comment continues */
+        {
+          p = nl;
+          continue;
+        }
+        return (nl);
+      }
+      return (end);
+    }
+    return (p + 1);
+  }
+
+  quote = *p;
+  tok = token_start (start, p);
+
+  if (quote == '\'' && tok < p && *tok >= '0' && *tok <= '9')
+     return (p + 1);                  /* a C++14 digit-separator */
+
+  if (quote == '"' && p > tok && p[-1] == 'R')
+  {
+    size_t len = p - tok;
+
+    if ((len == 1) || (len == 2 && strchr("uUL", *tok)) || (len == 3 && !strncmp(tok, "u8", 2)))
+       return skip_raw_string (p, end);
+  }
+
+  for (p++; p < end; p++)
+  {
+    if (*p == '\\')
+       p++;
+    else if (*p == quote || *p == '\n')
+       return (p + 1);
+  }
+  return (end);
+}
+
+static bool is_word (const char *p, size_t len, const char *word)
+{
+  return (strlen(word) == len && !memcmp(p, word, len));
+}
+
+/*
+ * Return true if the '(' at 'paren' starts the parameters of a function
+ * definition. I.e. the ')' is followed by a '{' or a K&R declaration-list
+ * (or 'try', '->' etc.). Not a prototype ending in ';' or a call.
+ */
+static bool is_definition (const char *start, const char *paren, const char *end)
+{
+  const char *p = paren + 1;
+  int         depth = 1;
+
+  while (p < end && depth > 0)
+  {
+    if (*p == '(')
+       depth++;
+    else if (*p == ')')
+       depth--;
+    else if (*p == '/' || *p == '"' || *p == '\'')
+    {
+      p = skip_comment_or_literal (start, p, end);
+      continue;
+    }
+    p++;
+  }
+
+  while (p < end)
+  {
+    if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+       p++;
+    else if (*p == '/' && p + 1 < end && (p[1] == '/' || p[1] == '*'))
+       p = skip_comment_or_literal (start, p, end);
+    else break;
+  }
+  if (p >= end)
+     return (false);
+  return (*p == '{' || is_ident_char(*p) || (*p == '-' && p + 1 < end && p[1] == '>'));
+}
+
+/*
+ * Look at the identifier in front of the '(' at 'paren'.
+ */
+static unsigned check_call (const char *start, const char *paren, const char *end)
+{
+  const char *p = paren;
+  const char *ident_end, *q;
+  size_t      len;
+
+  while (p > start && (p[-1] == ' ' || p[-1] == '\t' || p[-1] == '\r' || p[-1] == '\n'))
+     p--;
+  ident_end = p;
+
+  while (p > start && is_ident_char(p[-1]))
+     p--;
+
+  len = ident_end - p;
+  if (len < 4 || len > 10)
+     return (0);
+
+  /* Not a definition if it's 'x.main(', 'x->main(' or 'x::main('
+   */
+  q = p;
+  while (q > start && (q[-1] == ' ' || q[-1] == '\t'))
+     q--;
+  if (q > start && q[-1] == '.')
+     return (0);
+  if (q - start >= 2 && ((q[-2] == '-' && q[-1] == '>') || (q[-2] == ':' && q[-1] == ':')))
+     return (0);
+
+  if (is_word(p, len, "main") || is_word(p, len, "wmain") || is_word(p, len, "_tmain"))
+     return (is_definition(start, paren, end) ? SCAN_MAIN : 0);
+
+  if (is_word(p, len, "WinMain") || is_word(p, len, "wWinMain") || is_word(p, len, "_tWinMain"))
+     return (is_definition(start, paren, end) ? SCAN_WINMAIN : 0);
+
+  if (is_word(p, len, "DllMain"))
+     return (is_definition(start, paren, end) ? SCAN_DLLMAIN : 0);
+
+  if (is_word(p, len, "__declspec"))
+  {
+    for (q = paren + 1; q < end && (*q == ' ' || *q == '\t'); q++)
+        ;
+    if (end - q > 9 && !memcmp(q, "dllexport", 9) && !is_ident_char(q[9]))
+       return (SCAN_DLLEXPORT);
+  }
+  return (0);
+}
+
+/*
+ * Return a mask of 'SCAN_x' flags for the entry-points and exports
+ * found in the code of 'data'.
+ */
+unsigned scan_entry_points (const char *data, size_t size)
+{
+  static const byte_set set = { { '(', '/', '"', '\'' } };
+  const char *p   = data;
+  const char *end = data + size;
+  unsigned    flags = 0;
+
+  while ((p = find_any_byte(p, end, &set)) < end)
+  {
+    if (*p == '(')
+    {
+      flags |= check_call (data, p, end);
+      p++;
+    }
+    else
+      p = skip_comment_or_literal (data, p, end);
+  }
+  return (flags);
+}
+
+unsigned scan_file_entry_points (const char *fname)
+{
+  mapped_file mf;
+  unsigned    flags;
+
+  if (!map_file(fname, &mf))
+     return (0);
+
+  flags = scan_entry_points (mf.data, mf.size);
+  unmap_file (&mf);
+  return (flags);
+}
+
+static const char *skip_blanks (const char *p, const char *end)
+{
+  while (p < end && (*p == ' ' || *p == '\t'))
+     p++;
+  return (p);
+}
+
+/*
+ * Is 'p' the first non-blank on it's line?
+ */
+static bool at_line_start (const char *start, const char *p)
+{
+  while (p > start && (p[-1] == ' ' || p[-1] == '\t'))
+     p--;
+  return (p == start || p[-1] == '\n');
+}
+
+/*
+ * Call 'func' for each '#include' (or '#include_next') directive in 'data'.
+ * Includes inside '#if' blocks are reported too; a caller wanting a
+ * dependency list would rather have too many than too few.
+ * A computed include ('#include MACRO') is not reported.
+ * Return the number of includes found.
+ */
+size_t scan_includes (const char *data, size_t size, include_func func, void *arg)
+{
+  static const byte_set set = { { '#', '/', '"', '\'' } };
+  const char *p   = data;
+  const char *end = data + size;
+  size_t      num = 0;
+
+  while ((p = find_any_byte(p, end, &set)) < end)
+  {
+    const char *name;
+    int         close;
+
+    if (*p != '#')
+    {
+      p = skip_comment_or_literal (data, p, end);
+      continue;
+    }
+    if (!at_line_start(data, p))
+    {
+      p++;
+      continue;
+    }
+
+    p = skip_blanks (p + 1, end);
+    if (end - p < 8 || memcmp(p, "include", 7))
+       continue;
+
+    p += 7;
+    if (end - p > 5 && !memcmp(p, "_next", 5))
+       p += 5;
+
+    p = skip_blanks (p, end);
+    if (p >= end || (*p != '"' && *p != '<'))
+       continue;
+
+    close = (*p == '"') ? '"' : '>';
+    for (name = ++p; p < end && *p != close && *p != '\n'; p++)
+        ;
+    if (p < end && *p == close && p > name)
+    {
+      (*func) (arg, name, p - name, close == '>');
+      num++;
+      p++;
+    }
+  }
+  return (num);
+}
+
+/*
+ * Return a pointer to the end of the directive-line at 'p'. Line-splices
+ * are followed.
+ */
+static const char *directive_end (const char *p, const char *end)
+{
+  while (p < end)
+  {
+    const char *nl = memchr (p, '\n', end - p);
+    const char *q  = nl;
+
+    if (!nl)
+       return (end);
+    if (q > p && q[-1] == '\r')
+       q--;
+    if (q > p && q[-1] == '\\')
+    {
+      p = nl + 1;
+      continue;
+    }
+    return (q);
+  }
+  return (end);
+}
+
+/*
+ * Is the identifier at 'p' a keyword (or a specifier) that can not be
+ * the name in a declaration?
+ */
+static bool is_decl_keyword (const char *p, size_t len)
+{
+  static const char *keywords[] = {
+                    "const", "volatile", "int", "char", "void", "unsigned", "signed",
+                    "long", "short", "float", "double", "struct", "union", "enum",
+                    "inline", "__inline", "__forceinline", "register", "_Bool", "bool",
+                    "__declspec", "__attribute__", "_Thread_local", "thread_local",
+                    "constexpr", "restrict", "__restrict"
+                  };
+  size_t i;
+
+  for (i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+      if (is_word(p, len, keywords[i]))
+         return (true);
+  return (false);
+}
+
+/*
+ * Call 'func' for each 'static' definition at file-scope and each '#define'
+ * in 'data'. Only the first name in a 'static' declaration is reported.
+ * Return the number of names found.
+ */
+size_t scan_file_scope_names (const char *data, size_t size, name_func func, void *arg)
+{
+  const char *p   = data;
+  const char *end = data + size;
+  const char *last = NULL;       /* the last identifier in a 'static' declaration */
+  size_t      last_len = 0;
+  size_t      num = 0;
+  int         braces = 0, parens = 0;
+  bool        in_static = false;
+
+  while (p < end)
+  {
+    int ch = *p;
+
+    if (ch == '/' || ch == '"' || ch == '\'')
+    {
+      p = skip_comment_or_literal (data, p, end);
+      continue;
+    }
+
+    if (ch == '#' && at_line_start(data, p))
+    {
+      const char *eol = directive_end (p, end);
+
+      p = skip_blanks (p + 1, eol);
+      if (eol - p > 7 && !memcmp(p, "define", 6) && (p[6] == ' ' || p[6] == '\t'))
+      {
+        const char *name = skip_blanks (p + 7, eol);
+        const char *body;
+
+        for (p = name; p < eol && is_ident_char(*p); p++)
+            ;
+        body = p;
+        while (eol > body && (eol[-1] == ' ' || eol[-1] == '\t'))
+           eol--;
+        if (p > name)
+        {
+          (*func) (arg, name, p - name, body, eol - body);
+          num++;
+        }
+      }
+      p = eol;
+      continue;
+    }
+
+    if (is_ident_char(ch) && !(ch >= '0' && ch <= '9'))
+    {
+      const char *ident = p;
+      size_t      len;
+
+      while (p < end && is_ident_char(*p))
+         p++;
+      len = p - ident;
+
+      if (braces == 0 && parens == 0 && is_word(ident, len, "static"))
+      {
+        in_static = true;
+        last = NULL;
+      }
+      else if (in_static && braces == 0 && parens <= 1 && !is_decl_keyword(ident, len))
+      {
+        last = ident;
+        last_len = len;
+      }
+      else if (in_static && braces == 0 && is_decl_keyword(ident, len))
+      {
+        /* Skip a '__declspec(x)' or '__attribute__((x))'
+         */
+        const char *q = skip_blanks (p, end);
+
+        if (q < end && *q == '(' && (is_word(ident, len, "__declspec") || is_word(ident, len, "__attribute__")))
+        {
+          int depth = 0;
+
+          for (p = q; p < end; p++)
+          {
+            if (*p == '(')
+               depth++;
+            else if (*p == ')' && --depth == 0)
+            {
+              p++;
+              break;
+            }
+          }
+        }
+      }
+      continue;
+    }
+
+    if (in_static && braces == 0)
+    {
+      /* The name is in front of the first '(', '[', '=', ',' or ';'.
+       * Except in a declarator like 'static int (*func)(void)'.
+       */
+      if ((ch == '(' && last) || ((ch == '[' || ch == '=' || ch == ',' || ch == ';') && parens == 0))
+      {
+        if (last)
+        {
+          (*func) (arg, last, last_len, NULL, 0);
+          num++;
+        }
+        in_static = false;
+      }
+      else if (ch == '{')
+        last = NULL;          /* not the tag of a 'static struct x { ...' */
+    }
+
+    if (ch == '{')
+       braces++;
+    else if (ch == '}' && braces > 0)
+       braces--;
+    else if (ch == '(')
+       parens++;
+    else if (ch == ')' && parens > 0)
+       parens--;
+    p++;
+  }
+  return (num);
+}
+
+/*
+ * Return the number of lines in 'data'. A last line without a newline counts too.
+ */
+size_t count_lines (const char *data, size_t size)
+{
+  const char *p   = data;
+  const char *end = data + size;
+  size_t      num = 0;
+
+  while (p < end && (p = memchr(p, '\n', end - p)) != NULL)
+  {
+    num++;
+    p++;
+  }
+  if (size > 0 && data[size-1] != '\n')
+     num++;
+  return (num);
+}
+
+/*
+ * Return the identifier at 'p' (after any blanks); the length in '*len'.
+ */
+static const char *ident_at (const char *p, const char *end, size_t *len)
+{
+  const char *ident = skip_blanks (p, end);
+
+  for (p = ident; p < end && is_ident_char(*p); p++)
+      ;
+  *len = p - ident;
+  return (ident);
+}
+
+/*
+ * Return true if the compiler needs to read 'data' only once in a translation unit.
+ * That is, it has a '#pragma once' or all of it is inside an include-guard:
+ *   #ifndef X         (or '#if !defined(X)')
+ *   #define X
+ *   ...
+ *   #endif
+ *
+ * with nothing but comments outside of it.
+ */
+bool scan_include_guard (const char *data, size_t size)
+{
+  static const byte_set set = { { '#', '/', '"', '\'' } };
+  const char *p   = data;
+  const char *end = data + size;
+  const char *guard = NULL;
+  size_t      guard_len = 0;
+  int         state = 0;     /* 0: before the '#ifndef', 1: before the '#define', 2: inside, 3: after the '#endif' */
+  int         depth = 0;
+  bool        ok = true;
+
+  while (p < end)
+  {
+    const char *word, *arg, *eol;
+    size_t      len, arg_len;
+    int         ch;
+
+    if (state == 2 && (p = find_any_byte(p, end, &set)) >= end)
+       break;
+
+    ch = *p;
+    if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\f' || ch == '\v')
+    {
+      p++;
+      continue;
+    }
+    if (ch == '/' && end - p >= 2 && (p[1] == '*' || p[1] == '/'))
+    {
+      p = skip_comment_or_literal (data, p, end);
+      continue;
+    }
+    if (ch != '#' || !at_line_start(data, p))
+    {
+      if (state != 2)
+         ok = false;         /* code outside the guard */
+      p = (ch == '"' || ch == '\'') ? skip_comment_or_literal (data, p, end) : p + 1;
+      continue;
+    }
+
+    eol  = directive_end (p, end);
+    word = ident_at (p + 1, eol, &len);
+    arg  = ident_at (word + len, eol, &arg_len);
+
+    if (is_word(word, len, "pragma") && is_word(arg, arg_len, "once"))
+       return (true);
+
+    if (state == 0)
+    {
+      if (is_word(word, len, "if") && eol - arg > 0 && *arg == '!')
+      {
+        arg = ident_at (arg + 1, eol, &arg_len);
+        if (is_word(arg, arg_len, "defined"))
+        {
+          arg = skip_blanks (arg + arg_len, eol);
+          if (arg < eol && *arg == '(')
+             arg++;
+          arg = ident_at (arg, eol, &arg_len);
+          len = 6;
+          word = "ifndef";
+        }
+      }
+      if (is_word(word, len, "ifndef") && arg_len > 0)
+      {
+        guard = arg;
+        guard_len = arg_len;
+        state = 1;
+        depth = 1;
+      }
+      else
+        ok = false;
+    }
+    else if (state == 1)
+    {
+      if (is_word(word, len, "define") && arg_len == guard_len && !memcmp(arg, guard, guard_len))
+           state = 2;
+      else ok = false;
+    }
+    else if (state == 2)
+    {
+      if (is_word(word, len, "if") || is_word(word, len, "ifdef") || is_word(word, len, "ifndef"))
+         depth++;
+      else if (is_word(word, len, "endif") && --depth == 0)
+         state = 3;
+    }
+    else
+      ok = false;            /* a directive after the '#endif' */
+    p = eol;
+  }
+  return (ok && state == 3);
+}
+
+/*
+ * Return the length of a module-name at 'p'; 'a.b', 'a.b:part' or ':part'.
+ * It must be followed by a ';' or an attribute. Return 0 if it's not a module-name.
+ */
+static size_t module_name_len (const char *name, const char *end)
+{
+  const char *p = name;
+  const char *q;
+
+  while (p < end && (is_ident_char(*p) || *p == '.' || *p == ':'))
+     p++;
+  if (p == name)
+     return (0);
+
+  q = skip_blanks (p, end);
+  if (q < end && (*q == ';' || *q == '['))
+     return (p - name);
+  return (0);
+}
+
+/*
+ * Check the module-declaration (or import) at the start of a line.
+ */
+static size_t check_module_decl (const char *p, const char *end, module_func func, void *arg)
+{
+  const char *word, *name;
+  size_t      len;
+  bool        exported = false;
+  int         close;
+
+  word = ident_at (p, end, &len);
+  if (is_word(word, len, "export"))
+  {
+    exported = true;
+    word = ident_at (word + len, end, &len);
+  }
+
+  if (is_word(word, len, "module"))
+  {
+    name = skip_blanks (word + len, end);
+    if (name < end && *name == ';')
+    {
+      if (!exported)
+         (*func) (arg, MODULE_GLOBAL, NULL, 0);
+      return (1);
+    }
+    len = module_name_len (name, end);
+    if (len == 0 || is_word(name, len, ":private"))
+       return (0);
+    (*func) (arg, exported ? MODULE_EXPORT : MODULE_IMPL, name, len);
+    return (1);
+  }
+
+  if (!is_word(word, len, "import"))
+     return (0);
+
+  name = skip_blanks (word + len, end);
+  if (name < end && (*name == '<' || *name == '"'))
+  {
+    close = (*name == '"') ? '"' : '>';
+    for (p = ++name; p < end && *p != close && *p != '\n'; p++)
+        ;
+    if (p >= end || *p != close || p == name)
+       return (0);
+    (*func) (arg, close == '>' ? MODULE_HEADER_ANGLE : MODULE_HEADER_QUOTE, name, p - name);
+    return (1);
+  }
+
+  len = module_name_len (name, end);
+  if (len == 0)
+     return (0);
+  (*func) (arg, MODULE_IMPORT, name, len);
+  return (1);
+}
+
+/*
+ * Call 'func' for each C++20 module-declaration and import in 'data':
+ *   'export module M;'     -> MODULE_EXPORT  (a module interface; 'M' may be 'M:part')
+ *   'module M;'            -> MODULE_IMPL    (a module implementation)
+ *   'module;'              -> MODULE_GLOBAL  (the global module fragment)
+ *   '[export] import M;'   -> MODULE_IMPORT  ('M' may be ':part')
+ *   'import <h>;'          -> MODULE_HEADER_ANGLE (a header unit)
+ *   'import "h";'          -> MODULE_HEADER_QUOTE
+ *
+ * Like the preprocessor, only a declaration at the start of a line counts.
+ * Return the number of declarations found.
+ */
+size_t scan_module_decls (const char *data, size_t size, module_func func, void *arg)
+{
+  static const byte_set set = { { '\n', '/', '"', '\'' } };
+  const char *p   = data;
+  const char *end = data + size;
+  size_t      num = 0;
+  bool        line_start = true;
+
+  while (p < end)
+  {
+    if (line_start)
+    {
+      p = skip_blanks (p, end);
+      if (p < end && (*p == 'e' || *p == 'm' || *p == 'i'))
+         num += check_module_decl (p, end, func, arg);
+      line_start = false;
+    }
+
+    p = find_any_byte (p, end, &set);
+    if (p >= end)
+       break;
+
+    if (*p == '\n')
+    {
+      line_start = true;
+      p++;
+    }
+    else
+      p = skip_comment_or_literal (data, p, end);
+  }
+  return (num);
+}
+
+typedef struct parallel_job {
+        parallel_func  func;
+        void          *arg;
+        size_t         num;
+        volatile LONG  next;
+      } parallel_job;
+
+static DWORD WINAPI parallel_worker (void *arg)
+{
+  parallel_job *job = arg;
+  size_t        idx;
+
+  while ((idx = (size_t)InterlockedIncrement(&job->next) - 1) < job->num)
+     (*job->func) (job->arg, idx);
+  return (0);
+}
+
+/*
+ * Call 'func (arg, idx)' for every 'idx' in range '0 ... num-1'
+ * using 'scan_threads' (or one per CPU) worker threads.
+ * The calling thread is one of the workers.
+ *
+ * Only one call at a time uses several threads. A call from a 'func'
+ * (or from another thread) meanwhile runs on the calling thread. E.g.
+ * for '--batch'; N components each scanning on N threads would start
+ * N*N threads.
+ */
+void run_parallel (size_t num, parallel_func func, void *arg)
+{
+  HANDLE       threads [MAX_THREADS];
+  parallel_job job;
+  int          i, num_started = 0, num_threads = scan_threads;
+  bool         counted = false;
+
+  if (num_threads <= 0)
+  {
+    SYSTEM_INFO si;
+
+    GetSystemInfo (&si);
+    num_threads = (int) si.dwNumberOfProcessors;
+  }
+  if (num_threads > MAX_THREADS)
+     num_threads = MAX_THREADS;
+  if ((size_t)num_threads > num)
+     num_threads = (int) num;
+
+  if (num_threads > 1)
+  {
+    counted = true;
+    if (InterlockedIncrement(&num_parallel) > 1)
+       num_threads = 1;
+  }
+
+  job.func = func;
+  job.arg  = arg;
+  job.num  = num;
+  job.next = 0;
+
+  for (i = 1; i < num_threads; i++)
+  {
+    threads [num_started] = CreateThread (NULL, 0, parallel_worker, &job, 0, NULL);
+    if (threads[num_started])
+       num_started++;
+  }
+
+  parallel_worker (&job);
+
+  for (i = 0; i < num_started; i++)
+  {
+    WaitForSingleObject (threads[i], INFINITE);
+    CloseHandle (threads[i]);
+  }
+  if (counted)
+     InterlockedDecrement (&num_parallel);
+}
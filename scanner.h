@@ -0,0 +1,83 @@
+#ifndef _SCANNER_H
+#define _SCANNER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Flags returned from 'scan_entry_points()'.
+ */
+#define SCAN_MAIN       0x01   /* a 'main(){' or 'wmain(){' definition */
+#define SCAN_WINMAIN    0x02   /* a 'WinMain(){' or 'wWinMain(){' definition */
+#define SCAN_DLLMAIN    0x04   /* a 'DllMain(){' definition */
+#define SCAN_DLLEXPORT  0x08   /* '__declspec(dllexport)' */
+
+/*
+ * A read-only view of a whole file. An empty file gives 'data == NULL'
+ * and 'size == 0'.
+ */
+typedef struct mapped_file {
+        const char *data;
+        size_t      size;
+      } mapped_file;
+
+/*
+ * Up to 4 bytes to search for with 'find_any_byte()'.
+ * Unused slots should repeat one of the others.
+ */
+typedef struct byte_set {
+        char ch [4];
+      } byte_set;
+
+typedef void (*parallel_func) (void *arg, size_t idx);
+
+/*
+ * Called from 'scan_includes()' for each '#include "name"' or '#include <name>'.
+ * 'name' is not 0-terminated.
+ */
+typedef void (*include_func) (void *arg, const char *name, size_t len, bool angle);
+
+/*
+ * Called from 'scan_file_scope_names()' for each file-scope 'static' name
+ * ('body == NULL') and each '#define' ('body' is the rest of the line).
+ * 'name' and 'body' are not 0-terminated.
+ */
+typedef void (*name_func) (void *arg, const char *name, size_t len, const char *body, size_t body_len);
+
+/*
+ * The kinds of declarations reported by 'scan_module_decls()'.
+ */
+#define MODULE_EXPORT        1   /* 'export module M;' */
+#define MODULE_IMPL          2   /* 'module M;' */
+#define MODULE_GLOBAL        3   /* 'module;' */
+#define MODULE_IMPORT        4   /* 'import M;' or 'import :part;' */
+#define MODULE_HEADER_ANGLE  5   /* 'import <h>;' */
+#define MODULE_HEADER_QUOTE  6   /* 'import "h";' */
+
+/*
+ * Called from 'scan_module_decls()' for each module declaration or import.
+ * 'name' is not 0-terminated. It's NULL for a 'MODULE_GLOBAL'.
+ */
+typedef void (*module_func) (void *arg, int kind, const char *name, size_t len);
+
+extern int scan_threads;   /* 0: one thread per CPU */
+
+const char *base_path (const char *base, const char *fname, char *buf, size_t size);
+bool        map_file (const char *fname, mapped_file *mf);
+void        unmap_file (mapped_file *mf);
+
+const char *find_any_byte (const char *p, const char *end, const byte_set *set);
+const char *skip_comment_or_literal (const char *start, const char *p, const char *end);
+bool        is_ident_char (int ch);
+
+unsigned    scan_entry_points (const char *data, size_t size);
+unsigned    scan_file_entry_points (const char *fname);
+size_t      scan_includes (const char *data, size_t size, include_func func, void *arg);
+size_t      scan_file_scope_names (const char *data, size_t size, name_func func, void *arg);
+bool        scan_include_guard (const char *data, size_t size);
+size_t      scan_module_decls (const char *data, size_t size, module_func func, void *arg);
+size_t      count_lines (const char *data, size_t size);
+
+void        run_parallel (size_t num, parallel_func func, void *arg);
+
+#endif
@@ -327,6 +327,14 @@ void smartlist_sort (smartlist_t *sl, smartlist_sort_func compare)
      qsort (sl->list, sl->num_used, sizeof(void*), (CmpFunc)compare);
 }
 
+/*
+ * A 'smartlist_sort_func' for a list of strings.
+ */
+int smartlist_compare_strings (const void **a, const void **b)
+{
+  return strcmp ((const char*)*a, (const char*)*b);
+}
+
 #if defined(NOT_USED_YET)
 /*
  * Assuming the members of 'sl' are in order, return the index of the
@@ -29,6 +29,7 @@ int   smartlist_duplicates (smartlist_t *sl, smartlist_sort_func compare);
 void  smartlist_make_uniq (smartlist_t *sl, smartlist_sort_func compare, void (*free_fn)(void *a));
 
 void  smartlist_sort (smartlist_t *sl, smartlist_sort_func compare);
+int   smartlist_compare_strings (const void **a, const void **b);
 
 int   smartlist_bsearch_idx (const smartlist_t *sl, const void *key,
                              smartlist_compare_func compare, int *found_out);
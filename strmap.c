@@ -0,0 +1,155 @@
+/*
+ * A map from strings to 'void*' for the gen-make program.
+ * Modelled on Tor's 'strmap_t', but using open addressing.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "strmap.h"
+
+typedef struct strmap_entry {
+        char     *key;      /* NULL if a free slot */
+        void     *val;
+        unsigned  hash;
+      } strmap_entry;
+
+typedef struct strmap_t {
+        strmap_entry *slots;
+        int           num_used;
+        int           capacity;  /* always a power of 2 */
+        bool          nocase;
+      } strmap_t;
+
+#define STRMAP_DEFAULT_CAPACITY  64
+
+/*
+ * FNV-1a of 'key'. If 'nocase', ASCII letters are hashed as lower-case.
+ */
+static unsigned strmap_hash (const char *key, bool nocase)
+{
+  unsigned h = 2166136261U;
+
+  for ( ; *key; key++)
+  {
+    int ch = *(const unsigned char*) key;
+
+    if (nocase && ch >= 'A' && ch <= 'Z')
+       ch += 'a' - 'A';
+    h = (h ^ ch) * 16777619U;
+  }
+  return (h);
+}
+
+static strmap_entry *strmap_lookup (const strmap_t *map, const char *key, unsigned hash)
+{
+  unsigned mask = (unsigned) map->capacity - 1;
+  unsigned i    = hash & mask;
+
+  while (1)
+  {
+    strmap_entry *e = map->slots + i;
+
+    if (!e->key)
+       return (e);
+    if (e->hash == hash && !(map->nocase ? stricmp(e->key, key) : strcmp(e->key, key)))
+       return (e);
+    i = (i + 1) & mask;
+  }
+}
+
+static void strmap_grow (strmap_t *map)
+{
+  strmap_entry *old = map->slots;
+  int           i, old_capacity = map->capacity;
+
+  map->capacity *= 2;
+  map->slots = calloc (map->capacity, sizeof(*map->slots));
+  assert (map->slots);
+
+  for (i = 0; i < old_capacity; i++)
+      if (old[i].key)
+         *strmap_lookup (map, old[i].key, old[i].hash) = old[i];
+  free (old);
+}
+
+/*
+ * Allocate and return an empty strmap. If 'nocase', keys are
+ * compared case-insensitively (like Windows file-names).
+ */
+strmap_t *strmap_new (bool nocase)
+{
+  strmap_t *map = malloc (sizeof(*map));
+
+  if (map)
+  {
+    map->num_used = 0;
+    map->capacity = STRMAP_DEFAULT_CAPACITY;
+    map->nocase   = nocase;
+    map->slots    = calloc (map->capacity, sizeof(*map->slots));
+  }
+  return (map);
+}
+
+/*
+ * Deallocate a strmap. If 'free_fn' is provided, call it on each value.
+ */
+void strmap_free (strmap_t *map, void (*free_fn)(void *val))
+{
+  int i;
+
+  if (!map)
+     return;
+
+  for (i = 0; i < map->capacity; i++)
+  {
+    if (!map->slots[i].key)
+       continue;
+    if (free_fn)
+      (*free_fn) (map->slots[i].val);
+    free (map->slots[i].key);
+  }
+  free (map->slots);
+  free (map);
+}
+
+/*
+ * Return the value for 'key' or NULL if not found.
+ */
+void *strmap_get (const strmap_t *map, const char *key)
+{
+  return strmap_lookup (map, key, strmap_hash(key, map->nocase))->val;
+}
+
+/*
+ * Set the value for 'key' to 'val'. Return the old value (or NULL).
+ * The map keeps a copy of 'key'.
+ */
+void *strmap_set (strmap_t *map, const char *key, void *val)
+{
+  unsigned      hash = strmap_hash (key, map->nocase);
+  strmap_entry *e = strmap_lookup (map, key, hash);
+  void         *old = e->val;
+
+  if (e->key)
+  {
+    e->val = val;
+    return (old);
+  }
+
+  e->key  = strdup (key);
+  e->val  = val;
+  e->hash = hash;
+  if (++map->num_used * 2 > map->capacity)
+     strmap_grow (map);
+  return (NULL);
+}
+
+/*
+ * Return the number of keys in 'map'.
+ */
+int strmap_size (const strmap_t *map)
+{
+  return (map->num_used);
+}
@@ -0,0 +1,15 @@
+#ifndef _STRMAP_H
+#define _STRMAP_H
+
+#include <stdbool.h>
+
+typedef struct strmap_t strmap_t;  /* Opaque struct; defined in strmap.c */
+
+strmap_t   *strmap_new (bool nocase);
+void        strmap_free (strmap_t *map, void (*free_fn)(void *val));
+
+void       *strmap_get (const strmap_t *map, const char *key);
+void       *strmap_set (strmap_t *map, const char *key, void *val);
+int         strmap_size (const strmap_t *map);
+
+#endif
@@ -0,0 +1,529 @@
+/*
+ * Object file symbols for the gen-make program.
+ *
+ * The symbol-tables of ELF (32 and 64-bit; little-endian) and COFF
+ * (incl. '/bigobj') object files are read from the memory-mapped files.
+ * An undefined name is resolved to the object defining it. So the objects
+ * a program needs are those reachable from the object with it's 'main()'.
+ * A DLL also needs the objects exporting names; those with a '/EXPORT:'
+ * in their '.drectve' section. The rest need not be linked.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "strmap.h"
+#include "symbols.h"
+
+#define SHT_SYMTAB      2
+#define SHN_UNDEF       0
+#define STB_GLOBAL      1
+#define STB_WEAK        2
+#define STT_SECTION     3
+#define STT_FILE        4
+
+#define IMAGE_SYM_CLASS_EXTERNAL  2
+
+static uint16_t get16 (const uint8_t *p)
+{
+  return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get32 (const uint8_t *p)
+{
+  return ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static uint64_t get64 (const uint8_t *p)
+{
+  return ((uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32));
+}
+
+/*
+ * Is 'name' an entry point? For 32-bit COFF, the names have a leading '_'
+ * and the '__stdcall' ones a '@N' suffix.
+ */
+static const char *entry_name (const char *name)
+{
+  static const char *entries[] = { "main", "wmain", "WinMain", "wWinMain", "DllMain" };
+  size_t i, len;
+
+  for (i = 0; i < DIM(entries); i++)
+  {
+    const char *p = name;
+
+    len = strlen (entries[i]);
+    if (*p == '_' && strncmp(p, entries[i], len))
+       p++;
+    if (!strncmp(p, entries[i], len) && (p[len] == '\0' || p[len] == '@'))
+       return (entries[i]);
+  }
+  return (NULL);
+}
+
+static void add_symbol (obj_symbols *o, const char *name, size_t len, bool defined)
+{
+  char *s;
+
+  if (len == 0)
+     return;
+
+  s = malloc (len + 1);
+  assert (s);
+  memcpy (s, name, len);
+  s [len] = '\0';
+
+  if (defined)
+  {
+    if (!o->entry)
+       o->entry = entry_name (s);
+    smartlist_add (o->defined, s);
+  }
+  else
+    smartlist_add (o->undefined, s);
+}
+
+/*
+ * Read the '.symtab' of an ELF relocatable object.
+ */
+static bool read_elf (obj_symbols *o, const uint8_t *data, size_t size)
+{
+  bool     is_64 = (data[4] == 2);
+  uint64_t shoff;
+  unsigned shentsize, shnum, i;
+
+  if (data[5] != 1)           /* only little-endian */
+     return (false);
+
+  if (is_64)
+  {
+    if (size < 64)
+       return (false);
+    shoff     = get64 (data + 40);
+    shentsize = get16 (data + 58);
+    shnum     = get16 (data + 60);
+  }
+  else
+  {
+    if (size < 52)
+       return (false);
+    shoff     = get32 (data + 32);
+    shentsize = get16 (data + 46);
+    shnum     = get16 (data + 48);
+  }
+
+  /* Each section header must hold the fields read below.
+   */
+  if (shoff >= size || shentsize < (is_64 ? 64U : 40U) || (uint64_t)shnum * shentsize > size - shoff)
+     return (false);
+
+  o->format = is_64 ? "ELF64" : "ELF32";
+
+  for (i = 0; i < shnum; i++)
+  {
+    const uint8_t *sh = data + shoff + (uint64_t)i * shentsize;
+    const uint8_t *link_sh;
+    uint64_t       sym_off, sym_size, str_off, str_size, ent_size, j;
+    unsigned       link;
+
+    if (get32(sh + 4) != SHT_SYMTAB)
+       continue;
+
+    sym_off  = is_64 ? get64 (sh + 24) : get32 (sh + 16);
+    sym_size = is_64 ? get64 (sh + 32) : get32 (sh + 20);
+    link     = get32 (is_64 ? sh + 40 : sh + 24);
+    ent_size = is_64 ? 24 : 16;
+
+    if (link >= shnum || sym_off > size || sym_size > size - sym_off)
+       return (false);
+
+    link_sh  = data + shoff + (uint64_t)link * shentsize;
+    str_off  = is_64 ? get64 (link_sh + 24) : get32 (link_sh + 16);
+    str_size = is_64 ? get64 (link_sh + 32) : get32 (link_sh + 20);
+    if (str_off > size || str_size > size - str_off)
+       return (false);
+
+    for (j = 1; j < sym_size / ent_size; j++)   /* symbol 0 is always empty */
+    {
+      const uint8_t *sym = data + sym_off + j * ent_size;
+      uint32_t       name = get32 (sym);
+      unsigned       info = is_64 ? sym[4] : sym[12];
+      unsigned       shndx = get16 (is_64 ? sym + 6 : sym + 14);
+      unsigned       bind = info >> 4;
+      unsigned       type = info & 15;
+      const char    *str;
+
+      if ((bind != STB_GLOBAL && bind != STB_WEAK) || type == STT_SECTION || type == STT_FILE || name >= str_size)
+         continue;
+
+      str = (const char*) data + str_off + name;
+      add_symbol (o, str, strnlen(str, str_size - name), shndx != SHN_UNDEF);
+    }
+    return (true);
+  }
+  return (true);    /* no symbols */
+}
+
+/*
+ * Does the '.drectve' section of a COFF object have a '/EXPORT:' (or
+ * '-export:')? That's how a '__declspec(dllexport)' reaches the linker.
+ */
+static bool coff_exports (const uint8_t *data, size_t size, bool bigobj)
+{
+  uint64_t sections;
+  unsigned num_sections, i;
+
+  if (bigobj)
+  {
+    sections     = 56;
+    num_sections = get32 (data + 44);
+  }
+  else
+  {
+    sections     = 20 + get16 (data + 16);    /* after the optional header */
+    num_sections = get16 (data + 2);
+  }
+
+  for (i = 0; i < num_sections && sections + 40 * (i + 1) <= size; i++)
+  {
+    const uint8_t *sh = data + sections + 40 * i;
+    uint32_t       raw_size = get32 (sh + 16);
+    uint32_t       raw_ofs  = get32 (sh + 20);
+    const char    *p, *end;
+
+    if (memcmp(sh, ".drectve", 8) || raw_ofs > size || raw_size > size - raw_ofs)
+       continue;
+
+    end = (const char*) data + raw_ofs + raw_size;
+    for (p = (const char*) data + raw_ofs; p + 8 <= end; p++)
+        if ((*p == '/' || *p == '-') && !strnicmp(p + 1, "export:", 7))
+           return (true);
+  }
+  return (false);
+}
+
+/*
+ * Read the symbol-table of a COFF object. A '/bigobj' object has 32-bit
+ * section-numbers and 20 byte symbols.
+ */
+static bool read_coff (obj_symbols *o, const uint8_t *data, size_t size)
+{
+  static const uint8_t bigobj_class_id[16] = {
+                       0xC7, 0xA1, 0xBA, 0xD1, 0xEE, 0xBA, 0xA9, 0x4B,
+                       0xAF, 0x20, 0xFA, 0xF6, 0x6A, 0xA4, 0xDC, 0xB8
+                     };
+  uint64_t symtab, num_syms, str_off, str_size, i;
+  unsigned sym_size;
+  bool     bigobj = false;
+
+  if (size >= 56 && get16(data) == 0 && get16(data + 2) == 0xFFFF)
+  {
+    if (get16(data + 4) < 2 || memcmp(data + 12, bigobj_class_id, sizeof(bigobj_class_id)))
+       return (false);        /* e.g. a '-GL' object */
+    bigobj   = true;
+    symtab   = get32 (data + 48);
+    num_syms = get32 (data + 52);
+    sym_size = 20;
+  }
+  else
+  {
+    unsigned machine = get16 (data);
+
+    if (size < 20 || (machine != 0x14C && machine != 0x8664 && machine != 0xAA64 && machine != 0x1C4))
+       return (false);
+    symtab   = get32 (data + 8);
+    num_syms = get32 (data + 12);
+    sym_size = 18;
+  }
+
+  str_off = symtab + num_syms * sym_size;
+  if (symtab == 0 || str_off + 4 > size)
+     return (false);
+  str_size = get32 (data + str_off);
+  if (str_size > size - str_off)
+     str_size = size - str_off;
+
+  o->format  = bigobj ? "COFF-bigobj" : "COFF";
+  o->exports = coff_exports (data, size, bigobj);
+
+  for (i = 0; i < num_syms; i++)
+  {
+    const uint8_t *sym = data + symtab + i * sym_size;
+    int32_t        section = bigobj ? (int32_t)get32 (sym + 12) : (int16_t)get16 (sym + 12);
+    unsigned       class   = sym [sym_size - 2];
+    unsigned       num_aux = sym [sym_size - 1];
+    uint32_t       value   = get32 (sym + 8);
+    const char    *name = NULL;
+    size_t         len = 0;
+
+    /* A weak external has a default; it needs nothing.
+     */
+    if (class == IMAGE_SYM_CLASS_EXTERNAL)
+    {
+      if (get32(sym) != 0)
+      {
+        name = (const char*) sym;
+        len  = strnlen (name, 8);
+      }
+      else if (get32(sym + 4) >= 4 && get32(sym + 4) < str_size)   /* a long name in the string-table */
+      {
+        name = (const char*) data + str_off + get32 (sym + 4);
+        len  = strnlen (name, str_size - get32(sym + 4));
+      }
+    }
+
+    /* A section-number > 0 is defined here. 0 with a value is a common symbol.
+     */
+    if (name)
+       add_symbol (o, name, len, section > 0 || (section == 0 && value > 0));
+    i += num_aux;
+  }
+  return (true);
+}
+
+/*
+ * Read the external symbols of 'o->file'. Return false if it's not an
+ * object file in a known format.
+ */
+bool read_obj_symbols (obj_symbols *o)
+{
+  mapped_file    mf;
+  const uint8_t *data;
+  bool           rc = false;
+
+  if (!map_file(o->file, &mf))
+     return (false);
+
+  data = (const uint8_t*) mf.data;
+  if (mf.size >= 20 && !memcmp(data, "\x7F" "ELF", 4) && get16(data + 16) == 1)  /* ET_REL */
+       rc = read_elf (o, data, mf.size);
+  else if (mf.size >= 20)
+       rc = read_coff (o, data, mf.size);
+
+  if (!rc)
+     o->format = NULL;
+  unmap_file (&mf);
+  return (rc);
+}
+
+static void read_one (void *arg, size_t idx)
+{
+  obj_symbols *o = ((obj_symbols**) arg) [idx];
+
+  if (!read_obj_symbols(o))
+     DEBUG (1, "'%s' is not an object file.\n", o->file);
+}
+
+static int compare_file (const void **_a, const void **_b)
+{
+  const obj_symbols *a = *_a;
+  const obj_symbols *b = *_b;
+
+  return strcmp (a->file, b->file);
+}
+
+/*
+ * Add 'o' and all it needs to 'out'; those it needs first.
+ */
+static void add_needed (obj_symbols *o, unsigned stamp, smartlist_t *out)
+{
+  int i;
+
+  if (o->visited == stamp)
+     return;
+  o->visited = stamp;
+  for (i = 0; i < smartlist_len(o->needs); i++)
+      add_needed (smartlist_get(o->needs, i), stamp, out);
+  smartlist_add (out, o);
+}
+
+/*
+ * Add a target for 'root' and the 'extra' roots; with all they need.
+ */
+static void add_target (link_plan *lp, obj_symbols *root, const smartlist_t *extra, unsigned stamp)
+{
+  link_target *t = calloc (1, sizeof(*t));
+  int          i;
+
+  assert (t);
+  t->root    = root;
+  t->objects = smartlist_new();
+  smartlist_add (t->objects, root);
+  root->visited = stamp;
+  for (i = 0; i < smartlist_len(root->needs); i++)
+      add_needed (smartlist_get(root->needs, i), stamp, t->objects);
+  for (i = 0; extra && i < smartlist_len(extra); i++)
+      add_needed (smartlist_get(extra, i), stamp, t->objects);
+  smartlist_add (lp->targets, t);
+}
+
+/*
+ * Read the symbols of the object 'files' and find the objects each
+ * program (an object with an entry point) or DLL (with exported names) needs.
+ */
+link_plan *link_plan_new (const smartlist_t *files)
+{
+  link_plan   *lp = calloc (1, sizeof(*lp));
+  strmap_t    *definer = strmap_new (false);
+  smartlist_t *order, *exporters;
+  obj_symbols **array, *dll = NULL;
+  unsigned     stamp = 0;
+  int          i, j, num = smartlist_len (files);
+
+  assert (lp);
+  lp->objects     = smartlist_new();
+  lp->targets     = smartlist_new();
+  lp->lib_order   = smartlist_new();
+  lp->unreachable = smartlist_new();
+
+  for (i = 0; i < num; i++)
+  {
+    obj_symbols *o = calloc (1, sizeof(*o));
+
+    assert (o);
+    o->file      = strdup (smartlist_get(files, i));
+    o->defined   = smartlist_new();
+    o->undefined = smartlist_new();
+    o->needs     = smartlist_new();
+    smartlist_add (lp->objects, o);
+  }
+  smartlist_sort (lp->objects, compare_file);
+
+  array = calloc (num + 1, sizeof(*array));
+  assert (array);
+  for (i = 0; i < num; i++)
+      array[i] = smartlist_get (lp->objects, i);
+  run_parallel (num, read_one, array);
+  free (array);
+
+  for (i = 0; i < num; i++)
+  {
+    obj_symbols *o = smartlist_get (lp->objects, i);
+
+    for (j = 0; j < smartlist_len(o->defined); j++)
+    {
+      const char *name = smartlist_get (o->defined, j);
+
+      if (strmap_get(definer, name))
+           lp->num_duplicates++;
+      else strmap_set (definer, name, o);
+      lp->num_defined++;
+    }
+  }
+
+  for (i = 0; i < num; i++)
+  {
+    obj_symbols *o = smartlist_get (lp->objects, i);
+
+    o->visited = ++stamp;
+    for (j = 0; j < smartlist_len(o->undefined); j++)
+    {
+      obj_symbols *def = strmap_get (definer, smartlist_get(o->undefined, j));
+
+      if (!def)
+         lp->num_unresolved++;
+      else if (def->visited != stamp)
+      {
+        def->visited = stamp;
+        smartlist_add (o->needs, def);
+      }
+    }
+  }
+
+  /* One target for each object with an entry point. The objects exporting
+   * names are roots too; of the 'DllMain()' target or of a target of their
+   * own if there is none.
+   */
+  exporters = smartlist_new();
+  for (i = 0; i < num; i++)
+  {
+    obj_symbols *o = smartlist_get (lp->objects, i);
+
+    if (o->exports && !o->entry)
+       smartlist_add (exporters, o);
+    if (!dll && o->entry && !strcmp(o->entry, "DllMain"))
+       dll = o;
+  }
+  if (!dll && smartlist_len(exporters) > 0)
+     dll = smartlist_get (exporters, 0);
+
+  for (i = 0; i < num; i++)
+  {
+    obj_symbols *o = smartlist_get (lp->objects, i);
+
+    if (o->entry || o == dll)
+       add_target (lp, o, o == dll ? exporters : NULL, ++stamp);
+  }
+  smartlist_free (exporters);
+
+  /* The objects needed by the targets; those needed first.
+   * Reversed, it's the order a single-pass linker wants.
+   */
+  order = smartlist_new();
+  ++stamp;
+  for (i = 0; i < smartlist_len(lp->targets); i++)
+  {
+    const link_target *t = smartlist_get (lp->targets, i);
+
+    t->root->visited = stamp;
+    for (j = 1; j < smartlist_len(t->objects); j++)
+        add_needed (smartlist_get(t->objects, j), stamp, order);
+  }
+  for (i = smartlist_len(order) - 1; i >= 0; i--)
+  {
+    obj_symbols *o = smartlist_get (order, i);
+
+    if (!o->entry)
+       smartlist_add (lp->lib_order, o);
+  }
+
+  for (i = 0; i < num; i++)
+  {
+    obj_symbols *o = smartlist_get (lp->objects, i);
+
+    if (o->visited != stamp && o->format)
+       smartlist_add (lp->unreachable, o);
+  }
+
+  DEBUG (1, "%d objects, %d targets, %d names defined, %d unresolved, %d duplicates.\n",
+         num, smartlist_len(lp->targets), lp->num_defined, lp->num_unresolved, lp->num_duplicates);
+  smartlist_free (order);
+  strmap_free (definer, NULL);
+  return (lp);
+}
+
+static void obj_symbols_free (void *val)
+{
+  obj_symbols *o = val;
+
+  free (o->file);
+  smartlist_free_all (o->defined);
+  smartlist_free_all (o->undefined);
+  smartlist_free (o->needs);
+  free (o);
+}
+
+static void link_target_free (void *val)
+{
+  link_target *t = val;
+
+  smartlist_free (t->objects);
+  free (t);
+}
+
+void link_plan_free (link_plan *lp)
+{
+  if (!lp)
+     return;
+  smartlist_wipe (lp->objects, obj_symbols_free);
+  smartlist_free (lp->objects);
+  smartlist_wipe (lp->targets, link_target_free);
+  smartlist_free (lp->targets);
+  smartlist_free (lp->lib_order);
+  smartlist_free (lp->unreachable);
+  free (lp);
+}
@@ -0,0 +1,45 @@
+#ifndef _SYMBOLS_H
+#define _SYMBOLS_H
+
+#include <stdbool.h>
+
+#include "smartlist.h"
+
+/*
+ * The external symbols of an object file.
+ */
+typedef struct obj_symbols {
+        char        *file;
+        const char  *format;     /* "ELF32", "ELF64", "COFF" or "COFF-bigobj"; NULL if not an object */
+        smartlist_t *defined;    /* the names it defines */
+        smartlist_t *undefined;  /* the names it needs */
+        const char  *entry;      /* the entry point it defines ('main' etc.); or NULL */
+        bool         exports;    /* has a '/EXPORT:' in it's '.drectve'; a DLL needs it */
+        smartlist_t *needs;      /* the 'obj_symbols*' defining what it needs */
+        unsigned     visited;
+      } obj_symbols;
+
+/*
+ * A program or DLL; the objects reachable from the one with an entry point
+ * (or from the objects exporting names).
+ */
+typedef struct link_target {
+        obj_symbols *root;
+        smartlist_t *objects;    /* 'obj_symbols*'; 'root' first. 'root->entry' is NULL for a DLL without a 'DllMain()' */
+      } link_target;
+
+typedef struct link_plan {
+        smartlist_t *objects;      /* all 'obj_symbols*'; sorted on the file-name */
+        smartlist_t *targets;      /* 'link_target*' */
+        smartlist_t *lib_order;    /* the reachable objects without an entry point; each before those it needs */
+        smartlist_t *unreachable;  /* 'obj_symbols*' not needed by any target */
+        int          num_defined;
+        int          num_unresolved;  /* names not defined in any object; in a system library? */
+        int          num_duplicates;  /* names defined in more than one object */
+      } link_plan;
+
+bool       read_obj_symbols (obj_symbols *o);
+link_plan *link_plan_new (const smartlist_t *files);
+void       link_plan_free (link_plan *lp);
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ * Split the sources into several programs for the gen-make program.
+ *
+ * Each source with a 'main()' or 'WinMain()' is a program. Another source
+ * belongs to a program if:
+ *  1) the header with the same base-name (e.g. 'util.h' for 'util.c') is
+ *     included by that program only. Or if no program includes it:
+ *  2) it's in the same directory (or below) as that program only.
+ *
+ * The rest are shared by the programs; i.e. put in a library.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "strmap.h"
+#include "targets.h"
+
+#define OWNER_NONE  -1
+#define OWNER_MANY  -2
+
+/*
+ * Return a copy of the base-name of 'file' without the extension.
+ */
+static char *base_name (const char *file)
+{
+  const char *slash = strrchr (file, '/');
+  char       *base, *dot;
+
+  base = strdup (slash ? slash + 1 : file);
+  dot = strrchr (base, '.');
+  if (dot)
+     *dot = '\0';
+  return (base);
+}
+
+/*
+ * Return a copy of the directory of 'file'. Or "." if none.
+ */
+static char *dir_name (const char *file)
+{
+  const char *slash = strrchr (file, '/');
+  char       *dir;
+
+  if (!slash)
+     return strdup (".");
+  dir = strdup (file);
+  dir [slash - file] = '\0';
+  return (dir);
+}
+
+static void set_owner (int *owner, int idx, int prog)
+{
+  if (owner[idx] == OWNER_NONE)
+     owner[idx] = prog;
+  else if (owner[idx] != prog)
+     owner[idx] = OWNER_MANY;
+}
+
+/*
+ * Rule 1): map the base-name of all headers included by a program to the
+ * program. Or to 'OWNER_MANY' if more than one program includes them.
+ */
+static strmap_t *header_owners (const dep_graph *g, const int *owner)
+{
+  strmap_t *map = strmap_new (true);
+  int       i;
+
+  for (i = 0; i < smartlist_len(g->nodes); i++)
+  {
+    const dep_node *n = smartlist_get (g->nodes, i);
+    char           *base;
+    int            *o;
+
+    if (n->is_source || n->missing || owner[i] == OWNER_NONE)
+       continue;
+
+    base = base_name (n->file);
+    o = strmap_get (map, base);
+    if (!o)
+    {
+      o = malloc (sizeof(*o));
+      *o = owner[i];
+      strmap_set (map, base, o);
+    }
+    else if (*o != owner[i])
+      *o = OWNER_MANY;
+    free (base);
+  }
+  return (map);
+}
+
+/*
+ * Rule 2): the program in the nearest directory above 'src' with programs.
+ */
+static int owner_by_dir (const smartlist_t *mains, const char *src)
+{
+  char *dir = dir_name (src);
+  int   result = OWNER_NONE;
+
+  while (strcmp(dir, ".") && result == OWNER_NONE)
+  {
+    size_t len = strlen (dir);
+    int    i;
+
+    for (i = 0; i < smartlist_len(mains); i++)
+    {
+      const char *m = smartlist_get (mains, i);
+
+      if (!strnicmp(m, dir, len) && m[len] == '/')
+         result = (result == OWNER_NONE) ? i : OWNER_MANY;
+    }
+    if (result == OWNER_NONE)
+    {
+      char *up = dir_name (dir);
+
+      free (dir);
+      dir = up;
+    }
+  }
+  free (dir);
+  return (result);
+}
+
+/*
+ * Make the "bin/name.exe" target of 'src'. A 'main.c' is named after it's
+ * directory. Use the whole directory-name if the name is already used.
+ */
+static char *make_target (strmap_t *used, const char *src)
+{
+  char *base = base_name (src);
+  char *dir  = dir_name (src);
+  char *last = strrchr (dir, '/');
+  char *p;
+  bool  is_main = (!stricmp(base, "main") && strcmp(dir, "."));
+  char  target [_MAX_PATH];
+
+  if (is_main)
+       snprintf (target, sizeof(target), "bin/%s.exe", last ? last + 1 : dir);
+  else snprintf (target, sizeof(target), "bin/%s.exe", base);
+
+  if (strmap_get(used, target))
+  {
+    for (p = dir; *p; p++)
+        if (*p == '/')
+           *p = '_';
+    if (is_main)
+         snprintf (target, sizeof(target), "bin/%s.exe", dir);
+    else snprintf (target, sizeof(target), "bin/%s_%s.exe", dir, base);
+  }
+  strmap_set (used, target, used);
+  free (base);
+  free (dir);
+  return strdup (target);
+}
+
+/*
+ * Return a list of 'program*'; one for each source in 'mains'.
+ * The sources in 'others' not belonging to one program are added to 'shared'.
+ * All sources must be in 'g'; a scanned include-graph.
+ */
+smartlist_t *partition_programs (dep_graph *g, const smartlist_t *mains,
+                                 const smartlist_t *others, smartlist_t *shared)
+{
+  smartlist_t *progs = smartlist_new();
+  smartlist_t *deps  = smartlist_new();
+  strmap_t    *used  = strmap_new (true);
+  int         *owner = malloc ((smartlist_len(g->nodes) + 1) * sizeof(*owner));
+  int         *src_owner = calloc (smartlist_len(others) + 1, sizeof(*src_owner));
+  strmap_t    *headers;
+  int          i, j, iter;
+
+  assert (owner && src_owner);
+  for (i = 0; i < smartlist_len(g->nodes); i++)
+      owner[i] = OWNER_NONE;
+
+  for (i = 0; i < smartlist_len(mains); i++)
+  {
+    const char *src = smartlist_get (mains, i);
+    program    *p = calloc (1, sizeof(*p));
+
+    assert (p);
+    p->main_src = src;
+    p->target   = make_target (used, src);
+    p->sources  = smartlist_new();
+    smartlist_add (p->sources, (void*)src);
+    smartlist_add (progs, p);
+
+    smartlist_clear (deps);
+    dep_graph_closure (g, dep_graph_add_source(g, src), deps);
+    for (j = 0; j < smartlist_len(deps); j++)
+        set_owner (owner, ((const dep_node*)smartlist_get(deps, j))->idx, i);
+  }
+
+  /* A header included by a source of another program (or a shared
+   * source) is not owned by one program. Repeat until nothing changes.
+   */
+  for (iter = 0; iter < 10; iter++)
+  {
+    bool changed = false;
+
+    headers = header_owners (g, owner);
+    for (i = 0; i < smartlist_len(others); i++)
+    {
+      const char *src  = smartlist_get (others, i);
+      char       *base = base_name (src);
+      const int  *o    = strmap_get (headers, base);
+
+      src_owner[i] = o ? *o : OWNER_NONE;
+      if (src_owner[i] == OWNER_NONE)
+         src_owner[i] = owner_by_dir (mains, src);
+      free (base);
+    }
+    strmap_free (headers, free);
+
+    for (i = 0; i < smartlist_len(others); i++)
+    {
+      int prog = (src_owner[i] >= 0) ? src_owner[i] : OWNER_MANY;
+
+      smartlist_clear (deps);
+      dep_graph_closure (g, dep_graph_add_source(g, smartlist_get(others, i)), deps);
+      for (j = 0; j < smartlist_len(deps); j++)
+      {
+        int idx = ((const dep_node*)smartlist_get(deps, j))->idx;
+        int old = owner [idx];
+
+        set_owner (owner, idx, prog);
+        if (owner[idx] != old)
+           changed = true;
+      }
+    }
+    if (!changed)
+       break;
+  }
+
+  for (i = 0; i < smartlist_len(others); i++)
+  {
+    const char *src  = smartlist_get (others, i);
+    int         prog = src_owner[i];
+
+    DEBUG (1, "%-30s belongs to %s.\n", src,
+           prog >= 0 ? ((const program*)smartlist_get(progs, prog))->target : "the shared lib");
+
+    if (prog >= 0)
+         smartlist_add (((program*)smartlist_get(progs, prog))->sources, (void*)src);
+    else smartlist_add (shared, (void*)src);
+  }
+
+  free (src_owner);
+  free (owner);
+  smartlist_free (deps);
+  strmap_free (used, NULL);
+  return (progs);
+}
+
+void program_free (void *val)
+{
+  program *p = val;
+
+  smartlist_free (p->sources);
+  free (p->target);
+  free (p);
+}
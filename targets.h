@@ -0,0 +1,20 @@
+#ifndef _TARGETS_H
+#define _TARGETS_H
+
+#include "smartlist.h"
+#include "depend.h"
+
+/*
+ * A program found by 'partition_programs()'.
+ */
+typedef struct program {
+        char        *target;    /* "bin/name.exe" */
+        const char  *main_src;  /* the source with the 'main()' or 'WinMain()' */
+        smartlist_t *sources;   /* 'main_src' and the sources only it needs */
+      } program;
+
+smartlist_t *partition_programs (dep_graph *g, const smartlist_t *mains,
+                                 const smartlist_t *others, smartlist_t *shared);
+void         program_free (void *val);
+
+#endif
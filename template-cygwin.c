@@ -0,0 +1,320 @@
+/*
+ * Generated by 'gen-template' from 'template-cygwin.mk'. DO NOT EDIT.
+ * Edit the template and run 'make template-cygwin.c' instead.
+ */
+#include "gen-make.h"
+#include "template.h"
+
+static const char text[] =
+  "#\n"
+  "# GNU Makefile for project X (Cygwin gcc).\n"
+  "# Generated by 'gen-make' at %T.\0"
+  "#\n"
+  "THIS_FILE := $(firstword $(MAKEFILE_LIST))\n"
+  "TODAY     := $(shell date +%d-%B-%Y)\n"
+  "GEN_MAKE  := %g\0"
+  "MAKEFLAGS += --warn-undefined-variables\n"
+  "\n"
+  "VER_MAJOR = 1  #! Change this\n"
+  "VER_MINOR = 2  #! Change this\n"
+  "VER_PATCH = 3  #! Change this\n"
+  "VERSION   = $(strip $(VER_MAJOR)).$(strip $(VER_MINOR)).$(strip $(VER_PATCH))\n"
+  "\n"
+  "#! gen-make begin vpath\n"
+  "%v\0"
+  "#! gen-make end vpath\n"
+  "\n"
+  "#\n"
+  "# Options:\n"
+  "#\n"
+  "tool.ccache\0"
+  "#! Found tool.ccache.version\0"
+  "\n"
+  "USE_CCACHE    ?= 1\n"
+  "USE_CCACHE    ?= 0\n"
+  "USE_DEBUG     ?= 0\n"
+  "USE_PCH       ?= 0\n"
+  "USE_UNITY     ?= 0\n"
+  "\n"
+  "#\n"
+  "# What to build:\n"
+  "#\n"
+  "TARGETS = %t   #! Change this\0"
+  "\n"
+  "ifeq ($(origin CC),default)\n"
+  "  CC = gcc\n"
+  "endif\n"
+  "ifeq ($(origin CXX),default)\n"
+  "  CXX = g++\n"
+  "endif\n"
+  "\n"
+  "ifeq ($(USE_CCACHE),1)\n"
+  "  CC  := ccache $(CC)\n"
+  "  CXX := ccache $(CXX)\n"
+  "endif\n"
+  "\n"
+  "OBJ_DIR = Cygwin_obj\n"
+  "\n"
+  "c_to_obj   = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.c=.o)))\n"
+  "src_to_obj = $(addprefix $(OBJ_DIR)/, $(addsuffix .o, $(notdir $(basename $(1)))))\n"
+  "\n"
+  "PREFIX = $(realpath $(CYGWIN_ROOT))\n"
+  "\n"
+  "#\n"
+  "# '-MMD -MP' gives a '$(OBJ_DIR)/foo.d' with the headers of each object.\n"
+  "#\n"
+  "CFLAGS = -Wall -MMD -MP -I. -I./$(OBJ_DIR) -DHAVE_CONFIG_H %I\0"
+  "\n"
+  "LDFLAGS = -Wl,--print-map\n"
+  "RCFLAGS = -O COFF -D__CYGWIN__\n"
+  "\n"
+  "ifeq ($(USE_DEBUG),1)\n"
+  "  CFLAGS  += -O0 -ggdb\n"
+  "  RCFLAGS += -D_DEBUG\n"
+  "else\n"
+  "  CFLAGS  += -O2 -g\n"
+  "  LDFLAGS += -s\n"
+  "endif\n"
+  "\n"
+  "CXXFLAGS = $(CFLAGS) -std=c++17  #! CFLAGS for C++\n"
+  "\n"
+  "EX_LIBS += -lws2_32  #! Add more libs as needed\n"
+  "\n"
+  "#! gen-make begin sources\n"
+  "SOURCES = %s\0"
+  "#! gen-make end sources\n"
+  "\n"
+  "OBJECTS = $(call c_to_obj, $(SOURCES))\n"
+  "\n"
+  "#! gen-make begin unity\n"
+  "%u\0"
+  "#! gen-make end unity\n"
+  "\n"
+  "ifeq ($(USE_UNITY),1)\n"
+  "  OBJECTS = $(foreach n, $(UNITY_BATCHES), $(OBJ_DIR)/unity_$(n).o) \\\n"
+  "            $(call c_to_obj, $(UNITY_EXCLUDE))\n"
+  "endif\n"
+  "\n"
+  "GENERATED = $(OBJ_DIR)/config.h\n"
+  "\n"
+  "#! gen-make begin configured\n"
+  "%H\0"
+  "#! gen-make end configured\n"
+  "\n"
+  "#! gen-make begin pch\n"
+  "PCH_HEADERS = %P\0"
+  "#! gen-make end pch\n"
+  "\n"
+  "#\n"
+  "# With 'USE_PCH = 1', '$(OBJ_DIR)/pch.h' is force-included into each .c file and\n"
+  "# gcc uses the '$(OBJ_DIR)/pch.h.gch' next to it. Not for sources that set\n"
+  "# '_GNU_SOURCE' etc. before their first include; they would compile differently.\n"
+  "#\n"
+  "PCH_CFLAGS =\n"
+  "\n"
+  "ifeq ($(USE_PCH),1)\n"
+  "  ifneq ($(PCH_HEADERS),)\n"
+  "    PCH_CFLAGS = -include $(OBJ_DIR)/pch.h -Winvalid-pch\n"
+  "    GENERATED += $(OBJ_DIR)/pch.h $(OBJ_DIR)/pch.h.gch\n"
+  "  endif\n"
+  "endif\n"
+  "\n"
+  "%A\0"
+  "all: $(GENERATED) $(TARGETS)\n"
+  "\t$(call green_msg, Welcome to 'TARGETS' (CC=$(CC)).)\n"
+  "\n"
+  "$(OBJ_DIR) bin lib:\n"
+  "\tmkdir --parents $@\n"
+  "\n"
+  "bin/foo.exe: $(OBJECTS) | bin #! maybe add a '$(OBJ_DIR)/foo.res' here?\n"
+  "\t$(call link_EXE, $@, $^ $(EX_LIBS))\n"
+  "\n"
+  "lib/libfoo.dll.a: bin/foo.dll\n"
+  "bin/foo.dll: $(OBJECTS) | bin lib\n"
+  "\t$(call link_DLL, $@, $^ $(EX_LIBS), lib/libfoo.dll.a)\n"
+  "\n"
+  "lib/libfoo.a: $(OBJECTS) | lib\n"
+  "\t$(call green_msg, Creating static library $@)\n"
+  "\trm -f $@\n"
+  "\t$(AR) rcs $@ $^\n"
+  "\t@echo\n"
+  "\n"
+  "multi_target\0"
+  "#! The TARGETS has one program for each 'main()'. Their link rules are only written for the 'windows' template.\n"
+  "#! gen-make begin rules\n"
+  "%M\0"
+  "%c\0"
+  "\n"
+  "#! gen-make end rules\n"
+  "\n"
+  "ifeq ($(filter $(OBJ_DIR)/config.h, $(CONFIGURED_H)),)\n"
+  "$(OBJ_DIR)/config.h: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@,//)\n"
+  "\t$(file >> $@,$(CONFIG_H))\n"
+  "endif\n"
+  "\n"
+  "#! gen-make begin configure-rules\n"
+  "%h\0"
+  "#! gen-make end configure-rules\n"
+  "\n"
+  "#\n"
+  "# The precompiled header; compiled with the same 'CFLAGS' as the .c files.\n"
+  "#\n"
+  "$(OBJ_DIR)/pch.h: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@,//)\n"
+  "\t$(foreach h, $(PCH_HEADERS), $(file >> $@,#include $(h)))\n"
+  "\n"
+  "$(OBJ_DIR)/pch.h.gch: $(OBJ_DIR)/pch.h $(OBJ_DIR)/config.h\n"
+  "\t$(CC) -c $(CFLAGS) -x c-header -o $@ $<\n"
+  "\n"
+  "ifneq ($(PCH_CFLAGS),)\n"
+  "  $(OBJECTS): $(OBJ_DIR)/pch.h.gch\n"
+  "endif\n"
+  "\n"
+  "#\n"
+  "# A 'unity_N.c' file includes the sources in '$(UNITY_N)'.\n"
+  "#\n"
+  "$(OBJ_DIR)/unity_%.c: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@,//)\n"
+  "\t$(foreach f, $(UNITY_$*), $(file >> $@,#include \"$(f)\"))\n"
+  "\n"
+  ".PRECIOUS: $(OBJ_DIR)/unity_%.c\n"
+  "\n"
+  "$(OBJ_DIR)/unity_%.o: $(OBJ_DIR)/unity_%.c | $(OBJ_DIR)\n"
+  "\t$(CC) -c $(CFLAGS) $(PCH_CFLAGS) -o $@ $<\n"
+  "\n"
+  "$(OBJ_DIR)/%.res: %.rc | $(OBJ_DIR)\n"
+  "\t$(call green_msg, Creating $@)\n"
+  "\twindres $(RCFLAGS) -o $@ $<\n"
+  "\t@echo\n"
+  "\n"
+  "install: $(TARGETS)\n"
+  "\tinstall -d $(PREFIX)/bin\n"
+  "\tinstall $(TARGETS) $(PREFIX)/bin\n"
+  "\n"
+  "clean:\n"
+  "\trm -f $(GENERATED)\n"
+  "\trm -fr $(OBJ_DIR) gcm.cache\n"
+  "\n"
+  "vclean realclean: clean\n"
+  "\trm -f .gen-make.cache .gen-make.merkle .gen-make.probe\n"
+  "\trm -fr bin lib\n"
+  "\n"
+  "%.i: %.c $(GENERATED) FORCE\n"
+  "\t$(CC) -E $(CFLAGS) $< > $@\n"
+  "\n"
+  "FORCE:\n"
+  "\n"
+  "#\n"
+  "# GNU-make macros:\n"
+  "#\n"
+  "BRIGHT_GREEN = \\e[1;32m\n"
+  "\n"
+  "colour_msg = @echo -e \"$(1)\\e[0m\"\n"
+  "green_msg  = $(call colour_msg,$(BRIGHT_GREEN)$(strip $(1)))\n"
+  "\n"
+  "define link_EXE\n"
+  "  $(call green_msg, Linking $(1))\n"
+  "  $(CC) $(LDFLAGS) -o $(strip $(1)) $(2) > $(1:.exe=.map)\n"
+  "  @echo\n"
+  "endef\n"
+  "\n"
+  "define link_DLL\n"
+  "  $(call green_msg, Linking $(1))\n"
+  "  $(CC) -shared $(LDFLAGS) -Wl,--out-implib,$(strip $(3)) -o $(strip $(1)) $(2) > $(1:.dll=.map)\n"
+  "  @echo\n"
+  "endef\n"
+  "\n"
+  "define generate\n"
+  "  $(call green_msg, Generating $(1))\n"
+  "  $(file > $(1),$(call Warning,$(2)))\n"
+  "endef\n"
+  "\n"
+  "define Warning\n"
+  "  $(1)\n"
+  "  $(1) DO NOT EDIT! This file was automatically generated\n"
+  "  $(1) from $(realpath $(THIS_FILE)) at $(TODAY). Edit that file instead.\n"
+  "  $(1)\n"
+  "endef\n"
+  "\n"
+  "define CONFIG_H\n"
+  "  #pragma once\n"
+  "  #define WIN32_LEAN_AND_MEAN\n"
+  "  /* !Add more stuff here... */\n"
+  "endef\n"
+  "\n"
+  "-include $(OBJECTS:.o=.d)\n";
+
+static const template_op ops[] = {
+  { TEMPL_TEXT,       0,   0,      0,    45,    0 }, 
+  { TEMPL_DIRECTIVE,'T',  29,     45,    32,    0 },   /* # Generated by 'gen-make' at %T. */
+  { TEMPL_TEXT,       0,   0,     78,    82,    0 }, 
+  { TEMPL_DIRECTIVE,'g',  13,    160,    15,    0 },   /* GEN_MAKE  := %g */
+  { TEMPL_TEXT,       0,   0,    176,   234,    0 }, 
+  { TEMPL_DIRECTIVE,'v',   0,    410,     2,    0 },   /* %v */
+  { TEMPL_TEXT,       0,   0,    413,    38,    0 }, 
+  { TEMPL_IF,         0,   0,    451,    11,   12 },   /* tool.ccache */
+  { TEMPL_TEXT,       0,   0,    463,     9,    0 }, 
+  { TEMPL_VAR,        0,   0,    472,    19,    0 },   /* tool.ccache.version */
+  { TEMPL_TEXT,       0,   0,    492,    20,    0 }, 
+  { TEMPL_ELSE,       0,   0,      0,     0,   13 }, 
+  { TEMPL_TEXT,       0,   0,    512,    19,    0 }, 
+  { TEMPL_TEXT,       0,   0,    531,    79,    0 }, 
+  { TEMPL_DIRECTIVE,'t',  10,    610,    29,    0 },   /* TARGETS = %t   #! Change this */
+  { TEMPL_TEXT,       0,   0,    640,   449,    0 }, 
+  { TEMPL_DIRECTIVE,'I',  59,   1089,    61,    0 },   /* CFLAGS = -Wall -MMD -MP -I. -I./$(OBJ_DIR) -DHAVE_CONFIG_H %I */
+  { TEMPL_TEXT,       0,   0,   1151,   301,    0 }, 
+  { TEMPL_DIRECTIVE,'s',  10,   1452,    12,    0 },   /* SOURCES = %s */
+  { TEMPL_TEXT,       0,   0,   1465,    89,    0 }, 
+  { TEMPL_DIRECTIVE,'u',   0,   1554,     2,    0 },   /* %u */
+  { TEMPL_TEXT,       0,   0,   1557,   231,    0 }, 
+  { TEMPL_DIRECTIVE,'H',   0,   1788,     2,    0 },   /* %H */
+  { TEMPL_TEXT,       0,   0,   1791,    50,    0 }, 
+  { TEMPL_DIRECTIVE,'P',  14,   1841,    16,    0 },   /* PCH_HEADERS = %P */
+  { TEMPL_TEXT,       0,   0,   1858,   449,    0 }, 
+  { TEMPL_DIRECTIVE,'A',   0,   2307,     2,    0 },   /* %A */
+  { TEMPL_TEXT,       0,   0,   2310,   467,    0 }, 
+  { TEMPL_IF,         0,   0,   2777,    12,   30 },   /* multi_target */
+  { TEMPL_TEXT,       0,   0,   2790,   112,    0 }, 
+  { TEMPL_TEXT,       0,   0,   2902,    24,    0 }, 
+  { TEMPL_DIRECTIVE,'M',   0,   2926,     2,    0 },   /* %M */
+  { TEMPL_DIRECTIVE,'c',   0,   2929,     2,    0 },   /* %c */
+  { TEMPL_TEXT,       0,   0,   2932,   219,    0 }, 
+  { TEMPL_DIRECTIVE,'h',   0,   3151,     2,    0 },   /* %h */
+  { TEMPL_TEXT,       0,   0,   3154,  1961,    0 }, 
+};
+
+static const template_define defines[] = {
+  { "c_rule",
+    "$(OBJ_DIR)/%.o: %.c | $(OBJ_DIR)\n"
+    "\t$(CC) -c $(CFLAGS) $(PCH_CFLAGS) -o $@ $<\n"
+  },
+  { "cc_rule",
+    "$(OBJ_DIR)/%.o: %.cc | $(OBJ_DIR)\n"
+    "\t$(CXX) -c $(CXXFLAGS) -o $@ $<\n"
+  },
+  { "cpp_rule",
+    "$(OBJ_DIR)/%.o: %.cpp | $(OBJ_DIR)\n"
+    "\t$(CXX) -c $(CXXFLAGS) -o $@ $<\n"
+  },
+  { "cxx_rule",
+    "$(OBJ_DIR)/%.o: %.cxx | $(OBJ_DIR)\n"
+    "\t$(CXX) -c $(CXXFLAGS) -o $@ $<\n"
+  },
+  { "tools",
+    "kind       = gcc\n"
+    "cc         = gcc\n"
+    "cxx        = g++\n"
+    "cflags     = -Wall -O2 -g -I.\n"
+    "cxxflags   = -std=c++17\n"
+    "dll_cflags =\n"
+    "libs       = -lws2_32\n"
+    "obj_dir    = Cygwin_obj\n"
+    "obj_ext    = .o\n"
+    "exe_ext    = .exe\n"
+    "dll_ext    = .dll\n"
+    "lib_ext    = .a\n"
+  }
+};
+
+const template_code make_template_cygwin = { ops, DIM(ops), text, sizeof(text) - 1, defines, DIM(defines), NULL };
@@ -0,0 +1,272 @@
+%%# The makefile template for MinGW gcc. Compiled into 'template-mingw.c'
+%%# by 'gen-template'. See 'template-windows.mk' for the '%x' directives.
+#
+# GNU Makefile for project X (MinGW gcc).
+# Generated by 'gen-make' at %T.
+#
+THIS_FILE := $(firstword $(MAKEFILE_LIST))
+TODAY     := $(shell date +%d-%B-%Y)
+GEN_MAKE  := %g
+MAKEFLAGS += --warn-undefined-variables
+
+VER_MAJOR = 1  #! Change this
+VER_MINOR = 2  #! Change this
+VER_PATCH = 3  #! Change this
+VERSION   = $(strip $(VER_MAJOR)).$(strip $(VER_MINOR)).$(strip $(VER_PATCH))
+
+#! gen-make begin vpath
+%v
+#! gen-make end vpath
+
+#
+# Options:
+#
+%%if tool.ccache
+#! Found %{tool.ccache.version}
+USE_CCACHE    ?= 1
+%%else
+USE_CCACHE    ?= 0
+%%endif
+USE_DEBUG     ?= 0
+USE_PCH       ?= 0
+USE_UNITY     ?= 0
+
+#
+# What to build:
+#
+TARGETS = %t   #! Change this
+
+ifeq ($(origin CC),default)
+  CC = gcc
+endif
+ifeq ($(origin CXX),default)
+  CXX = g++
+endif
+
+ifeq ($(USE_CCACHE),1)
+  CC  := ccache $(CC)
+  CXX := ccache $(CXX)
+endif
+
+OBJ_DIR = MinGW_obj
+
+c_to_obj   = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.c=.o)))
+src_to_obj = $(addprefix $(OBJ_DIR)/, $(addsuffix .o, $(notdir $(basename $(1)))))
+
+PREFIX = $(realpath $(MINGW32))
+
+#
+# '-MMD -MP' gives a '$(OBJ_DIR)/foo.d' with the headers of each object.
+#
+CFLAGS = -Wall -MMD -MP -I. -I./$(OBJ_DIR) -DHAVE_CONFIG_H %I
+
+LDFLAGS = -Wl,--print-map
+RCFLAGS = -O COFF -D__MINGW32__
+
+ifeq ($(USE_DEBUG),1)
+  CFLAGS  += -O0 -ggdb
+  RCFLAGS += -D_DEBUG
+else
+  CFLAGS  += -O2 -g
+  LDFLAGS += -s
+endif
+
+CXXFLAGS = $(CFLAGS) -std=c++17  #! CFLAGS for C++
+
+EX_LIBS += -lws2_32  #! Add more libs as needed
+
+#! gen-make begin sources
+SOURCES = %s
+#! gen-make end sources
+
+OBJECTS = $(call c_to_obj, $(SOURCES))
+
+#! gen-make begin unity
+%u
+#! gen-make end unity
+
+ifeq ($(USE_UNITY),1)
+  OBJECTS = $(foreach n, $(UNITY_BATCHES), $(OBJ_DIR)/unity_$(n).o) \
+            $(call c_to_obj, $(UNITY_EXCLUDE))
+endif
+
+GENERATED = $(OBJ_DIR)/config.h
+
+#! gen-make begin configured
+%H
+#! gen-make end configured
+
+#! gen-make begin pch
+PCH_HEADERS = %P
+#! gen-make end pch
+
+#
+# With 'USE_PCH = 1', '$(OBJ_DIR)/pch.h' is force-included into each .c file and
+# gcc uses the '$(OBJ_DIR)/pch.h.gch' next to it. Not for sources that set
+# '_GNU_SOURCE' etc. before their first include; they would compile differently.
+#
+PCH_CFLAGS =
+
+ifeq ($(USE_PCH),1)
+  ifneq ($(PCH_HEADERS),)
+    PCH_CFLAGS = -include $(OBJ_DIR)/pch.h -Winvalid-pch
+    GENERATED += $(OBJ_DIR)/pch.h $(OBJ_DIR)/pch.h.gch
+  endif
+endif
+
+%A
+all: $(GENERATED) $(TARGETS)
+	$(call green_msg, Welcome to 'TARGETS' (CC=$(CC)).)
+
+$(OBJ_DIR) bin lib:
+	mkdir --parents $@
+
+bin/foo.exe: $(OBJECTS) | bin #! maybe add a '$(OBJ_DIR)/foo.res' here?
+	$(call link_EXE, $@, $^ $(EX_LIBS))
+
+lib/libfoo.dll.a: bin/foo.dll
+bin/foo.dll: $(OBJECTS) | bin lib
+	$(call link_DLL, $@, $^ $(EX_LIBS), lib/libfoo.dll.a)
+
+lib/libfoo.a: $(OBJECTS) | lib
+	$(call green_msg, Creating static library $@)
+	rm -f $@
+	$(AR) rcs $@ $^
+	@echo
+
+%%if multi_target
+#! The TARGETS has one program for each 'main()'. Their link rules are only written for the 'windows' template.
+%%endif
+#! gen-make begin rules
+%M
+%c
+#! gen-make end rules
+
+ifeq ($(filter $(OBJ_DIR)/config.h, $(CONFIGURED_H)),)
+$(OBJ_DIR)/config.h: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@,//)
+	$(file >> $@,$(CONFIG_H))
+endif
+
+#! gen-make begin configure-rules
+%h
+#! gen-make end configure-rules
+
+#
+# The precompiled header; compiled with the same 'CFLAGS' as the .c files.
+#
+$(OBJ_DIR)/pch.h: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@,//)
+	$(foreach h, $(PCH_HEADERS), $(file >> $@,#include $(h)))
+
+$(OBJ_DIR)/pch.h.gch: $(OBJ_DIR)/pch.h $(OBJ_DIR)/config.h
+	$(CC) -c $(CFLAGS) -x c-header -o $@ $<
+
+ifneq ($(PCH_CFLAGS),)
+  $(OBJECTS): $(OBJ_DIR)/pch.h.gch
+endif
+
+#
+# A 'unity_N.c' file includes the sources in '$(UNITY_N)'.
+#
+$(OBJ_DIR)/unity_%.c: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@,//)
+	$(foreach f, $(UNITY_$*), $(file >> $@,#include "$(f)"))
+
+.PRECIOUS: $(OBJ_DIR)/unity_%.c
+
+$(OBJ_DIR)/unity_%.o: $(OBJ_DIR)/unity_%.c | $(OBJ_DIR)
+	$(CC) -c $(CFLAGS) $(PCH_CFLAGS) -o $@ $<
+
+$(OBJ_DIR)/%.res: %.rc | $(OBJ_DIR)
+	$(call green_msg, Creating $@)
+	windres $(RCFLAGS) -o $@ $<
+	@echo
+
+install: $(TARGETS)
+	install -d $(PREFIX)/bin
+	install $(TARGETS) $(PREFIX)/bin
+
+clean:
+	rm -f $(GENERATED)
+	rm -fr $(OBJ_DIR) gcm.cache
+
+vclean realclean: clean
+	rm -f .gen-make.cache .gen-make.merkle .gen-make.probe
+	rm -fr bin lib
+
+%.i: %.c $(GENERATED) FORCE
+	$(CC) -E $(CFLAGS) $< > $@
+
+FORCE:
+
+#
+# GNU-make macros:
+#
+BRIGHT_GREEN = \e[1;32m
+
+colour_msg = @echo -e "$(1)\e[0m"
+green_msg  = $(call colour_msg,$(BRIGHT_GREEN)$(strip $(1)))
+
+define link_EXE
+  $(call green_msg, Linking $(1))
+  $(CC) $(LDFLAGS) -o $(strip $(1)) $(2) > $(1:.exe=.map)
+  @echo
+endef
+
+define link_DLL
+  $(call green_msg, Linking $(1))
+  $(CC) -shared $(LDFLAGS) -Wl,--out-implib,$(strip $(3)) -o $(strip $(1)) $(2) > $(1:.dll=.map)
+  @echo
+endef
+
+define generate
+  $(call green_msg, Generating $(1))
+  $(file > $(1),$(call Warning,$(2)))
+endef
+
+define Warning
+  $(1)
+  $(1) DO NOT EDIT! This file was automatically generated
+  $(1) from $(realpath $(THIS_FILE)) at $(TODAY). Edit that file instead.
+  $(1)
+endef
+
+define CONFIG_H
+  #pragma once
+  #define WIN32_LEAN_AND_MEAN
+  /* !Add more stuff here... */
+endef
+
+-include $(OBJECTS:.o=.d)
+%%define c_rule
+$(OBJ_DIR)/%.o: %.c | $(OBJ_DIR)
+	$(CC) -c $(CFLAGS) $(PCH_CFLAGS) -o $@ $<
+%%end
+%%define cc_rule
+$(OBJ_DIR)/%.o: %.cc | $(OBJ_DIR)
+	$(CXX) -c $(CXXFLAGS) -o $@ $<
+%%end
+%%define cpp_rule
+$(OBJ_DIR)/%.o: %.cpp | $(OBJ_DIR)
+	$(CXX) -c $(CXXFLAGS) -o $@ $<
+%%end
+%%define cxx_rule
+$(OBJ_DIR)/%.o: %.cxx | $(OBJ_DIR)
+	$(CXX) -c $(CXXFLAGS) -o $@ $<
+%%end
+%%# The toolchain for the other backends; like '--emit ninja'. See 'tools.c'.
+%%define tools
+kind       = gcc
+cc         = gcc
+cxx        = g++
+cflags     = -Wall -O2 -g -I.
+cxxflags   = -std=c++17
+dll_cflags =
+libs       = -lws2_32
+obj_dir    = MinGW_obj
+obj_ext    = .o
+exe_ext    = .exe
+dll_ext    = .dll
+lib_ext    = .a
+%%end
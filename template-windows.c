@@ -1,371 +1,527 @@
+/*
+ * Generated by 'gen-template' from 'template-windows.mk'. DO NOT EDIT.
+ * Edit the template and run 'make template-windows.c' instead.
+ */
 #include "gen-make.h"
+#include "template.h"
 
-const char *make_template[] = {
-  "#",
-  "# GNU Makefile for project X (MSVC+clang-cl).",
-  "# Generated by 'gen-make' at %T.",
-  "#",
-  "THIS_FILE := $(firstword $(MAKEFILE_LIST))",
-  "TODAY     := $(shell date +%d-%B-%Y)",
-  "PYTHON    := py -3",
-  "MAKEFLAGS += --warn-undefined-variables",
-  "",
-  "VER_MAJOR = 1  #! Change this",
-  "VER_MINOR = 2  #! Change this",
-  "VER_PATCH = 3  #! Change this",
-  "VERSION   = $(VER_MAJOR).$(VER_MINOR).$(VER_PATCH)",
-  "",
-  "%v",
-  "",
-  "#",
-  "# Options:",
-  "#",
-  "USE_ASTYLE    ?= %a",
-  "USE_OPENSSL   ?= 0",
-  "USE_CRT_DEBUG ?= 0",
-  "",
-  "#",
-  "# What to build:",
-  "#",
-  "TARGETS = bin/foo.exe   #! Change this",
-  "",
-  "#",
-  "# Location of required packages",
-  "#",
-  "OPENSSL_ROOT = c:/dev/src/inet/Crypto/OpenSSL  #! Example requirement.",
-  "MSVC_ROOT    = $(realpath $(VSINSTALLDIR))",
-  "",
-  "define Usage",
-  "",
-  "  Usage: $(MAKE) -f $(THIS_FILE) CC=[cl | clang-cl] [all | depend | clean | vclean | install]",
-  "endef",
-  "",
-  "ifneq ($(CC),cl)",
-  "  ifneq ($(CC),clang-cl)",
-  "    $(error $(Usage))",
-  "  endif",
-  "endif",
-  "",
-  "OBJ_DIR = objects",
-  "",
-  "#",
-  "# Undefine any '%CL%' env-var",
-  "#",
-  "export CL=",
-  "",
-  "#",
-  "# Since 'clang-cl' could pick up some .h-files from this.",
-  "# Just remove it.",
-  "#",
-  "export C_INCLUDE_PATH=",
-  "",
-  "c_to_obj   = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.c=.obj)))",
-  "cc_to_obj  = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.cc=.obj)))",
-  "cpp_to_obj = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.cpp=.obj)))",
-  "",
-  "INSTALL_ROOT = $(VC_ROOT)",
-  "",
-  "CFLAGS = -nologo -W3 -Zi -I.         \\",
-  "         -I./$(OBJ_DIR)              \\",
-  "         -D_CRT_NONSTDC_NO_WARNINGS  \\",
-  "         -D_CRT_OBSOLETE_NO_WARNINGS \\",
-  "         -D_CRT_SECURE_NO_DEPRECATE  \\",
-  "         -D_CRT_SECURE_NO_WARNINGS",
-  "",
-  "CFLAGS += -D_WIN32_WINNT=0x0601 -DHAVE_CONFIG_H -I. #! Add include dirs as needed",
-  "",
-  "LDFLAGS = -nologo -debug -incremental:no -map -verbose",
-  "RCFLAGS = -nologo",
-  "",
-  "ifeq ($(CC),clang-cl)",
-  "  CFLAGS  += -fms-compatibility \\",
-  "             -ferror-limit=5",
-  "  RCFLAGS += -D__clang__",
-  "else",
-  "  RCFLAGS += -D_MSC_VER",
-  "endif",
-  "",
-  "ifeq ($(USE_CRT_DEBUG),1)",
-  "  CFLAGS  += -MDd -Od -GF -GS -RTCs -RTCu -RTCc",
-  "  RCFLAGS += -D_DEBUG",
-  "else",
-  "  CFLAGS += -MD -Ot",
-  "endif",
-  "",
-  "CXXFLAGS = -std:c++17 -TP -EHsc  #! CFLAGS for C++",
-  "",
-  "EX_LIBS += ws2_32.lib  #! Add more libs as needed",
-  "",
-  "ifeq ($(USE_OPENSSL),1)",
-  "  CFLAGS  += -DHAVE_OPENSSL -DOPENSSL_USE_DEPRECATED -I$(OPENSSL_ROOT)/include",
-  "  EX_LIBS += $(OPENSSL_ROOT)/lib/libssl.lib $(OPENSSL_ROOT)/lib/libcrypto.lib",
-  "endif",
-  "",
-  "SOURCES = %s",
-  "",
-  "OBJECTS = $(call c_to_obj, $(SOURCES))",
-  "",
-  "GENERATED = $(OBJ_DIR)/config.h",
-  "",
-  "all: $(GENERATED) $(TARGETS)",
-  "\t$(call green_msg, Welcome to 'TARGETS' (CC=$(CC)).)",
-  "",
-  "$(OBJ_DIR) bin lib:",
-  "\tmkdir --parents $(OBJ_DIR)",
-  "",
-  "bin/foo.exe: $(OBJECTS) | bin #! maybe add a '$(OBJ_DIR)/foo.res' here?",
-  "\t$(call link_EXE, $@, $^ $(EX_LIBS))",
-  "",
-  "#",
-  "#! Unless the '$(OBJECTS)' exports something, this could create no 'lib/foo_imp.lib' file.",
-  "#",
-  "lib/foo_imp.lib: bin/foo.dll",
-  "bin/foo.dll: $(OBJECTS) | bin lib",
-  "\t$(call link_DLL, $@, $^ $(EX_LIBS), lib/foo_imp.lib)",
-  "",
-  "%c",
-  "#",
-  "# Link $(TARGETS) with this instead?",
-  "#",
-  "LIB_OBJ ?=",
-  "",
-  "lib/foo.lib: $(LIB_OBJ) | lib",
-  "\t$(call create_static_lib, $@, $(LIB_OBJ))",
-  "",
-  "$(OBJ_DIR)/%.res: %.rc | $(OBJ_DIR)",
-  "\t$(call create_res_file, $@, $<)",
-  "",
-  "$(OBJ_DIR)/config.h: $(THIS_FILE) | $(OBJ_DIR)",
-  "\t$(call generate, $@,//)",
-  "\t$(file >> $@,$(CONFIG_H))",
-  "",
-  "$(OBJ_DIR)/foo.rc: $(THIS_FILE) | $(OBJ_DIR)",
-  "\t$(call generate, $@,//)",
-  "\t$(file >> $@,$(FOO_RC))",
-  "",
-  "install: $(TARGETS)",
-  "\tcp --update $(TARGETS) $(TARGETS:.exe=.pdb) $(INSTALL_ROOT)/bin",
-  "\t@echo",
-  "",
-  "clean:",
-  "\trm -f $(GENERATED) link.tmp",
-  "\trm -fr $(OBJ_DIR)",
-  "",
-  "vclean realclean: clean",
-  "\trm -f .depend.Windows",
-  "\trm -fr bin lib",
-  "",
-  "%.i: %.c $(OBJ_DIR)/cpp-filter.py $(GENERATED) FORCE",
-  "\t$(call C_preprocess, $@, $<)",
-  "",
-  "FORCE:",
-  "",
-  "$(OBJ_DIR)/cpp-filter.py: $(THIS_FILE) | $(OBJ_DIR)",
-  "\t$(call generate, $@, #)",
-  "\t$(file >> $@,if 1:)",
-  "\t$(file >> $@,$(cpp_filter_PY))",
-  "",
-  "#",
-  "# GNU-make macros:",
-  "#",
-  "# This assumes you have CygWin/Msys's 'echo' with colour support.",
-  "#",
-  "BRIGHT_GREEN = \\e[1;32m",
-  "BRIGHT_WHITE = \\e[1;37m",
-  "",
-  "colour_msg = @echo -e \"$(1)\\e[0m\"",
-  "green_msg  = $(call colour_msg,$(BRIGHT_GREEN)$(strip $(1)))",
-  "",
-  "define generate",
-  "  $(call green_msg, Generating $(1))",
-  "  $(file > $(1),$(call Warning,$(2)))",
-  "endef",
-  "",
-  "define Warning",
-  "  $(1)",
-  "  $(1) DO NOT EDIT! This file was automatically generated",
-  "  $(1) from $(realpath $(THIS_FILE)) at $(TODAY). Edit that file instead.",
-  "  $(1)",
-  "endef",
-  "",
-  "define create_resp_file",
-  "  $(file > $(1))",
-  "  $(foreach f, $(2), $(file >> $(1),$(strip $(f))) )",
-  "endef",
-  "",
-  "define C_compile",
-  "  $(CC) -c $(CFLAGS) -Fo./$(strip $(1) $(2))",
-  "  @echo",
-  "endef",
-  "",
-  "define link_EXE",
-  "  $(call green_msg, Linking $(1))",
-  "  link $(LDFLAGS) -out:$(strip $(1)) $(2) > link.tmp",
-  "  @cat link.tmp >> $(1:.exe=.map)",
-  "  @echo",
-  "endef",
-  "",
-  "define link_DLL",
-  "  $(call green_msg, Linking $(1))",
-  "  link $(LDFLAGS) -dll -out:$(strip $(1)) -implib:$(strip $(3)) $(2) > link.tmp",
-  "  @cat link.tmp >> $(1:.dll=.map)",
-  "  @rm -f $(3:.lib=.exp)",
-  "  @echo",
-  "endef",
-  "",
-  "define create_static_lib",
-  "  $(call green_msg, Creating static library $(1))",
-  "  rm -f $(1)",
-  "  lib -nologo -out:$(strip $(1)) -machine:$(CPU) $(2)",
-  "  @echo",
-  "endef",
-  "",
-  "define create_res_file",
-  "  $(call green_msg, Creating $(1))",
-  "  rc $(RCFLAGS) -Fo./$(strip $(1)) $(2)",
-  "  @echo",
-  "endef",
-  "",
-  "#",
-  "# clang-cl: /d1PP  Retain macro definitions in /E mode",
-  "#",
-  "ifeq ($(CC),clang-cl)",
-  "  d1PP = -d1PP",
-  "else",
-  "  d1PP =",
-  "endif",
-  "",
-  "ifeq ($(USE_ASTYLE),1)",
-  "  pp_filter  = | astyle",
-  "  pp_comment = The preprocessed and Astyled output of $(strip $(1))",
-  "else",
-  "  pp_filter  =",
-  "  pp_comment = The raw preprocessed output of $(strip $(1))",
-  "endif",
-  "",
-  "define C_preprocess",
-  "  $(file  > $(1), /* $(call pp_comment, $(2)) */)",
-  "  $(file >> $(1),  * $(CC) -E)",
-  "  $(foreach f, $(CFLAGS), $(file >> $(1),  *   $(f)))",
-  "  $(file >> $(1), ---------------------------------)",
-  "  $(file >> $(1),  */)",
-  "  $(CC) -E $(CFLAGS) $(d1PP) $(2) | $(PYTHON) $(OBJ_DIR)/cpp-filter.py $(pp_filter) >> $(1)",
-  "endef",
-  "",
-  "define CONFIG_H",
-  "  #pragma once",
-  "  #define WIN32_LEAN_AND_MEAN",
-  "",
-  "  #ifndef _CRT_NONSTDC_NO_WARNINGS",
-  "  #define _CRT_NONSTDC_NO_WARNINGS",
-  "  #endif",
-  "  #ifndef _CRT_OBSOLETE_NO_WARNINGS",
-  "  #define _CRT_OBSOLETE_NO_WARNINGS",
-  "  #endif",
-  "  #ifndef _CRT_SECURE_NO_DEPRECATE",
-  "  #define _CRT_SECURE_NO_DEPRECATE",
-  "  #endif",
-  "  #ifndef _CRT_SECURE_NO_WARNINGS",
-  "  #define _CRT_SECURE_NO_WARNINGS",
-  "  #endif",
-  "  /* !Add more stuff here... */",
-  "endef",
-  "",
-  "define FOO_RC",
-  "  #include <winver.h>",
-  "",
-  "  #if defined(__clang__)",
-  "    #define RC_HOST        \"clang\"",
-  "  #elif defined(_MSC_VER)",
-  "    #define RC_HOST        \"MSVC\"",
-  "  #else",
-  "    #error \"Unsupported compiler\"",
-  "  #endif",
-  "",
-  "  #define RC_VERSION    $(VER_MAJOR),$(VER_MINOR),$(VER_PATCH),0",
-  "",
-  "  #ifdef _DEBUG",
-  "    #define RC_FILEFLAGS 1",
-  "    #define RC_DBG_REL   \", debug\"",
-  "  #else",
-  "    #define RC_FILEFLAGS 0",
-  "    #define RC_DBG_REL   \", release\"",
-  "  #endif",
-  "",
-  "  LANGUAGE  0x09,0x01",
-  "",
-  "  VS_VERSION_INFO VERSIONINFO",
-  "    FILEVERSION    RC_VERSION",
-  "    PRODUCTVERSION RC_VERSION",
-  "    FILEFLAGSMASK  0x3FL",
-  "    FILEOS         VOS__WINDOWS32",
-  "    FILETYPE       VFT_APP",
-  "    FILESUBTYPE    0x0L",
-  "    FILEFLAGS      RC_FILEFLAGS",
-  "",
-  "  BEGIN",
-  "    BLOCK \"StringFileInfo\"",
-  "    BEGIN",
-  "      BLOCK \"040904B0\"",
-  "      BEGIN",
-  "        VALUE \"CompanyName\",     \"http://www.foo.com/\"",
-  "        VALUE \"FileDescription\", \"foo-bar (\" RC_HOST RC_DBG_REL \").\"",
-  "        VALUE \"FileVersion\",     \"$(VERSION).\"",
-  "        VALUE \"InternalName\",    \"foo-bar.\"",
-  "        VALUE \"LegalCopyright\",  \"GNU GENERAL PUBLIC LICENSE v2 or comercial licence.\"",
-  "        VALUE \"Comments\",        \"Built on $(TODAY) by ...\"",
-  "      END",
-  "    END",
-  "",
-  "    BLOCK \"VarFileInfo\"",
-  "    BEGIN",
-  "      VALUE \"Translation\", 0x409, 1200",
-  "    END",
-  "  END",
-  "endef",
-  "",
-  "define cpp_filter_PY",
-  "  import sys, os",
-  "",
-  "  empty_lines = 0",
-  "  while True:",
-  "    line = sys.stdin.readline()",
-  "    if not line:",
-  "       break",
-  "    line = line.rstrip()",
-  "    if line == '':",
-  "       empty_lines += 1",
-  "       continue",
-  "",
-  "    #",
-  "    # MSVC or clang-cl 'line' directive",
-  "    #",
-  "    if line.startswith('#line') or line.startswith('# '):",
-  "       line = line.replace (r'\\\\', '/')",
-  "",
-  "    print (line)",
-  "",
-  "    #",
-  "    # Print a newline after a functions or structs",
-  "    #",
-  "    if line == '}' or line == '};':",
-  "       print ('')",
-  "",
-  "  print ('Removed %d empty lines.' % empty_lines, file=sys.stderr)",
-  "endef",
-  "",
-  "DEP_CFLAGS  = -MM $(filter -I% -D%, $(CFLAGS))",
-  "DEP_REPLACE = sed -e 's/\\(.*\\)\\.o: /\\n$$(OBJ_DIR)\\/\\1.obj: /'",
-  "",
-  "depend: $(GENERATED)",
-  "\tgcc $(DEP_CFLAGS) $(SOURCES) | $(DEP_REPLACE) > .depend.Windows",
-  "",
-  "-include .depend.Windows",
-  NULL
+static const char text[] =
+  "#\n"
+  "# GNU Makefile for project X (MSVC+clang-cl).\n"
+  "# Generated by 'gen-make' at %T.\0"
+  "#\n"
+  "THIS_FILE := $(firstword $(MAKEFILE_LIST))\n"
+  "TODAY     := $(shell date +%d-%B-%Y)\n"
+  "PYTHON    := py -3\n"
+  "GEN_MAKE  := %g\0"
+  "MAKEFLAGS += --warn-undefined-variables\n"
+  "\n"
+  "VER_MAJOR = 1  #! Change this\n"
+  "VER_MINOR = 2  #! Change this\n"
+  "VER_PATCH = 3  #! Change this\n"
+  "VERSION   = $(strip $(VER_MAJOR)).$(strip $(VER_MINOR)).$(strip $(VER_PATCH))\n"
+  "\n"
+  "#! gen-make begin vpath\n"
+  "%v\0"
+  "#! gen-make end vpath\n"
+  "\n"
+  "#\n"
+  "# Options:\n"
+  "#\n"
+  "USE_ASTYLE    ?= %a\0"
+  "USE_OPENSSL   ?= 0\n"
+  "USE_CRT_DEBUG ?= 0\n"
+  "USE_PCH       ?= 0\n"
+  "tool.sccache\0"
+  "#! Found tool.sccache.version\0"
+  "\n"
+  "USE_SCCACHE   ?= 1\n"
+  "USE_SCCACHE   ?= 0\n"
+  "USE_UNITY     ?= 0\n"
+  "\n"
+  "#\n"
+  "# What to build:\n"
+  "#\n"
+  "TARGETS = %t   #! Change this\0"
+  "\n"
+  "#\n"
+  "# Location of required packages\n"
+  "#\n"
+  "OPENSSL_ROOT = c:/dev/src/inet/Crypto/OpenSSL  #! Example requirement.\n"
+  "MSVC_ROOT    = $(realpath $(VSINSTALLDIR))\n"
+  "\n"
+  "define Usage\n"
+  "\n"
+  "  Usage: $(MAKE) -f $(THIS_FILE) CC=[cl | clang-cl] [all | depend | clean | vclean | install]\n"
+  "endef\n"
+  "\n"
+  "ifneq ($(CC),cl)\n"
+  "  ifneq ($(CC),clang-cl)\n"
+  "    $(error $(Usage))\n"
+  "  endif\n"
+  "endif\n"
+  "\n"
+  "OBJ_DIR = objects\n"
+  "\n"
+  "#\n"
+  "# Undefine any '%CL%' env-var\n"
+  "#\n"
+  "export CL=\n"
+  "\n"
+  "#\n"
+  "# Since 'clang-cl' could pick up some .h-files from this.\n"
+  "# Just remove it.\n"
+  "#\n"
+  "export C_INCLUDE_PATH=\n"
+  "\n"
+  "c_to_obj   = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.c=.obj)))\n"
+  "cc_to_obj  = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.cc=.obj)))\n"
+  "cpp_to_obj = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.cpp=.obj)))\n"
+  "src_to_obj = $(addprefix $(OBJ_DIR)/, $(addsuffix .obj, $(notdir $(basename $(1)))))\n"
+  "\n"
+  "INSTALL_ROOT = $(VC_ROOT)\n"
+  "\n"
+  "CFLAGS = -nologo -W3 -Zi -I.         \\\n"
+  "         -I./$(OBJ_DIR)              \\\n"
+  "         -D_CRT_NONSTDC_NO_WARNINGS  \\\n"
+  "         -D_CRT_OBSOLETE_NO_WARNINGS \\\n"
+  "         -D_CRT_SECURE_NO_DEPRECATE  \\\n"
+  "         -D_CRT_SECURE_NO_WARNINGS\n"
+  "\n"
+  "CFLAGS += -D_WIN32_WINNT=0x0601 -DHAVE_CONFIG_H %I\0"
+  "\n"
+  "LDFLAGS = -nologo -debug -incremental:no -map -verbose\n"
+  "RCFLAGS = -nologo\n"
+  "\n"
+  "ifeq ($(CC),clang-cl)\n"
+  "  CFLAGS  += -fms-compatibility \\\n"
+  "             -ferror-limit=5\n"
+  "  RCFLAGS += -D__clang__\n"
+  "else\n"
+  "  RCFLAGS += -D_MSC_VER\n"
+  "endif\n"
+  "\n"
+  "ifeq ($(USE_CRT_DEBUG),1)\n"
+  "  CFLAGS  += -MDd -Od -GF -GS -RTCs -RTCu -RTCc\n"
+  "  RCFLAGS += -D_DEBUG\n"
+  "else\n"
+  "  CFLAGS += -MD -Ot\n"
+  "endif\n"
+  "\n"
+  "ifeq ($(USE_SCCACHE),1)\n"
+  "  #\n"
+  "  # 'sccache' can not cache with a '-Zi' .pdb-file shared by all objects.\n"
+  "  #\n"
+  "  CFLAGS     := $(subst -Zi,-Z7,$(CFLAGS))\n"
+  "  CC_LAUNCHER = sccache\n"
+  "else\n"
+  "  CC_LAUNCHER =\n"
+  "endif\n"
+  "\n"
+  "CXXFLAGS = -std:c++17 -TP -EHsc  #! CFLAGS for C++\n"
+  "\n"
+  "EX_LIBS += ws2_32.lib  #! Add more libs as needed\n"
+  "\n"
+  "ifeq ($(USE_OPENSSL),1)\n"
+  "  CFLAGS  += -DHAVE_OPENSSL -DOPENSSL_USE_DEPRECATED -I$(OPENSSL_ROOT)/include\n"
+  "  EX_LIBS += $(OPENSSL_ROOT)/lib/libssl.lib $(OPENSSL_ROOT)/lib/libcrypto.lib\n"
+  "endif\n"
+  "\n"
+  "#! gen-make begin sources\n"
+  "SOURCES = %s\0"
+  "#! gen-make end sources\n"
+  "\n"
+  "OBJECTS = $(call c_to_obj, $(SOURCES))\n"
+  "\n"
+  "#! gen-make begin unity\n"
+  "%u\0"
+  "#! gen-make end unity\n"
+  "\n"
+  "ifeq ($(USE_UNITY),1)\n"
+  "  OBJECTS = $(foreach n, $(UNITY_BATCHES), $(OBJ_DIR)/unity_$(n).obj) \\\n"
+  "            $(call c_to_obj, $(UNITY_EXCLUDE))\n"
+  "endif\n"
+  "\n"
+  "GENERATED = $(OBJ_DIR)/config.h\n"
+  "\n"
+  "#! gen-make begin configured\n"
+  "%H\0"
+  "#! gen-make end configured\n"
+  "\n"
+  "#! gen-make begin pch\n"
+  "PCH_HEADERS = %P\0"
+  "#! gen-make end pch\n"
+  "\n"
+  "PCH_CFLAGS =\n"
+  "\n"
+  "ifeq ($(USE_PCH),1)\n"
+  "  ifneq ($(PCH_HEADERS),)\n"
+  "    PCH_CFLAGS = -Yu$(OBJ_DIR)/pch.h -FI$(OBJ_DIR)/pch.h -Fp$(OBJ_DIR)/pch.pch\n"
+  "    OBJECTS   += $(OBJ_DIR)/pch.obj\n"
+  "    GENERATED += $(OBJ_DIR)/pch.h\n"
+  "  endif\n"
+  "endif\n"
+  "\n"
+  "%A\0"
+  "all: $(GENERATED) $(TARGETS)\n"
+  "\t$(call green_msg, Welcome to 'TARGETS' (CC=$(CC)).)\n"
+  "\n"
+  "$(OBJ_DIR) bin lib:\n"
+  "\tmkdir --parents $(OBJ_DIR)\n"
+  "\n"
+  "bin/foo.exe: $(OBJECTS) | bin #! maybe add a '$(OBJ_DIR)/foo.res' here?\n"
+  "\t$(call link_EXE, $@, $^ $(EX_LIBS))\n"
+  "\n"
+  "#\n"
+  "#! Unless the '$(OBJECTS)' exports something, this could create no 'lib/foo_imp.lib' file.\n"
+  "#\n"
+  "lib/foo_imp.lib: bin/foo.dll\n"
+  "bin/foo.dll: $(OBJECTS) | bin lib\n"
+  "\t$(call link_DLL, $@, $^ $(EX_LIBS), lib/foo_imp.lib)\n"
+  "\n"
+  "#! gen-make begin rules\n"
+  "%m\0"
+  "%M\0"
+  "%c\0"
+  "\n"
+  "#! gen-make end rules\n"
+  "#\n"
+  "# Link $(TARGETS) with this instead?\n"
+  "#! After a build, 'gen-make --analyze-objects' writes a 'LIB_OBJ' with only the objects needed.\n"
+  "#\n"
+  "LIB_OBJ ?=\n"
+  "\n"
+  "lib/foo.lib: $(LIB_OBJ) | lib\n"
+  "\t$(call create_static_lib, $@, $(LIB_OBJ))\n"
+  "\n"
+  "$(OBJ_DIR)/%.res: %.rc | $(OBJ_DIR)\n"
+  "\t$(call create_res_file, $@, $<)\n"
+  "\n"
+  "ifeq ($(filter $(OBJ_DIR)/config.h, $(CONFIGURED_H)),)\n"
+  "$(OBJ_DIR)/config.h: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@,//)\n"
+  "\t$(file >> $@,$(CONFIG_H))\n"
+  "endif\n"
+  "\n"
+  "#! gen-make begin configure-rules\n"
+  "%h\0"
+  "#! gen-make end configure-rules\n"
+  "#\n"
+  "# Create the precompiled header from an empty .c-file.\n"
+  "# All the other objects depends on it.\n"
+  "#\n"
+  "$(OBJ_DIR)/pch.h: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@,//)\n"
+  "\t$(foreach h, $(PCH_HEADERS), $(file >> $@,#include $(h)))\n"
+  "\n"
+  "$(OBJ_DIR)/pch.obj: $(GENERATED)\n"
+  "\t$(file > $(OBJ_DIR)/pch.c,/* For $(OBJ_DIR)/pch.pch */)\n"
+  "\t$(call C_compile, $@, -Yc$(OBJ_DIR)/pch.h -FI$(OBJ_DIR)/pch.h -Fp$(OBJ_DIR)/pch.pch $(OBJ_DIR)/pch.c)\n"
+  "\n"
+  "ifneq ($(PCH_CFLAGS),)\n"
+  "  $(filter-out $(OBJ_DIR)/pch.obj, $(OBJECTS)): $(OBJ_DIR)/pch.obj\n"
+  "endif\n"
+  "\n"
+  "#\n"
+  "# A 'unity_N.c' file includes the sources in '$(UNITY_N)'.\n"
+  "#\n"
+  "$(OBJ_DIR)/unity_%.c: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@,//)\n"
+  "\t$(foreach f, $(UNITY_$*), $(file >> $@,#include \"$(f)\"))\n"
+  "\n"
+  ".PRECIOUS: $(OBJ_DIR)/unity_%.c\n"
+  ".SECONDEXPANSION:\n"
+  "\n"
+  "$(OBJ_DIR)/unity_%.obj: $(OBJ_DIR)/unity_%.c $$(UNITY_$$*) | $(OBJ_DIR)\n"
+  "\t$(call C_compile, $@, $(PCH_CFLAGS) $<)\n"
+  "\n"
+  "$(OBJ_DIR)/foo.rc: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@,//)\n"
+  "\t$(file >> $@,$(FOO_RC))\n"
+  "\n"
+  "install: $(TARGETS)\n"
+  "\tcp --update $(TARGETS) $(TARGETS:.exe=.pdb) $(INSTALL_ROOT)/bin\n"
+  "\t@echo\n"
+  "\n"
+  "clean:\n"
+  "\trm -f $(GENERATED) link.tmp\n"
+  "\trm -fr $(OBJ_DIR)\n"
+  "\n"
+  "vclean realclean: clean\n"
+  "\trm -f .depend.Windows .gen-make.cache .gen-make.merkle .gen-make.probe\n"
+  "\trm -fr bin lib\n"
+  "\n"
+  "%.i: %.c $(OBJ_DIR)/cpp-filter.py $(GENERATED) FORCE\n"
+  "\t$(call C_preprocess, $@, $<)\n"
+  "\n"
+  "FORCE:\n"
+  "\n"
+  "$(OBJ_DIR)/cpp-filter.py: $(THIS_FILE) | $(OBJ_DIR)\n"
+  "\t$(call generate, $@, #)\n"
+  "\t$(file >> $@,if 1:)\n"
+  "\t$(file >> $@,$(cpp_filter_PY))\n"
+  "\n"
+  "#\n"
+  "# GNU-make macros:\n"
+  "#\n"
+  "# This assumes you have CygWin/Msys's 'echo' with colour support.\n"
+  "#\n"
+  "BRIGHT_GREEN = \\e[1;32m\n"
+  "BRIGHT_WHITE = \\e[1;37m\n"
+  "\n"
+  "colour_msg = @echo -e \"$(1)\\e[0m\"\n"
+  "green_msg  = $(call colour_msg,$(BRIGHT_GREEN)$(strip $(1)))\n"
+  "\n"
+  "define generate\n"
+  "  $(call green_msg, Generating $(1))\n"
+  "  $(file > $(1),$(call Warning,$(2)))\n"
+  "endef\n"
+  "\n"
+  "define Warning\n"
+  "  $(1)\n"
+  "  $(1) DO NOT EDIT! This file was automatically generated\n"
+  "  $(1) from $(realpath $(THIS_FILE)) at $(TODAY). Edit that file instead.\n"
+  "  $(1)\n"
+  "endef\n"
+  "\n"
+  "define create_resp_file\n"
+  "  $(file > $(1))\n"
+  "  $(foreach f, $(2), $(file >> $(1),$(strip $(f))) )\n"
+  "endef\n"
+  "\n"
+  "define C_compile\n"
+  "  $(CC_LAUNCHER) $(CC) -c $(CFLAGS) -Fo./$(strip $(1) $(2))\n"
+  "  @echo\n"
+  "endef\n"
+  "\n"
+  "define link_EXE\n"
+  "  $(call green_msg, Linking $(1))\n"
+  "  link $(LDFLAGS) -out:$(strip $(1)) $(2) > link.tmp\n"
+  "  @cat link.tmp >> $(1:.exe=.map)\n"
+  "  @echo\n"
+  "endef\n"
+  "\n"
+  "define link_DLL\n"
+  "  $(call green_msg, Linking $(1))\n"
+  "  link $(LDFLAGS) -dll -out:$(strip $(1)) -implib:$(strip $(3)) $(2) > link.tmp\n"
+  "  @cat link.tmp >> $(1:.dll=.map)\n"
+  "  @rm -f $(3:.lib=.exp)\n"
+  "  @echo\n"
+  "endef\n"
+  "\n"
+  "define create_static_lib\n"
+  "  $(call green_msg, Creating static library $(1))\n"
+  "  rm -f $(1)\n"
+  "  lib -nologo -out:$(strip $(1)) -machine:$(CPU) $(2)\n"
+  "  @echo\n"
+  "endef\n"
+  "\n"
+  "define create_res_file\n"
+  "  $(call green_msg, Creating $(1))\n"
+  "  rc $(RCFLAGS) -Fo./$(strip $(1)) $(2)\n"
+  "  @echo\n"
+  "endef\n"
+  "\n"
+  "#\n"
+  "# clang-cl: /d1PP  Retain macro definitions in /E mode\n"
+  "#\n"
+  "ifeq ($(CC),clang-cl)\n"
+  "  d1PP = -d1PP\n"
+  "else\n"
+  "  d1PP =\n"
+  "endif\n"
+  "\n"
+  "ifeq ($(USE_ASTYLE),1)\n"
+  "  pp_filter  = | astyle\n"
+  "  pp_comment = The preprocessed and Astyled output of $(strip $(1))\n"
+  "else\n"
+  "  pp_filter  =\n"
+  "  pp_comment = The raw preprocessed output of $(strip $(1))\n"
+  "endif\n"
+  "\n"
+  "define C_preprocess\n"
+  "  $(file  > $(1), /* $(call pp_comment, $(2)) */)\n"
+  "  $(file >> $(1),  * $(CC) -E)\n"
+  "  $(foreach f, $(CFLAGS), $(file >> $(1),  *   $(f)))\n"
+  "  $(file >> $(1), ---------------------------------)\n"
+  "  $(file >> $(1),  */)\n"
+  "  $(CC) -E $(CFLAGS) $(d1PP) $(2) | $(PYTHON) $(OBJ_DIR)/cpp-filter.py $(pp_filter) >> $(1)\n"
+  "endef\n"
+  "\n"
+  "define CONFIG_H\n"
+  "  #pragma once\n"
+  "  #define WIN32_LEAN_AND_MEAN\n"
+  "\n"
+  "  #ifndef _CRT_NONSTDC_NO_WARNINGS\n"
+  "  #define _CRT_NONSTDC_NO_WARNINGS\n"
+  "  #endif\n"
+  "  #ifndef _CRT_OBSOLETE_NO_WARNINGS\n"
+  "  #define _CRT_OBSOLETE_NO_WARNINGS\n"
+  "  #endif\n"
+  "  #ifndef _CRT_SECURE_NO_DEPRECATE\n"
+  "  #define _CRT_SECURE_NO_DEPRECATE\n"
+  "  #endif\n"
+  "  #ifndef _CRT_SECURE_NO_WARNINGS\n"
+  "  #define _CRT_SECURE_NO_WARNINGS\n"
+  "  #endif\n"
+  "  /* !Add more stuff here... */\n"
+  "endef\n"
+  "\n"
+  "define FOO_RC\n"
+  "  #include <winver.h>\n"
+  "\n"
+  "  #if defined(__clang__)\n"
+  "    #define RC_HOST        \"clang\"\n"
+  "  #elif defined(_MSC_VER)\n"
+  "    #define RC_HOST        \"MSVC\"\n"
+  "  #else\n"
+  "    #error \"Unsupported compiler\"\n"
+  "  #endif\n"
+  "\n"
+  "  #define RC_VERSION    $(VER_MAJOR),$(VER_MINOR),$(VER_PATCH),0\n"
+  "\n"
+  "  #ifdef _DEBUG\n"
+  "    #define RC_FILEFLAGS 1\n"
+  "    #define RC_DBG_REL   \", debug\"\n"
+  "  #else\n"
+  "    #define RC_FILEFLAGS 0\n"
+  "    #define RC_DBG_REL   \", release\"\n"
+  "  #endif\n"
+  "\n"
+  "  LANGUAGE  0x09,0x01\n"
+  "\n"
+  "  VS_VERSION_INFO VERSIONINFO\n"
+  "    FILEVERSION    RC_VERSION\n"
+  "    PRODUCTVERSION RC_VERSION\n"
+  "    FILEFLAGSMASK  0x3FL\n"
+  "    FILEOS         VOS__WINDOWS32\n"
+  "    FILETYPE       VFT_APP\n"
+  "    FILESUBTYPE    0x0L\n"
+  "    FILEFLAGS      RC_FILEFLAGS\n"
+  "\n"
+  "  BEGIN\n"
+  "    BLOCK \"StringFileInfo\"\n"
+  "    BEGIN\n"
+  "      BLOCK \"040904B0\"\n"
+  "      BEGIN\n"
+  "        VALUE \"CompanyName\",     \"http://www.foo.com/\"\n"
+  "        VALUE \"FileDescription\", \"foo-bar (\" RC_HOST RC_DBG_REL \").\"\n"
+  "        VALUE \"FileVersion\",     \"$(VERSION).\"\n"
+  "        VALUE \"InternalName\",    \"foo-bar.\"\n"
+  "        VALUE \"LegalCopyright\",  \"GNU GENERAL PUBLIC LICENSE v2 or comercial licence.\"\n"
+  "        VALUE \"Comments\",        \"Built on $(TODAY) by ...\"\n"
+  "      END\n"
+  "    END\n"
+  "\n"
+  "    BLOCK \"VarFileInfo\"\n"
+  "    BEGIN\n"
+  "      VALUE \"Translation\", 0x409, 1200\n"
+  "    END\n"
+  "  END\n"
+  "endef\n"
+  "\n"
+  "define cpp_filter_PY\n"
+  "  import sys, os\n"
+  "\n"
+  "  empty_lines = 0\n"
+  "  while True:\n"
+  "    line = sys.stdin.readline()\n"
+  "    if not line:\n"
+  "       break\n"
+  "    line = line.rstrip()\n"
+  "    if line == '':\n"
+  "       empty_lines += 1\n"
+  "       continue\n"
+  "\n"
+  "    #\n"
+  "    # MSVC or clang-cl 'line' directive\n"
+  "    #\n"
+  "    if line.startswith('#line') or line.startswith('# '):\n"
+  "       line = line.replace (r'\\\\', '/')\n"
+  "\n"
+  "    print (line)\n"
+  "\n"
+  "    #\n"
+  "    # Print a newline after a functions or structs\n"
+  "    #\n"
+  "    if line == '}' or line == '};':\n"
+  "       print ('')\n"
+  "\n"
+  "  print ('Removed %d empty lines.' % empty_lines, file=sys.stderr)\n"
+  "endef\n"
+  "\n"
+  "depend: $(GENERATED)\n"
+  "\t$(GEN_MAKE) --depend $(filter -I%, $(CFLAGS)) $(SOURCES) > .depend.Windows\n"
+  "\n"
+  "-include .depend.Windows\n";
+
+static const template_op ops[] = {
+  { TEMPL_TEXT,       0,   0,      0,    48,    0 }, 
+  { TEMPL_DIRECTIVE,'T',  29,     48,    32,    0 },   /* # Generated by 'gen-make' at %T. */
+  { TEMPL_TEXT,       0,   0,     81,   101,    0 }, 
+  { TEMPL_DIRECTIVE,'g',  13,    182,    15,    0 },   /* GEN_MAKE  := %g */
+  { TEMPL_TEXT,       0,   0,    198,   234,    0 }, 
+  { TEMPL_DIRECTIVE,'v',   0,    432,     2,    0 },   /* %v */
+  { TEMPL_TEXT,       0,   0,    435,    38,    0 }, 
+  { TEMPL_DIRECTIVE,'a',  17,    473,    19,    0 },   /* USE_ASTYLE    ?= %a */
+  { TEMPL_TEXT,       0,   0,    493,    57,    0 }, 
+  { TEMPL_IF,         0,   0,    550,    12,   14 },   /* tool.sccache */
+  { TEMPL_TEXT,       0,   0,    563,     9,    0 }, 
+  { TEMPL_VAR,        0,   0,    572,    20,    0 },   /* tool.sccache.version */
+  { TEMPL_TEXT,       0,   0,    593,    20,    0 }, 
+  { TEMPL_ELSE,       0,   0,      0,     0,   15 }, 
+  { TEMPL_TEXT,       0,   0,    613,    19,    0 }, 
+  { TEMPL_TEXT,       0,   0,    632,    41,    0 }, 
+  { TEMPL_DIRECTIVE,'t',  10,    673,    29,    0 },   /* TARGETS = %t   #! Change this */
+  { TEMPL_TEXT,       0,   0,    703,  1048,    0 }, 
+  { TEMPL_DIRECTIVE,'I',  48,   1751,    50,    0 },   /* CFLAGS += -D_WIN32_WINNT=0x0601 -DHAVE_CONFIG_H %I */
+  { TEMPL_TEXT,       0,   0,   1802,   867,    0 }, 
+  { TEMPL_DIRECTIVE,'s',  10,   2669,    12,    0 },   /* SOURCES = %s */
+  { TEMPL_TEXT,       0,   0,   2682,    89,    0 }, 
+  { TEMPL_DIRECTIVE,'u',   0,   2771,     2,    0 },   /* %u */
+  { TEMPL_TEXT,       0,   0,   2774,   233,    0 }, 
+  { TEMPL_DIRECTIVE,'H',   0,   3007,     2,    0 },   /* %H */
+  { TEMPL_TEXT,       0,   0,   3010,    50,    0 }, 
+  { TEMPL_DIRECTIVE,'P',  14,   3060,    16,    0 },   /* PCH_HEADERS = %P */
+  { TEMPL_TEXT,       0,   0,   3077,   245,    0 }, 
+  { TEMPL_DIRECTIVE,'A',   0,   3322,     2,    0 },   /* %A */
+  { TEMPL_TEXT,       0,   0,   3325,   479,    0 }, 
+  { TEMPL_DIRECTIVE,'m',   0,   3804,     2,    0 },   /* %m */
+  { TEMPL_DIRECTIVE,'M',   0,   3807,     2,    0 },   /* %M */
+  { TEMPL_DIRECTIVE,'c',   0,   3810,     2,    0 },   /* %c */
+  { TEMPL_TEXT,       0,   0,   3813,   511,    0 }, 
+  { TEMPL_DIRECTIVE,'h',   0,   4324,     2,    0 },   /* %h */
+  { TEMPL_TEXT,       0,   0,   4327,  5825,    0 }, 
 };
 
-const char *c_rule   = "$(OBJ_DIR)/%.obj: %.c | $(OBJ_DIR)\n\t$(call C_compile, $@, $<)\n";
-const char *cc_rule  = "$(OBJ_DIR)/%.obj: %.cc | $(OBJ_DIR)\n\t$(call C_compile, $@, $(CXXFLAGS) $<)\n";
-const char *cpp_rule = "$(OBJ_DIR)/%.obj: %.cpp | $(OBJ_DIR)\n\t$(call C_compile, $@, $(CXXFLAGS) $<)\n";
-const char *cxx_rule = "$(OBJ_DIR)/%.obj: %.cxx | $(OBJ_DIR)\n\t$(call C_compile, $@, $(CXXFLAGS) $<)\n";
+static const template_define defines[] = {
+  { "c_rule",
+    "$(OBJ_DIR)/%.obj: %.c | $(OBJ_DIR)\n"
+    "\t$(call C_compile, $@, $(PCH_CFLAGS) $<)\n"
+  },
+  { "cc_rule",
+    "$(OBJ_DIR)/%.obj: %.cc | $(OBJ_DIR)\n"
+    "\t$(call C_compile, $@, $(CXXFLAGS) $<)\n"
+  },
+  { "cpp_rule",
+    "$(OBJ_DIR)/%.obj: %.cpp | $(OBJ_DIR)\n"
+    "\t$(call C_compile, $@, $(CXXFLAGS) $<)\n"
+  },
+  { "cxx_rule",
+    "$(OBJ_DIR)/%.obj: %.cxx | $(OBJ_DIR)\n"
+    "\t$(call C_compile, $@, $(CXXFLAGS) $<)\n"
+  },
+  { "tools",
+    "kind     = msvc\n"
+    "cc       = cl\n"
+    "cxx      = cl\n"
+    "cflags   = -nologo -W3 -Zi -MD -Ot -I. -D_CRT_NONSTDC_NO_WARNINGS -D_CRT_OBSOLETE_NO_WARNINGS -D_CRT_SECURE_NO_DEPRECATE -D_CRT_SECURE_NO_WARNINGS -D_WIN32_WINNT=0x0601\n"
+    "cxxflags = -std:c++17 -TP -EHsc\n"
+    "ld       = link\n"
+    "ldflags  = -nologo -debug -incremental:no\n"
+    "libs     = ws2_32.lib\n"
+    "obj_dir  = objects\n"
+  }
+};
 
+const template_code make_template_windows = { ops, DIM(ops), text, sizeof(text) - 1, defines, DIM(defines), NULL };
@@ -0,0 +1,496 @@
+%%# The makefile template for MSVC and clang-cl. Compiled into 'template-windows.c'
+%%# by 'gen-template'. The first '%' on a line followed by one of these is replaced:
+%%#   %A -> a hint on the 'main()', 'WinMain()' or 'DllMain()' found.
+%%#   %a -> '1' if 'astyle.exe' is found on PATH. '0' otherwise. Like '%%if tool.astyle'.
+%%#   %c -> the .c/.cc/.cpp/.cxx -> object rule(s) from the '%%define'-s below.
+%%#   %g -> the path of gen-make.
+%%#   %H -> the .h.in-files to configure.
+%%#   %h -> the rules to configure them.
+%%#   %I -> the '-I' paths needed.
+%%#   %M -> the rules for the C++20 modules.
+%%#   %m -> the rules for option '--multi-target'.
+%%#   %P -> the headers for the precompiled header.
+%%#   %s -> the list of .c-files for the SOURCES line.
+%%#   %T -> the time stamp.
+%%#   %t -> the TARGETS; a .exe or a .dll.
+%%#   %u -> the unity batches.
+%%#   %v -> a VPATH statement if needed.
+%%#
+%%# The '#! gen-make begin/end X' lines mark what 'gen-make --update' replaces in
+%%# a hand-edited makefile.
+#
+# GNU Makefile for project X (MSVC+clang-cl).
+# Generated by 'gen-make' at %T.
+#
+THIS_FILE := $(firstword $(MAKEFILE_LIST))
+TODAY     := $(shell date +%d-%B-%Y)
+PYTHON    := py -3
+GEN_MAKE  := %g
+MAKEFLAGS += --warn-undefined-variables
+
+VER_MAJOR = 1  #! Change this
+VER_MINOR = 2  #! Change this
+VER_PATCH = 3  #! Change this
+VERSION   = $(strip $(VER_MAJOR)).$(strip $(VER_MINOR)).$(strip $(VER_PATCH))
+
+#! gen-make begin vpath
+%v
+#! gen-make end vpath
+
+#
+# Options:
+#
+USE_ASTYLE    ?= %a
+USE_OPENSSL   ?= 0
+USE_CRT_DEBUG ?= 0
+USE_PCH       ?= 0
+%%if tool.sccache
+#! Found %{tool.sccache.version}
+USE_SCCACHE   ?= 1
+%%else
+USE_SCCACHE   ?= 0
+%%endif
+USE_UNITY     ?= 0
+
+#
+# What to build:
+#
+TARGETS = %t   #! Change this
+
+#
+# Location of required packages
+#
+OPENSSL_ROOT = c:/dev/src/inet/Crypto/OpenSSL  #! Example requirement.
+MSVC_ROOT    = $(realpath $(VSINSTALLDIR))
+
+define Usage
+
+  Usage: $(MAKE) -f $(THIS_FILE) CC=[cl | clang-cl] [all | depend | clean | vclean | install]
+endef
+
+ifneq ($(CC),cl)
+  ifneq ($(CC),clang-cl)
+    $(error $(Usage))
+  endif
+endif
+
+OBJ_DIR = objects
+
+#
+# Undefine any '%CL%' env-var
+#
+export CL=
+
+#
+# Since 'clang-cl' could pick up some .h-files from this.
+# Just remove it.
+#
+export C_INCLUDE_PATH=
+
+c_to_obj   = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.c=.obj)))
+cc_to_obj  = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.cc=.obj)))
+cpp_to_obj = $(addprefix $(OBJ_DIR)/, $(notdir $(1:.cpp=.obj)))
+src_to_obj = $(addprefix $(OBJ_DIR)/, $(addsuffix .obj, $(notdir $(basename $(1)))))
+
+INSTALL_ROOT = $(VC_ROOT)
+
+CFLAGS = -nologo -W3 -Zi -I.         \
+         -I./$(OBJ_DIR)              \
+         -D_CRT_NONSTDC_NO_WARNINGS  \
+         -D_CRT_OBSOLETE_NO_WARNINGS \
+         -D_CRT_SECURE_NO_DEPRECATE  \
+         -D_CRT_SECURE_NO_WARNINGS
+
+CFLAGS += -D_WIN32_WINNT=0x0601 -DHAVE_CONFIG_H %I
+
+LDFLAGS = -nologo -debug -incremental:no -map -verbose
+RCFLAGS = -nologo
+
+ifeq ($(CC),clang-cl)
+  CFLAGS  += -fms-compatibility \
+             -ferror-limit=5
+  RCFLAGS += -D__clang__
+else
+  RCFLAGS += -D_MSC_VER
+endif
+
+ifeq ($(USE_CRT_DEBUG),1)
+  CFLAGS  += -MDd -Od -GF -GS -RTCs -RTCu -RTCc
+  RCFLAGS += -D_DEBUG
+else
+  CFLAGS += -MD -Ot
+endif
+
+ifeq ($(USE_SCCACHE),1)
+  #
+  # 'sccache' can not cache with a '-Zi' .pdb-file shared by all objects.
+  #
+  CFLAGS     := $(subst -Zi,-Z7,$(CFLAGS))
+  CC_LAUNCHER = sccache
+else
+  CC_LAUNCHER =
+endif
+
+CXXFLAGS = -std:c++17 -TP -EHsc  #! CFLAGS for C++
+
+EX_LIBS += ws2_32.lib  #! Add more libs as needed
+
+ifeq ($(USE_OPENSSL),1)
+  CFLAGS  += -DHAVE_OPENSSL -DOPENSSL_USE_DEPRECATED -I$(OPENSSL_ROOT)/include
+  EX_LIBS += $(OPENSSL_ROOT)/lib/libssl.lib $(OPENSSL_ROOT)/lib/libcrypto.lib
+endif
+
+#! gen-make begin sources
+SOURCES = %s
+#! gen-make end sources
+
+OBJECTS = $(call c_to_obj, $(SOURCES))
+
+#! gen-make begin unity
+%u
+#! gen-make end unity
+
+ifeq ($(USE_UNITY),1)
+  OBJECTS = $(foreach n, $(UNITY_BATCHES), $(OBJ_DIR)/unity_$(n).obj) \
+            $(call c_to_obj, $(UNITY_EXCLUDE))
+endif
+
+GENERATED = $(OBJ_DIR)/config.h
+
+#! gen-make begin configured
+%H
+#! gen-make end configured
+
+#! gen-make begin pch
+PCH_HEADERS = %P
+#! gen-make end pch
+
+PCH_CFLAGS =
+
+ifeq ($(USE_PCH),1)
+  ifneq ($(PCH_HEADERS),)
+    PCH_CFLAGS = -Yu$(OBJ_DIR)/pch.h -FI$(OBJ_DIR)/pch.h -Fp$(OBJ_DIR)/pch.pch
+    OBJECTS   += $(OBJ_DIR)/pch.obj
+    GENERATED += $(OBJ_DIR)/pch.h
+  endif
+endif
+
+%A
+all: $(GENERATED) $(TARGETS)
+	$(call green_msg, Welcome to 'TARGETS' (CC=$(CC)).)
+
+$(OBJ_DIR) bin lib:
+	mkdir --parents $(OBJ_DIR)
+
+bin/foo.exe: $(OBJECTS) | bin #! maybe add a '$(OBJ_DIR)/foo.res' here?
+	$(call link_EXE, $@, $^ $(EX_LIBS))
+
+#
+#! Unless the '$(OBJECTS)' exports something, this could create no 'lib/foo_imp.lib' file.
+#
+lib/foo_imp.lib: bin/foo.dll
+bin/foo.dll: $(OBJECTS) | bin lib
+	$(call link_DLL, $@, $^ $(EX_LIBS), lib/foo_imp.lib)
+
+#! gen-make begin rules
+%m
+%M
+%c
+#! gen-make end rules
+#
+# Link $(TARGETS) with this instead?
+#! After a build, 'gen-make --analyze-objects' writes a 'LIB_OBJ' with only the objects needed.
+#
+LIB_OBJ ?=
+
+lib/foo.lib: $(LIB_OBJ) | lib
+	$(call create_static_lib, $@, $(LIB_OBJ))
+
+$(OBJ_DIR)/%.res: %.rc | $(OBJ_DIR)
+	$(call create_res_file, $@, $<)
+
+ifeq ($(filter $(OBJ_DIR)/config.h, $(CONFIGURED_H)),)
+$(OBJ_DIR)/config.h: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@,//)
+	$(file >> $@,$(CONFIG_H))
+endif
+
+#! gen-make begin configure-rules
+%h
+#! gen-make end configure-rules
+#
+# Create the precompiled header from an empty .c-file.
+# All the other objects depends on it.
+#
+$(OBJ_DIR)/pch.h: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@,//)
+	$(foreach h, $(PCH_HEADERS), $(file >> $@,#include $(h)))
+
+$(OBJ_DIR)/pch.obj: $(GENERATED)
+	$(file > $(OBJ_DIR)/pch.c,/* For $(OBJ_DIR)/pch.pch */)
+	$(call C_compile, $@, -Yc$(OBJ_DIR)/pch.h -FI$(OBJ_DIR)/pch.h -Fp$(OBJ_DIR)/pch.pch $(OBJ_DIR)/pch.c)
+
+ifneq ($(PCH_CFLAGS),)
+  $(filter-out $(OBJ_DIR)/pch.obj, $(OBJECTS)): $(OBJ_DIR)/pch.obj
+endif
+
+#
+# A 'unity_N.c' file includes the sources in '$(UNITY_N)'.
+#
+$(OBJ_DIR)/unity_%.c: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@,//)
+	$(foreach f, $(UNITY_$*), $(file >> $@,#include "$(f)"))
+
+.PRECIOUS: $(OBJ_DIR)/unity_%.c
+.SECONDEXPANSION:
+
+$(OBJ_DIR)/unity_%.obj: $(OBJ_DIR)/unity_%.c $$(UNITY_$$*) | $(OBJ_DIR)
+	$(call C_compile, $@, $(PCH_CFLAGS) $<)
+
+$(OBJ_DIR)/foo.rc: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@,//)
+	$(file >> $@,$(FOO_RC))
+
+install: $(TARGETS)
+	cp --update $(TARGETS) $(TARGETS:.exe=.pdb) $(INSTALL_ROOT)/bin
+	@echo
+
+clean:
+	rm -f $(GENERATED) link.tmp
+	rm -fr $(OBJ_DIR)
+
+vclean realclean: clean
+	rm -f .depend.Windows .gen-make.cache .gen-make.merkle .gen-make.probe
+	rm -fr bin lib
+
+%.i: %.c $(OBJ_DIR)/cpp-filter.py $(GENERATED) FORCE
+	$(call C_preprocess, $@, $<)
+
+FORCE:
+
+$(OBJ_DIR)/cpp-filter.py: $(THIS_FILE) | $(OBJ_DIR)
+	$(call generate, $@, #)
+	$(file >> $@,if 1:)
+	$(file >> $@,$(cpp_filter_PY))
+
+#
+# GNU-make macros:
+#
+# This assumes you have CygWin/Msys's 'echo' with colour support.
+#
+BRIGHT_GREEN = \e[1;32m
+BRIGHT_WHITE = \e[1;37m
+
+colour_msg = @echo -e "$(1)\e[0m"
+green_msg  = $(call colour_msg,$(BRIGHT_GREEN)$(strip $(1)))
+
+define generate
+  $(call green_msg, Generating $(1))
+  $(file > $(1),$(call Warning,$(2)))
+endef
+
+define Warning
+  $(1)
+  $(1) DO NOT EDIT! This file was automatically generated
+  $(1) from $(realpath $(THIS_FILE)) at $(TODAY). Edit that file instead.
+  $(1)
+endef
+
+define create_resp_file
+  $(file > $(1))
+  $(foreach f, $(2), $(file >> $(1),$(strip $(f))) )
+endef
+
+define C_compile
+  $(CC_LAUNCHER) $(CC) -c $(CFLAGS) -Fo./$(strip $(1) $(2))
+  @echo
+endef
+
+define link_EXE
+  $(call green_msg, Linking $(1))
+  link $(LDFLAGS) -out:$(strip $(1)) $(2) > link.tmp
+  @cat link.tmp >> $(1:.exe=.map)
+  @echo
+endef
+
+define link_DLL
+  $(call green_msg, Linking $(1))
+  link $(LDFLAGS) -dll -out:$(strip $(1)) -implib:$(strip $(3)) $(2) > link.tmp
+  @cat link.tmp >> $(1:.dll=.map)
+  @rm -f $(3:.lib=.exp)
+  @echo
+endef
+
+define create_static_lib
+  $(call green_msg, Creating static library $(1))
+  rm -f $(1)
+  lib -nologo -out:$(strip $(1)) -machine:$(CPU) $(2)
+  @echo
+endef
+
+define create_res_file
+  $(call green_msg, Creating $(1))
+  rc $(RCFLAGS) -Fo./$(strip $(1)) $(2)
+  @echo
+endef
+
+#
+# clang-cl: /d1PP  Retain macro definitions in /E mode
+#
+ifeq ($(CC),clang-cl)
+  d1PP = -d1PP
+else
+  d1PP =
+endif
+
+ifeq ($(USE_ASTYLE),1)
+  pp_filter  = | astyle
+  pp_comment = The preprocessed and Astyled output of $(strip $(1))
+else
+  pp_filter  =
+  pp_comment = The raw preprocessed output of $(strip $(1))
+endif
+
+define C_preprocess
+  $(file  > $(1), /* $(call pp_comment, $(2)) */)
+  $(file >> $(1),  * $(CC) -E)
+  $(foreach f, $(CFLAGS), $(file >> $(1),  *   $(f)))
+  $(file >> $(1), ---------------------------------)
+  $(file >> $(1),  */)
+  $(CC) -E $(CFLAGS) $(d1PP) $(2) | $(PYTHON) $(OBJ_DIR)/cpp-filter.py $(pp_filter) >> $(1)
+endef
+
+define CONFIG_H
+  #pragma once
+  #define WIN32_LEAN_AND_MEAN
+
+  #ifndef _CRT_NONSTDC_NO_WARNINGS
+  #define _CRT_NONSTDC_NO_WARNINGS
+  #endif
+  #ifndef _CRT_OBSOLETE_NO_WARNINGS
+  #define _CRT_OBSOLETE_NO_WARNINGS
+  #endif
+  #ifndef _CRT_SECURE_NO_DEPRECATE
+  #define _CRT_SECURE_NO_DEPRECATE
+  #endif
+  #ifndef _CRT_SECURE_NO_WARNINGS
+  #define _CRT_SECURE_NO_WARNINGS
+  #endif
+  /* !Add more stuff here... */
+endef
+
+define FOO_RC
+  #include <winver.h>
+
+  #if defined(__clang__)
+    #define RC_HOST        "clang"
+  #elif defined(_MSC_VER)
+    #define RC_HOST        "MSVC"
+  #else
+    #error "Unsupported compiler"
+  #endif
+
+  #define RC_VERSION    $(VER_MAJOR),$(VER_MINOR),$(VER_PATCH),0
+
+  #ifdef _DEBUG
+    #define RC_FILEFLAGS 1
+    #define RC_DBG_REL   ", debug"
+  #else
+    #define RC_FILEFLAGS 0
+    #define RC_DBG_REL   ", release"
+  #endif
+
+  LANGUAGE  0x09,0x01
+
+  VS_VERSION_INFO VERSIONINFO
+    FILEVERSION    RC_VERSION
+    PRODUCTVERSION RC_VERSION
+    FILEFLAGSMASK  0x3FL
+    FILEOS         VOS__WINDOWS32
+    FILETYPE       VFT_APP
+    FILESUBTYPE    0x0L
+    FILEFLAGS      RC_FILEFLAGS
+
+  BEGIN
+    BLOCK "StringFileInfo"
+    BEGIN
+      BLOCK "040904B0"
+      BEGIN
+        VALUE "CompanyName",     "http://www.foo.com/"
+        VALUE "FileDescription", "foo-bar (" RC_HOST RC_DBG_REL ")."
+        VALUE "FileVersion",     "$(VERSION)."
+        VALUE "InternalName",    "foo-bar."
+        VALUE "LegalCopyright",  "GNU GENERAL PUBLIC LICENSE v2 or comercial licence."
+        VALUE "Comments",        "Built on $(TODAY) by ..."
+      END
+    END
+
+    BLOCK "VarFileInfo"
+    BEGIN
+      VALUE "Translation", 0x409, 1200
+    END
+  END
+endef
+
+define cpp_filter_PY
+  import sys, os
+
+  empty_lines = 0
+  while True:
+    line = sys.stdin.readline()
+    if not line:
+       break
+    line = line.rstrip()
+    if line == '':
+       empty_lines += 1
+       continue
+
+    #
+    # MSVC or clang-cl 'line' directive
+    #
+    if line.startswith('#line') or line.startswith('# '):
+       line = line.replace (r'\\', '/')
+
+    print (line)
+
+    #
+    # Print a newline after a functions or structs
+    #
+    if line == '}' or line == '};':
+       print ('')
+
+  print ('Removed %d empty lines.' % empty_lines, file=sys.stderr)
+endef
+
+depend: $(GENERATED)
+	$(GEN_MAKE) --depend $(filter -I%, $(CFLAGS)) $(SOURCES) > .depend.Windows
+
+-include .depend.Windows
+%%define c_rule
+$(OBJ_DIR)/%.obj: %.c | $(OBJ_DIR)
+	$(call C_compile, $@, $(PCH_CFLAGS) $<)
+%%end
+%%define cc_rule
+$(OBJ_DIR)/%.obj: %.cc | $(OBJ_DIR)
+	$(call C_compile, $@, $(CXXFLAGS) $<)
+%%end
+%%define cpp_rule
+$(OBJ_DIR)/%.obj: %.cpp | $(OBJ_DIR)
+	$(call C_compile, $@, $(CXXFLAGS) $<)
+%%end
+%%define cxx_rule
+$(OBJ_DIR)/%.obj: %.cxx | $(OBJ_DIR)
+	$(call C_compile, $@, $(CXXFLAGS) $<)
+%%end
+%%# The toolchain for the other backends; like '--emit ninja'. See 'tools.c'.
+%%define tools
+kind     = msvc
+cc       = cl
+cxx      = cl
+cflags   = -nologo -W3 -Zi -MD -Ot -I. -D_CRT_NONSTDC_NO_WARNINGS -D_CRT_OBSOLETE_NO_WARNINGS -D_CRT_SECURE_NO_DEPRECATE -D_CRT_SECURE_NO_WARNINGS -D_WIN32_WINNT=0x0601
+cxxflags = -std:c++17 -TP -EHsc
+ld       = link
+ldflags  = -nologo -debug -incremental:no
+libs     = ws2_32.lib
+obj_dir  = objects
+%%end
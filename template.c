@@ -0,0 +1,667 @@
+/*
+ * Makefile templates for the gen-make program.
+ *
+ * A template is plain makefile text. The first '%' on a line followed by
+ * one of the 'TEMPL_DIRECTIVES' is replaced by what gen-make found. On
+ * other lines a '%{name}' is replaced by the value of a variable. Lines
+ * starting with '%%' are for the template compiler:
+ *   %%# comment
+ *   %%if [!]name ... [%%else ...] %%endif   -> true if 'name' is set and not "" or "0".
+ *   %%for var in list ... %%endfor          -> '%{var}' is each file in 'list'; like "c" for
+ *                                              the .c-files. '%{var.base}' and '%{var.dir}'
+ *                                              are the base-name (no suffix) and the directory.
+ *   %%include file                          -> relative to this template.
+ *   %%define name ... %%end                 -> a 'const char *name' with these lines (only
+ *                                              for 'gen-template').
+ *
+ * 'template_compile()' turns a template into an array of 'template_op'.
+ * Consecutive literal lines become one span of text. So 'template_run()'
+ * does no parsing; it writes the spans, looks up the variables and calls
+ * the directive handlers from a table. The 'gen-template' program does the
+ * compile at build-time and writes the result as C; 'template-windows.c'
+ * is made that way from 'template-windows.mk'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "template.h"
+
+/*
+ * An open '%%if', '%%else' or '%%for' block.
+ */
+typedef struct block {
+        int    opcode;
+        size_t op_idx;
+      } block;
+
+typedef struct compiler {
+        const char  *fname;
+        unsigned     line_num;
+        template_op *ops;
+        size_t       num_ops;
+        size_t       max_ops;
+        size_t       join_from;   /* a literal may only join a span from here on */
+        char        *text;
+        size_t       text_size;
+        size_t       text_max;
+        block        blocks [TEMPL_MAX_DEPTH];
+        int          num_blocks;
+      } compiler;
+
+static size_t add_text (compiler *c, const char *str, size_t len)
+{
+  size_t offset = c->text_size;
+
+  if (c->text_size + len + 1 > c->text_max)
+  {
+    c->text_max = 2 * (c->text_size + len + 1);
+    c->text = realloc (c->text, c->text_max);
+    assert (c->text);
+  }
+  memcpy (c->text + c->text_size, str, len);
+  c->text_size += len;
+  c->text [c->text_size] = '\0';
+  return (offset);
+}
+
+static template_op *add_op (compiler *c, int opcode)
+{
+  template_op *op;
+
+  if (c->num_ops == c->max_ops)
+  {
+    c->max_ops = c->max_ops ? 2 * c->max_ops : 64;
+    c->ops = realloc (c->ops, c->max_ops * sizeof(*c->ops));
+    assert (c->ops);
+  }
+  op = c->ops + c->num_ops++;
+  memset (op, '\0', sizeof(*op));
+  op->opcode = opcode;
+  return (op);
+}
+
+/*
+ * Add an op with a 0-terminated string.
+ */
+static template_op *add_string_op (compiler *c, int opcode, const char *str, size_t len)
+{
+  template_op *op = add_op (c, opcode);
+
+  op->len    = (uint32_t) len;
+  op->offset = (uint32_t) add_text (c, str, len);
+  add_text (c, "", 1);   /* keep the '\0' */
+  return (op);
+}
+
+/*
+ * Add literal text; join it with the previous span if that ends here.
+ */
+static void add_literal (compiler *c, const char *str, size_t len)
+{
+  template_op *last = c->num_ops > c->join_from ? c->ops + c->num_ops - 1 : NULL;
+  size_t       offset = add_text (c, str, len);
+
+  if (last && last->opcode == TEMPL_TEXT && last->offset + last->len == offset)
+  {
+    last->len += (uint32_t) len;
+    return;
+  }
+  last = add_op (c, TEMPL_TEXT);
+  last->offset = (uint32_t) offset;
+  last->len    = (uint32_t) len;
+}
+
+static size_t name_len (const char *str, const char *end)
+{
+  const char *p = str;
+
+  while (p < end && (isalnum((int)*p) || *p == '_' || *p == '.'))
+        p++;
+  return (p - str);
+}
+
+/*
+ * Compile a line with no directive; the '%{name}' in it become variables.
+ */
+static void compile_vars (compiler *c, const char *line, size_t len)
+{
+  const char *p = line, *end = line + len;
+
+  while (p < end)
+  {
+    const char *var = memchr (p, '%', end - p);
+    size_t      n;
+
+    if (!var)
+       break;
+    if (var + 2 < end && var[1] == '{')
+    {
+      n = name_len (var + 2, end);
+      if (n > 0 && var + 2 + n < end && var[2+n] == '}')
+      {
+        add_literal (c, p, var - p);
+        add_string_op (c, TEMPL_VAR, var + 2, n);
+        p = var + 3 + n;
+        continue;
+      }
+    }
+    add_literal (c, p, var + 1 - p);
+    p = var + 1;
+  }
+  add_literal (c, p, end - p);
+}
+
+static void compile_line (compiler *c, const char *line, size_t len)
+{
+  const char  *p = memchr (line, '%', len);
+  template_op *op;
+
+  if (!p || p + 1 >= line + len || !p[1] || !strchr(TEMPL_DIRECTIVES, p[1]))
+  {
+    compile_vars (c, line, len);
+    add_literal (c, "\n", 1);
+    return;
+  }
+
+  op = add_string_op (c, TEMPL_DIRECTIVE, line, len);
+  op->directive = p[1];
+  op->indent    = (uint16_t) (p - line);
+
+  if (strchr(TEMPL_PREFIX_DIRECTIVES, p[1]))
+     compile_line (c, p + 2, len - (p + 2 - line));
+}
+
+static bool push_block (compiler *c, int opcode)
+{
+  if (c->num_blocks == TEMPL_MAX_DEPTH)
+  {
+    fprintf (stderr, "%s(%u): too deeply nested.\n", c->fname, c->line_num);
+    return (false);
+  }
+  c->blocks [c->num_blocks].opcode = opcode;
+  c->blocks [c->num_blocks].op_idx = c->num_ops - 1;
+  c->num_blocks++;
+  return (true);
+}
+
+/*
+ * Close the open block; it must be one of 'opcode1' or 'opcode2'.
+ */
+static block *pop_block (compiler *c, const char *what, int opcode1, int opcode2)
+{
+  block *b;
+
+  if (c->num_blocks == 0 ||
+      (c->blocks[c->num_blocks-1].opcode != opcode1 && c->blocks[c->num_blocks-1].opcode != opcode2))
+  {
+    fprintf (stderr, "%s(%u): unexpected '%%%%%s'.\n", c->fname, c->line_num, what);
+    return (NULL);
+  }
+  b = c->blocks + --c->num_blocks;
+  c->join_from = c->num_ops;
+  return (b);
+}
+
+static bool compile_meta (compiler *c, const char *line, size_t len, template_define **define)
+{
+  const char *end = line + len;
+  const char *word = line + 2;
+  const char *arg;
+  size_t      word_len = name_len (word, end);
+  size_t      arg_len;
+  block      *b;
+
+  if (len >= 3 && line[2] == '#')
+     return (true);
+
+  arg = word + word_len;
+  while (arg < end && (*arg == ' ' || *arg == '\t'))
+        arg++;
+  while (end > arg && (end[-1] == ' ' || end[-1] == '\t'))
+        end--;
+  arg_len = end - arg;
+
+#define IS_WORD(w)  (word_len == sizeof(w) - 1 && !strncmp(word, w, word_len))
+
+  if (*define && !IS_WORD("end"))
+  {
+    fprintf (stderr, "%s(%u): '%.*s' in a '%%%%define'.\n", c->fname, c->line_num, (int)len, line);
+    return (false);
+  }
+
+  if (IS_WORD("define") && arg_len > 0)
+  {
+    *define = calloc (1, sizeof(**define));
+    assert (*define);
+    (*define)->name = malloc (arg_len + 1);
+    assert ((*define)->name);
+    memcpy ((*define)->name, arg, arg_len);
+    (*define)->name [arg_len] = '\0';
+    (*define)->value = strdup ("");
+    return (true);
+  }
+
+  if (IS_WORD("end"))
+  {
+    if (!*define)
+    {
+      fprintf (stderr, "%s(%u): '%%%%end' without a '%%%%define'.\n", c->fname, c->line_num);
+      return (false);
+    }
+    *define = NULL;
+    return (true);
+  }
+
+  if (IS_WORD("if") && arg_len > 0)
+  {
+    add_string_op (c, TEMPL_IF, arg, arg_len);
+    return push_block (c, TEMPL_IF);
+  }
+
+  if (IS_WORD("else"))
+  {
+    b = pop_block (c, "else", TEMPL_IF, 0);
+    if (!b)
+       return (false);
+    add_op (c, TEMPL_ELSE);
+    c->ops [b->op_idx].jump = (uint32_t) c->num_ops;
+    c->join_from = c->num_ops;
+    return push_block (c, TEMPL_ELSE);
+  }
+
+  if (IS_WORD("endif"))
+  {
+    b = pop_block (c, "endif", TEMPL_IF, TEMPL_ELSE);
+    if (!b)
+       return (false);
+    c->ops [b->op_idx].jump = (uint32_t) c->num_ops;
+    return (true);
+  }
+
+  if (IS_WORD("for") && arg_len > 0)
+  {
+    const char *var = arg;
+    size_t      var_len = name_len (var, end);
+    const char *in = var + var_len;
+    char        buf [200];
+
+    while (in < end && *in == ' ')
+          in++;
+    if (var_len == 0 || var_len + arg_len + 2 > sizeof(buf) || end - in < 4 || strncmp(in, "in ", 3))
+    {
+      fprintf (stderr, "%s(%u): expected '%%%%for var in list'.\n", c->fname, c->line_num);
+      return (false);
+    }
+    in += 3;
+    while (in < end && *in == ' ')
+          in++;
+
+    /* Store it as "var\0list".
+     */
+    memcpy (buf, var, var_len);
+    buf [var_len] = '\0';
+    memcpy (buf + var_len + 1, in, end - in);
+    add_string_op (c, TEMPL_FOR, buf, var_len + 1 + (end - in));
+    c->join_from = c->num_ops;
+    return push_block (c, TEMPL_FOR);
+  }
+
+  if (IS_WORD("endfor"))
+  {
+    b = pop_block (c, "endfor", TEMPL_FOR, 0);
+    if (!b)
+       return (false);
+    add_op (c, TEMPL_ENDFOR)->jump = (uint32_t) b->op_idx;
+    c->ops [b->op_idx].jump = (uint32_t) c->num_ops;
+    c->join_from = c->num_ops;
+    return (true);
+  }
+
+  if (IS_WORD("include") && arg_len > 0)
+  {
+    add_string_op (c, TEMPL_INCLUDE, arg, arg_len);
+    return (true);
+  }
+
+#undef IS_WORD
+
+  fprintf (stderr, "%s(%u): unknown '%.*s'.\n", c->fname, c->line_num, (int)len, line);
+  return (false);
+}
+
+static void append_define (template_define *d, const char *line, size_t len)
+{
+  size_t old_len = strlen (d->value);
+
+  d->value = realloc (d->value, old_len + len + 2);
+  assert (d->value);
+  memcpy (d->value + old_len, line, len);
+  d->value [old_len + len]     = '\n';
+  d->value [old_len + len + 1] = '\0';
+}
+
+
+/*
+ * Compile the template in 'data'. 'fname' is for the error messages
+ * and the '%%include' files. Returns NULL on error.
+ */
+template_code *template_compile (const char *data, size_t size, const char *fname)
+{
+  template_code   *tc;
+  template_define *define = NULL;
+  smartlist_t     *defines = smartlist_new();
+  compiler         c;
+  const char      *p = data, *end = data + size;
+  bool             ok = true;
+  int              i;
+
+  memset (&c, '\0', sizeof(c));
+  c.fname = fname;
+
+  while (ok && p < end)
+  {
+    const char *eol = memchr (p, '\n', end - p);
+    const char *next;
+    size_t      len;
+
+    if (!eol)
+         next = eol = end;
+    else next = eol + 1;
+    if (eol > p && eol[-1] == '\r')
+       eol--;
+    len = eol - p;
+    c.line_num++;
+
+    if (len >= 2 && p[0] == '%' && p[1] == '%')
+    {
+      template_define *prev = define;
+
+      ok = compile_meta (&c, p, len, &define);
+      if (define && !prev)
+         smartlist_add (defines, define);
+    }
+    else if (define)
+      append_define (define, p, len);
+    else
+      compile_line (&c, p, len);
+    p = next;
+  }
+
+  if (ok && define)
+  {
+    fprintf (stderr, "%s(%u): no '%%%%end' for '%%%%define %s'.\n", fname, c.line_num, define->name);
+    ok = false;
+  }
+  if (ok && c.num_blocks > 0)
+  {
+    fprintf (stderr, "%s(%u): no '%%%%%s' at the end.\n", fname, c.line_num,
+             c.blocks[c.num_blocks-1].opcode == TEMPL_FOR ? "endfor" : "endif");
+    ok = false;
+  }
+  if (!ok)
+  {
+    for (i = 0; i < smartlist_len(defines); i++)
+    {
+      define = smartlist_get (defines, i);
+      free (define->name);
+      free (define->value);
+    }
+    smartlist_free_all (defines);
+    free (c.ops);
+    free (c.text);
+    return (NULL);
+  }
+
+  tc = calloc (1, sizeof(*tc));
+  assert (tc);
+  tc->ops       = c.ops;
+  tc->num_ops   = c.num_ops;
+  tc->text      = c.text ? c.text : strdup ("");
+  tc->text_size = c.text_size;
+  tc->fname     = strdup (fname);
+
+  /* The '%%define' blocks as an array; like in a built-in template.
+   */
+  if (smartlist_len(defines) > 0)
+  {
+    template_define *arr = calloc (smartlist_len(defines), sizeof(*arr));
+
+    assert (arr);
+    for (i = 0; i < smartlist_len(defines); i++)
+        arr [i] = *(const template_define*) smartlist_get (defines, i);
+    tc->defines     = arr;
+    tc->num_defines = smartlist_len (defines);
+  }
+  smartlist_free_all (defines);
+  DEBUG (1, "Compiled '%s'; %u lines into %zu ops and %zu bytes of text.\n", fname, c.line_num, c.num_ops, c.text_size);
+  return (tc);
+}
+
+/*
+ * A running '%%for' loop.
+ */
+typedef struct run_loop {
+        const char        *var;
+        const smartlist_t *list;
+        int                idx;
+      } run_loop;
+
+typedef struct run_state {
+        const template_env *env;
+        template_func       funcs [256];
+        run_loop            loops [TEMPL_MAX_DEPTH];
+        int                 num_loops;
+        int                 depth;
+        char                buf [_MAX_PATH];
+      } run_state;
+
+/*
+ * Return the value of 'name'. A loop variable first; then from the program.
+ */
+static const char *get_value (run_state *rs, const char *name)
+{
+  int i;
+
+  for (i = rs->num_loops - 1; i >= 0; i--)
+  {
+    const run_loop *l   = rs->loops + i;
+    const char     *val = smartlist_get (l->list, l->idx);
+    size_t          len = strlen (l->var);
+    const char     *slash, *dot;
+
+    if (strncmp(name, l->var, len) || (name[len] && name[len] != '.'))
+       continue;
+    if (!name[len])
+       return (val);
+
+    slash = strrchr (val, '/');
+    if (!strcmp(name + len, ".dir"))
+    {
+      if (!slash)
+           snprintf (rs->buf, sizeof(rs->buf), ".");
+      else snprintf (rs->buf, sizeof(rs->buf), "%.*s", (int)(slash - val), val);
+      return (rs->buf);
+    }
+    if (!strcmp(name + len, ".base"))
+    {
+      val = slash ? slash + 1 : val;
+      dot = strrchr (val, '.');
+      snprintf (rs->buf, sizeof(rs->buf), "%.*s", dot ? (int)(dot - val) : (int)strlen(val), val);
+      return (rs->buf);
+    }
+  }
+  return (rs->env->get_var ? (*rs->env->get_var) (rs->env->arg, name) : NULL);
+}
+
+static bool is_true (run_state *rs, const char *name)
+{
+  bool        negate = (*name == '!');
+  const char *val = get_value (rs, negate ? name + 1 : name);
+  bool        set = (val && *val && strcmp(val, "0"));
+
+  return (negate ? !set : set);
+}
+
+static void run_include (run_state *rs, const template_code *tc, const char *name, out_buf *out);
+
+static void run_code (run_state *rs, const template_code *tc, out_buf *out)
+{
+  size_t i = 0;
+
+  while (i < tc->num_ops)
+  {
+    const template_op *op   = tc->ops + i;
+    const char        *text = tc->text + op->offset;
+    const char        *val;
+    run_loop          *l;
+
+    switch (op->opcode)
+    {
+      case TEMPL_TEXT:
+           buf_add (out, text, op->len);
+           break;
+
+      case TEMPL_DIRECTIVE:
+           if (rs->funcs[op->directive])
+                (*rs->funcs[op->directive]) (rs->env->arg, out, text, text + op->indent + 2);
+           else buf_printf (out, "%s\n", text);
+           break;
+
+      case TEMPL_VAR:
+           val = get_value (rs, text);
+           if (val)
+                buf_puts (out, val);
+           else DEBUG (1, "%s: variable '%s' is not set.\n", tc->fname ? tc->fname : "template", text);
+           break;
+
+      case TEMPL_IF:
+           if (!is_true(rs, text))
+           {
+             i = op->jump;
+             continue;
+           }
+           break;
+
+      case TEMPL_ELSE:
+           i = op->jump;
+           continue;
+
+      case TEMPL_FOR:
+           l = rs->loops + rs->num_loops;
+           l->var  = text;
+           l->list = rs->env->get_list ? (*rs->env->get_list) (rs->env->arg, text + strlen(text) + 1) : NULL;
+           l->idx  = 0;
+           if (!l->list || smartlist_len(l->list) == 0 || rs->num_loops == TEMPL_MAX_DEPTH - 1)
+           {
+             i = op->jump;
+             continue;
+           }
+           rs->num_loops++;
+           break;
+
+      case TEMPL_ENDFOR:
+           l = rs->loops + rs->num_loops - 1;
+           if (++l->idx < smartlist_len(l->list))
+           {
+             i = op->jump + 1;
+             continue;
+           }
+           rs->num_loops--;
+           break;
+
+      case TEMPL_INCLUDE:
+           run_include (rs, tc, text, out);
+           break;
+    }
+    i++;
+  }
+}
+
+/*
+ * Run the template 'name'; relative to the directory of 'tc'.
+ */
+static void run_include (run_state *rs, const template_code *tc, const char *name, out_buf *out)
+{
+  const template_code *inc;
+  const char          *slash = tc->fname ? strrchr (tc->fname, '/') : NULL;
+  const char          *bslash = tc->fname ? strrchr (tc->fname, '\\') : NULL;
+  char                 path [_MAX_PATH];
+
+  if (bslash > slash)
+     slash = bslash;
+  if (slash && name[0] != '/' && name[0] != '\\' && !strchr(name, ':'))
+       snprintf (path, sizeof(path), "%.*s/%s", (int)(slash - tc->fname), tc->fname, name);
+  else snprintf (path, sizeof(path), "%s", name);
+
+  if (rs->depth == TEMPL_MAX_DEPTH)
+  {
+    fprintf (stderr, "%s: includes nested too deep.\n", path);
+    return;
+  }
+  inc = rs->env->load ? (*rs->env->load) (path) : NULL;
+  if (!inc)
+  {
+    fprintf (stderr, "%s: failed to include '%s'.\n", tc->fname ? tc->fname : "template", path);
+    return;
+  }
+  rs->depth++;
+  run_code (rs, inc, out);
+  rs->depth--;
+}
+
+/*
+ * Write the template; a literal span as-is, a directive by it's handler in
+ * 'env->directives' and a variable from 'env->get_var()'. A directive without
+ * a handler is written as-is.
+ */
+void template_run (const template_code *tc, out_buf *out, const template_env *env)
+{
+  run_state *rs = calloc (1, sizeof(*rs));
+  size_t     i;
+
+  assert (rs);
+  rs->env = env;
+  for (i = 0; i < env->num_directives; i++)
+      rs->funcs [env->directives[i].directive & 255] = env->directives[i].func;
+  run_code (rs, tc, out);
+  free (rs);
+}
+
+/*
+ * Free a template from 'template_compile()'.
+ */
+void template_free (template_code *tc)
+{
+  size_t i;
+
+  if (!tc)
+     return;
+  free ((void*)tc->ops);
+  free ((void*)tc->text);
+  free ((void*)tc->fname);
+  for (i = 0; i < tc->num_defines; i++)
+  {
+    free (tc->defines[i].name);
+    free (tc->defines[i].value);
+  }
+  free ((void*)tc->defines);
+  free (tc);
+}
+
+/*
+ * Return the value of the '%%define name' block in 'tc'. Or NULL.
+ */
+const char *template_get_define (const template_code *tc, const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < tc->num_defines; i++)
+      if (!strcmp(tc->defines[i].name, name))
+         return (tc->defines[i].value);
+  return (NULL);
+}
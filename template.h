@@ -0,0 +1,101 @@
+#ifndef _TEMPLATE_H
+#define _TEMPLATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "smartlist.h"
+#include "outbuf.h"
+
+/*
+ * The letters 'x' of a '%x' directive. Only the first '%' on a line can be one.
+ */
+#define TEMPL_DIRECTIVES  "AacgHhIMmPsTtuv"
+
+/*
+ * The rest of the line after these is compiled as a line of it's own.
+ */
+#define TEMPL_PREFIX_DIRECTIVES  "c"
+
+/*
+ * Max nesting of '%%for' loops and of '%%include' files.
+ */
+#define TEMPL_MAX_DEPTH  16
+
+enum template_opcode {
+     TEMPL_TEXT = 1,     /* write 'len' bytes at 'offset' */
+     TEMPL_DIRECTIVE,    /* call the handler of 'directive' for the line at 'offset' */
+     TEMPL_VAR,          /* write the value of the variable at 'offset' */
+     TEMPL_IF,           /* if the variable at 'offset' is false; go to 'jump' */
+     TEMPL_ELSE,         /* go to 'jump' (past the '%%endif') */
+     TEMPL_FOR,          /* "var\0list" at 'offset'. If 'list' is empty; go to 'jump' */
+     TEMPL_ENDFOR,       /* next in the list; go to 'jump + 1' */
+     TEMPL_INCLUDE       /* run the template file at 'offset' */
+   };
+
+typedef struct template_op {
+        uint8_t  opcode;
+        uint8_t  directive;  /* the 'x' in '%x' */
+        uint16_t indent;     /* column of the '%' */
+        uint32_t offset;     /* into 'template_code::text' */
+        uint32_t len;        /* of the text; or of the 0-terminated string */
+        uint32_t jump;       /* index of the op to go to */
+      } template_op;
+
+/*
+ * A '%%define' block.
+ */
+typedef struct template_define {
+        char *name;
+        char *value;
+      } template_define;
+
+typedef struct template_code {
+        const template_op     *ops;
+        size_t                 num_ops;
+        const char            *text;
+        size_t                 text_size;
+        const template_define *defines;   /* NULL for a template file */
+        size_t                 num_defines;
+        const char            *fname;     /* NULL for a built-in template */
+      } template_code;
+
+/*
+ * A handler gets the 'template_env::arg', the whole line and the text after the '%x'.
+ */
+typedef void (*template_func) (void *arg, out_buf *out, const char *line, const char *rest);
+
+typedef struct template_directive {
+        int           directive;
+        template_func func;
+      } template_directive;
+
+/*
+ * What 'template_run()' needs from the program.
+ */
+typedef struct template_env {
+        const template_directive *directives;
+        size_t                    num_directives;
+        const char               *(*get_var) (void *arg, const char *name);   /* NULL if not known */
+        const smartlist_t        *(*get_list) (void *arg, const char *name);  /* NULL if not known */
+        const template_code      *(*load) (const char *fname);                /* for '%%include' */
+        void                     *arg;                                        /* for the handlers and the above */
+      } template_env;
+
+/*
+ * The built-in templates; see 'template-*.mk'.
+ */
+extern const template_code make_template_windows;
+extern const template_code make_template_linux;
+extern const template_code make_template_mingw;
+extern const template_code make_template_cygwin;
+
+template_code *template_compile (const char *data, size_t size, const char *fname);
+void           template_run (const template_code *tc, out_buf *out, const template_env *env);
+void           template_free (template_code *tc);
+const char    *template_get_define (const template_code *tc, const char *name);
+
+const template_code *template_load (const char *fname);
+void                 template_unload_all (void);
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * Template files and their compiled cache for the gen-make program.
+ *
+ * A template file given with option '--template-file' (or included by
+ * one) is memory-mapped and compiled by 'template_compile()'. The result
+ * is written next to it as 'foo.mk.cache':
+ *   templ_cache_header
+ *   template_op  ops  [num_ops]
+ *   char         text [text_size]
+ *
+ * The header has the 'hash64()' of the template and of the compiler's
+ * output format. So on the next run the cache is used (memory-mapped) as-is
+ * if the template and gen-make's directives are unchanged; no parsing is
+ * done. But the ops are checked to be within the cache.
+ *
+ * The templates loaded are shared by all threads; hence the 'load_lock'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "hash.h"
+#include "strmap.h"
+#include "template.h"
+
+#define TEMPL_CACHE_MAGIC    "GMTMPL\r\n"
+#define TEMPL_CACHE_VERSION  2   /* bump on a change in what 'template_compile()' produces */
+
+typedef struct templ_cache_header {
+        char     magic [8];
+        uint32_t version;
+        uint32_t num_ops;
+        uint64_t format;         /* from 'templ_cache_format()' */
+        uint64_t templ_hash;     /* 'hash64()' of the template */
+        uint64_t templ_size;
+        uint64_t text_size;
+      } templ_cache_header;
+
+/*
+ * A loaded template; the 'code' is in the mapped 'cache' or is 'compiled'.
+ */
+typedef struct template_file {
+        template_code  code;
+        mapped_file    cache;
+        template_code *compiled;
+      } template_file;
+
+static strmap_t *loaded;      /* file-name -> 'template_file*' */
+static SRWLOCK   load_lock = SRWLOCK_INIT;
+
+/*
+ * A key for the compiler's output; it changes with the directives known
+ * and the layout of a 'template_op'.
+ */
+static uint64_t templ_cache_format (void)
+{
+  char layout [200];
+  int  len = snprintf (layout, sizeof(layout), "%s/%s/%d/%d/%zu/%zu/%zu/%zu/%zu/%zu",
+                       TEMPL_DIRECTIVES, TEMPL_PREFIX_DIRECTIVES, TEMPL_MAX_DEPTH, TEMPL_INCLUDE,
+                       sizeof(template_op), offsetof(template_op, directive), offsetof(template_op, indent),
+                       offsetof(template_op, offset), offsetof(template_op, len), offsetof(template_op, jump));
+
+  return hash64 (layout, len);
+}
+
+/*
+ * Check that the text of each op is within the 'tc->text', that the
+ * '%%for' / '%%endfor' pairs nest and that no jump goes into or out of a
+ * loop. So a corrupt cache cannot make 'template_run()' read outside the
+ * mapped file or it's loop stack.
+ */
+static bool templ_cache_sane (const template_code *tc)
+{
+  uint32_t fors [TEMPL_MAX_DEPTH];
+  int64_t *loop;       /* the '%%for' an op is in (or -1); a '%%for' is in the one around it */
+  size_t   i, num_fors = 0;
+  bool     ok = (tc->text[tc->text_size] == '\0');
+
+  loop = malloc ((tc->num_ops + 1) * sizeof(*loop));
+  assert (loop);
+
+  for (i = 0; ok && i < tc->num_ops; i++)
+  {
+    const template_op *op = tc->ops + i;
+
+    loop[i] = num_fors > 0 ? fors [num_fors - 1] : -1;
+
+    if (op->offset > tc->text_size || op->len > tc->text_size - op->offset ||
+        op->opcode < TEMPL_TEXT || op->opcode > TEMPL_INCLUDE)
+       ok = false;
+
+    /* A 0-terminated string.
+     */
+    else if ((op->opcode == TEMPL_DIRECTIVE || op->opcode == TEMPL_VAR || op->opcode == TEMPL_IF ||
+              op->opcode == TEMPL_FOR || op->opcode == TEMPL_INCLUDE) && tc->text[op->offset + op->len] != '\0')
+       ok = false;
+
+    else if (op->opcode == TEMPL_DIRECTIVE && op->indent + 2 > op->len)
+       ok = false;
+
+    else if ((op->opcode == TEMPL_IF || op->opcode == TEMPL_ELSE || op->opcode == TEMPL_FOR) &&
+             (op->jump <= i || op->jump > tc->num_ops))
+       ok = false;
+
+    else if (op->opcode == TEMPL_FOR)
+    {
+      if (num_fors == DIM(fors))
+           ok = false;
+      else fors [num_fors++] = (uint32_t) i;
+    }
+
+    /* Back to it's '%%for'; which goes past this.
+     */
+    else if (op->opcode == TEMPL_ENDFOR)
+    {
+      if (num_fors == 0 || fors[--num_fors] != op->jump || tc->ops[op->jump].jump != i + 1)
+         ok = false;
+    }
+  }
+  loop [tc->num_ops] = -1;
+
+  for (i = 0; ok && i < tc->num_ops; i++)
+  {
+    const template_op *op = tc->ops + i;
+
+    if ((op->opcode == TEMPL_IF || op->opcode == TEMPL_ELSE || op->opcode == TEMPL_FOR) &&
+        loop[op->jump] != loop[i])
+       ok = false;
+  }
+  free (loop);
+  return (ok && num_fors == 0);
+}
+
+static bool templ_cache_open (template_file *tf, const char *cache_name, uint64_t hash, uint64_t size)
+{
+  const templ_cache_header *hdr;
+
+  if (!map_file(cache_name, &tf->cache) || tf->cache.size < sizeof(*hdr))
+     goto fail;
+
+  hdr = (const templ_cache_header*) tf->cache.data;
+  if (memcmp(hdr->magic, TEMPL_CACHE_MAGIC, sizeof(hdr->magic)) || hdr->version != TEMPL_CACHE_VERSION ||
+      hdr->format != templ_cache_format())
+  {
+    DEBUG (1, "Cache '%s' is not valid or of another version.\n", cache_name);
+    goto fail;
+  }
+  if (hdr->templ_hash != hash || hdr->templ_size != size)
+  {
+    DEBUG (1, "Cache '%s' is for another version of the template.\n", cache_name);
+    goto fail;
+  }
+  if (sizeof(*hdr) + (uint64_t)hdr->num_ops * sizeof(template_op) + hdr->text_size + 1 != tf->cache.size)
+  {
+    DEBUG (1, "Cache '%s' is corrupt.\n", cache_name);
+    goto fail;
+  }
+
+  tf->code.ops       = (const template_op*) (hdr + 1);
+  tf->code.num_ops   = hdr->num_ops;
+  tf->code.text      = (const char*) (tf->code.ops + hdr->num_ops);
+  tf->code.text_size = hdr->text_size;
+  if (!templ_cache_sane(&tf->code))
+  {
+    DEBUG (1, "Cache '%s' is corrupt.\n", cache_name);
+    goto fail;
+  }
+  DEBUG (1, "Using the compiled template '%s'; %u ops.\n", cache_name, hdr->num_ops);
+  return (true);
+
+fail:
+  unmap_file (&tf->cache);
+  return (false);
+}
+
+/*
+ * The parts of a cache-file for 'write_code()'.
+ */
+typedef struct code_image {
+        const templ_cache_header *hdr;
+        const template_code      *tc;
+      } code_image;
+
+static bool write_code (void *arg, FILE *f)
+{
+  const code_image    *img = arg;
+  const template_code *tc = img->tc;
+
+  return (fwrite(img->hdr, sizeof(*img->hdr), 1, f) == 1 &&
+          fwrite(tc->ops, sizeof(*tc->ops), tc->num_ops, f) == tc->num_ops &&
+          fwrite(tc->text, 1, tc->text_size + 1, f) == tc->text_size + 1);
+}
+
+static bool templ_cache_write (const template_code *tc, const char *cache_name, uint64_t hash, uint64_t size)
+{
+  templ_cache_header hdr;
+  code_image         img;
+  bool               rc;
+
+  memset (&hdr, '\0', sizeof(hdr));
+  memcpy (hdr.magic, TEMPL_CACHE_MAGIC, sizeof(hdr.magic));
+  hdr.version    = TEMPL_CACHE_VERSION;
+  hdr.num_ops    = (uint32_t) tc->num_ops;
+  hdr.format     = templ_cache_format();
+  hdr.templ_hash = hash;
+  hdr.templ_size = size;
+  hdr.text_size  = tc->text_size;
+
+  img.hdr = &hdr;
+  img.tc  = tc;
+  rc = write_replace_file (cache_name, write_code, &img);
+  DEBUG (1, "%s the compiled template '%s'.\n", rc ? "Wrote" : "Failed to write", cache_name);
+  return (rc);
+}
+
+static const template_code *load_template (const char *fname)
+{
+  template_file *tf;
+  mapped_file    mf;
+  uint64_t       hash;
+  char           cache_name [_MAX_PATH];
+
+  if (!loaded)
+     loaded = strmap_new (true);
+
+  tf = strmap_get (loaded, fname);
+  if (tf)
+     return (&tf->code);
+
+  if (!map_file(fname, &mf))
+  {
+    fprintf (stderr, "Failed to read the template '%s'.\n", fname);
+    return (NULL);
+  }
+
+  tf = calloc (1, sizeof(*tf));
+  assert (tf);
+  hash = hash64 (mf.data, mf.size);
+  snprintf (cache_name, sizeof(cache_name), "%s.cache", fname);
+
+  if (!templ_cache_open(tf, cache_name, hash, mf.size))
+  {
+    tf->compiled = template_compile (mf.data, mf.size, fname);
+    if (!tf->compiled)
+    {
+      unmap_file (&mf);
+      free (tf);
+      return (NULL);
+    }
+    templ_cache_write (tf->compiled, cache_name, hash, mf.size);
+    tf->code = *tf->compiled;
+  }
+  unmap_file (&mf);
+
+  tf->code.defines     = NULL;
+  tf->code.num_defines = 0;
+  tf->code.fname       = strdup (fname);
+  strmap_set (loaded, fname, tf);
+  return (&tf->code);
+}
+
+/*
+ * Return the compiled template 'fname'. From it's cache if that is for the
+ * same contents; otherwise it's compiled and the cache is written. A file is
+ * only loaded once. Returns NULL if it cannot be read or compiled.
+ */
+const template_code *template_load (const char *fname)
+{
+  const template_code *tc;
+
+  AcquireSRWLockExclusive (&load_lock);
+  tc = load_template (fname);
+  ReleaseSRWLockExclusive (&load_lock);
+  return (tc);
+}
+
+static void template_file_free (void *val)
+{
+  template_file *tf = val;
+
+  free ((void*)tf->code.fname);
+  unmap_file (&tf->cache);
+  template_free (tf->compiled);
+  free (tf);
+}
+
+void template_unload_all (void)
+{
+  AcquireSRWLockExclusive (&load_lock);
+  strmap_free (loaded, template_file_free);
+  loaded = NULL;
+  ReleaseSRWLockExclusive (&load_lock);
+}
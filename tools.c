@@ -0,0 +1,214 @@
+/*
+ * The toolchain of a template for the gen-make program.
+ *
+ * The backends that do not expand a makefile template (like '--emit ninja')
+ * need the compiler and flags as plain strings. Each 'template-*.mk' has
+ * them in a '%%define tools' block:
+ *   kind     = gcc
+ *   cc       = gcc
+ *   cflags   = -Wall -O2 -I.
+ *   ...
+ *
+ * A '#' line is a comment. An unknown key is an error. A key not given
+ * gets the 'gcc' (or 'msvc') default below.
+ *
+ * The backends also share the object-names and the effective C-flags from here.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "smartlist.h"
+#include "strmap.h"
+#include "outbuf.h"
+#include "tools.h"
+
+#define TOOL_FIELD(name)  { #name, offsetof(build_tools, name) }
+
+static const struct {
+       const char *key;
+       size_t      ofs;
+     } tool_fields[] = {
+       TOOL_FIELD (cc),
+       TOOL_FIELD (cxx),
+       TOOL_FIELD (cflags),
+       TOOL_FIELD (cxxflags),
+       TOOL_FIELD (dll_cflags),
+       TOOL_FIELD (ld),
+       TOOL_FIELD (ldflags),
+       TOOL_FIELD (libs),
+       TOOL_FIELD (ar),
+       TOOL_FIELD (obj_dir),
+       TOOL_FIELD (obj_ext),
+       TOOL_FIELD (exe_ext),
+       TOOL_FIELD (dll_ext),
+       TOOL_FIELD (lib_ext)
+     };
+
+#define FIELD(t, i)  ((char**) ((char*)(t) + tool_fields[i].ofs))
+
+/*
+ * The defaults; in the order of 'tool_fields[]'.
+ */
+static const char *gcc_defaults[] = {
+              "gcc", "g++", "-Wall -O2 -g -I.", "-std=c++17", "-fPIC", "", "", "", "ar",
+              "objects", ".o", "", ".so", ".a"
+            };
+
+static const char *msvc_defaults[] = {
+              "cl", "cl", "-nologo -W3 -MD -Ot -I.", "-std:c++17 -TP -EHsc", "", "link", "-nologo", "", "lib",
+              "objects", ".obj", ".exe", ".dll", ".lib"
+            };
+
+/*
+ * Return 'p' to 'end' with the surrounding spaces removed; in a new string.
+ */
+static char *trim_dup (const char *p, const char *end)
+{
+  char *s;
+
+  while (p < end && isspace((int)*p))
+     p++;
+  while (end > p && isspace((int)end[-1]))
+     end--;
+  s = malloc (end - p + 1);
+  assert (s);
+  memcpy (s, p, end - p);
+  s [end - p] = '\0';
+  return (s);
+}
+
+/*
+ * Parse the 'key = value' lines in 'text' into 'tools'. 'where' is for the
+ * error messages. Free it with 'build_tools_free()'.
+ */
+bool build_tools_parse (const char *text, const char *where, build_tools *tools)
+{
+  const char **defaults;
+  const char  *p, *eol, *eq;
+  char        *key;
+  unsigned     line = 0;
+  size_t       i;
+  bool         rc = true;
+
+  memset (tools, '\0', sizeof(*tools));
+
+  for (p = text; rc && *p; p = *eol ? eol + 1 : eol)
+  {
+    eol = strchr (p, '\n');
+    if (!eol)
+       eol = strchr (p, '\0');
+    line++;
+
+    while (p < eol && isspace((int)*p))
+       p++;
+    if (p == eol || *p == '#')
+       continue;
+
+    eq = memchr (p, '=', eol - p);
+    if (!eq)
+    {
+      fprintf (stderr, "%s(%u): no '=' in '%.*s'.\n", where, line, (int)(eol - p), p);
+      rc = false;
+      break;
+    }
+
+    key = trim_dup (p, eq);
+    if (!strcmp(key, "kind"))
+    {
+      char *kind = trim_dup (eq + 1, eol);
+
+      if (!strcmp(kind, "msvc"))
+           tools->msvc = true;
+      else if (strcmp(kind, "gcc"))
+      {
+        fprintf (stderr, "%s(%u): unknown kind '%s'; use 'msvc' or 'gcc'.\n", where, line, kind);
+        rc = false;
+      }
+      free (kind);
+      free (key);
+      continue;
+    }
+
+    for (i = 0; i < DIM(tool_fields); i++)
+        if (!strcmp(key, tool_fields[i].key))
+           break;
+    if (i == DIM(tool_fields))
+    {
+      fprintf (stderr, "%s(%u): unknown key '%s'.\n", where, line, key);
+      rc = false;
+    }
+    else
+    {
+      free (*FIELD(tools, i));
+      *FIELD(tools, i) = trim_dup (eq + 1, eol);
+    }
+    free (key);
+  }
+
+  defaults = tools->msvc ? msvc_defaults : gcc_defaults;
+  for (i = 0; i < DIM(tool_fields); i++)
+      if (!*FIELD(tools, i))
+         *FIELD(tools, i) = strdup (defaults[i]);
+
+  if (!rc)
+     build_tools_free (tools);
+  return (rc);
+}
+
+/*
+ * The C-flags for 'tools'; the '-I' for '$obj_dir/config.h' and the
+ * 'inc_dirs' added.
+ */
+void build_tools_cflags (const build_tools *t, const smartlist_t *inc_dirs, out_buf *out)
+{
+  int i;
+
+  buf_printf (out, "%s -I%s -DHAVE_CONFIG_H", t->cflags, t->obj_dir);
+  for (i = 0; i < smartlist_len(inc_dirs); i++)
+  {
+    const char *dir = smartlist_get (inc_dirs, i);
+
+    if (stricmp(dir, t->obj_dir))
+       buf_printf (out, " -I%s", dir);
+  }
+}
+
+/*
+ * Put the object of 'src' in 'buf'; 'dir/foo.c' gives '$obj_dir/foo.o'.
+ * An object must be unique (Ninja can not have 2 edges for one output). So
+ * if 'objs' already has that object, the directory is put in the name; 'dir_foo.o'.
+ */
+const char *build_tools_object (const build_tools *t, strmap_t *objs, const char *src, char *buf, size_t size)
+{
+  const char *slash = strrchr (src, '/');
+  const char *base  = slash ? slash + 1 : src;
+  const char *dot   = strrchr (base, '.');
+  char       *p;
+
+  snprintf (buf, size, "%s/%.*s%s", t->obj_dir, dot ? (int)(dot - base) : (int)strlen(base), base, t->obj_ext);
+  if (strmap_get(objs, buf))
+  {
+    dot = strrchr (src, '.');
+    snprintf (buf, size, "%s/%.*s%s", t->obj_dir, dot ? (int)(dot - src) : (int)strlen(src), src, t->obj_ext);
+    for (p = buf + strlen(t->obj_dir) + 1; *p; p++)
+        if (*p == '/' || *p == ':')
+           *p = '_';
+    DEBUG (1, "Object for '%s' renamed to '%s'.\n", src, buf);
+  }
+  strmap_set (objs, buf, (void*)src);
+  return (buf);
+}
+
+void build_tools_free (build_tools *tools)
+{
+  size_t i;
+
+  for (i = 0; i < DIM(tool_fields); i++)
+      free (*FIELD(tools, i));
+  memset (tools, '\0', sizeof(*tools));
+}
@@ -0,0 +1,38 @@
+#ifndef _TOOLS_H
+#define _TOOLS_H
+
+#include <stdbool.h>
+
+#include "smartlist.h"
+#include "strmap.h"
+#include "outbuf.h"
+
+/*
+ * The compiler, flags and file-name rules of a template. From the
+ * 'key = value' lines in it's '%%define tools' block.
+ */
+typedef struct build_tools {
+        bool  msvc;        /* 'kind = msvc' for 'cl' or 'clang-cl'. Otherwise 'kind = gcc' */
+        char *cc;
+        char *cxx;
+        char *cflags;
+        char *cxxflags;    /* added to 'cflags' for C++ */
+        char *dll_cflags;  /* added to 'cflags' when the target is a DLL */
+        char *ld;          /* the linker; '$cc' or '$cxx' if empty */
+        char *ldflags;
+        char *libs;
+        char *ar;          /* the static librarian */
+        char *obj_dir;
+        char *obj_ext;     /* '.obj' or '.o' */
+        char *exe_ext;     /* '.exe' or '' */
+        char *dll_ext;     /* '.dll' or '.so' */
+        char *lib_ext;     /* '.lib' or '.a' */
+      } build_tools;
+
+bool build_tools_parse (const char *text, const char *where, build_tools *tools);
+void build_tools_free (build_tools *tools);
+void build_tools_cflags (const build_tools *tools, const smartlist_t *inc_dirs, out_buf *out);
+
+const char *build_tools_object (const build_tools *tools, strmap_t *objs, const char *src, char *buf, size_t size);
+
+#endif
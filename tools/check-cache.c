@@ -0,0 +1,379 @@
+/*
+ * check-cache: check that a truncated or corrupt cache-file is rejected.
+ *
+ * Usage: check-cache work-dir template.mk source.c ...
+ *
+ * Writes a '.gen-make.cache' of the include-graph of the sources and a
+ * 'check.mk.cache' of the template in 'work-dir'. Then writes them back
+ * truncated and with bits flipped:
+ *  - a truncated cache or one with another magic or version must be rejected.
+ *  - a cache with a flipped bit elsewhere may be used (e.g. a changed 'mtime');
+ *    but only if all it's strings, indices and jumps are within the file.
+ *    So it is read (or the template is run) to check it does not crash.
+ *
+ * A rejected '.mk.cache' is compiled again and rewritten by 'template_load()'.
+ * So it is rejected if it is the same as the good cache after loading it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "depend.h"
+#include "template.h"
+
+/*
+ * Both caches start with a 'char magic[8]' and a 'uint32_t version'.
+ */
+#define MAGIC_VERSION_LEN  12
+
+/*
+ * Max number of truncated and corrupted files written for each cache.
+ */
+#define MAX_TRIES  1000
+
+typedef struct cache_test {
+        const char *name;
+        int         num_truncated;
+        int         num_corrupt;
+        int         num_used;     /* corrupted; but used */
+        int         num_failed;
+      } cache_test;
+
+static char *read_file (const char *fname, size_t *size)
+{
+  FILE *f = fopen (fname, "rb");
+  char *data;
+  long  len;
+
+  if (!f)
+     return (NULL);
+  fseek (f, 0, SEEK_END);
+  len = ftell (f);
+  rewind (f);
+  data = malloc (len + 1);
+  assert (data);
+  *size = fread (data, 1, len, f);
+  data [*size] = '\0';
+  fclose (f);
+  return (data);
+}
+
+static bool write_file (const char *fname, const char *data, size_t size)
+{
+  FILE *f = fopen (fname, "wb");
+  bool  rc;
+
+  if (!f)
+  {
+    fprintf (stderr, "Failed to create '%s'.\n", fname);
+    return (false);
+  }
+  rc = (fwrite(data, 1, size, f) == size);
+  return (fclose(f) == 0 && rc);
+}
+
+static bool same_file (const char *fname, const char *data, size_t size)
+{
+  size_t len;
+  char  *now = read_file (fname, &len);
+  bool   rc = (now && len == size && !memcmp(now, data, size));
+
+  free (now);
+  return (rc);
+}
+
+static void failed (cache_test *t, const char *what, size_t pos)
+{
+  fprintf (stderr, "%s: %s at offset %zu.\n", t->name, what, pos);
+  t->num_failed++;
+}
+
+/*
+ * The offsets to truncate or corrupt; all in the header part and a
+ * spread over the rest.
+ */
+static size_t next_offset (size_t pos, size_t head_size, size_t size)
+{
+  size_t step = size / MAX_TRIES + 1;
+
+  if (pos < head_size)
+     return (pos + 1);
+  if (pos + step >= size && pos < size - 1)
+     return (size - 1);
+  return (pos + step);
+}
+
+/*
+ * Read all of a cache accepted by 'dep_cache_open()'. Every string must
+ * end inside the file and every edge must be a node.
+ */
+static bool read_dep_cache (const dep_cache *c, size_t size)
+{
+  int  i, j, num = dep_cache_num_nodes (c);
+  int *all = calloc (num + 1, sizeof(*all));
+  bool ok = true;
+
+  assert (all);
+  for (i = 0; i < num; i++)
+  {
+    const char     *name = dep_cache_name (c, i);
+    const uint32_t *edges;
+    uint64_t        mtime, fsize, hash;
+    int             num_edges;
+
+    if (strlen(name) >= size)
+       ok = false;
+    dep_cache_lookup (c, name);
+    dep_cache_stat (c, i, &mtime, &fsize, &hash);
+
+    for (j = 0; j < dep_cache_num_raw_includes(c, i); j++)
+        if (strlen(dep_cache_raw_include(c, i, j)) >= size)
+           ok = false;
+
+    edges = dep_cache_edges (c, i, &num_edges);
+    for (j = 0; j < num_edges; j++)
+        if ((int)edges[j] >= num)
+           ok = false;
+    all [i] = i;
+  }
+  smartlist_free (dep_cache_affected(c, all, num));
+  free (all);
+  return (ok);
+}
+
+/*
+ * Return true if 'fname' with these contents is rejected (or on a failure
+ * that is counted already).
+ */
+static bool dep_cache_rejects (cache_test *t, const char *fname, const char *data, size_t size, size_t pos)
+{
+  dep_cache *c;
+  bool       rc;
+
+  if (!write_file(fname, data, size))
+  {
+    t->num_failed++;
+    return (true);
+  }
+  c = dep_cache_open (fname);
+  rc = (c == NULL);
+  if (c && !read_dep_cache(c, size))
+     failed (t, "a bad string or edge was used", pos);
+  dep_cache_close (c);
+  return (rc);
+}
+
+static bool check_dep_cache (const char *dir, int num_sources, char **sources)
+{
+  cache_test t;
+  dep_graph *g = dep_graph_new();
+  dep_cache *c;
+  char       fname [_MAX_PATH];
+  char      *good, *bad;
+  size_t     size, pos;
+  int        i;
+
+  memset (&t, '\0', sizeof(t));
+  t.name = ".gen-make.cache";
+
+  snprintf (fname, sizeof(fname), "%s/.gen-make.cache", dir);
+  remove (fname);
+
+  dep_graph_add_inc_path (g, ".");
+  for (i = 0; i < num_sources; i++)
+      dep_graph_add_source (g, sources[i]);
+  dep_graph_scan (g);
+  if (!dep_cache_write(g, fname))
+  {
+    fprintf (stderr, "Failed to write '%s'.\n", fname);
+    dep_graph_free (g);
+    return (false);
+  }
+  dep_graph_free (g);
+
+  good = read_file (fname, &size);
+  c = dep_cache_open (fname);
+  if (!good || !c || dep_cache_num_nodes(c) < num_sources || !read_dep_cache(c, size))
+  {
+    fprintf (stderr, "%s: the good cache was not accepted.\n", t.name);
+    dep_cache_close (c);
+    free (good);
+    return (false);
+  }
+  dep_cache_close (c);
+
+  for (pos = 0; pos < size; pos = next_offset(pos, MAGIC_VERSION_LEN, size))
+  {
+    if (!dep_cache_rejects(&t, fname, good, pos, pos))
+       failed (&t, "a truncated cache was used", pos);
+    t.num_truncated++;
+  }
+
+  bad = malloc (size);
+  assert (bad);
+  for (pos = 0; pos < size; pos = next_offset(pos, 2*MAGIC_VERSION_LEN, size))
+  {
+    memcpy (bad, good, size);
+    bad [pos] ^= (1 << (pos % 8));
+    if (!dep_cache_rejects(&t, fname, bad, size, pos))
+    {
+      if (pos < MAGIC_VERSION_LEN)
+         failed (&t, "a bad magic or version was used", pos);
+      t.num_used++;
+    }
+    t.num_corrupt++;
+  }
+
+  write_file (fname, good, size);
+  free (bad);
+  free (good);
+
+  printf ("%s: %d truncated rejected, %d of %d corrupted rejected; %d failed.\n",
+          t.name, t.num_truncated, t.num_corrupt - t.num_used, t.num_corrupt, t.num_failed);
+  return (t.num_failed == 0);
+}
+
+/*
+ * For running a corrupted template that was used; every variable is true
+ * and every list has 2 file-names.
+ */
+static const char *get_var (void *arg, const char *name)
+{
+  return ("1");
+}
+
+static const smartlist_t *get_list (void *arg, const char *name)
+{
+  return (arg);
+}
+
+static void run_template (const template_code *tc)
+{
+  smartlist_t *list = smartlist_new();
+  template_env env;
+  out_buf      out;
+
+  smartlist_add (list, "dir/foo.c");
+  smartlist_add (list, "bar.c");
+
+  memset (&env, '\0', sizeof(env));
+  memset (&out, '\0', sizeof(out));
+  env.get_var  = get_var;
+  env.get_list = get_list;
+  env.arg      = list;
+  template_run (tc, &out, &env);
+  buf_free (&out);
+  smartlist_free (list);
+}
+
+/*
+ * Return true if the 'cache' of 'templ' with these contents is rejected (or
+ * on a failure that is counted already).
+ */
+static bool templ_cache_rejects (cache_test *t, const char *templ, const char *cache,
+                                 const char *data, size_t size, const char *good, size_t good_size, size_t pos)
+{
+  const template_code *tc;
+  bool                 rc;
+
+  if (!write_file(cache, data, size))
+  {
+    t->num_failed++;
+    return (true);
+  }
+  tc = template_load (templ);
+  if (!tc)
+  {
+    failed (t, "the template was not loaded", pos);
+    return (true);
+  }
+  rc = same_file (cache, good, good_size);
+  if (!rc)
+     run_template (tc);
+  template_unload_all();
+  return (rc);
+}
+
+static bool check_templ_cache (const char *dir, const char *template)
+{
+  cache_test t;
+  char       templ [_MAX_PATH];
+  char       cache [_MAX_PATH];
+  char      *data, *good, *bad;
+  size_t     size, pos;
+
+  memset (&t, '\0', sizeof(t));
+  t.name = "check.mk.cache";
+
+  data = read_file (template, &size);
+  if (!data)
+  {
+    fprintf (stderr, "Failed to read '%s'.\n", template);
+    return (false);
+  }
+  snprintf (templ, sizeof(templ), "%s/check.mk", dir);
+  snprintf (cache, sizeof(cache), "%s.cache", templ);
+  remove (cache);
+  if (!write_file(templ, data, size))
+  {
+    free (data);
+    return (false);
+  }
+  free (data);
+
+  if (!template_load(templ))
+     return (false);
+  template_unload_all();
+
+  good = read_file (cache, &size);
+  if (!good)
+  {
+    fprintf (stderr, "%s: the cache was not written.\n", t.name);
+    return (false);
+  }
+
+  for (pos = 0; pos < size; pos = next_offset(pos, MAGIC_VERSION_LEN, size))
+  {
+    if (!templ_cache_rejects(&t, templ, cache, good, pos, good, size, pos))
+       failed (&t, "a truncated cache was used", pos);
+    t.num_truncated++;
+  }
+
+  bad = malloc (size);
+  assert (bad);
+  for (pos = 0; pos < size; pos = next_offset(pos, 2*MAGIC_VERSION_LEN, size))
+  {
+    memcpy (bad, good, size);
+    bad [pos] ^= (1 << (pos % 8));
+    if (!templ_cache_rejects(&t, templ, cache, bad, size, good, size, pos))
+    {
+      if (pos < MAGIC_VERSION_LEN)
+         failed (&t, "a bad magic or version was used", pos);
+      t.num_used++;
+    }
+    t.num_corrupt++;
+  }
+  free (bad);
+  free (good);
+
+  printf ("%s: %d truncated rejected, %d of %d corrupted rejected; %d failed.\n",
+          t.name, t.num_truncated, t.num_corrupt - t.num_used, t.num_corrupt, t.num_failed);
+  return (t.num_failed == 0);
+}
+
+int main (int argc, char **argv)
+{
+  bool ok;
+
+  if (argc < 4)
+  {
+    fprintf (stderr, "Usage: check-cache work-dir template.mk source.c ...\n");
+    return (1);
+  }
+  ok = check_dep_cache (argv[1], argc - 3, argv + 3);
+  ok = check_templ_cache (argv[1], argv[2]) && ok;
+  return (ok ? 0 : 1);
+}
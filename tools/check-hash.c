@@ -0,0 +1,40 @@
+/*
+ * check-hash: print the 'hash64()' of some test data for 'make check'.
+ *
+ * Usage: check-hash
+ *
+ * It's linked with 'hash.c' compiled 3 ways; with '-DHASH_SCALAR', the default
+ * (SSE2) and '-arch:AVX2'. The outputs must be the same. Each length from 0 to
+ * 257 is hashed (every tail of a stripe) and some around a block of 1024 bytes.
+ * The data starts at an odd address to test the unaligned loads.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+#define MAX_LEN  (16*1024 + 65)
+
+static const size_t long_lens[] = { 511, 512, 513, 1023, 1024, 1025, 1089, 2048, 4097, MAX_LEN };
+
+int main (void)
+{
+  static unsigned char buf [MAX_LEN + 1];
+  unsigned char       *data = buf + 1;
+  uint32_t             seed = 12345;
+  size_t               i;
+
+  for (i = 0; i < MAX_LEN; i++)
+  {
+    seed = seed * 1103515245U + 12345U;
+    data [i] = (unsigned char) (seed >> 16);
+  }
+
+  for (i = 0; i <= 257; i++)
+      printf ("%5u %016llx\n", (unsigned)i, (unsigned long long)hash64(data, i));
+
+  for (i = 0; i < sizeof(long_lens) / sizeof(long_lens[0]); i++)
+      printf ("%5u %016llx\n", (unsigned)long_lens[i], (unsigned long long)hash64(data, long_lens[i]));
+  return (0);
+}
@@ -0,0 +1,232 @@
+/*
+ * gen-template: compile a makefile template into C at build-time.
+ *
+ * Usage: gen-template [-n name] template.mk output.c
+ *
+ * Writes the 'template_op' array, the text and the '%%define' blocks of
+ * 'template.mk' as a 'const template_code name' (default 'make_template').
+ * See 'template.c'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "template.h"
+
+int debug_level = 0;
+
+static char *read_file (const char *fname, size_t *size)
+{
+  FILE *f = fopen (fname, "rb");
+  char *data;
+  long  len;
+
+  if (!f)
+     return (NULL);
+  fseek (f, 0, SEEK_END);
+  len = ftell (f);
+  rewind (f);
+  data = malloc (len + 1);
+  assert (data);
+  *size = fread (data, 1, len, f);
+  data [*size] = '\0';
+  fclose (f);
+  return (data);
+}
+
+/*
+ * Write 'len' bytes of 'str' as C string literals; one for each line.
+ */
+static void write_string (FILE *out, const char *str, size_t len, const char *indent)
+{
+  size_t i;
+  bool   open = false;
+
+  if (len == 0)
+  {
+    fprintf (out, "%s\"\"", indent);
+    return;
+  }
+
+  for (i = 0; i < len; i++)
+  {
+    int ch = (unsigned char) str[i];
+
+    if (!open)
+    {
+      fprintf (out, "%s%s\"", i > 0 ? "\n" : "", indent);
+      open = true;
+    }
+    switch (ch)
+    {
+      case '\\':
+           fputs ("\\\\", out);
+           break;
+      case '"':
+           fputs ("\\\"", out);
+           break;
+      case '\t':
+           fputs ("\\t", out);
+           break;
+      case '\n':
+           fputs ("\\n", out);
+           break;
+      case '\0':
+           fputs ("\\0", out);
+           break;
+      default:
+           if (ch < ' ' || ch == 127)
+                fprintf (out, "\\%03o", ch);
+           else fputc (ch, out);
+           break;
+    }
+    if (ch == '\n' || ch == '\0')
+    {
+      fputc ('"', out);
+      open = false;
+    }
+  }
+  if (open)
+     fputc ('"', out);
+}
+
+static const char *opcode_name (int opcode)
+{
+  switch (opcode)
+  {
+    case TEMPL_TEXT:
+         return ("TEMPL_TEXT,");
+    case TEMPL_DIRECTIVE:
+         return ("TEMPL_DIRECTIVE,");
+    case TEMPL_VAR:
+         return ("TEMPL_VAR,");
+    case TEMPL_IF:
+         return ("TEMPL_IF,");
+    case TEMPL_ELSE:
+         return ("TEMPL_ELSE,");
+    case TEMPL_FOR:
+         return ("TEMPL_FOR,");
+    case TEMPL_ENDFOR:
+         return ("TEMPL_ENDFOR,");
+    case TEMPL_INCLUDE:
+         return ("TEMPL_INCLUDE,");
+  }
+  return ("?");
+}
+
+/*
+ * The 'make X' target in the header is the name without a directory.
+ * So 'make check' can write to '$(OBJ_DIR)/' and compare with the committed file.
+ */
+static const char *base_name (const char *fname)
+{
+  const char *p = fname + strlen (fname);
+
+  while (p > fname && p[-1] != '/' && p[-1] != '\\')
+     p--;
+  return (p);
+}
+
+static bool write_code (const template_code *tc, const char *in_file, const char *out_file, const char *name)
+{
+  FILE  *out = fopen (out_file, "wb");
+  size_t i;
+
+  if (!out)
+  {
+    fprintf (stderr, "Failed to create '%s'.\n", out_file);
+    return (false);
+  }
+
+  fprintf (out, "/*\n"
+                " * Generated by 'gen-template' from '%s'. DO NOT EDIT.\n"
+                " * Edit the template and run 'make %s' instead.\n"
+                " */\n"
+                "#include \"gen-make.h\"\n"
+                "#include \"template.h\"\n\n", in_file, base_name(out_file));
+
+  fputs ("static const char text[] =\n", out);
+  write_string (out, tc->text, tc->text_size, "  ");
+  fputs (";\n\n", out);
+
+  fputs ("static const template_op ops[] = {\n", out);
+  for (i = 0; i < tc->num_ops; i++)
+  {
+    const template_op *op = tc->ops + i;
+    const char        *str = tc->text + op->offset;
+
+    fprintf (out, "  { %-16s", opcode_name(op->opcode));
+    if (op->directive)
+         fprintf (out, "'%c', ", op->directive);
+    else fputs ("  0, ", out);
+    fprintf (out, "%3u, %6lu, %5lu, %4lu }, ", op->indent, (unsigned long)op->offset,
+             (unsigned long)op->len, (unsigned long)op->jump);
+
+    if (op->opcode == TEMPL_TEXT || op->opcode == TEMPL_ELSE || op->opcode == TEMPL_ENDFOR || strstr(str, "*/"))
+         fputc ('\n', out);
+    else if (op->opcode == TEMPL_FOR)
+         fprintf (out, "  /* %s in %s */\n", str, str + strlen(str) + 1);
+    else fprintf (out, "  /* %s */\n", str);
+  }
+  fputs ("};\n\n", out);
+
+  if (tc->num_defines == 0)
+  {
+    fprintf (out, "const template_code %s = { ops, DIM(ops), text, sizeof(text) - 1, NULL, 0, NULL };\n", name);
+    return (fclose(out) == 0);
+  }
+
+  fputs ("static const template_define defines[] = {\n", out);
+  for (i = 0; i < tc->num_defines; i++)
+  {
+    const template_define *d = tc->defines + i;
+
+    fprintf (out, "  { \"%s\",\n", d->name);
+    write_string (out, d->value, strlen(d->value), "    ");
+    fprintf (out, "\n  }%s\n", i < tc->num_defines - 1 ? "," : "");
+  }
+  fputs ("};\n\n", out);
+
+  fprintf (out, "const template_code %s = { ops, DIM(ops), text, sizeof(text) - 1, defines, DIM(defines), NULL };\n", name);
+  return (fclose(out) == 0);
+}
+
+int main (int argc, char **argv)
+{
+  template_code *tc;
+  const char    *name = "make_template";
+  char          *data;
+  size_t         size;
+  bool           ok;
+
+  if (argc >= 3 && !strcmp(argv[1], "-n"))
+  {
+    name = argv[2];
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc != 3)
+  {
+    fprintf (stderr, "Usage: gen-template [-n name] template.mk output.c\n");
+    return (1);
+  }
+
+  data = read_file (argv[1], &size);
+  if (!data)
+  {
+    fprintf (stderr, "Failed to read '%s'.\n", argv[1]);
+    return (1);
+  }
+
+  tc = template_compile (data, size, argv[1]);
+  free (data);
+  if (!tc)
+     return (1);
+
+  ok = write_code (tc, argv[1], argv[2], name);
+  template_free (tc);
+  return (ok ? 0 : 1);
+}
@@ -0,0 +1,250 @@
+/*
+ * Unity (or jumbo) builds for the gen-make program.
+ *
+ * The .c-files are packed into batches of about the same size. Each batch
+ * becomes a generated 'unity_N.c' file that '#include's the files in it.
+ *
+ * A file-scope 'static' name or a '#define' in one file is seen in all
+ * the files after it in a batch. So a file with a 'static' name also
+ * used in another file (or a '#define' with another value) is excluded.
+ * It's compiled on it's own.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "strmap.h"
+#include "unity.h"
+
+typedef struct unity_file {
+        const char  *file;
+        const char  *base;      /* 'file' is relative to this; NULL for "." */
+        smartlist_t *names;     /* "name" for a 'static'. "name=body" for a '#define' */
+        uint64_t     size;
+        char        *reason;    /* why it's excluded */
+      } unity_file;
+
+static void add_name (void *arg, const char *name, size_t len, const char *body, size_t body_len)
+{
+  unity_file *uf = arg;
+  char       *str = malloc (len + body_len + 2);
+
+  memcpy (str, name, len);
+  str [len] = '\0';
+  if (body)
+  {
+    str [len] = '=';
+    memcpy (str + len + 1, body, body_len);
+    str [len + 1 + body_len] = '\0';
+  }
+  smartlist_add (uf->names, str);
+}
+
+static void scan_unity_file (void *arg, size_t idx)
+{
+  unity_file *uf = (unity_file*) arg + idx;
+  mapped_file mf;
+  char        buf [_MAX_PATH];
+
+  if (!map_file(base_path(uf->base, uf->file, buf, sizeof(buf)), &mf))
+  {
+    uf->reason = strdup ("could not be read");
+    return;
+  }
+  uf->size = mf.size;
+  scan_file_scope_names (mf.data, mf.size, add_name, uf);
+  unmap_file (&mf);
+}
+
+/*
+ * Check the names in 'uf' against the 'names' seen in the files before it.
+ * A 'static' name conflicts with anything. A '#define' only with another value.
+ */
+static char *find_conflict (strmap_t *names, const unity_file *uf)
+{
+  int i;
+
+  for (i = 0; i < smartlist_len(uf->names); i++)
+  {
+    char             *name = strdup (smartlist_get(uf->names, i));
+    char             *eq   = strchr (name, '=');
+    const unity_file *other;
+    const char       *value;
+    char              reason [300];
+
+    if (eq)
+       *eq = '\0';
+    other = strmap_get (names, name);
+    if (other && other != uf)
+    {
+      value = NULL;
+      if (eq)
+      {
+        int j;
+
+        /* Find the same '#define' in 'other'
+         */
+        for (j = 0; j < smartlist_len(other->names); j++)
+        {
+          const char *o = smartlist_get (other->names, j);
+
+          if (!strncmp(o, name, eq - name) && o[eq - name] == '=')
+             value = o + (eq - name) + 1;
+        }
+      }
+      if (!value || strcmp(value, eq + 1))
+      {
+        snprintf (reason, sizeof(reason), "%s '%s' also in %s", eq ? "macro" : "static", name, other->file);
+        free (name);
+        return strdup (reason);
+      }
+    }
+    free (name);
+  }
+  return (NULL);
+}
+
+static int compare_size (const void **_a, const void **_b)
+{
+  const unity_file *a = *_a;
+  const unity_file *b = *_b;
+
+  if (a->size != b->size)
+     return (a->size < b->size ? 1 : -1);
+  return strcmp (a->file, b->file);
+}
+
+/*
+ * Pack the '.c' 'files' (relative to 'base'; NULL for the current directory)
+ * into batches of about 'batch_size' bytes. The 'exclude' files and the files with a conflict are left out.
+ *
+ * A first-fit decreasing bin-packing; the largest files are placed
+ * first in the first batch with room for it.
+ */
+unity_plan *unity_plan_new (const char *base, const smartlist_t *files, const smartlist_t *exclude, uint64_t batch_size)
+{
+  unity_plan  *plan  = calloc (1, sizeof(*plan));
+  int          num   = smartlist_len (files);
+  unity_file  *ufs   = calloc (num + 1, sizeof(*ufs));
+  strmap_t    *names = strmap_new (false);
+  smartlist_t *todo  = smartlist_new();
+  int          i, j;
+
+  assert (plan);
+  assert (ufs);
+  plan->batches  = smartlist_new();
+  plan->excluded = smartlist_new();
+
+  for (i = 0; i < num; i++)
+  {
+    ufs[i].file  = smartlist_get (files, i);
+    ufs[i].base  = base;
+    ufs[i].names = smartlist_new();
+  }
+  run_parallel (num, scan_unity_file, ufs);
+
+  for (i = 0; i < num; i++)
+  {
+    unity_file *uf = ufs + i;
+
+    for (j = 0; !uf->reason && exclude && j < smartlist_len(exclude); j++)
+        if (!stricmp(uf->file, smartlist_get(exclude, j)))
+           uf->reason = strdup ("in the exclude list");
+
+    if (!uf->reason)
+       uf->reason = find_conflict (names, uf);
+
+    if (uf->reason)
+    {
+      unity_excluded *ex = malloc (sizeof(*ex));
+
+      ex->file   = strdup (uf->file);
+      ex->reason = uf->reason;
+      smartlist_add (plan->excluded, ex);
+      DEBUG (1, "Unity: %s excluded; %s.\n", uf->file, uf->reason);
+      continue;
+    }
+
+    for (j = 0; j < smartlist_len(uf->names); j++)
+    {
+      char *name = strdup (smartlist_get(uf->names, j));
+      char *eq   = strchr (name, '=');
+
+      if (eq)
+         *eq = '\0';
+      if (!strmap_get(names, name))
+         strmap_set (names, name, uf);
+      free (name);
+    }
+    smartlist_add (todo, uf);
+  }
+
+  smartlist_sort (todo, compare_size);
+  for (i = 0; i < smartlist_len(todo); i++)
+  {
+    const unity_file *uf = smartlist_get (todo, i);
+    unity_batch      *b  = NULL;
+
+    for (j = 0; j < smartlist_len(plan->batches); j++)
+    {
+      b = smartlist_get (plan->batches, j);
+      if (b->size + uf->size <= batch_size)
+         break;
+      b = NULL;
+    }
+    if (!b)
+    {
+      b = calloc (1, sizeof(*b));
+      assert (b);
+      b->files = smartlist_new();
+      smartlist_add (plan->batches, b);
+    }
+    smartlist_add (b->files, strdup(uf->file));
+    b->size += uf->size;
+  }
+
+  for (i = 0; i < smartlist_len(plan->batches); i++)
+  {
+    unity_batch *b = smartlist_get (plan->batches, i);
+
+    smartlist_sort (b->files, smartlist_compare_strings);
+    DEBUG (1, "Unity batch %d: %d files, %llu bytes.\n", i + 1, smartlist_len(b->files), (unsigned long long)b->size);
+  }
+
+  for (i = 0; i < num; i++)
+      smartlist_free_all (ufs[i].names);
+  free (ufs);
+  smartlist_free (todo);
+  strmap_free (names, NULL);
+  return (plan);
+}
+
+void unity_plan_free (unity_plan *plan)
+{
+  int i;
+
+  if (!plan)
+     return;
+
+  for (i = 0; i < smartlist_len(plan->batches); i++)
+  {
+    unity_batch *b = smartlist_get (plan->batches, i);
+
+    smartlist_free_all (b->files);
+    free (b);
+  }
+  for (i = 0; i < smartlist_len(plan->excluded); i++)
+  {
+    unity_excluded *ex = smartlist_get (plan->excluded, i);
+
+    free (ex->file);
+    free (ex->reason);
+    free (ex);
+  }
+  smartlist_free (plan->batches);
+  smartlist_free (plan->excluded);
+  free (plan);
+}
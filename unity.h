@@ -0,0 +1,33 @@
+#ifndef _UNITY_H
+#define _UNITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smartlist.h"
+
+/*
+ * A 'unity_N.c' file; '#include'-ing all the 'files'.
+ */
+typedef struct unity_batch {
+        smartlist_t *files;
+        uint64_t     size;
+      } unity_batch;
+
+/*
+ * A source that can not be in a batch.
+ */
+typedef struct unity_excluded {
+        char *file;
+        char *reason;
+      } unity_excluded;
+
+typedef struct unity_plan {
+        smartlist_t *batches;    /* 'unity_batch*' */
+        smartlist_t *excluded;   /* 'unity_excluded*' */
+      } unity_plan;
+
+unity_plan *unity_plan_new (const char *base, const smartlist_t *files, const smartlist_t *exclude, uint64_t batch_size);
+void        unity_plan_free (unity_plan *plan);
+
+#endif
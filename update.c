@@ -0,0 +1,240 @@
+/*
+ * Update the generated regions of a hand-edited makefile for the gen-make program.
+ *
+ * The template puts the parts that depend on the files found between two
+ * marker lines:
+ *   #! gen-make begin sources
+ *   SOURCES = ...
+ *   #! gen-make end sources
+ *
+ * 'update_regions()' streams through an existing makefile and copies it
+ * as-is; except the lines inside each region. These are replaced by the
+ * same region from a freshly generated makefile. The markers themselves,
+ * and everything outside them, are kept byte for byte (a CRLF file stays
+ * CRLF). The file is only rewritten if a region changed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "gen-make.h"
+#include "scanner.h"
+#include "smartlist.h"
+#include "strmap.h"
+#include "outbuf.h"
+#include "update.h"
+
+#define MAX_NAME  100
+
+typedef struct region {
+        char        name [MAX_NAME];
+        const char *body;   /* the lines after the begin-marker */
+        size_t      len;    /* up to the end-marker */
+        bool        used;
+      } region;
+
+/*
+ * If the line 'p' to 'eol' is a 'marker' line, copy the region name to
+ * 'name' and return true.
+ */
+static bool is_marker (const char *p, const char *eol, const char *marker, char *name)
+{
+  size_t len = strlen (marker);
+  size_t i = 0;
+
+  while (p < eol && (*p == ' ' || *p == '\t'))
+     p++;
+  if ((size_t)(eol - p) <= len || strncmp(p, marker, len))
+     return (false);
+
+  for (p += len; p < eol && *p != ' ' && *p != '\t' && i < MAX_NAME - 1; p++)
+      name [i++] = *p;
+  name [i] = '\0';
+  return (i > 0);
+}
+
+/*
+ * Return the next line in 'p' to 'end'. Set '*eol' to where the line ends;
+ * before the '\r\n' or '\n'.
+ */
+static const char *next_line (const char *p, const char *end, const char **eol)
+{
+  const char *nl = memchr (p, '\n', end - p);
+
+  if (!nl)
+  {
+    *eol = end;
+    return (end);
+  }
+  *eol = (nl > p && nl[-1] == '\r') ? nl - 1 : nl;
+  return (nl + 1);
+}
+
+/*
+ * Collect the regions of the generated makefile into 'all' and 'regions'.
+ */
+static bool fresh_regions (const out_buf *fresh, smartlist_t *all, strmap_t *regions)
+{
+  const char *p = fresh->data;
+  const char *end = fresh->data + fresh->size;
+  const char *eol, *next;
+  region     *r = NULL;
+  char        name [MAX_NAME];
+
+  for ( ; p < end; p = next)
+  {
+    next = next_line (p, end, &eol);
+    if (!r && is_marker(p, eol, UPDATE_BEGIN, name))
+    {
+      r = calloc (1, sizeof(*r));
+      assert (r);
+      r->body = next;
+      strcpy (r->name, name);
+      smartlist_add (all, r);
+    }
+    else if (r && is_marker(p, eol, UPDATE_END, name) && !strcmp(name, r->name))
+    {
+      r->len = p - r->body;
+      strmap_set (regions, r->name, r);
+      r = NULL;
+    }
+  }
+  if (r)
+  {
+    fprintf (stderr, "The template has no '%s%s'.\n", UPDATE_END, r->name);
+    return (false);
+  }
+  return (true);
+}
+
+/*
+ * Add the 'len' bytes of 'text'. With a '\r\n' for each '\n' if 'crlf'.
+ */
+static void add_text (out_buf *out, const char *text, size_t len, bool crlf)
+{
+  const char *end = text + len;
+  const char *nl;
+
+  if (!crlf)
+  {
+    buf_add (out, text, len);
+    return;
+  }
+  while (text < end && (nl = memchr(text, '\n', end - text)) != NULL)
+  {
+    buf_add (out, text, nl - text);
+    if (nl == text || nl[-1] != '\r')
+       buf_putc (out, '\r');
+    buf_putc (out, '\n');
+    text = nl + 1;
+  }
+  buf_add (out, text, end - text);
+}
+
+/*
+ * Replace the regions in 'fname' with those in 'fresh'; the generated makefile.
+ */
+bool update_regions (const char *fname, const out_buf *fresh)
+{
+  smartlist_t *all;
+  strmap_t    *regions;
+  mapped_file  mf;
+  out_buf      out, text;
+  const char  *p, *end, *eol, *next, *start = NULL;
+  region      *r;
+  char         name [MAX_NAME], cur [MAX_NAME];
+  unsigned     line = 0, start_line = 0;
+  int          i, num_changed = 0;
+  bool         crlf = false, rc = false, changed;
+
+  if (!map_file(fname, &mf))
+  {
+    fprintf (stderr, "Failed to read '%s'.\n", fname);
+    return (false);
+  }
+
+  all     = smartlist_new();
+  regions = strmap_new (false);
+  memset (&out, '\0', sizeof(out));
+  memset (&text, '\0', sizeof(text));
+
+  if (!fresh_regions(fresh, all, regions))
+     goto quit;
+
+  end = mf.data + mf.size;
+  for (p = mf.data; p < end; p = next)
+  {
+    next = next_line (p, end, &eol);
+    line++;
+
+    if (!start)
+    {
+      buf_add (&out, p, next - p);
+      if (is_marker(p, eol, UPDATE_BEGIN, cur))
+      {
+        start      = next;
+        start_line = line;
+        crlf       = (eol < next && *eol == '\r');
+      }
+      continue;
+    }
+
+    if (is_marker(p, eol, UPDATE_BEGIN, name))
+    {
+      fprintf (stderr, "%s(%u): '%s%s' inside region '%s'.\n", fname, line, UPDATE_BEGIN, name, cur);
+      goto quit;
+    }
+    if (!is_marker(p, eol, UPDATE_END, name) || strcmp(name, cur))
+       continue;
+
+    r = strmap_get (regions, cur);
+    if (r)
+    {
+      r->used = true;
+      text.size = 0;
+      add_text (&text, r->body, r->len, crlf);
+      if (text.size != (size_t)(p - start) || memcmp(text.data, start, text.size))
+      {
+        DEBUG (1, "%s(%u): region '%s' changed.\n", fname, start_line, cur);
+        num_changed++;
+      }
+      buf_add (&out, text.data, text.size);
+    }
+    else
+    {
+      fprintf (stderr, "%s(%u): the template has no region '%s'; kept as is.\n", fname, start_line, cur);
+      buf_add (&out, start, p - start);
+    }
+    buf_add (&out, p, next - p);
+    start = NULL;
+  }
+
+  if (start)
+  {
+    fprintf (stderr, "%s(%u): no '%s%s'.\n", fname, start_line, UPDATE_END, cur);
+    goto quit;
+  }
+  for (i = 0; i < smartlist_len(all); i++)
+  {
+    r = smartlist_get (all, i);
+    if (!r->used)
+       fprintf (stderr, "Region '%s' is not in '%s'; add a '%s%s' and '%s%s' to get it.\n",
+                r->name, fname, UPDATE_BEGIN, r->name, UPDATE_END, r->name);
+  }
+
+  unmap_file (&mf);
+  rc = buf_write_file (&out, fname, &changed);
+  if (rc && changed)
+     fprintf (stderr, "Updated %d region(s) in '%s'.\n", num_changed, fname);
+  else if (rc)
+     fprintf (stderr, "'%s' is unchanged.\n", fname);
+
+quit:
+  unmap_file (&mf);
+  strmap_free (regions, NULL);
+  smartlist_free_all (all);
+  buf_free (&text);
+  buf_free (&out);
+  return (rc);
+}
@@ -0,0 +1,16 @@
+#ifndef _UPDATE_H
+#define _UPDATE_H
+
+#include <stdbool.h>
+
+#include "outbuf.h"
+
+/*
+ * The lines around a region of generated text in a makefile.
+ */
+#define UPDATE_BEGIN  "#! gen-make begin "
+#define UPDATE_END    "#! gen-make end "
+
+bool update_regions (const char *fname, const out_buf *fresh);
+
+#endif